@@ -1497,8 +1497,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 								"Table Function Call", planstate, ancestors,
 								es->verbose, es);
 			}
+			show_scan_qual(((TableFuncScan *) plan)->rowqual, "Row Filter",
+						   planstate, ancestors, es);
 			show_scan_qual(plan->qual, "Filter", planstate, ancestors, es);
-			if (plan->qual)
+			if (plan->qual || ((TableFuncScan *) plan)->rowqual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
 			break;
@@ -2694,7 +2696,8 @@ ExplainTargetRel(Plan *plan, Index rti, ExplainState *es)
 			break;
 		case T_TableFuncScan:
 			Assert(rte->rtekind == RTE_TABLEFUNC);
-			objectname = "xmltable";
+			objectname = rte->tablefunc->functype == TFT_JSON_TABLE ?
+				"json_table" : "xmltable";
 			objecttag = "Table Function Name";
 			break;
 		case T_ValuesScan:
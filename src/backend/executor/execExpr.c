@@ -45,6 +45,7 @@
 #include "utils/builtins.h"
 #include "utils/jsonpath.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/typcache.h"
 
 
@@ -73,6 +74,7 @@ static bool isAssignmentIndirectionExpr(Expr *expr);
 static void ExecInitCoerceToDomain(ExprEvalStep *scratch, CoerceToDomain *ctest,
 					   PlanState *parent, ExprState *state,
 					   Datum *resv, bool *resnull);
+static bool get_exec_params_walker(Node *node, List **params);
 
 
 /*
@@ -2016,6 +2018,7 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 			{
 				JsonExpr   *jexpr = castNode(JsonExpr, node);
 				int			nargs;
+				int			i;
 
 				scratch.opcode = EEOP_JSONEXPR;
 				scratch.d.jsonexpr.jsexpr = jexpr;
@@ -2039,6 +2042,33 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 				scratch.d.jsonexpr.default_on_error =
 					ExecInitExpr((Expr *) jexpr->on_error.default_expr, parent);
 
+				scratch.d.jsonexpr.path = NULL;
+				scratch.d.jsonexpr.path_spec = NULL;
+				scratch.d.jsonexpr.pathcache = NULL;
+
+				/* JSON_TABLE executes its paths itself */
+				if (jexpr->op != IS_JSON_TABLE)
+				{
+					if (IsA(jexpr->path_spec, Const) &&
+						!((Const *) jexpr->path_spec)->constisnull)
+					{
+						Const	   *path = (Const *) jexpr->path_spec;
+
+						/* compile the path once instead of decoding it every row */
+						scratch.d.jsonexpr.path =
+							jspCompile(DatumGetJsonPath(path->constvalue),
+									   CurrentMemoryContext);
+					}
+					else
+					{
+						/* other paths are compiled when they are evaluated */
+						scratch.d.jsonexpr.path_spec =
+							ExecInitExpr((Expr *) jexpr->path_spec, parent);
+						scratch.d.jsonexpr.pathcache =
+							JsonPathCacheCreate(CurrentMemoryContext);
+					}
+				}
+
 				if (jexpr->coerce_via_io || jexpr->omit_quotes)
 				{
 					Oid			typinput;
@@ -2065,16 +2095,7 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 						Value	   *argname = (Value *) lfirst(argnamelc);
 						JsonPathVariableEvalContext *var = palloc(sizeof(*var));
 
-						var->var.varName = cstring_to_text(argname->val.str);
-						var->var.typid = exprType((Node *) argexpr);
-						var->var.typmod = exprTypmod((Node *) argexpr);
-						var->var.cb = EvalJsonPathVar;
-						var->var.cb_arg = var;
-						var->estate = ExecInitExpr(argexpr, parent);
-						var->econtext = NULL;
-						var->evaluated = false;
-						var->value = (Datum) 0;
-						var->isnull = true;
+						InitJsonPathVar(var, argname->val.str, argexpr, parent);
 
 						scratch.d.jsonexpr.args =
 										lappend(scratch.d.jsonexpr.args, var);
@@ -2083,6 +2104,32 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 
 				scratch.d.jsonexpr.cache = NULL;
 
+				/*
+				 * Share the context item with the preceding JsonExprs of the
+				 * same context item expression.
+				 */
+				scratch.d.jsonexpr.doccache = NULL;
+
+				for (i = 0; i < state->steps_len; i++)
+				{
+					ExprEvalStep *prev = &state->steps[i];
+
+					if (prev->opcode == EEOP_JSONEXPR &&
+						equal(prev->d.jsonexpr.jsexpr->raw_expr,
+							  jexpr->raw_expr) &&
+						equal(prev->d.jsonexpr.jsexpr->formatted_expr,
+							  jexpr->formatted_expr) &&
+						!contain_volatile_functions(jexpr->raw_expr))
+					{
+						scratch.d.jsonexpr.doccache = prev->d.jsonexpr.doccache;
+						break;
+					}
+				}
+
+				if (!scratch.d.jsonexpr.doccache)
+					scratch.d.jsonexpr.doccache =
+						palloc0(sizeof(*scratch.d.jsonexpr.doccache));
+
 				memset(&scratch.d.jsonexpr.scalar, 0,
 					   sizeof(scratch.d.jsonexpr.scalar));
 
@@ -2755,3 +2802,89 @@ ExecInitCoerceToDomain(ExprEvalStep *scratch, CoerceToDomain *ctest,
 		}
 	}
 }
+
+/*
+ * Prepare a SQL/JSON PASSING argument for evaluation.
+ *
+ * An argument not depending on the current row is evaluated only once per
+ * execution of the plan, and again only when the PARAM_EXEC Params it refers
+ * to change, e.g. on rescans of the inner side of a nested loop.  Expressions
+ * without a plan, like simple expressions of PL/pgSQL, may be evaluated many
+ * times with different values of PARAM_EXTERN Params, so their arguments
+ * are evaluated every time.
+ */
+void
+InitJsonPathVar(JsonPathVariableEvalContext *var, const char *name,
+				Expr *expr, PlanState *parent)
+{
+	var->var.varName = cstring_to_text(name);
+	var->var.typid = exprType((Node *) expr);
+	var->var.typmod = exprTypmod((Node *) expr);
+	var->var.cb = EvalJsonPathVar;
+	var->var.cb_arg = var;
+	var->estate = ExecInitExpr(expr, parent);
+	var->econtext = NULL;
+	var->evaluated = false;
+	var->value = (Datum) 0;
+	var->isnull = true;
+	var->cache = NULL;
+
+	if (parent && is_execution_invariant_clause((Node *) expr))
+	{
+		JsonPathVariableCache *cache;
+		List	   *params = NIL;
+		ListCell   *lc;
+		int			i = 0;
+
+		(void) get_exec_params_walker((Node *) expr, &params);
+
+		cache = palloc(offsetof(JsonPathVariableCache, params) +
+					   sizeof(JsonPathVariableParam) * list_length(params));
+		cache->mcxt = AllocSetContextCreate(CurrentMemoryContext,
+											"JSON PASSING argument",
+											ALLOCSET_SMALL_SIZES);
+		get_typlenbyval(var->var.typid, &cache->typlen, &cache->typbyval);
+		cache->nparams = list_length(params);
+
+		foreach(lc, params)
+		{
+			Param	   *param = lfirst(lc);
+			JsonPathVariableParam *p = &cache->params[i++];
+
+			p->paramid = param->paramid;
+			get_typlenbyval(param->paramtype, &p->typlen, &p->typbyval);
+			p->isnull = true;
+			p->value = (Datum) 0;
+		}
+
+		var->cache = cache;
+	}
+}
+
+/*
+ * Collect distinct PARAM_EXEC Params of an expression.
+ */
+static bool
+get_exec_params_walker(Node *node, List **params)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, Param) && ((Param *) node)->paramkind == PARAM_EXEC)
+	{
+		Param	   *param = (Param *) node;
+		ListCell   *lc;
+
+		foreach(lc, *params)
+		{
+			if (((Param *) lfirst(lc))->paramid == param->paramid)
+				return false;
+		}
+
+		*params = lappend(*params, param);
+		return false;
+	}
+
+	return expression_tree_walker(node, get_exec_params_walker,
+								  (void *) params);
+}
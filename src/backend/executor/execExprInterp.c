@@ -71,10 +71,14 @@
 #include "pgstat.h"
 #include "utils/builtins.h"
 #include "utils/date.h"
+#include "utils/datum.h"
+#include "utils/int8.h"
 #include "utils/jsonapi.h"
 #include "utils/jsonb.h"
 #include "utils/jsonpath.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/numeric.h"
 #include "utils/timestamp.h"
 #include "utils/typcache.h"
 #include "utils/xml.h"
@@ -3576,14 +3580,39 @@ ExecEvalWholeRowVar(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
 	*op->resnull = false;
 }
 
+/*
+ * Check whether the error caught by PG_CATCH() is a data error which can be
+ * returned in *error, if it is not NULL, and flush it.  Other errors have to
+ * be rethrown.
+ */
+static bool
+ExecCatchJsonDataError(MemoryContext mcxt, bool *error)
+{
+	if (!error || ERRCODE_TO_CATEGORY(geterrcode()) != ERRCODE_DATA_EXCEPTION)
+		return false;
+
+	FlushErrorState();
+	MemoryContextSwitchTo(mcxt);
+
+	*error = true;
+
+	return true;
+}
+
+/*
+ * Evaluate expression with the given CASE test value.  Data errors are
+ * returned in *error, if it is not NULL.
+ */
 static Datum
 ExecEvalExprPassingCaseValue(ExprState *estate, ExprContext *econtext,
 							 bool *isnull,
-							 Datum caseval_datum, bool caseval_isnull)
+							 Datum caseval_datum, bool caseval_isnull,
+							 bool *error)
 {
 	Datum		res;
 	Datum		save_datum = econtext->caseValue_datum;
 	bool		save_isNull = econtext->caseValue_isNull;
+	MemoryContext mcxt = CurrentMemoryContext;
 
 	econtext->caseValue_datum = caseval_datum;
 	econtext->caseValue_isNull = caseval_isnull;
@@ -3597,7 +3626,11 @@ ExecEvalExprPassingCaseValue(ExprState *estate, ExprContext *econtext,
 		econtext->caseValue_datum = save_datum;
 		econtext->caseValue_isNull = save_isNull;
 
-		PG_RE_THROW();
+		if (!ExecCatchJsonDataError(mcxt, error))
+			PG_RE_THROW();
+
+		*isnull = true;
+		res = (Datum) 0;
 	}
 	PG_END_TRY();
 
@@ -3609,7 +3642,8 @@ ExecEvalExprPassingCaseValue(ExprState *estate, ExprContext *econtext,
 
 static Datum
 ExecEvalJsonBehavior(ExprContext *econtext, JsonBehavior *behavior,
-					 ExprState *default_estate, bool is_jsonb, bool *is_null)
+					 ExprState *default_estate, bool is_jsonb, bool *is_null,
+					 bool *error)
 {
 	*is_null = false;
 
@@ -3633,10 +3667,21 @@ ExecEvalJsonBehavior(ExprContext *econtext, JsonBehavior *behavior,
 
 		case JSON_BEHAVIOR_NULL:
 		case JSON_BEHAVIOR_UNKNOWN:
+		case JSON_BEHAVIOR_EMPTY:	/* NULL document gives empty JSON_TABLE */
 			*is_null = true;
 			return (Datum) 0;
 
 		case JSON_BEHAVIOR_DEFAULT:
+			if (error)
+			{
+				/* catch errors without changing CASE test value */
+				return ExecEvalExprPassingCaseValue(default_estate, econtext,
+													is_null,
+													econtext->caseValue_datum,
+													econtext->caseValue_isNull,
+													error);
+			}
+
 			return ExecEvalExpr(default_estate, econtext, is_null);
 
 		default:
@@ -3645,15 +3690,72 @@ ExecEvalJsonBehavior(ExprContext *econtext, JsonBehavior *behavior,
 	}
 }
 
+/*
+ * Convert jsonb result into json, if the context item is json.
+ */
+static Datum
+JsonbToFormattedDatum(Jsonb *jb, bool isjsonb)
+{
+	if (isjsonb)
+		return JsonbGetDatum(jb);
+
+	return PointerGetDatum(cstring_to_text(JsonbToCString(NULL, &jb->root,
+														  VARSIZE(jb))));
+}
+
+/*
+ * Coerce the result to the output type.  Data errors are returned in *error,
+ * if it is not NULL.
+ */
 static Datum
 ExecEvalJsonExprCoercion(ExprEvalStep *op, ExprContext *econtext,
-						 Datum res, bool *isNull)
+						 Datum res, bool isjsonb, bool *isNull, bool *error)
 {
 	JsonExpr   *jexpr = op->d.jsonexpr.jsexpr;
-	Jsonb	   *jb = *isNull ? NULL : DatumGetJsonb(res);
+	Jsonb	   *jb = NULL;
+
+	/*
+	 * Errors of input functions and of json_populate_type() have to be
+	 * caught, the coercion expression catches its errors itself.
+	 */
+	if (error &&
+		(jexpr->coerce_via_io || jexpr->omit_quotes ||
+		 jexpr->coerce_via_populate))
+	{
+		MemoryContext mcxt = CurrentMemoryContext;
+
+		PG_TRY();
+		{
+			res = ExecEvalJsonExprCoercion(op, econtext, res, isjsonb,
+										   isNull, NULL);
+		}
+		PG_CATCH();
+		{
+			if (!ExecCatchJsonDataError(mcxt, error))
+				PG_RE_THROW();
+
+			*isNull = true;
+			res = (Datum) 0;
+		}
+		PG_END_TRY();
+
+		return res;
+	}
+
+	if (!*isNull && (jexpr->coerce_via_io || jexpr->omit_quotes))
+	{
+		if (isjsonb)
+			jb = DatumGetJsonb(res);
+		else
+		{
+			text	   *js = DatumGetTextPP(res);
+
+			jb = JsonbFromCStringLen(VARDATA_ANY(js), VARSIZE_ANY_EXHDR(js));
+		}
+	}
 
 	if (jexpr->coerce_via_io ||
-		(jexpr->omit_quotes && !*isNull && JB_ROOT_IS_SCALAR(jb)))
+		(jexpr->omit_quotes && jb && JB_ROOT_IS_SCALAR(jb)))
 	{
 		char *str = *isNull ? NULL : JsonbUnquote(jb);
 
@@ -3663,9 +3765,9 @@ ExecEvalJsonExprCoercion(ExprEvalStep *op, ExprContext *econtext,
 	}
 	else if (op->d.jsonexpr.result_expr)
 		res = ExecEvalExprPassingCaseValue(op->d.jsonexpr.result_expr, econtext,
-										   isNull, res, *isNull);
+										   isNull, res, *isNull, error);
 	else if (jexpr->coerce_via_populate)
-		res = json_populate_type(res, JSONBOID,
+		res = json_populate_type(res, isjsonb ? JSONBOID : JSONOID,
 								 jexpr->returning.typid,
 								 jexpr->returning.typmod,
 								 &op->d.jsonexpr.cache,
@@ -3675,14 +3777,86 @@ ExecEvalJsonExprCoercion(ExprEvalStep *op, ExprContext *econtext,
 	return res;
 }
 
+/*
+ * Prepare a PASSING argument for the next evaluation of the path.  The kept
+ * value of an invariant argument is used unless the PARAM_EXEC Params it
+ * refers to have changed since it was computed.
+ */
+void
+ResetJsonPathVar(JsonPathVariableEvalContext *var)
+{
+	JsonPathVariableCache *cache = var->cache;
+	int			i;
+
+	if (!cache || !var->evaluated)
+	{
+		var->evaluated = false;
+		return;
+	}
+
+	for (i = 0; i < cache->nparams; i++)
+	{
+		JsonPathVariableParam *p = &cache->params[i];
+		ParamExecData *prm = &var->econtext->ecxt_param_exec_vals[p->paramid];
+
+		if (prm->execPlan != NULL ||
+			prm->isnull != p->isnull ||
+			(!p->isnull &&
+			 !datumIsEqual(prm->value, p->value, p->typbyval, p->typlen)))
+		{
+			var->evaluated = false;
+			return;
+		}
+	}
+}
+
 Datum
 EvalJsonPathVar(void *cxt, bool *isnull)
 {
 	JsonPathVariableEvalContext *ecxt = cxt;
+	JsonPathVariableCache *cache = ecxt->cache;
 
 	if (!ecxt->evaluated)
 	{
-		ecxt->value = ExecEvalExpr(ecxt->estate, ecxt->econtext, &ecxt->isnull);
+		MemoryContext oldcxt;
+		int			i;
+
+		if (!cache)
+		{
+			ecxt->value = ExecEvalExpr(ecxt->estate, ecxt->econtext,
+									   &ecxt->isnull);
+			ecxt->evaluated = true;
+
+			*isnull = ecxt->isnull;
+			return ecxt->value;
+		}
+
+		/*
+		 * Invariant value must survive the resets of per-tuple memory, and
+		 * the memory of the Params it may point to.
+		 */
+		MemoryContextReset(cache->mcxt);
+		oldcxt = MemoryContextSwitchTo(cache->mcxt);
+
+		ecxt->value = ExecEvalExpr(ecxt->estate, ecxt->econtext,
+								   &ecxt->isnull);
+		if (!ecxt->isnull)
+			ecxt->value = datumCopy(ecxt->value, cache->typbyval,
+									cache->typlen);
+
+		for (i = 0; i < cache->nparams; i++)
+		{
+			JsonPathVariableParam *p = &cache->params[i];
+			ParamExecData *prm =
+				&ecxt->econtext->ecxt_param_exec_vals[p->paramid];
+
+			p->isnull = prm->isnull;
+			p->value = prm->isnull ? (Datum) 0 :
+				datumCopy(prm->value, p->typbyval, p->typlen);
+		}
+
+		MemoryContextSwitchTo(oldcxt);
+
 		ecxt->evaluated = true;
 	}
 
@@ -3690,239 +3864,801 @@ EvalJsonPathVar(void *cxt, bool *isnull)
 	return ecxt->value;
 }
 
-/* ----------------------------------------------------------------
- *		ExecEvalJson
- * ----------------------------------------------------------------
+/*
+ * Variants of the casts and input functions of common JSON_VALUE output
+ * types returning errors in *error instead of throwing them, so NULL or
+ * DEFAULT ON ERROR need not catch errors of the coercion.
  */
-void
-ExecEvalJson(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
+static Datum
+JsonNumericToInt2(Datum value, bool *error)
+{
+	return Int16GetDatum(numeric_int2_opt_error(DatumGetNumeric(value),
+												error));
+}
+
+static Datum
+JsonNumericToInt4(Datum value, bool *error)
+{
+	return Int32GetDatum(numeric_int4_opt_error(DatumGetNumeric(value),
+												error));
+}
+
+static Datum
+JsonNumericToInt8(Datum value, bool *error)
+{
+	return Int64GetDatum(numeric_int8_opt_error(DatumGetNumeric(value),
+												error));
+}
+
+static Datum
+JsonNumericToFloat4(Datum value, bool *error)
+{
+	float8		val = numeric_float8_opt_error(DatumGetNumeric(value), error);
+
+	return Float4GetDatum(*error ? 0 : float8_float4_opt_error(val, error));
+}
+
+static Datum
+JsonNumericToFloat8(Datum value, bool *error)
+{
+	return Float8GetDatum(numeric_float8_opt_error(DatumGetNumeric(value),
+												   error));
+}
+
+static Datum
+JsonBoolToInt4(Datum value, bool *error)
+{
+	return Int32GetDatum(DatumGetBool(value) ? 1 : 0);
+}
+
+static Datum
+JsonTimestampToDate(Datum value, bool *error)
+{
+	return DateADTGetDatum(timestamp2date_opt_error(DatumGetTimestamp(value),
+													error));
+}
+
+static Datum
+JsonTimestampTzToDate(Datum value, bool *error)
+{
+	return DateADTGetDatum(timestamptz2date_opt_error(DatumGetTimestampTz(value),
+													  error));
+}
+
+static Datum
+JsonDateToTimestamp(Datum value, bool *error)
+{
+	return TimestampGetDatum(date2timestamp_opt_error(DatumGetDateADT(value),
+													  error));
+}
+
+static Datum
+JsonTimestampTzToTimestamp(Datum value, bool *error)
+{
+	return TimestampGetDatum(
+		timestamptz2timestamp_opt_error(DatumGetTimestampTz(value), error));
+}
+
+static Datum
+JsonDateToTimestampTz(Datum value, bool *error)
+{
+	return TimestampTzGetDatum(date2timestamptz_opt_error(DatumGetDateADT(value),
+														  error));
+}
+
+static Datum
+JsonTimestampToTimestampTz(Datum value, bool *error)
+{
+	return TimestampTzGetDatum(
+		timestamp2timestamptz_opt_error(DatumGetTimestamp(value), error));
+}
+
+static Datum
+JsonInputInt2(char *str, bool *error)
+{
+	int64		val;
+
+	if (!scanint8(str, true, &val) || val < PG_INT16_MIN || val > PG_INT16_MAX)
+	{
+		*error = true;
+		return (Datum) 0;
+	}
+
+	return Int16GetDatum((int16) val);
+}
+
+static Datum
+JsonInputInt4(char *str, bool *error)
+{
+	int64		val;
+
+	if (!scanint8(str, true, &val) || val < PG_INT32_MIN || val > PG_INT32_MAX)
+	{
+		*error = true;
+		return (Datum) 0;
+	}
+
+	return Int32GetDatum((int32) val);
+}
+
+static Datum
+JsonInputInt8(char *str, bool *error)
+{
+	int64		val;
+
+	if (!scanint8(str, true, &val))
+	{
+		*error = true;
+		return (Datum) 0;
+	}
+
+	return Int64GetDatum(val);
+}
+
+static Datum
+JsonInputFloat4(char *str, bool *error)
+{
+	float8		val = float8in_internal_opt_error(str, NULL, "real", str,
+												  error);
+
+	return Float4GetDatum(*error ? 0 : float8_float4_opt_error(val, error));
+}
+
+static Datum
+JsonInputFloat8(char *str, bool *error)
+{
+	return Float8GetDatum(float8in_internal_opt_error(str, NULL,
+													  "double precision", str,
+													  error));
+}
+
+static Datum
+JsonInputNumeric(char *str, bool *error)
+{
+	return NumericGetDatum(numeric_in_opt_error(str, error));
+}
+
+static Datum
+JsonInputBool(char *str, bool *error)
+{
+	size_t		len;
+	bool		result;
+
+	/* skip leading and trailing whitespace like boolin() */
+	while (isspace((unsigned char) *str))
+		str++;
+
+	len = strlen(str);
+	while (len > 0 && isspace((unsigned char) str[len - 1]))
+		len--;
+
+	if (!parse_bool_with_len(str, len, &result))
+	{
+		*error = true;
+		return (Datum) 0;
+	}
+
+	return BoolGetDatum(result);
+}
+
+static Datum
+JsonInputDate(char *str, bool *error)
+{
+	return DateADTGetDatum(date_in_opt_error(str, error));
+}
+
+static Datum
+JsonInputTimestamp(char *str, bool *error)
+{
+	return TimestampGetDatum(timestamp_in_opt_error(str, error));
+}
+
+static Datum
+JsonInputTimestampTz(char *str, bool *error)
+{
+	return TimestampTzGetDatum(timestamptz_in_opt_error(str, error));
+}
+
+static Datum
+JsonInputText(char *str, bool *error)
+{
+	return PointerGetDatum(cstring_to_text(str));
+}
+
+/*
+ * Casts of SQL/JSON scalar items to common JSON_VALUE output types which can
+ * be performed by calling the cast function directly, without building and
+ * evaluating a coercion expression.
+ */
+static const struct
+{
+	Oid			targettype;
+	Oid			sourcetype;
+	PGFunction	func;
+	Datum		(*func_opt_error) (Datum value, bool *error);
+}			JsonValueDirectCasts[] =
+{
+	{INT2OID, NUMERICOID, numeric_int2, JsonNumericToInt2},
+	{INT4OID, NUMERICOID, numeric_int4, JsonNumericToInt4},
+	{INT8OID, NUMERICOID, numeric_int8, JsonNumericToInt8},
+	{FLOAT4OID, NUMERICOID, numeric_float4, JsonNumericToFloat4},
+	{FLOAT8OID, NUMERICOID, numeric_float8, JsonNumericToFloat8},
+	{INT4OID, BOOLOID, bool_int4, JsonBoolToInt4},
+	{DATEOID, TIMESTAMPOID, timestamp_date, JsonTimestampToDate},
+	{DATEOID, TIMESTAMPTZOID, timestamptz_date, JsonTimestampTzToDate},
+	{TIMESTAMPOID, DATEOID, date_timestamp, JsonDateToTimestamp},
+	{TIMESTAMPOID, TIMESTAMPTZOID, timestamptz_timestamp,
+	 JsonTimestampTzToTimestamp},
+	{TIMESTAMPTZOID, DATEOID, date_timestamptz, JsonDateToTimestampTz},
+	{TIMESTAMPTZOID, TIMESTAMPOID, timestamp_timestamptz,
+	 JsonTimestampToTimestampTz}
+};
+
+/* Input functions of common JSON_VALUE output types returning errors */
+static const struct
+{
+	Oid			targettype;
+	Datum		(*func_opt_error) (char *str, bool *error);
+}			JsonValueInputs[] =
+{
+	{INT2OID, JsonInputInt2},
+	{INT4OID, JsonInputInt4},
+	{INT8OID, JsonInputInt8},
+	{FLOAT4OID, JsonInputFloat4},
+	{FLOAT8OID, JsonInputFloat8},
+	{NUMERICOID, JsonInputNumeric},
+	{BOOLOID, JsonInputBool},
+	{DATEOID, JsonInputDate},
+	{TIMESTAMPOID, JsonInputTimestamp},
+	{TIMESTAMPTZOID, JsonInputTimestampTz},
+	{TEXTOID, JsonInputText}
+};
+
+static void
+initJsonValueDirectCast(struct JsonScalarCoercionExprState *cestate,
+						JsonReturning *returning, Oid sourcetype)
+{
+	int			i;
+
+	cestate->direct_cast = NULL;
+	cestate->direct_cast_opt_error = NULL;
+	cestate->input_opt_error = NULL;
+
+	/* typmod coercions and domain checks need the full expression */
+	if (returning->typmod >= 0)
+		return;
+
+	if (cestate->coerce_via_io)
+	{
+		for (i = 0; i < lengthof(JsonValueInputs); i++)
+		{
+			if (JsonValueInputs[i].targettype == returning->typid)
+			{
+				cestate->input_opt_error = JsonValueInputs[i].func_opt_error;
+				break;
+			}
+		}
+
+		return;
+	}
+
+	if (!cestate->result_expr)
+		return;
+
+	for (i = 0; i < lengthof(JsonValueDirectCasts); i++)
+	{
+		if (JsonValueDirectCasts[i].targettype == returning->typid &&
+			JsonValueDirectCasts[i].sourcetype == sourcetype)
+		{
+			cestate->direct_cast = JsonValueDirectCasts[i].func;
+			cestate->direct_cast_opt_error =
+				JsonValueDirectCasts[i].func_opt_error;
+			break;
+		}
+	}
+}
+
+/*
+ * Call the input function of the output type, data errors are returned in
+ * *error, if it is not NULL.
+ */
+static Datum
+ExecEvalJsonExprInput(ExprEvalStep *op, char *str, bool *error)
 {
 	JsonExpr   *jexpr = op->d.jsonexpr.jsexpr;
-	Datum		item;
-	Datum		res = (Datum) 0;
-	JsonPath   *path;
-	ListCell   *lc;
-	Oid			formattedType = exprType(jexpr->formatted_expr ?
-										 jexpr->formatted_expr :
-										 jexpr->raw_expr);
-	bool		isjsonb = formattedType == JSONBOID;
 	MemoryContext mcxt = CurrentMemoryContext;
+	Datum		res;
 
-	*op->resnull = true;		/* until we get a result */
-	*op->resvalue = (Datum) 0;
+	if (!error)
+		return InputFunctionCall(&op->d.jsonexpr.input.func, str,
+								 op->d.jsonexpr.input.typioparam,
+								 jexpr->returning.typmod);
 
-	if (op->d.jsonexpr.raw_expr->isnull)
+	PG_TRY();
 	{
-		/* execute domain checks for NULLs */
-		(void) ExecEvalJsonExprCoercion(op, econtext, res, op->resnull);
-		return;
+		res = InputFunctionCall(&op->d.jsonexpr.input.func, str,
+								op->d.jsonexpr.input.typioparam,
+								jexpr->returning.typmod);
 	}
+	PG_CATCH();
+	{
+		if (!ExecCatchJsonDataError(mcxt, error))
+			PG_RE_THROW();
 
-	item = op->d.jsonexpr.raw_expr->value;
+		res = (Datum) 0;
+	}
+	PG_END_TRY();
 
-	path = DatumGetJsonPath(jexpr->path_spec->constvalue);
+	return res;
+}
 
-	foreach(lc, op->d.jsonexpr.args)
+/* Empty the context item cache on reset of its per-tuple memory context */
+static void
+ResetJsonExprDocCache(void *arg)
+{
+	JsonExprDocCache *cache = arg;
+
+	cache->mcxt = NULL;
+	cache->keys = NULL;
+}
+
+/*
+ * Get the formatted context item, json text is converted to jsonb if
+ * tojsonb is true.  The document is cached until the end of the row, so
+ * JsonExprs sharing the cache detoast, format and convert the same context
+ * item only once, and the memo of members looked up in the jsonb document is
+ * returned in *keys.  Nothing is cached if the document is not evaluated in
+ * the per-tuple memory context, because the caller can keep it longer.
+ */
+static Datum
+ExecGetJsonExprDocument(ExprEvalStep *op, ExprContext *econtext, Datum item,
+						bool isjsonb, bool tojsonb, bool *isnull,
+						JsonPathKeyMemo **keys)
+{
+	JsonExprDocCache *cache = op->d.jsonexpr.doccache;
+	MemoryContext mcxt = econtext->ecxt_per_tuple_memory;
+	bool		cached = CurrentMemoryContext == mcxt;
+	Datum		doc;
+	Datum		jb;
+
+	*keys = NULL;
+
+	if (cache->pinned)
 	{
-		JsonPathVariableEvalContext *var = lfirst(lc);
+		/* only the item installed by the owner is cached */
+		if (cache->item == item)
+		{
+			*isnull = false;
+			*keys = cache->keys;
+			return cache->doc;
+		}
 
-		var->econtext = econtext;
-		var->evaluated = false;
+		cached = false;
 	}
 
-	PG_TRY();
+	if (cached && cache->mcxt == mcxt && cache->item == item)
 	{
-		Jsonb	   *jb;
-		bool		empty = false;
+		*isnull = cache->isnull;
+		doc = cache->doc;
+		jb = cache->jsonb;
+	}
+	else
+	{
+		*isnull = false;
+		doc = item;
 
 		if (op->d.jsonexpr.formatted_expr)
+			doc = ExecEvalExprPassingCaseValue(op->d.jsonexpr.formatted_expr,
+											   econtext, isnull, item, false,
+											   NULL);
+
+		if (!*isnull)
+			doc = PointerGetDatum(PG_DETOAST_DATUM(doc));
+
+		jb = isjsonb ? doc : (Datum) 0;
+
+		if (!cache->mcxt && cached)
+		{
+			cache->cb.func = ResetJsonExprDocCache;
+			cache->cb.arg = cache;
+			MemoryContextRegisterResetCallback(mcxt, &cache->cb);
+			cache->mcxt = mcxt;
+		}
+		else if (cache->mcxt != mcxt)
+			cached = false;		/* cache is used by another econtext */
+
+		if (cached)
 		{
-			bool		isnull;
+			cache->item = item;
+			cache->doc = doc;
+			cache->jsonb = jb;
+			cache->isnull = *isnull;
+			cache->keys = NULL;
+		}
+	}
+
+	if (*isnull || !tojsonb)
+		return doc;
 
-			item = ExecEvalExprPassingCaseValue(op->d.jsonexpr.formatted_expr,
-												econtext, &isnull, item, false);
-			if (isnull)
+	if (!jb)
+	{
+		text	   *js = DatumGetTextPP(doc);
+
+		jb = JsonbGetDatum(JsonbFromCStringLen(VARDATA_ANY(js),
+												VARSIZE_ANY_EXHDR(js)));
+		if (cached)
+			cache->jsonb = jb;
+	}
+
+	if (cached)
+	{
+		if (!cache->keys)
+			cache->keys = JsonPathKeyMemoCreate(DatumGetJsonb(jb));
+
+		*keys = cache->keys;
+	}
+
+	return jb;
+}
+
+/*
+ * Evaluate SQL/JSON expression on a non-NULL context item.  Recoverable
+ * jsonpath errors are returned in *error, if it is not NULL, other errors
+ * are thrown.
+ */
+static Datum
+ExecEvalJsonExpr(ExprEvalStep *op, ExprContext *econtext, Datum item,
+				 JsonPathCompiled *path, bool isjsonb, bool *resnull,
+				 bool *error)
+{
+	JsonExpr   *jexpr = op->d.jsonexpr.jsexpr;
+	Datum		res = (Datum) 0;
+	Jsonb	   *jb = NULL;
+	JsonPathIterator *it = NULL;
+	JsonPathKeyMemo *keys;
+	Datum		doc;
+	bool		tojsonb;
+	bool		isnull;
+	bool		empty = false;
+
+	*resnull = true;
+
+	/*
+	 * Simple paths are executed directly on json text.  JSON_TABLE gets json
+	 * text as is, its scan converts the document itself if needed.
+	 */
+	tojsonb = isjsonb ||
+		(jexpr->op != IS_JSON_TABLE && (!path || !path->stream));
+
+	doc = ExecGetJsonExprDocument(op, econtext, item, isjsonb, tojsonb,
+								  &isnull, &keys);
+
+	if (isnull)
+		return ExecEvalJsonExprCoercion(op, econtext, res, isjsonb, resnull,
+										error);
+
+	if (tojsonb)
+		jb = DatumGetJsonb(doc);
+	else if (jexpr->op != IS_JSON_TABLE)
+	{
+		/*
+		 * EXISTS needs only the first item, VALUE and QUERY without wrapper
+		 * only the second one to report an error, if there is one.
+		 */
+		int			limit = jexpr->op == IS_JSON_EXISTS ? 1 :
+			jexpr->op == IS_JSON_QUERY && jexpr->wrapper != JSW_NONE ? 0 : 2;
+
+		it = JsonPathIteratorInitJson(path, DatumGetTextPP(doc), limit);
+	}
+
+	switch (jexpr->op)
+	{
+		case IS_JSON_QUERY:
+			jb = it ?
+				JsonPathIteratorQuery(it, jexpr->wrapper, &empty, error) :
+				JsonbPathQuery(jb, path, jexpr->wrapper, &empty, error,
+							   op->d.jsonexpr.args, keys);
+			if (jb)
 			{
-				(void) ExecEvalJsonExprCoercion(op, econtext, res, op->resnull);
-				return;
+				res = JsonbToFormattedDatum(jb, isjsonb);
+				*resnull = false;
 			}
-		}
+			break;
 
-		jb = DatumGetJsonb(item);
+		case IS_JSON_VALUE:
+			{
+				JsonbValue *jbv = it ?
+					JsonPathIteratorValue(it, &empty, error) :
+					JsonbPathValue(jb, path, &empty, error,
+								   op->d.jsonexpr.args, keys);
+				struct JsonScalarCoercionExprState *cestate;
+				Oid			typid;
+
+				if (!jbv)
+					break;
 
-		switch (jexpr->op)
-		{
-			case IS_JSON_QUERY:
-				jb = JsonbPathQuery(jb, path, jexpr->wrapper, &empty,
-									op->d.jsonexpr.args);
-				if (jb)
+				*resnull = false;
+
+				switch (jbv->type)
 				{
-					res = JsonbGetDatum(jb);
-					*op->resnull = false;
+					case jbvString:
+						cestate = &op->d.jsonexpr.scalar.string;
+						typid = TEXTOID;
+						res = PointerGetDatum(
+							cstring_to_text_with_len(jbv->val.string.val,
+													 jbv->val.string.len));
+						break;
+					case jbvNumeric:
+						cestate = &op->d.jsonexpr.scalar.numeric;
+						typid = NUMERICOID;
+						res = NumericGetDatum(jbv->val.numeric);
+						break;
+					case jbvBool:
+						cestate = &op->d.jsonexpr.scalar.boolean;
+						typid = BOOLOID;
+						res = BoolGetDatum(jbv->val.boolean);
+						break;
+					case jbvDatetime:
+						res = jbv->val.datetime.value;
+						typid = jbv->val.datetime.typid;
+						switch (jbv->val.datetime.typid)
+						{
+							case DATEOID:
+								cestate = &op->d.jsonexpr.scalar.date;
+								break;
+							case TIMEOID:
+								cestate = &op->d.jsonexpr.scalar.time;
+								break;
+							case TIMETZOID:
+								cestate = &op->d.jsonexpr.scalar.timetz;
+								break;
+							case TIMESTAMPOID:
+								cestate = &op->d.jsonexpr.scalar.timestamp;
+								break;
+							case TIMESTAMPTZOID:
+								cestate = &op->d.jsonexpr.scalar.timestamptz;
+								break;
+							default:
+								elog(ERROR, "unexpected jsonb datetime type oid %d",
+									 jbv->val.datetime.typid);
+								cestate = NULL;
+								break;
+						}
+						break;
+					default:
+						elog(ERROR, "unexpected jsonb value type %d",
+							 jbv->type);
+						cestate = NULL;
+						typid = InvalidOid;
+						break;
 				}
-				break;
 
-			case IS_JSON_VALUE:
+				if (!cestate->initialized)
 				{
-					JsonbValue *jbv = JsonbPathValue(jb, path, &empty,
-													 op->d.jsonexpr.args);
-					struct JsonScalarCoercionExprState *cestate;
-					Oid			typid;
+					MemoryContext oldCxt = MemoryContextSwitchTo(
+										econtext->ecxt_per_query_memory);
+					CaseTestExpr *placeholder = makeNode(CaseTestExpr);
 
-					if (!jbv)
-						break;
-
-					*op->resnull = false;
+					placeholder->typeId = typid;
+					placeholder->typeMod = -1;
+					placeholder->collation = InvalidOid;
 
-					switch (jbv->type)
-					{
-						case jbvString:
-							cestate = &op->d.jsonexpr.scalar.string;
-							typid = TEXTOID;
-							res = PointerGetDatum(
-								cstring_to_text_with_len(jbv->val.string.val,
-														 jbv->val.string.len));
-							break;
-						case jbvNumeric:
-							cestate = &op->d.jsonexpr.scalar.numeric;
-							typid = NUMERICOID;
-							res = NumericGetDatum(jbv->val.numeric);
-							break;
-						case jbvBool:
-							cestate = &op->d.jsonexpr.scalar.boolean;
-							typid = BOOLOID;
-							res = BoolGetDatum(jbv->val.boolean);
-							break;
-						case jbvDatetime:
-							res = jbv->val.datetime.value;
-							typid = jbv->val.datetime.typid;
-							switch (jbv->val.datetime.typid)
-							{
-								case DATEOID:
-									cestate = &op->d.jsonexpr.scalar.date;
-									break;
-								case TIMEOID:
-									cestate = &op->d.jsonexpr.scalar.time;
-									break;
-								case TIMETZOID:
-									cestate = &op->d.jsonexpr.scalar.timetz;
-									break;
-								case TIMESTAMPOID:
-									cestate = &op->d.jsonexpr.scalar.timestamp;
-									break;
-								case TIMESTAMPTZOID:
-									cestate = &op->d.jsonexpr.scalar.timestamptz;
-									break;
-								default:
-									elog(ERROR, "unexpected jsonb datetime type oid %d",
-										 jbv->val.datetime.typid);
-									cestate = NULL;
-									break;
-							}
-							break;
-						default:
-							elog(ERROR, "unexpected jsonb value type %d",
-								 jbv->type);
-							cestate = NULL;
-							typid = InvalidOid;
-							break;
-					}
+					cestate->result_expr =
+							coerceJsonFuncExpr(NULL, (Node *) placeholder,
+										&op->d.jsonexpr.jsexpr->returning,
+										false);
 
-					if (!cestate->initialized)
-					{
-						MemoryContext oldCxt = MemoryContextSwitchTo(
-											econtext->ecxt_per_query_memory);
-						CaseTestExpr *placeholder = makeNode(CaseTestExpr);
+					cestate->coerce_via_io = !cestate->result_expr ||
+									IsA(cestate->result_expr, CoerceViaIO);
 
-						placeholder->typeId = typid;
-						placeholder->typeMod = -1;
-						placeholder->collation = InvalidOid;
+					if (cestate->coerce_via_io ||
+						cestate->result_expr == (Node *) placeholder)
+						cestate->result_expr = NULL;
 
-						cestate->result_expr =
-								coerceJsonFuncExpr(NULL, (Node *) placeholder,
+					initJsonValueDirectCast(cestate,
 											&op->d.jsonexpr.jsexpr->returning,
-											false);
-
-						cestate->coerce_via_io = !cestate->result_expr ||
-										IsA(cestate->result_expr, CoerceViaIO);
+											typid);
 
-						if (cestate->coerce_via_io ||
-							cestate->result_expr == (Node *) placeholder)
-							cestate->result_expr = NULL;
+					cestate->result_expr_state = cestate->direct_cast ? NULL :
+						ExecInitExpr((Expr *) cestate->result_expr, NULL);
 
-						cestate->result_expr_state =
-							ExecInitExpr((Expr *) cestate->result_expr, NULL);
+					MemoryContextSwitchTo(oldCxt);
 
-						MemoryContextSwitchTo(oldCxt);
+					cestate->initialized = true;
+				}
 
-						cestate->initialized = true;
-					}
+				if (cestate->direct_cast)
+				{
+					res = error ?
+						cestate->direct_cast_opt_error(res, error) :
+						DirectFunctionCall1(cestate->direct_cast, res);
+				}
+				else if (cestate->coerce_via_io && jexpr->coerce_via_io &&
+						 jbv->type != jbvDatetime)
+				{
+					/* pass unquoted scalar to the input function directly */
+					char	   *str = JsonbValueUnquote(jbv);
 
-					if (cestate->coerce_via_io)
-					{
-						res = JsonbGetDatum(JsonbValueToJsonb(jbv));
-						res = ExecEvalJsonExprCoercion(op, econtext,
-													   res, op->resnull);
-					}
-					else if (cestate->result_expr_state)
-					{
-						res = ExecEvalExprPassingCaseValue(cestate->result_expr_state,
-														   econtext,
-														   op->resnull,
-														   res, false);
-					}
-					/* else no coercion */
+					res = error && cestate->input_opt_error ?
+						cestate->input_opt_error(str, error) :
+						ExecEvalJsonExprInput(op, str, error);
 				}
-				break;
+				else if (cestate->coerce_via_io)
+				{
+					res = JsonbToFormattedDatum(JsonbValueToJsonb(jbv),
+												isjsonb);
+					res = ExecEvalJsonExprCoercion(op, econtext,
+												   res, isjsonb, resnull,
+												   error);
+				}
+				else if (cestate->result_expr_state)
+				{
+					res = ExecEvalExprPassingCaseValue(cestate->result_expr_state,
+													   econtext,
+													   resnull,
+													   res, false, error);
+				}
+				/* else no coercion */
+			}
+			break;
 
-			case IS_JSON_EXISTS:
-				res = BoolGetDatum(JsonbPathExists(jb, path,
-												   op->d.jsonexpr.args));
-				*op->resnull = false;
-				break;
+		case IS_JSON_EXISTS:
+			res = BoolGetDatum(it ?
+							   JsonPathIteratorExists(it, error) :
+							   JsonbPathExists(jb, path,
+											   op->d.jsonexpr.args, error));
+			*resnull = false;
+			break;
 
-			default:
-				elog(ERROR, "unrecognized SQL/JSON expression op %d",
-					 jexpr->op);
-				return;
-		}
+		case IS_JSON_TABLE:
+			/* JSON_TABLE document is a formatted context item itself */
+			res = tojsonb ? JsonbGetDatum(jb) : doc;
+			*resnull = false;
+			break;
+
+		default:
+			elog(ERROR, "unrecognized SQL/JSON expression op %d",
+				 jexpr->op);
+			return (Datum) 0;
+	}
 
-		if (empty)
+	if (error && *error)
+		return (Datum) 0;
+
+	if (empty)
+	{
+		if (jexpr->on_empty.btype == JSON_BEHAVIOR_ERROR)
 		{
-			if (jexpr->on_empty.btype == JSON_BEHAVIOR_ERROR)
-				ereport(ERROR,
-						(errcode(ERRCODE_NO_JSON_ITEM),
-						 errmsg("no SQL/JSON item")));
+			if (error)
+			{
+				*error = true;
+				return (Datum) 0;
+			}
 
-			res = ExecEvalJsonBehavior(econtext, &jexpr->on_empty,
-									   op->d.jsonexpr.default_on_empty,
-									   isjsonb, op->resnull);
+			ereport(ERROR,
+					(errcode(ERRCODE_NO_JSON_ITEM),
+					 errmsg("no SQL/JSON item")));
 		}
 
-		if (jexpr->op != IS_JSON_EXISTS &&
-			(!empty ? jexpr->op != IS_JSON_VALUE :
-			 /* already coerced in DEFAULT case */
-			 jexpr->on_empty.btype != JSON_BEHAVIOR_DEFAULT))
-			res = ExecEvalJsonExprCoercion(op, econtext, res, op->resnull);
+		res = ExecEvalJsonBehavior(econtext, &jexpr->on_empty,
+								   op->d.jsonexpr.default_on_empty,
+								   isjsonb, resnull, error);
+
+		if (error && *error)
+			return (Datum) 0;
 	}
-	PG_CATCH();
+
+	if (jexpr->op != IS_JSON_EXISTS &&
+		(!empty ? jexpr->op != IS_JSON_VALUE :
+		 /* already coerced in DEFAULT case */
+		 jexpr->on_empty.btype != JSON_BEHAVIOR_DEFAULT))
+		res = ExecEvalJsonExprCoercion(op, econtext, res, isjsonb, resnull,
+									   error);
+
+	return res;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEvalJson
+ * ----------------------------------------------------------------
+ */
+void
+ExecEvalJson(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
+{
+	JsonExpr   *jexpr = op->d.jsonexpr.jsexpr;
+	Datum		item;
+	Datum		res = (Datum) 0;
+	ListCell   *lc;
+	Oid			formattedType = exprType(jexpr->formatted_expr ?
+										 jexpr->formatted_expr :
+										 jexpr->raw_expr);
+	bool		isjsonb = formattedType == JSONBOID;
+	bool		error = false;
+	JsonPathCompiled *path = op->d.jsonexpr.path;
+	MemoryContext mcxt = CurrentMemoryContext;
+
+	*op->resnull = true;		/* until we get a result */
+	*op->resvalue = (Datum) 0;
+
+	if (op->d.jsonexpr.raw_expr->isnull)
 	{
-		if (jexpr->on_error.btype == JSON_BEHAVIOR_ERROR ||
-			ERRCODE_TO_CATEGORY(geterrcode()) != ERRCODE_DATA_EXCEPTION)
-			PG_RE_THROW();
+		/* execute domain checks for NULLs */
+		(void) ExecEvalJsonExprCoercion(op, econtext, res, isjsonb,
+										op->resnull, NULL);
+		return;
+	}
+
+	item = op->d.jsonexpr.raw_expr->value;
+
+	if (op->d.jsonexpr.path_spec)
+	{
+		bool		isnull;
+		Datum		pathval = ExecEvalExpr(op->d.jsonexpr.path_spec, econtext,
+										   &isnull);
+
+		/* NULL path gives NULL result like NULL context item */
+		if (isnull)
+		{
+			(void) ExecEvalJsonExprCoercion(op, econtext, res, isjsonb,
+											op->resnull, NULL);
+			return;
+		}
+
+		path = JsonPathCacheLookup(op->d.jsonexpr.pathcache,
+								   DatumGetJsonPath(pathval));
+	}
+
+	foreach(lc, op->d.jsonexpr.args)
+	{
+		JsonPathVariableEvalContext *var = lfirst(lc);
 
-		FlushErrorState();
-		MemoryContextSwitchTo(mcxt);
+		var->econtext = econtext;
+		ResetJsonPathVar(var);
+	}
 
+	if (jexpr->on_error.btype == JSON_BEHAVIOR_ERROR)
+	{
+		/* no need to catch anything, errors are simply thrown */
+		*op->resvalue = ExecEvalJsonExpr(op, econtext, item, path, isjsonb,
+										 op->resnull, NULL);
+		return;
+	}
+
+	/*
+	 * Jsonpath errors and errors of coercions to the output type are
+	 * returned without throwing.  Other data errors have to be caught only
+	 * if the context item needs to be formatted or parsed, or the path can
+	 * throw them.
+	 */
+	if (isjsonb && !op->d.jsonexpr.formatted_expr && path && path->nothrow)
+		res = ExecEvalJsonExpr(op, econtext, item, path, isjsonb,
+							   op->resnull, &error);
+	else
+	{
+		PG_TRY();
+		{
+			res = ExecEvalJsonExpr(op, econtext, item, path, isjsonb,
+								   op->resnull, &error);
+		}
+		PG_CATCH();
+		{
+			if (!ExecCatchJsonDataError(mcxt, &error))
+				PG_RE_THROW();
+		}
+		PG_END_TRY();
+	}
+
+	if (error)
+	{
 		res = ExecEvalJsonBehavior(econtext, &jexpr->on_error,
 								   op->d.jsonexpr.default_on_error,
-								   isjsonb, op->resnull);
+								   isjsonb, op->resnull, NULL);
 
 		if (jexpr->op != IS_JSON_EXISTS &&
 			jexpr->on_error.btype != JSON_BEHAVIOR_DEFAULT)
-			res = ExecEvalJsonExprCoercion(op, econtext, res, op->resnull);
+			res = ExecEvalJsonExprCoercion(op, econtext, res, isjsonb,
+										   op->resnull, NULL);
 	}
-	PG_END_TRY();
 
 	*op->resvalue = res;
 }
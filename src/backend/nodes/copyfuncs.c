@@ -638,6 +638,8 @@ _copyTableFuncScan(const TableFuncScan *from)
 	 * copy remainder of node
 	 */
 	COPY_NODE_FIELD(tablefunc);
+	COPY_BITMAPSET_FIELD(unusedcols);
+	COPY_NODE_FIELD(rowqual);
 
 	return newnode;
 }
@@ -1224,6 +1226,7 @@ _copyTableFunc(const TableFunc *from)
 {
 	TableFunc  *newnode = makeNode(TableFunc);
 
+	COPY_SCALAR_FIELD(functype);
 	COPY_NODE_FIELD(ns_names);
 	COPY_NODE_FIELD(ns_uris);
 	COPY_NODE_FIELD(docexpr);
@@ -1236,6 +1239,7 @@ _copyTableFunc(const TableFunc *from)
 	COPY_NODE_FIELD(coldefexprs);
 	COPY_BITMAPSET_FIELD(notnulls);
 	COPY_SCALAR_FIELD(ordinalitycol);
+	COPY_NODE_FIELD(plan);
 	COPY_LOCATION_FIELD(location);
 
 	return newnode;
@@ -2153,6 +2157,39 @@ _copyJsonExpr(const JsonExpr *from)
 	return newnode;
 }
 
+/*
+ * _copyJsonTableParentNode
+ */
+static JsonTableParentNode *
+_copyJsonTableParentNode(const JsonTableParentNode *from)
+{
+	JsonTableParentNode *newnode = makeNode(JsonTableParentNode);
+
+	COPY_NODE_FIELD(path);
+	COPY_STRING_FIELD(name);
+	COPY_NODE_FIELD(child);
+	COPY_SCALAR_FIELD(outerJoin);
+	COPY_NODE_FIELD(colnos);
+	COPY_SCALAR_FIELD(errorOnError);
+
+	return newnode;
+}
+
+/*
+ * _copyJsonTableSiblingNode
+ */
+static JsonTableSiblingNode *
+_copyJsonTableSiblingNode(const JsonTableSiblingNode *from)
+{
+	JsonTableSiblingNode *newnode = makeNode(JsonTableSiblingNode);
+
+	COPY_NODE_FIELD(larg);
+	COPY_NODE_FIELD(rarg);
+	COPY_SCALAR_FIELD(cross);
+
+	return newnode;
+}
+
 /*
  * _copyJsonFuncExpr
  */
@@ -2226,7 +2263,7 @@ _copyJsonCommon(const JsonCommon *from)
 	JsonCommon	   *newnode = makeNode(JsonCommon);
 
 	COPY_NODE_FIELD(expr);
-	COPY_STRING_FIELD(pathspec);
+	COPY_NODE_FIELD(pathspec);
 	COPY_STRING_FIELD(pathname);
 	COPY_NODE_FIELD(passing);
 	COPY_SCALAR_FIELD(location);
@@ -5288,6 +5325,12 @@ copyObjectImpl(const void *from)
 		case T_JsonExpr:
 			retval = _copyJsonExpr(from);
 			break;
+		case T_JsonTableParentNode:
+			retval = _copyJsonTableParentNode(from);
+			break;
+		case T_JsonTableSiblingNode:
+			retval = _copyJsonTableSiblingNode(from);
+			break;
 		case T_JsonCommon:
 			retval = _copyJsonCommon(from);
 			break;
@@ -119,6 +119,7 @@ _equalRangeVar(const RangeVar *a, const RangeVar *b)
 static bool
 _equalTableFunc(const TableFunc *a, const TableFunc *b)
 {
+	COMPARE_SCALAR_FIELD(functype);
 	COMPARE_NODE_FIELD(ns_names);
 	COMPARE_NODE_FIELD(ns_uris);
 	COMPARE_NODE_FIELD(docexpr);
@@ -131,6 +132,7 @@ _equalTableFunc(const TableFunc *a, const TableFunc *b)
 	COMPARE_NODE_FIELD(coldefexprs);
 	COMPARE_BITMAPSET_FIELD(notnulls);
 	COMPARE_SCALAR_FIELD(ordinalitycol);
+	COMPARE_NODE_FIELD(plan);
 	COMPARE_LOCATION_FIELD(location);
 
 	return true;
@@ -847,6 +849,31 @@ _equalJsonExpr(const JsonExpr *a, const JsonExpr *b)
 	return true;
 }
 
+static bool
+_equalJsonTableParentNode(const JsonTableParentNode *a,
+						  const JsonTableParentNode *b)
+{
+	COMPARE_NODE_FIELD(path);
+	COMPARE_STRING_FIELD(name);
+	COMPARE_NODE_FIELD(child);
+	COMPARE_SCALAR_FIELD(outerJoin);
+	COMPARE_NODE_FIELD(colnos);
+	COMPARE_SCALAR_FIELD(errorOnError);
+
+	return true;
+}
+
+static bool
+_equalJsonTableSiblingNode(const JsonTableSiblingNode *a,
+						   const JsonTableSiblingNode *b)
+{
+	COMPARE_NODE_FIELD(larg);
+	COMPARE_NODE_FIELD(rarg);
+	COMPARE_SCALAR_FIELD(cross);
+
+	return true;
+}
+
 /*
  * Stuff from relation.h
  */
@@ -3173,6 +3200,12 @@ equal(const void *a, const void *b)
 		case T_JsonExpr:
 			retval = _equalJsonExpr(a, b);
 			break;
+		case T_JsonTableParentNode:
+			retval = _equalJsonTableParentNode(a, b);
+			break;
+		case T_JsonTableSiblingNode:
+			retval = _equalJsonTableSiblingNode(a, b);
+			break;
 
 			/*
 			 * RELATION NODES
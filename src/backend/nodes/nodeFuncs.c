@@ -2285,6 +2285,8 @@ expression_tree_walker(Node *node,
 					return true;
 				if (walker(jexpr->result_expr, context))
 					return true;
+				if (walker(jexpr->path_spec, context))
+					return true;
 				if (walker(jexpr->passing.values, context))
 					return true;
 				/* we assume walker doesn't care about passing.names */
@@ -3119,6 +3121,7 @@ expression_tree_mutator(Node *node,
 				MUTATE(newnode->raw_expr, xexpr->raw_expr, Node *);
 				MUTATE(newnode->formatted_expr, xexpr->formatted_expr, Node *);
 				MUTATE(newnode->result_expr, xexpr->result_expr, Node *);
+				MUTATE(newnode->path_spec, xexpr->path_spec, Node *);
 				MUTATE(newnode->passing.values, xexpr->passing.values, List *);
 				/* assume mutator does not care about passing.names */
 				MUTATE(newnode->on_empty.default_expr,
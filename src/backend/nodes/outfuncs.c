@@ -612,6 +612,8 @@ _outTableFuncScan(StringInfo str, const TableFuncScan *node)
 	_outScanInfo(str, (const Scan *) node);
 
 	WRITE_NODE_FIELD(tablefunc);
+	WRITE_BITMAPSET_FIELD(unusedcols);
+	WRITE_NODE_FIELD(rowqual);
 }
 
 static void
@@ -1020,6 +1022,7 @@ _outTableFunc(StringInfo str, const TableFunc *node)
 {
 	WRITE_NODE_TYPE("TABLEFUNC");
 
+	WRITE_ENUM_FIELD(functype, TableFuncType);
 	WRITE_NODE_FIELD(ns_names);
 	WRITE_NODE_FIELD(ns_uris);
 	WRITE_NODE_FIELD(docexpr);
@@ -1032,6 +1035,7 @@ _outTableFunc(StringInfo str, const TableFunc *node)
 	WRITE_NODE_FIELD(coldefexprs);
 	WRITE_BITMAPSET_FIELD(notnulls);
 	WRITE_INT_FIELD(ordinalitycol);
+	WRITE_NODE_FIELD(plan);
 	WRITE_LOCATION_FIELD(location);
 }
 
@@ -1696,6 +1700,29 @@ _outJsonExpr(StringInfo str, const JsonExpr *node)
 	WRITE_LOCATION_FIELD(location);
 }
 
+static void
+_outJsonTableParentNode(StringInfo str, const JsonTableParentNode *node)
+{
+	WRITE_NODE_TYPE("JSONTABPNODE");
+
+	WRITE_NODE_FIELD(path);
+	WRITE_STRING_FIELD(name);
+	WRITE_NODE_FIELD(child);
+	WRITE_BOOL_FIELD(outerJoin);
+	WRITE_NODE_FIELD(colnos);
+	WRITE_BOOL_FIELD(errorOnError);
+}
+
+static void
+_outJsonTableSiblingNode(StringInfo str, const JsonTableSiblingNode *node)
+{
+	WRITE_NODE_TYPE("JSONTABSNODE");
+
+	WRITE_NODE_FIELD(larg);
+	WRITE_NODE_FIELD(rarg);
+	WRITE_BOOL_FIELD(cross);
+}
+
 /*****************************************************************************
  *
  *	Stuff from relation.h.
@@ -4232,6 +4259,12 @@ outNode(StringInfo str, const void *obj)
 			case T_JsonExpr:
 				_outJsonExpr(str, obj);
 				break;
+			case T_JsonTableParentNode:
+				_outJsonTableParentNode(str, obj);
+				break;
+			case T_JsonTableSiblingNode:
+				_outJsonTableSiblingNode(str, obj);
+				break;
 
 			default:
 
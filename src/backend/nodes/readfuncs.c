@@ -467,6 +467,7 @@ _readTableFunc(void)
 {
 	READ_LOCALS(TableFunc);
 
+	READ_ENUM_FIELD(functype, TableFuncType);
 	READ_NODE_FIELD(ns_names);
 	READ_NODE_FIELD(ns_uris);
 	READ_NODE_FIELD(docexpr);
@@ -479,6 +480,7 @@ _readTableFunc(void)
 	READ_NODE_FIELD(coldefexprs);
 	READ_BITMAPSET_FIELD(notnulls);
 	READ_INT_FIELD(ordinalitycol);
+	READ_NODE_FIELD(plan);
 	READ_LOCATION_FIELD(location);
 
 	READ_DONE();
@@ -1339,6 +1341,39 @@ _readJsonExpr(void)
 	READ_DONE();
 }
 
+/*
+ * _readJsonTableParentNode
+ */
+static JsonTableParentNode *
+_readJsonTableParentNode(void)
+{
+	READ_LOCALS(JsonTableParentNode);
+
+	READ_NODE_FIELD(path);
+	READ_STRING_FIELD(name);
+	READ_NODE_FIELD(child);
+	READ_BOOL_FIELD(outerJoin);
+	READ_NODE_FIELD(colnos);
+	READ_BOOL_FIELD(errorOnError);
+
+	READ_DONE();
+}
+
+/*
+ * _readJsonTableSiblingNode
+ */
+static JsonTableSiblingNode *
+_readJsonTableSiblingNode(void)
+{
+	READ_LOCALS(JsonTableSiblingNode);
+
+	READ_NODE_FIELD(larg);
+	READ_NODE_FIELD(rarg);
+	READ_BOOL_FIELD(cross);
+
+	READ_DONE();
+}
+
 /*
  *	Stuff from parsenodes.h.
  */
@@ -1890,6 +1925,8 @@ _readTableFuncScan(void)
 	ReadCommonScan(&local_node->scan);
 
 	READ_NODE_FIELD(tablefunc);
+	READ_BITMAPSET_FIELD(unusedcols);
+	READ_NODE_FIELD(rowqual);
 
 	READ_DONE();
 }
@@ -2678,6 +2715,10 @@ parseNodeString(void)
 		return_value = _readPartitionRangeDatum();
 	else if (MATCH("JSONEXPR", 8))
 		return_value = _readJsonExpr();
+	else if (MATCH("JSONTABPNODE", 12))
+		return_value = _readJsonTableParentNode();
+	else if (MATCH("JSONTABSNODE", 12))
+		return_value = _readJsonTableSiblingNode();
 	else
 	{
 		elog(ERROR, "badly formatted node string \"%.32s\"...", token);
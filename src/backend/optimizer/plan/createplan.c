@@ -196,7 +196,10 @@ static FunctionScan *make_functionscan(List *qptlist, List *qpqual,
 static ValuesScan *make_valuesscan(List *qptlist, List *qpqual,
 				Index scanrelid, List *values_lists);
 static TableFuncScan *make_tablefuncscan(List *qptlist, List *qpqual,
-				   Index scanrelid, TableFunc *tablefunc);
+				   Index scanrelid, TableFunc *tablefunc,
+				   Bitmapset *unusedcols, List *rowqual);
+static bool is_json_table_root_clause(Node *clause, Index scanrelid,
+						  JsonTableParentNode *rootpath);
 static CteScan *make_ctescan(List *qptlist, List *qpqual,
 			 Index scanrelid, int ctePlanId, int cteParam);
 static NamedTuplestoreScan *make_namedtuplestorescan(List *qptlist, List *qpqual,
@@ -3153,6 +3156,8 @@ create_tablefuncscan_plan(PlannerInfo *root, Path *best_path,
 	Index		scan_relid = best_path->parent->relid;
 	RangeTblEntry *rte;
 	TableFunc  *tablefunc;
+	Bitmapset  *unusedcols = NULL;
+	List	   *rowqual = NIL;
 
 	/* it should be a function base rel... */
 	Assert(scan_relid > 0);
@@ -3175,14 +3180,100 @@ create_tablefuncscan_plan(PlannerInfo *root, Path *best_path,
 		tablefunc = (TableFunc *) replace_nestloop_params(root, (Node *) tablefunc);
 	}
 
+	/*
+	 * JSON_TABLE evaluates only the columns needed above the scan or by its
+	 * quals, the others are left NULL.  A whole-row reference needs all of
+	 * them.
+	 */
+	if (tablefunc->functype == TFT_JSON_TABLE)
+	{
+		Bitmapset  *attrs = NULL;
+		int			ncols = list_length(tablefunc->colnames);
+		int			i;
+
+		pull_varattnos((Node *) best_path->parent->reltarget->exprs,
+					   scan_relid, &attrs);
+		pull_varattnos((Node *) scan_clauses, scan_relid, &attrs);
+
+		if (!bms_is_member(0 - FirstLowInvalidHeapAttributeNumber, attrs))
+		{
+			for (i = 0; i < ncols; i++)
+			{
+				if (!bms_is_member(i + 1 - FirstLowInvalidHeapAttributeNumber,
+								   attrs))
+					unusedcols = bms_add_member(unusedcols, i);
+			}
+		}
+	}
+
+	/*
+	 * Quals on the columns of the JSON_TABLE root path are pushed down to
+	 * its items: they are checked before the other columns and the nested
+	 * rows of an item are computed, so non-matching items produce nothing.
+	 */
+	if (tablefunc->functype == TFT_JSON_TABLE)
+	{
+		JsonTableParentNode *rootpath =
+			castNode(JsonTableParentNode, tablefunc->plan);
+		List	   *quals = NIL;
+		ListCell   *lc;
+
+		foreach(lc, scan_clauses)
+		{
+			Node	   *clause = (Node *) lfirst(lc);
+
+			if (is_json_table_root_clause(clause, scan_relid, rootpath))
+				rowqual = lappend(rowqual, clause);
+			else
+				quals = lappend(quals, clause);
+		}
+
+		scan_clauses = quals;
+	}
+
 	scan_plan = make_tablefuncscan(tlist, scan_clauses, scan_relid,
-								   tablefunc);
+								   tablefunc, unusedcols, rowqual);
 
 	copy_generic_path_info(&scan_plan->scan.plan, best_path);
 
 	return scan_plan;
 }
 
+/*
+ * is_json_table_root_clause
+ *	  Can the clause be evaluated on an item of the JSON_TABLE root path?
+ *
+ * It must reference only the root path columns, which keep their values
+ * in all the rows of the item, and must be safe to evaluate before the
+ * other columns of the row.
+ */
+static bool
+is_json_table_root_clause(Node *clause, Index scanrelid,
+						  JsonTableParentNode *rootpath)
+{
+	Bitmapset  *attrs = NULL;
+	int			attidx = -1;
+
+	if (contain_volatile_functions(clause) || contain_subplans(clause))
+		return false;
+
+	pull_varattnos(clause, scanrelid, &attrs);
+
+	if (bms_is_empty(attrs))
+		return false;
+
+	while ((attidx = bms_next_member(attrs, attidx)) >= 0)
+	{
+		AttrNumber	attno = attidx + FirstLowInvalidHeapAttributeNumber;
+
+		/* whole-row references are not pushed down */
+		if (attno <= 0 || !list_member_int(rootpath->colnos, attno - 1))
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * create_valuesscan_plan
  *	 Returns a valuesscan plan for the base relation scanned by 'best_path'
@@ -5147,7 +5238,9 @@ static TableFuncScan *
 make_tablefuncscan(List *qptlist,
 				   List *qpqual,
 				   Index scanrelid,
-				   TableFunc *tablefunc)
+				   TableFunc *tablefunc,
+				   Bitmapset *unusedcols,
+				   List *rowqual)
 {
 	TableFuncScan *node = makeNode(TableFuncScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5158,6 +5251,8 @@ make_tablefuncscan(List *qptlist,
 	plan->righttree = NULL;
 	node->scan.scanrelid = scanrelid;
 	node->tablefunc = tablefunc;
+	node->unusedcols = unusedcols;
+	node->rowqual = rowqual;
 
 	return node;
 }
@@ -2423,6 +2423,8 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 		case T_TableFuncScan:
 			finalize_primnode((Node *) ((TableFuncScan *) plan)->tablefunc,
 							  &context);
+			finalize_primnode((Node *) ((TableFuncScan *) plan)->rowqual,
+							  &context);
 			context.paramids = bms_add_members(context.paramids, scan_params);
 			break;
 
@@ -40,6 +40,7 @@
 #include "parser/analyze.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "parser/parse_expr.h"
 #include "parser/parse_func.h"
 #include "rewrite/rewriteManip.h"
 #include "tcop/tcopprot.h"
@@ -47,6 +48,7 @@
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
+#include "utils/jsonpath.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
@@ -107,6 +109,7 @@ static bool contain_volatile_functions_not_nextval_walker(Node *node, void *cont
 static bool max_parallel_hazard_walker(Node *node,
 						   max_parallel_hazard_context *context);
 static bool contain_nonstrict_functions_walker(Node *node, void *context);
+static bool contain_row_dependent_nodes_walker(Node *node, void *context);
 static bool contain_context_dependent_node(Node *clause);
 static bool contain_context_dependent_node_walker(Node *node, int *flags);
 static bool contain_leaked_vars_walker(Node *node, void *context);
@@ -115,6 +118,7 @@ static List *find_nonnullable_vars_walker(Node *node, bool top_level);
 static bool is_strict_saop(ScalarArrayOpExpr *expr, bool falseOK);
 static Node *eval_const_expressions_mutator(Node *node,
 							   eval_const_expressions_context *context);
+static bool json_expr_is_foldable(JsonExpr *jexpr);
 static List *simplify_or_arguments(List *args,
 					  eval_const_expressions_context *context,
 					  bool *haveNull, bool *forceTrue);
@@ -2186,6 +2190,47 @@ is_pseudo_constant_clause(Node *clause)
 	return false;
 }
 
+/*
+ * is_execution_invariant_clause
+ *	  Detect whether an expression yields the same value for every row
+ *	  processed during one execution of a plan, as long as the PARAM_EXEC
+ *	  Params it contains keep their values, so that it need only be computed
+ *	  once.  This is stricter than is_pseudo_constant_clause(): the
+ *	  expression must not contain Vars, placeholders for values supplied by
+ *	  the enclosing expression, aggregates or subplans.  Stable functions are
+ *	  allowed since their results do not change within a single statement.
+ *	  PARAM_EXTERN Params keep their values only for one execution, so the
+ *	  value must not be kept longer than that.
+ */
+bool
+is_execution_invariant_clause(Node *clause)
+{
+	if (!contain_row_dependent_nodes_walker(clause, NULL) &&
+		!contain_volatile_functions(clause))
+		return true;
+	return false;
+}
+
+static bool
+contain_row_dependent_nodes_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var) ||
+		IsA(node, CaseTestExpr) ||
+		IsA(node, CoerceToDomainValue) ||
+		IsA(node, Aggref) ||
+		IsA(node, GroupingFunc) ||
+		IsA(node, WindowFunc) ||
+		IsA(node, SubLink) ||
+		IsA(node, SubPlan) ||
+		IsA(node, AlternativeSubPlan) ||
+		IsA(node, CurrentOfExpr))
+		return true;
+	return expression_tree_walker(node, contain_row_dependent_nodes_walker,
+								  context);
+}
+
 /*
  * is_pseudo_constant_clause_relids
  *	  Same as above, except caller already has available the var membership
@@ -3530,6 +3575,62 @@ eval_const_expressions_mutator(Node *node,
 				newbtest->location = btest->location;
 				return (Node *) newbtest;
 			}
+		case T_JsonExpr:
+			{
+				JsonExpr   *jexpr = (JsonExpr *) node;
+				JsonExpr   *newjexpr;
+				Node	   *save_case_val;
+
+				/* JSON_TABLE document expression is executed by the scan */
+				if (jexpr->op == IS_JSON_TABLE)
+					break;
+
+				newjexpr = makeNode(JsonExpr);
+				memcpy(newjexpr, jexpr, sizeof(JsonExpr));
+
+				newjexpr->raw_expr =
+					eval_const_expressions_mutator(jexpr->raw_expr, context);
+				newjexpr->path_spec =
+					eval_const_expressions_mutator(jexpr->path_spec, context);
+				newjexpr->passing.values = (List *)
+					eval_const_expressions_mutator((Node *) jexpr->passing.values,
+												   context);
+				newjexpr->on_empty.default_expr =
+					eval_const_expressions_mutator(jexpr->on_empty.default_expr,
+												   context);
+				newjexpr->on_error.default_expr =
+					eval_const_expressions_mutator(jexpr->on_error.default_expr,
+												   context);
+
+				/*
+				 * The formatting and the result coercion expressions refer
+				 * to the context item and to the result through their own
+				 * CaseTestExprs, so hide the value of any enclosing CASE.
+				 */
+				save_case_val = context->case_val;
+				context->case_val = NULL;
+
+				newjexpr->formatted_expr =
+					eval_const_expressions_mutator(jexpr->formatted_expr,
+												   context);
+				newjexpr->result_expr =
+					eval_const_expressions_mutator(jexpr->result_expr, context);
+
+				context->case_val = save_case_val;
+
+				/*
+				 * If all the inputs are constants and the evaluation is
+				 * immutable, pre-evaluate the expression.  ON EMPTY and ON
+				 * ERROR behaviors are handled by the regular execution.
+				 */
+				if (!context->estimate && json_expr_is_foldable(newjexpr))
+					return (Node *) evaluate_expr((Expr *) newjexpr,
+												  exprType((Node *) newjexpr),
+												  exprTypmod((Node *) newjexpr),
+												  exprCollation((Node *) newjexpr));
+
+				return (Node *) newjexpr;
+			}
 		case T_PlaceHolderVar:
 
 			/*
@@ -3562,6 +3663,101 @@ eval_const_expressions_mutator(Node *node,
 								   (void *) context);
 }
 
+/*
+ * Subroutine for eval_const_expressions: check whether a SQL/JSON function
+ * can be pre-evaluated.
+ *
+ * The context item, the path and the PASSING arguments must be constants,
+ * and all the functions involved must be immutable.  Besides the functions
+ * visible in the expression tree, this includes the coercions of SQL/JSON
+ * items to the RETURNING type, which are built by the executor at run time.
+ * Datetime items are never folded: their comparisons and casts depend on
+ * TimeZone, and their serialization into json depends on DateStyle.
+ */
+static bool
+json_expr_is_foldable(JsonExpr *jexpr)
+{
+	static const Oid itemtypes[] = {TEXTOID, NUMERICOID, BOOLOID};
+	Const	   *path;
+	ListCell   *lc;
+	int			i;
+
+	if (!IsA(jexpr->raw_expr, Const) ||
+		!IsA(jexpr->path_spec, Const))
+		return false;
+
+	foreach(lc, jexpr->passing.values)
+	{
+		if (!IsA(lfirst(lc), Const))
+			return false;
+	}
+
+	/* populating composite types may call any input function */
+	if (jexpr->coerce_via_populate)
+		return false;
+
+	if (contain_mutable_functions((Node *) jexpr))
+		return false;
+
+	/* datetime items come from .datetime() methods or PASSING arguments */
+	foreach(lc, jexpr->passing.values)
+	{
+		switch (getBaseType(exprType(lfirst(lc))))
+		{
+			case DATEOID:
+			case TIMEOID:
+			case TIMETZOID:
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+				return false;
+			default:
+				break;
+		}
+	}
+
+	path = (Const *) jexpr->path_spec;
+
+	if (!path->constisnull &&
+		jspHasDatetimeItems(DatumGetJsonPath(path->constvalue)))
+		return false;
+
+	if (jexpr->op != IS_JSON_VALUE &&
+		!jexpr->coerce_via_io && !jexpr->omit_quotes)
+		return true;
+
+	if (OidIsValid(jexpr->returning.typid))
+	{
+		Oid			typinput;
+		Oid			typioparam;
+
+		getTypeInputInfo(jexpr->returning.typid, &typinput, &typioparam);
+
+		if (func_volatile(typinput) != PROVOLATILE_IMMUTABLE)
+			return false;
+	}
+
+	if (jexpr->op != IS_JSON_VALUE)
+		return true;
+
+	for (i = 0; i < lengthof(itemtypes); i++)
+	{
+		CaseTestExpr *placeholder = makeNode(CaseTestExpr);
+		Node	   *coercion;
+
+		placeholder->typeId = itemtypes[i];
+		placeholder->typeMod = -1;
+		placeholder->collation = InvalidOid;
+
+		coercion = coerceJsonFuncExpr(NULL, (Node *) placeholder,
+									  &jexpr->returning, false);
+
+		if (coercion && contain_mutable_functions(coercion))
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * Subroutine for eval_const_expressions: process arguments of an OR clause
  *
@@ -615,6 +615,7 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 					json_table_plan_cross
 					json_table_plan_primary
 					json_table_default_plan
+					json_path_specification
 					json_output_clause_opt
 					json_value_constructor
 					json_object_constructor
@@ -638,8 +639,7 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 
 %type <typnam>		json_returning_clause_opt
 
-%type <str>			json_path_specification
-					json_table_column_path_specification_clause_opt
+%type <str>			json_table_column_path_specification_clause_opt
 					json_table_path_name
 					json_as_path_name_clause_opt
 
@@ -14456,7 +14456,7 @@ json_context_item:
 		;
 
 json_path_specification:
-			Sconst									{ $$ = $1; }
+			c_expr									{ $$ = $1; }
 		;
 
 json_as_path_name_clause_opt:
@@ -14759,7 +14759,7 @@ json_table_error_clause_opt:
 		;
 
 json_table_column_path_specification_clause_opt:
-			PATH json_path_specification			{ $$ = $2; }
+			PATH Sconst								{ $$ = $2; }
 			| /* EMPTY */ %prec json_table_column	{ $$ = NULL; }
 		;
 
@@ -14791,7 +14791,7 @@ json_table_formatted_column_definition:
 		;
 
 json_table_nested_columns:
-			NESTED path_opt json_path_specification
+			NESTED path_opt Sconst
 							json_as_path_name_clause_opt
 							json_table_columns_clause
 				{
@@ -43,6 +43,7 @@
 #include "parser/parse_target.h"
 #include "parser/parse_type.h"
 #include "rewrite/rewriteManip.h"
+#include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/json.h"
 #include "utils/lsyscache.h"
@@ -50,12 +51,11 @@
 
 typedef struct JsonTableContext
 {
-	JsonTable  *table;
-	List	   *pathnames;
-	int			pathNameId;
-	int			contextItemId;
-	ColumnRef  *passingArgsRef;
-	RangeVar   *passingArgsRte;
+	JsonTable  *table;			/* untransformed node */
+	TableFunc  *tablefunc;		/* transformed node */
+	List	   *pathnames;		/* list of all path and column names */
+	int			pathNameId;		/* path name id counter */
+	List	   *columns;		/* all non-nested columns in output order */
 } JsonTableContext;
 
 /* Convenience macro for the most common makeNamespaceItem() case */
@@ -109,10 +109,10 @@ static List *addTargetToGroupList(ParseState *pstate, TargetEntry *tle,
 static WindowClause *findWindowClause(List *wclist, const char *name);
 static Node *transformFrameOffset(ParseState *pstate, int frameOptions,
 					 Node *clause);
-static RangeSubselect * transformJsonTableColumns(ParseState *pstate,
+static JsonTableParentNode *transformJsonTableColumns(ParseState *pstate,
 						JsonTableContext *cxt, JsonTablePlan *plan,
-						Node *expr, List *columns,
-						char *pathSpec, char **pathName, int location);
+						List *columns, char *pathSpec, char **pathName,
+						int location);
 
 
 /*
@@ -1060,6 +1060,18 @@ transformRangeTableSample(ParseState *pstate, RangeTableSample *rts)
 	return tablesample;
 }
 
+static Node *
+makeStringConst(char *str, int location)
+{
+	A_Const    *n = makeNode(A_Const);
+
+	n->val.type = T_String;
+	n->val.val.str = str;
+	n->location = location;
+
+	return (Node *) n;
+}
+
 /*
  * Transform
  *   - regular column into JSON_VALUE()
@@ -1095,7 +1107,7 @@ transformJsonTableColumn(JsonTableColumn *jtc, Node *contextItemExpr,
 	common->passing = passingArgs;
 
 	if (jtc->pathspec)
-		common->pathspec = jtc->pathspec;
+		common->pathspec = makeStringConst(jtc->pathspec, -1);
 	else
 	{
 		/* Construct default path as '$."column_name"' */
@@ -1106,7 +1118,7 @@ transformJsonTableColumn(JsonTableColumn *jtc, Node *contextItemExpr,
 		appendStringInfoString(&path, "$.");
 		escape_json(&path, jtc->name);
 
-		common->pathspec = path.data;
+		common->pathspec = makeStringConst(path.data, -1);
 	}
 
 	jvexpr->expr = (Expr *) contextItemExpr;
@@ -1117,23 +1129,6 @@ transformJsonTableColumn(JsonTableColumn *jtc, Node *contextItemExpr,
 	return (Node *) jfexpr;
 }
 
-static Node *
-makeConstJoinQual(bool value)
-{
-	A_Const *stringConst = makeNode(A_Const);
-	TypeCast *boolConst = makeNode(TypeCast);
-
-	stringConst->val.type = T_String;
-	stringConst->val.val.str = value ? "t" : "f";
-	stringConst->location = -1;
-
-	boolConst->arg = (Node *) stringConst;
-	boolConst->typeName = SystemTypeName("bool");
-	boolConst->location = -1;
-
-	return (Node *) boolConst;
-}
-
 static bool
 isJsonTablePathNameDuplicate(JsonTableContext *cxt, const char *pathname)
 {
@@ -1208,12 +1203,6 @@ generateJsonTableAlias(JsonTableContext *cxt)
 	return generateJsonTablePathName(cxt, "json_table_path", &cxt->pathNameId);
 }
 
-static char *
-generateJsonTableContextItemAlias(JsonTableContext *cxt)
-{
-	return generateJsonTablePathName(cxt, "context_item", &cxt->contextItemId);
-}
-
 static void
 collectSiblingPathsInJsonTablePlan(JsonTablePlan *plan, List **paths)
 {
@@ -1313,50 +1302,38 @@ findNestedJsonTableColumn(List *columns, const char *pathname)
 
 static Node *
 transformNestedJsonTableColumn(ParseState *pstate, JsonTableContext *cxt,
-							   JsonTableColumn *jtc, JsonTablePlan *plan,
-							   Node *expr)
+							   JsonTableColumn *jtc, JsonTablePlan *plan)
 {
-	RangeSubselect *subselect;
-	Alias	   *alias = makeNode(Alias);
 	char	   *pathname = jtc->pathname;
 
-	subselect = transformJsonTableColumns(pstate, cxt, plan, expr,
-										  jtc->columns, jtc->pathspec,
-										  &pathname, jtc->location);
-	subselect->alias = alias;
-
-	alias->aliasname = pstrdup(pathname);
-
-	return (Node *) subselect;
+	return (Node *) transformJsonTableColumns(pstate, cxt, plan, jtc->columns,
+											  jtc->pathspec, &pathname,
+											  jtc->location);
 }
 
 static Node *
 makeJsonTableSiblingJoin(bool cross, Node *lnode, Node *rnode)
 {
-	JoinExpr   *join = makeNode(JoinExpr);
+	JsonTableSiblingNode *join = makeNode(JsonTableSiblingNode);
 
-	join->isNatural = FALSE;
-	join->usingClause = NIL;
 	join->larg = lnode;
 	join->rarg = rnode;
-
-	if (cross)
-	{
-		join->jointype = JOIN_INNER;
-		join->quals = NULL;
-	}
-	else
-	{
-		join->jointype = JOIN_FULL;
-		join->quals = makeConstJoinQual(false);
-	}
+	join->cross = cross;
 
 	return (Node *) join;
 }
 
+/*
+ * Recursively transform child JSON_TABLE plan.
+ *
+ * Default plan is transformed into a cross/union join of its nested columns.
+ * Simple and outer/inner plans are transformed into a JsonTableParentNode by
+ * finding and transforming corresponding nested column.
+ * Sibling plans are recursively transformed into a JsonTableSiblingNode.
+ */
 static Node *
 transformJsonTableChildPlan(ParseState *pstate, JsonTableContext *cxt,
-							JsonTablePlan *plan, Node *expr, List *columns)
+							JsonTablePlan *plan, List *columns)
 {
 	JsonTableColumn *jtc = NULL;
 
@@ -1369,17 +1346,17 @@ transformJsonTableChildPlan(ParseState *pstate, JsonTableContext *cxt,
 		foreach(lc, columns)
 		{
 			JsonTableColumn *jtc = castNode(JsonTableColumn, lfirst(lc));
-			Node	   *subselect;
+			Node	   *node;
 
 			if (jtc->coltype != JTC_NESTED)
 				continue;
 
-			subselect = transformNestedJsonTableColumn(pstate, cxt, jtc,
-													   plan, expr);
+			node = transformNestedJsonTableColumn(pstate, cxt, jtc, plan);
+
 			if (!result)
-				result = subselect;
+				result = node;
 			else
-				result = makeJsonTableSiblingJoin(cross, result, subselect);
+				result = makeJsonTableSiblingJoin(cross, result, node);
 		}
 
 		return result;
@@ -1400,10 +1377,10 @@ transformJsonTableChildPlan(ParseState *pstate, JsonTableContext *cxt,
 		{
 			Node	   *node1 =
 					transformJsonTableChildPlan(pstate, cxt, plan->plan1,
-												expr, columns);
+												columns);
 			Node	   *node2 =
 					transformJsonTableChildPlan(pstate, cxt, plan->plan2,
-												expr, columns);
+												columns);
 
 			return makeJsonTableSiblingJoin(plan->join_type == JSTP_CROSS,
 											node1, node2);
@@ -1420,208 +1397,145 @@ transformJsonTableChildPlan(ParseState *pstate, JsonTableContext *cxt,
 						   plan->pathname),
 				 parser_errposition(pstate, plan->location)));
 
-	return transformNestedJsonTableColumn(pstate, cxt, jtc, plan, expr);
+	return transformNestedJsonTableColumn(pstate, cxt, jtc, plan);
 }
 
+/*
+ * Append all JSON_TABLE columns, including nested ones, to the TableFunc
+ * column lists in the order of their definition.
+ *
+ * Regular and formatted columns are transformed into JSON_VALUE() and
+ * JSON_QUERY() expressions whose context item is a CaseTestExpr placeholder
+ * for the current row item of the corresponding path.  FOR ORDINALITY
+ * columns have no expression, they are computed by the executor.
+ */
 static void
-appendJsonTableColumn(List **targetList, const char *name, int location,
-					  Node *expr)
-{
-	ResTarget  *target = makeNode(ResTarget);
-
-	target->name = pstrdup(name);
-	target->indirection = NIL;
-	target->val = expr;
-	target->location = location;
-
-	*targetList = lappend(*targetList, target);
-}
-
-static List *
 appendJsonTableColumns(ParseState *pstate, JsonTableContext *cxt,
-					   List *columns, Node *contextItem,
-					   RangeFunction *rangefunc, Alias *alias,
-					   const char *contextItemColumnName)
+					   List *columns)
 {
-	ListCell   *lc;
-	List	   *targetList = NIL;
+	TableFunc  *tf = cxt->tablefunc;
 	JsonTable  *jt = cxt->table;
 	bool		errorOnError = jt->on_error &&
 							   jt->on_error->btype == JSON_BEHAVIOR_ERROR;
-	bool		contextItemAppended = false;
+	ListCell   *lc;
 
 	foreach(lc, columns)
 	{
 		JsonTableColumn *jtc = castNode(JsonTableColumn, lfirst(lc));
+		Node	   *colexpr;
+		Oid			typid;
+		int32		typmod;
 
 		switch (jtc->coltype)
 		{
-			case JTC_REGULAR:
-			case JTC_FORMATTED:
-				{
-					Node	   *expr =
-							transformJsonTableColumn(jtc, contextItem,
-								/* arguments are not passed to column paths */
-													 NIL,
-													 /* jt->common->passing, */
-													 errorOnError);
-
-					appendJsonTableColumn(&targetList, jtc->name, jtc->location,
-										  expr);
-				}
+			case JTC_FOR_ORDINALITY:
+				colexpr = NULL;
+				typid = INT4OID;
+				typmod = -1;
 				break;
 
-			case JTC_FOR_ORDINALITY:
+			case JTC_REGULAR:
+			case JTC_FORMATTED:
 				{
-					ColumnRef  *ordcolref = makeNode(ColumnRef);
+					CaseTestExpr *param = makeNode(CaseTestExpr);
+					JsonExpr   *jsexpr;
 
-					if (!rangefunc->ordinality)
-					{
-						rangefunc->ordinality = true;
+					param->typeId = JSONBOID;
+					param->typeMod = -1;
+					param->collation = InvalidOid;
 
-						/* Append ordinality column to alias */
-						alias->colnames =
-								lappend(alias->colnames,
-										makeString(pstrdup("ordinality")));
-					}
+					colexpr = transformJsonTableColumn(jtc, (Node *) param,
+								/* arguments are not passed to column paths */
+													   NIL,
+													   errorOnError);
 
-					/* Make reference to ordinality column (second in the list) */
-					ordcolref->fields =
-							list_make2(makeString(pstrdup(alias->aliasname)),
-									   copyObject(lsecond(alias->colnames)));
+					colexpr = transformExpr(pstate, colexpr,
+											EXPR_KIND_FROM_FUNCTION);
+					assign_expr_collations(pstate, colexpr);
 
-					appendJsonTableColumn(&targetList, jtc->name, jtc->location,
-										  (Node *) ordcolref);
+					jsexpr = castNode(JsonExpr, colexpr);
+					typid = jsexpr->returning.typid;
+					typmod = jsexpr->returning.typmod;
 				}
 				break;
 
 			case JTC_NESTED:
-				if (!contextItemAppended)
-				{
-					appendJsonTableColumn(&targetList, contextItemColumnName,
-										  -1, contextItem);
-					contextItemAppended = true;
-				}
-				break;
+				appendJsonTableColumns(pstate, cxt, jtc->columns);
+				continue;
 
 			default:
 				elog(ERROR, "unrecognized JSON_TABLE column type %d",
 					 jtc->coltype);
-				break;
+				return;
 		}
-	}
 
-	return targetList;
+		tf->colnames = lappend(tf->colnames, makeString(pstrdup(jtc->name)));
+		tf->coltypes = lappend_oid(tf->coltypes, typid);
+		tf->coltypmods = lappend_int(tf->coltypmods, typmod);
+		tf->colcollations = lappend_oid(tf->colcollations,
+										type_is_collatable(typid) ?
+										DEFAULT_COLLATION_OID : InvalidOid);
+		tf->colexprs = lappend(tf->colexprs, colexpr);
+
+		cxt->columns = lappend(cxt->columns, jtc);
+	}
 }
 
-static void
-appendNestedJsonTableColumns(List **targetList, List *columns)
+static int
+getJsonTableColumnNumber(JsonTableContext *cxt, JsonTableColumn *jtc)
 {
 	ListCell   *lc;
+	int			colno = 0;
 
-	foreach(lc, columns)
+	foreach(lc, cxt->columns)
 	{
-		JsonTableColumn *jtc = castNode(JsonTableColumn, lfirst(lc));
+		if (lfirst(lc) == jtc)
+			return colno;
 
-		switch (jtc->coltype)
-		{
-			case JTC_REGULAR:
-			case JTC_FORMATTED:
-			case JTC_FOR_ORDINALITY:
-				{
-					ColumnRef  *cref = makeNode(ColumnRef);
+		colno++;
+	}
 
-					cref->fields = list_make1(makeString(pstrdup(jtc->name)));
+	elog(ERROR, "JSON_TABLE column \"%s\" not found", jtc->name);
+	return -1;					/* keep compiler quiet */
+}
 
-					appendJsonTableColumn(targetList, jtc->name, jtc->location,
-										  (Node *) cref);
-				}
-				break;
+static JsonTableParentNode *
+makeParentJsonTableNode(JsonTableContext *cxt, char *pathSpec, List *columns)
+{
+	JsonTableParentNode *node = makeNode(JsonTableParentNode);
+	ListCell   *lc;
 
-			case JTC_NESTED:
-				appendNestedJsonTableColumns(targetList, jtc->columns);
-				break;
+	/* root path is taken from the document expression */
+	node->path = !pathSpec ? NULL :
+		makeConst(JSONPATHOID, -1, InvalidOid, -1,
+				  DirectFunctionCall1(jsonpath_in, CStringGetDatum(pathSpec)),
+				  false, false);
 
-			default:
-				elog(ERROR, "unrecognized JSON_TABLE column type %d",
-					 jtc->coltype);
-				break;
-		}
+	/* Collect numbers of columns belonging to this path */
+	foreach(lc, columns)
+	{
+		JsonTableColumn *jtc = castNode(JsonTableColumn, lfirst(lc));
+
+		if (jtc->coltype != JTC_NESTED)
+			node->colnos = lappend_int(node->colnos,
+									   getJsonTableColumnNumber(cxt, jtc));
 	}
-}
 
-static RangeSubselect *
-makeParentJsonTableNode(ParseState *pstate, JsonTableContext *cxt,
-						Node *expr, char *pathSpec, List *columns,
-						char *contextItemColumnName)
-{
-	RangeSubselect *subselect = makeNode(RangeSubselect);
-	RangeFunction *rangefunc = makeNode(RangeFunction);
-	SelectStmt *select = makeNode(SelectStmt);
-	ColumnRef  *colref = makeNode(ColumnRef);
-	A_Const	   *path = makeNode(A_Const);
-	Alias	   *alias = makeNode(Alias);
-	FuncCall   *fcall;
-	List	   *args;
-	bool		errorOnError = cxt->table->on_error &&
-							cxt->table->on_error->btype == JSON_BEHAVIOR_ERROR;
-
-	/* Make JSON path argument */
-	path->val.type = T_String;
-	path->val.val.str = pathSpec;
-	path->location = -1;
-
-	args = list_make2(expr, path);
-
-	if (cxt->passingArgsRef)
-		args = lappend(args, cxt->passingArgsRef);
-
-	/* Make jsonb_unnest_path() call */
-	fcall = makeFuncCall(list_make2(makeString(pstrdup("pg_catalog")),
-									makeString(pstrdup(errorOnError ?
-													"_jsonpath_object" :
-													"_jsonpath_object_safe"))),
-						 args, -1);
-
-	/* Make alias for RangeFunction */
-	alias->aliasname = generateJsonTableAlias(cxt);
-	alias->colnames = list_make1(makeString(pstrdup("context_item")));
-
-	/* Make RangeFunction */
-	rangefunc->functions = list_make1(list_make2(fcall, NIL));
-	rangefunc->alias = alias;
-	rangefunc->lateral = true;
-	rangefunc->ordinality = false;
-	rangefunc->is_rowsfrom = false;
-
-	/* Make reference to JSON context item column (first in the list) */
-	colref->fields = list_make2(makeString(pstrdup(alias->aliasname)),
-								copyObject(linitial(alias->colnames)));
-
-	select->fromClause = list_make1(rangefunc);
-	select->targetList = appendJsonTableColumns(pstate, cxt, columns,
-												(Node *) colref,
-												rangefunc, alias,
-												contextItemColumnName);
-
-	if (cxt->passingArgsRte)
-		select->fromClause = lcons(cxt->passingArgsRte, select->fromClause);
-
-	subselect->subquery = (Node *) select;
-	subselect->lateral = true;
-
-	return subselect;
+	node->errorOnError =
+		cxt->table->on_error &&
+		cxt->table->on_error->btype == JSON_BEHAVIOR_ERROR;
+
+	return node;
 }
 
-static RangeSubselect *
+static JsonTableParentNode *
 transformJsonTableColumns(ParseState *pstate, JsonTableContext *cxt,
-						  JsonTablePlan *plan, Node *expr, List *columns,
+						  JsonTablePlan *plan, List *columns,
 						  char *pathSpec, char **pathName, int location)
 {
-	RangeSubselect *subselect = makeNode(RangeSubselect);
+	JsonTableParentNode *node;
 	JsonTablePlan *childPlan;
 	JsonTable  *jt = cxt->table;
-	char	   *contextItemColumnName;
 	bool		defaultPlan = !plan || plan->plan_type == JSTP_DEFAULT;
 
 	if (!*pathName)
@@ -1671,118 +1585,55 @@ transformJsonTableColumns(ParseState *pstate, JsonTableContext *cxt,
 		checkJsonTableChildPlan(pstate, childPlan, columns);
 	}
 
-	contextItemColumnName = generateJsonTableContextItemAlias(cxt);
-
-	subselect = makeParentJsonTableNode(pstate, cxt, expr, pathSpec, columns,
-										contextItemColumnName);
+	node = makeParentJsonTableNode(cxt, pathSpec, columns);
+	node->name = pstrdup(*pathName);
 
 	if (childPlan || defaultPlan)
 	{
-		JoinExpr   *join = makeNode(JoinExpr);
-		SelectStmt *select = makeNode(SelectStmt);
-		Alias	   *alias = makeNode(Alias);
-		ColumnRef  *colref = makeNode(ColumnRef);
-
-		alias->aliasname = pstrdup(*pathName);
-		colref->fields = list_make2(makeString(pstrdup(alias->aliasname)),
-									makeString(pstrdup(contextItemColumnName)));
-
-		join->isNatural = FALSE;
-		join->usingClause = NIL;
-		join->rarg = transformJsonTableChildPlan(pstate, cxt, childPlan,
-												 (Node *) colref, columns);
-
-		if (!join->rarg)
-			return subselect; /* default plan case: no children found */
-
-		join->larg = (Node *) subselect;
-		subselect->alias = alias;
-
-		if (!plan || (plan->join_type & JSTP_OUTER))
-		{
-			join->jointype = JOIN_LEFT;
-			join->quals = makeConstJoinQual(true);
-		}
-		else
-		{
-			join->jointype = JOIN_INNER;
-			join->quals = NULL;
-		}
-
-		select->fromClause = list_make1(join);
-		select->targetList = NIL;
-		appendNestedJsonTableColumns(&select->targetList, columns);
-
-		subselect = makeNode(RangeSubselect);
-		subselect->subquery = (Node *) select;
-		subselect->lateral = true;
+		/* transform recursively nested columns */
+		node->child = transformJsonTableChildPlan(pstate, cxt, childPlan,
+												  columns);
+		if (node->child)
+			node->outerJoin = !plan || (plan->join_type & JSTP_OUTER);
+		/* else: default plan case, no children found */
 	}
 
-	return subselect;
+	return node;
 }
 
-static RangeSubselect *
+/*
+ * transformJsonTable -
+ *			Transform a raw JsonTable into TableFunc.
+ *
+ * Transform the document-generating expression, the row-generating expression,
+ * the column-generating expressions, and the default value expressions.
+ */
+static RangeTblEntry *
 transformJsonTable(ParseState *pstate, JsonTable *jt)
 {
-	RangeSubselect *subselect;
-	JsonValueExpr *jsexpr = jt->common->expr;
 	JsonTableContext cxt;
+	TableFunc  *tf = makeNode(TableFunc);
+	JsonFuncExpr *jfe = makeNode(JsonFuncExpr);
+	JsonCommon *jscommon;
+	JsonValueExpr *jsexpr = jt->common->expr;
 	JsonTablePlan *plan = jt->plan;
+	JsonTableParentNode *root;
+	Node	   *pathspec;
 	char	   *rootPathName = jt->common->pathname;
-	char	   *passingArgsAlias = NULL;
-	JsonObjectCtor *argctor;
+	RangeTblEntry *rte;
+	bool		is_lateral;
 
 	cxt.table = jt;
+	cxt.tablefunc = tf;
 	cxt.pathnames = NIL;
 	cxt.pathNameId = 0;
-	cxt.contextItemId = 0;
-	cxt.passingArgsRef = NULL;
-	cxt.passingArgsRte = NULL;
+	cxt.columns = NIL;
 
 	if (rootPathName)
 		registerJsonTableColumn(&cxt, rootPathName);
 
 	registerAllJsonTableColumns(&cxt, jt->columns);
 
-	if (jt->common->passing)
-	{
-		ListCell   *lc;
-		int			tmpid = 0;
-
-		passingArgsAlias =
-				generateJsonTablePathName(&cxt, "json_table_path_args", &tmpid);
-
-		cxt.passingArgsRte = makeRangeVar(NULL, passingArgsAlias, -1);
-
-		cxt.passingArgsRef = makeNode(ColumnRef);
-		cxt.passingArgsRef->fields = list_make2(makeString(passingArgsAlias),
-												makeString("args"));
-		cxt.passingArgsRef->location = -1;
-
-		argctor = makeNode(JsonObjectCtor);
-		argctor->output = makeNode(JsonOutput);
-		argctor->output->typename = makeTypeNameFromOid(JSONBOID, -1);
-		argctor->output->returning.format.type = JS_FORMAT_DEFAULT;
-		argctor->output->returning.format.encoding = JS_ENC_DEFAULT;
-		argctor->unique = true;
-
-		foreach(lc, jt->common->passing)
-		{
-			JsonArgument *arg = castNode(JsonArgument, lfirst(lc));
-			JsonKeyValue *kv = makeNode(JsonKeyValue);
-			A_Const	   *key = makeNode(A_Const);
-
-			key->val.val.str = pstrdup(arg->name);
-			key->val.type = T_String;
-			key->location = -1;
-
-			kv->key = (Expr *) key;
-			kv->value = arg->val;
-
-			argctor->exprs = lappend(argctor->exprs, kv);
-		}
-	}
-
 	if (plan && plan->plan_type != JSTP_DEFAULT && !rootPathName)
 	{
 		/* Assign root path name and create corresponding plan node */
@@ -1799,52 +1650,79 @@ transformJsonTable(ParseState *pstate, JsonTable *jt)
 		plan = rootPlan;
 	}
 
-	if (jsexpr->format.type == JS_FORMAT_JSON)
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("JSON_TABLE is not yet implemented for json type"),
-				 parser_errposition(pstate, jsexpr->format.location)));
-
-	/* Using JSONB as default FORMAT */
+	/*
+	 * Without explicit FORMAT, the context item is formatted as json text
+	 * like in other SQL/JSON functions, and invalid json text produces no
+	 * rows unless ERROR ON ERROR is specified.
+	 */
 	if (jsexpr->format.type == JS_FORMAT_DEFAULT)
 	{
 		jsexpr = makeNode(JsonValueExpr);
 		jsexpr->expr = jt->common->expr->expr;
-		jsexpr->format.type = JS_FORMAT_JSONB;
+		jsexpr->format.type = JS_FORMAT_DEFAULT;
 		jsexpr->format.encoding = JS_ENC_DEFAULT;
 		jsexpr->null_on_error =
 				!jt->on_error || jt->on_error->btype == JSON_BEHAVIOR_EMPTY;
 	}
 
-	subselect = transformJsonTableColumns(pstate, &cxt, plan,
-										  (Node *) jsexpr,
-										  jt->columns,
-										  jt->common->pathspec,
-										  &rootPathName,
-										  jt->common->location);
+	/*
+	 * The document expression is a JSON_TABLE-flavored JsonExpr carrying the
+	 * formatted context item and the PASSING arguments, which are bound
+	 * directly to the path variables of the root and nested paths.
+	 */
+	jscommon = copyObject(jt->common);
+	jscommon->expr = jsexpr;
+	jscommon->pathname = NULL;
 
-	subselect->alias = jt->alias;
+	jfe->op = IS_JSON_TABLE;
+	jfe->common = jscommon;
+	jfe->on_error = jt->on_error;
+	jfe->location = jt->common->location;
 
-	if (passingArgsAlias)
-	{
-		SelectStmt *select = castNode(SelectStmt, subselect->subquery);
-		CommonTableExpr *cte = makeNode(CommonTableExpr);
-		SelectStmt *argsel = makeNode(SelectStmt);
-		ResTarget  *target = makeNode(ResTarget);
+	/*
+	 * We make lateral_only names of this level visible, whether or not the
+	 * JSON_TABLE is explicitly marked LATERAL.  This is needed for SQL spec
+	 * compliance and seems useful on convenience grounds for all functions
+	 * in FROM.
+	 *
+	 * (LATERAL can't nest within a single pstate level, so we don't need
+	 * save/restore logic here.)
+	 */
+	Assert(!pstate->p_lateral_active);
+	pstate->p_lateral_active = true;
 
-		select->withClause = makeNode(WithClause);
-		select->withClause->ctes = list_make1(cte);
+	tf->functype = TFT_JSON_TABLE;
+	tf->docexpr = transformExpr(pstate, (Node *) jfe, EXPR_KIND_FROM_FUNCTION);
+	assign_expr_collations(pstate, tf->docexpr);
 
-		cte->ctename = pstrdup(passingArgsAlias);
-		cte->ctequery = (Node *) argsel;
+	appendJsonTableColumns(pstate, &cxt, jt->columns);
 
-		argsel->targetList = list_make1(target);
+	root = transformJsonTableColumns(pstate, &cxt, plan, jt->columns, NULL,
+									 &rootPathName, jt->common->location);
 
-		target->name = pstrdup("args");
-		target->val = (Node *) argctor;
-	}
+	/* non-constant root path is evaluated for each document */
+	pathspec = castNode(JsonExpr, tf->docexpr)->path_spec;
+
+	if (IsA(pathspec, Const) && !castNode(Const, pathspec)->constisnull)
+		root->path = copyObject((Const *) pathspec);
+
+	tf->plan = (Node *) root;
+
+	tf->ordinalitycol = -1;		/* undefine ordinality column number */
+	tf->location = jt->location;
+
+	pstate->p_lateral_active = false;
 
-	return subselect;
+	/*
+	 * Mark the RTE as LATERAL if there are any lateral cross-references in
+	 * it.
+	 */
+	is_lateral = contain_vars_of_level((Node *) tf, 0);
+
+	rte = addRangeTableEntryForTableFunc(pstate,
+										 tf, jt->alias, is_lateral, true);
+
+	return rte;
 }
 
 static RangeTblEntry *
@@ -1955,14 +1833,17 @@ transformFromClauseItem(ParseState *pstate, Node *n,
 		rtr->rtindex = rtindex;
 		return (Node *) rtr;
 	}
-	else if (IsA(n, RangeTableFunc))
+	else if (IsA(n, RangeTableFunc) || IsA(n, JsonTable))
 	{
 		/* table function is like a plain relation */
 		RangeTblRef *rtr;
 		RangeTblEntry *rte;
 		int			rtindex;
 
-		rte = transformRangeTableFunc(pstate, (RangeTableFunc *) n);
+		if (IsA(n, RangeTableFunc))
+			rte = transformRangeTableFunc(pstate, (RangeTableFunc *) n);
+		else
+			rte = transformJsonTable(pstate, (JsonTable *) n);
 		/* assume new rte is at end */
 		rtindex = list_length(pstate->p_rtable);
 		Assert(rte == rt_fetch(rtindex, pstate->p_rtable));
@@ -2000,15 +1881,6 @@ transformFromClauseItem(ParseState *pstate, Node *n,
 		rte->tablesample = transformRangeTableSample(pstate, rts);
 		return (Node *) rtr;
 	}
-	else if (IsA(n, JsonTable))
-	{
-		/* JsonTable is transformed into RangeSubselect */
-		JsonTable *jt = castNode(JsonTable, n);
-		RangeSubselect *subselect = transformJsonTable(pstate, jt);
-
-		return transformFromClauseItem(pstate, (Node *) subselect,
-									   top_rte, top_rti, namespace);
-	}
 	else if (IsA(n, JoinExpr))
 	{
 		/* A newfangled join expression */
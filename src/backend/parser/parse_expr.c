@@ -4219,7 +4219,7 @@ static JsonExpr *
 transformJsonExprCommon(ParseState *pstate, JsonFuncExpr *func)
 {
 	JsonExpr   *jsexpr = makeNode(JsonExpr);
-	Datum		jsonpath;
+	Node	   *pathspec;
 
 	if (func->common->pathname)
 		ereport(ERROR,
@@ -4242,21 +4242,33 @@ transformJsonExprCommon(ParseState *pstate, JsonFuncExpr *func)
 
 	jsexpr->format = func->common->expr->format;
 
-	jsonpath = DirectFunctionCall1(jsonpath_in,
-									CStringGetDatum(func->common->pathspec));
+	/* string literals are parsed here, other paths at execution time */
+	pathspec = transformExprRecurse(pstate, func->common->pathspec);
 
-	jsexpr->path_spec = makeConst(JSONPATHOID, -1, InvalidOid, -1,
-								  jsonpath, false, false);
+	jsexpr->path_spec =
+		coerce_to_target_type(pstate, pathspec, exprType(pathspec),
+							  JSONPATHOID, -1,
+							  COERCION_EXPLICIT, COERCE_IMPLICIT_CAST,
+							  exprLocation(pathspec));
+
+	if (!jsexpr->path_spec)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("JSON path expression must be type %s, not type %s",
+						"jsonpath", format_type_be(exprType(pathspec))),
+				 parser_errposition(pstate, exprLocation(pathspec))));
 
 	transformJsonPassingArgs(pstate, func->common->passing, &jsexpr->passing);
 
-	if (func->op != IS_JSON_EXISTS)
+	if (func->op != IS_JSON_EXISTS && func->op != IS_JSON_TABLE)
 		jsexpr->on_empty = transformJsonBehavior(pstate, func->on_empty,
 												 JSON_BEHAVIOR_NULL);
 
 	jsexpr->on_error = transformJsonBehavior(pstate, func->on_error,
 											 func->op == IS_JSON_EXISTS ?
 											 JSON_BEHAVIOR_FALSE :
+											 func->op == IS_JSON_TABLE ?
+											 JSON_BEHAVIOR_EMPTY :
 											 JSON_BEHAVIOR_NULL);
 
 	return jsexpr;
@@ -4425,10 +4437,22 @@ transformJsonFuncExpr(ParseState *pstate, JsonFuncExpr *func)
 			jsexpr->returning.typid = BOOLOID;
 			jsexpr->returning.typmod = -1;
 
+			break;
+
+		case IS_JSON_TABLE:
+			func_name = "JSON_TABLE";
+
+			/* JSON_TABLE document expression returns formatted context item */
+			jsexpr->returning.format.type = JS_FORMAT_DEFAULT;
+			jsexpr->returning.format.encoding = JS_ENC_DEFAULT;
+			jsexpr->returning.format.location = -1;
+			jsexpr->returning.typid = exprType(expr);
+			jsexpr->returning.typmod = -1;
+
 			break;
 	}
 
-	if (exprType(expr) != JSONBOID)
+	if (exprType(expr) != JSONBOID && exprType(expr) != JSONOID)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("%s() is not yet implemented for json type", func_name),
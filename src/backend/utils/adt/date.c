@@ -43,6 +43,8 @@
 
 static int	time2tm(TimeADT time, struct pg_tm * tm, fsec_t *fsec);
 static int	timetz2tm(TimeTzADT *time, struct pg_tm * tm, fsec_t *fsec, int *tzp);
+static DateADT timestamp2date_internal(Timestamp timestamp, bool withtz,
+						bool *have_error);
 
 
 /* common code for timetypmodin and timetztypmodin */
@@ -113,6 +115,17 @@ Datum
 date_in(PG_FUNCTION_ARGS)
 {
 	char	   *str = PG_GETARG_CSTRING(0);
+
+	PG_RETURN_DATEADT(date_in_opt_error(str, NULL));
+}
+
+/*
+ * Convert a string to date.  If have_error is not NULL, invalid or out of
+ * range input sets *have_error instead of throwing an error.
+ */
+DateADT
+date_in_opt_error(char *str, bool *have_error)
+{
 	DateADT		date;
 	fsec_t		fsec;
 	struct pg_tm tt,
@@ -130,7 +143,15 @@ date_in(PG_FUNCTION_ARGS)
 	if (dterr == 0)
 		dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tzp);
 	if (dterr != 0)
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return 0;
+		}
+
 		DateTimeParseError(dterr, str, "date");
+	}
 
 	switch (dtype)
 	{
@@ -151,32 +172,47 @@ date_in(PG_FUNCTION_ARGS)
 
 		case DTK_LATE:
 			DATE_NOEND(date);
-			PG_RETURN_DATEADT(date);
+			return date;
 
 		case DTK_EARLY:
 			DATE_NOBEGIN(date);
-			PG_RETURN_DATEADT(date);
+			return date;
 
 		default:
+			if (have_error)
+			{
+				*have_error = true;
+				return 0;
+			}
+
 			DateTimeParseError(DTERR_BAD_FORMAT, str, "date");
 			break;
 	}
 
 	/* Prevent overflow in Julian-day routines */
 	if (!IS_VALID_JULIAN(tm->tm_year, tm->tm_mon, tm->tm_mday))
-		ereport(ERROR,
-				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-				 errmsg("date out of range: \"%s\"", str)));
+		goto out_of_range;
 
 	date = date2j(tm->tm_year, tm->tm_mon, tm->tm_mday) - POSTGRES_EPOCH_JDATE;
 
 	/* Now check for just-out-of-range dates */
 	if (!IS_VALID_DATE(date))
-		ereport(ERROR,
-				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-				 errmsg("date out of range: \"%s\"", str)));
+		goto out_of_range;
 
-	PG_RETURN_DATEADT(date);
+	return date;
+
+out_of_range:
+	if (have_error)
+	{
+		*have_error = true;
+		return 0;
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+			 errmsg("date out of range: \"%s\"", str)));
+
+	return 0;					/* keep compiler quiet */
 }
 
 /* date_out()
@@ -569,6 +605,22 @@ date_mii(PG_FUNCTION_ARGS)
 
 static Timestamp
 date2timestamp(DateADT dateVal)
+{
+	return date2timestamp_opt_error(dateVal, NULL);
+}
+
+static TimestampTz
+date2timestamptz(DateADT dateVal)
+{
+	return date2timestamptz_opt_error(dateVal, NULL);
+}
+
+/*
+ * Promote date to timestamp.  If have_error is not NULL, a date out of range
+ * for timestamp sets *have_error instead of throwing an error.
+ */
+Timestamp
+date2timestamp_opt_error(DateADT dateVal, bool *have_error)
 {
 	Timestamp	result;
 
@@ -584,9 +636,17 @@ date2timestamp(DateADT dateVal)
 		 * boundary need be checked for overflow.
 		 */
 		if (dateVal >= (TIMESTAMP_END_JULIAN - POSTGRES_EPOCH_JDATE))
+		{
+			if (have_error)
+			{
+				*have_error = true;
+				return 0;
+			}
+
 			ereport(ERROR,
 					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 					 errmsg("date out of range for timestamp")));
+		}
 
 		/* date is days since 2000, timestamp is microseconds since same... */
 		result = dateVal * USECS_PER_DAY;
@@ -595,8 +655,13 @@ date2timestamp(DateADT dateVal)
 	return result;
 }
 
-static TimestampTz
-date2timestamptz(DateADT dateVal)
+/*
+ * Promote date to timestamp with time zone.  If have_error is not NULL, a
+ * date out of range for timestamp sets *have_error instead of throwing an
+ * error.
+ */
+TimestampTz
+date2timestamptz_opt_error(DateADT dateVal, bool *have_error)
 {
 	TimestampTz result;
 	struct pg_tm tt,
@@ -615,9 +680,7 @@ date2timestamptz(DateADT dateVal)
 		 * boundary need be checked for overflow.
 		 */
 		if (dateVal >= (TIMESTAMP_END_JULIAN - POSTGRES_EPOCH_JDATE))
-			ereport(ERROR,
-					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-					 errmsg("date out of range for timestamp")));
+			goto out_of_range;
 
 		j2date(dateVal + POSTGRES_EPOCH_JDATE,
 			   &(tm->tm_year), &(tm->tm_mon), &(tm->tm_mday));
@@ -633,12 +696,23 @@ date2timestamptz(DateADT dateVal)
 		 * of time zone, check for allowed timestamp range after adding tz.
 		 */
 		if (!IS_VALID_TIMESTAMP(result))
-			ereport(ERROR,
-					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-					 errmsg("date out of range for timestamp")));
+			goto out_of_range;
 	}
 
 	return result;
+
+out_of_range:
+	if (have_error)
+	{
+		*have_error = true;
+		return 0;
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+			 errmsg("date out of range for timestamp")));
+
+	return 0;					/* keep compiler quiet */
 }
 
 /*
@@ -1072,10 +1146,32 @@ Datum
 timestamp_date(PG_FUNCTION_ARGS)
 {
 	Timestamp	timestamp = PG_GETARG_TIMESTAMP(0);
+
+	PG_RETURN_DATEADT(timestamp2date_opt_error(timestamp, NULL));
+}
+
+/*
+ * Convert timestamp to date.  If have_error is not NULL, an out of
+ * range timestamp sets *have_error instead of throwing an error.
+ */
+DateADT
+timestamp2date_opt_error(Timestamp timestamp, bool *have_error)
+{
+	return timestamp2date_internal(timestamp, false, have_error);
+}
+
+/*
+ * Guts of timestamp_date() and timestamptz_date().  The timestamp is taken
+ * in the session time zone if withtz is true.
+ */
+static DateADT
+timestamp2date_internal(Timestamp timestamp, bool withtz, bool *have_error)
+{
 	DateADT		result;
 	struct pg_tm tt,
 			   *tm = &tt;
 	fsec_t		fsec;
+	int			tz;
 
 	if (TIMESTAMP_IS_NOBEGIN(timestamp))
 		DATE_NOBEGIN(result);
@@ -1083,18 +1179,26 @@ timestamp_date(PG_FUNCTION_ARGS)
 		DATE_NOEND(result);
 	else
 	{
-		if (timestamp2tm(timestamp, NULL, tm, &fsec, NULL, NULL) != 0)
+		if (timestamp2tm(timestamp, withtz ? &tz : NULL, tm, &fsec,
+						 NULL, NULL) != 0)
+		{
+			if (have_error)
+			{
+				*have_error = true;
+				return 0;
+			}
+
 			ereport(ERROR,
 					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 					 errmsg("timestamp out of range")));
+		}
 
 		result = date2j(tm->tm_year, tm->tm_mon, tm->tm_mday) - POSTGRES_EPOCH_JDATE;
 	}
 
-	PG_RETURN_DATEADT(result);
+	return result;
 }
 
-
 /* date_timestamptz()
  * Convert date to timestamp with time zone data type.
  */
@@ -1117,29 +1221,19 @@ Datum
 timestamptz_date(PG_FUNCTION_ARGS)
 {
 	TimestampTz timestamp = PG_GETARG_TIMESTAMP(0);
-	DateADT		result;
-	struct pg_tm tt,
-			   *tm = &tt;
-	fsec_t		fsec;
-	int			tz;
 
-	if (TIMESTAMP_IS_NOBEGIN(timestamp))
-		DATE_NOBEGIN(result);
-	else if (TIMESTAMP_IS_NOEND(timestamp))
-		DATE_NOEND(result);
-	else
-	{
-		if (timestamp2tm(timestamp, &tz, tm, &fsec, NULL, NULL) != 0)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-					 errmsg("timestamp out of range")));
-
-		result = date2j(tm->tm_year, tm->tm_mon, tm->tm_mday) - POSTGRES_EPOCH_JDATE;
-	}
-
-	PG_RETURN_DATEADT(result);
+	PG_RETURN_DATEADT(timestamptz2date_opt_error(timestamp, NULL));
 }
 
+/*
+ * Convert timestamp with time zone to date.  If have_error is not NULL, an
+ * out of range timestamp sets *have_error instead of throwing an error.
+ */
+DateADT
+timestamptz2date_opt_error(TimestampTz timestamp, bool *have_error)
+{
+	return timestamp2date_internal(timestamp, true, have_error);
+}
 
 /* abstime_date()
  * Convert abstime to date data type.
@@ -411,6 +411,20 @@ float4send(PG_FUNCTION_ARGS)
 	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
 }
 
+/*
+ * Report error, or set *have_error and return 0 if it is not NULL.
+ */
+#define RETURN_ERROR(throw_error, have_error) \
+do { \
+	if (have_error) \
+	{ \
+		*(have_error) = true; \
+		return 0.0; \
+	} \
+	else \
+		throw_error; \
+} while (0)
+
 /*
  *		float8in		- converts "num" to float8
  */
@@ -443,6 +457,22 @@ float8in(PG_FUNCTION_ARGS)
 double
 float8in_internal(char *num, char **endptr_p,
 				  const char *type_name, const char *orig_string)
+{
+	return float8in_internal_opt_error(num, endptr_p, type_name, orig_string,
+									   NULL);
+}
+
+/*
+ * float8in_internal_opt_error - float8in_internal() with optional soft
+ * error reporting
+ *
+ * If have_error is not NULL, invalid or out of range input sets *have_error
+ * and returns 0 instead of throwing an error.
+ */
+double
+float8in_internal_opt_error(char *num, char **endptr_p,
+							const char *type_name, const char *orig_string,
+							bool *have_error)
 {
 	double		val;
 	char	   *endptr;
@@ -456,10 +486,11 @@ float8in_internal(char *num, char **endptr_p,
 	 * strtod() on different platforms.
 	 */
 	if (*num == '\0')
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-				 errmsg("invalid input syntax for type %s: \"%s\"",
-						type_name, orig_string)));
+		RETURN_ERROR(ereport(ERROR,
+							 (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+							  errmsg("invalid input syntax for type %s: \"%s\"",
+									 type_name, orig_string))),
+					 have_error);
 
 	errno = 0;
 	val = strtod(num, &endptr);
@@ -532,17 +563,19 @@ float8in_internal(char *num, char **endptr_p,
 				char	   *errnumber = pstrdup(num);
 
 				errnumber[endptr - num] = '\0';
-				ereport(ERROR,
-						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
-				   errmsg("\"%s\" is out of range for type double precision",
-						  errnumber)));
+				RETURN_ERROR(ereport(ERROR,
+									 (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+									  errmsg("\"%s\" is out of range for type double precision",
+											 errnumber))),
+							 have_error);
 			}
 		}
 		else
-			ereport(ERROR,
-					(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-					 errmsg("invalid input syntax for type %s: \"%s\"",
-							type_name, orig_string)));
+			RETURN_ERROR(ereport(ERROR,
+								 (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+								  errmsg("invalid input syntax for type %s: \"%s\"",
+										 type_name, orig_string))),
+						 have_error);
 	}
 #ifdef HAVE_BUGGY_SOLARIS_STRTOD
 	else
@@ -565,10 +598,11 @@ float8in_internal(char *num, char **endptr_p,
 	if (endptr_p)
 		*endptr_p = endptr;
 	else if (*endptr != '\0')
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-				 errmsg("invalid input syntax for type %s: \"%s\"",
-						type_name, orig_string)));
+		RETURN_ERROR(ereport(ERROR,
+							 (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+							  errmsg("invalid input syntax for type %s: \"%s\"",
+									 type_name, orig_string))),
+					 have_error);
 
 	return val;
 }
@@ -1206,9 +1240,34 @@ dtof(PG_FUNCTION_ARGS)
 {
 	float8		num = PG_GETARG_FLOAT8(0);
 
-	CHECKFLOATVAL((float4) num, isinf(num), num == 0);
+	PG_RETURN_FLOAT4(float8_float4_opt_error(num, NULL));
+}
 
-	PG_RETURN_FLOAT4((float4) num);
+/*
+ * float8_float4_opt_error - dtof() with optional soft error reporting
+ *
+ * If have_error is not NULL, overflow or underflow sets *have_error and
+ * returns 0 instead of throwing an error.
+ */
+float4
+float8_float4_opt_error(float8 num, bool *have_error)
+{
+	float4		result = (float4) num;
+
+	/* same checks as CHECKFLOATVAL(result, isinf(num), num == 0) */
+	if (isinf(result) && !isinf(num))
+		RETURN_ERROR(ereport(ERROR,
+							 (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							  errmsg("value out of range: overflow"))),
+					 have_error);
+
+	if (result == 0.0 && num != 0)
+		RETURN_ERROR(ereport(ERROR,
+							 (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							  errmsg("value out of range: underflow"))),
+					 have_error);
+
+	return result;
 }
 
 
@@ -152,8 +152,6 @@ typedef enum
 	FROM_CHAR_DATE_ISOWEEK		/* ISO 8601 week date */
 } FromCharDateMode;
 
-typedef struct FormatNode FormatNode;
-
 typedef struct
 {
 	const char *name;
@@ -993,7 +991,10 @@ static int	from_char_parse_int(int *dest, char **src, FormatNode *node);
 static int	seq_search(char *name, const char *const * array, int type, int max, int *len);
 static int	from_char_seq_search(int *dest, char **src, const char *const * array, int type, int max, FormatNode *node);
 static void do_to_timestamp(text *date_txt, const char *fmt, int fmt_len,
-					bool strict, struct pg_tm * tm, fsec_t *fsec, int *flags);
+				FormatNode *format, bool strict, struct pg_tm * tm,
+				fsec_t *fsec, int *flags);
+static Datum do_to_datetime(text *date_txt, const char *fmt, int fmt_len,
+			   FormatNode *format, bool strict, Oid *typid, int32 *typmod);
 static char *fill_str(char *str, int c, int max);
 static FormatNode *NUM_cache(int len, NUMDesc *Num, text *pars_str, bool *shouldFree);
 static char *int_to_roman(int number);
@@ -3669,8 +3670,8 @@ to_timestamp(PG_FUNCTION_ARGS)
 	struct pg_tm tm;
 	fsec_t		fsec;
 
-	do_to_timestamp(date_txt, VARDATA(fmt), VARSIZE_ANY_EXHDR(fmt), false,
-					&tm, &fsec, NULL);
+	do_to_timestamp(date_txt, VARDATA(fmt), VARSIZE_ANY_EXHDR(fmt), NULL,
+					false, &tm, &fsec, NULL);
 
 	if (tm.tm_zone)
 	{
@@ -3704,8 +3705,8 @@ to_date(PG_FUNCTION_ARGS)
 	struct pg_tm tm;
 	fsec_t		fsec;
 
-	do_to_timestamp(date_txt, VARDATA(fmt), VARSIZE_ANY_EXHDR(fmt), false,
-					&tm, &fsec, NULL);
+	do_to_timestamp(date_txt, VARDATA(fmt), VARSIZE_ANY_EXHDR(fmt), NULL,
+					false, &tm, &fsec, NULL);
 
 	/* Prevent overflow in Julian-day routines */
 	if (!IS_VALID_JULIAN(tm.tm_year, tm.tm_mon, tm.tm_mday))
@@ -3729,12 +3730,56 @@ to_date(PG_FUNCTION_ARGS)
 Datum
 to_datetime(text *date_txt, const char *fmt, int fmt_len, bool strict,
 			Oid *typid, int32 *typmod)
+{
+	return do_to_datetime(date_txt, fmt, fmt_len, NULL, strict, typid, typmod);
+}
+
+/*
+ * Parse datetime format picture once, so that it can be applied to any
+ * number of input strings by to_datetime_compiled().  The result is
+ * allocated in the current memory context.
+ */
+FormatNode *
+to_datetime_compile_format(const char *fmt, int fmt_len)
+{
+	FormatNode *format;
+	char	   *fmt_str;
+
+	if (fmt_len < 0)
+		fmt_len = strlen(fmt);
+
+	fmt_str = pnstrdup(fmt, fmt_len);
+	format = (FormatNode *) palloc((fmt_len + 1) * sizeof(FormatNode));
+
+	parse_format(format, fmt_str, DCH_keywords,
+				 DCH_suff, DCH_index, DCH_TYPE, NULL);
+
+	pfree(fmt_str);
+
+	return format;
+}
+
+/*
+ * Same as to_datetime(), but with the format picture pre-parsed by
+ * to_datetime_compile_format().
+ */
+Datum
+to_datetime_compiled(text *date_txt, FormatNode *format, bool strict,
+					 Oid *typid, int32 *typmod)
+{
+	return do_to_datetime(date_txt, NULL, 0, format, strict, typid, typmod);
+}
+
+static Datum
+do_to_datetime(text *date_txt, const char *fmt, int fmt_len,
+			   FormatNode *format, bool strict, Oid *typid, int32 *typmod)
 {
 	struct pg_tm tm;
 	fsec_t		fsec;
 	int			flags;
 
-	do_to_timestamp(date_txt, fmt, fmt_len, strict, &tm, &fsec, &flags);
+	do_to_timestamp(date_txt, fmt, fmt_len, format, strict, &tm, &fsec,
+					&flags);
 
 	*typmod = -1; /* TODO implement FF1, ..., FF9 */
 
@@ -3884,10 +3929,10 @@ to_datetime(text *date_txt, const char *fmt, int fmt_len, bool strict,
  * struct 'tm' and 'fsec'.
  */
 static void
-do_to_timestamp(text *date_txt, const char *fmt_str, int fmt_len, bool strict,
-				struct pg_tm * tm, fsec_t *fsec, int *flags)
+do_to_timestamp(text *date_txt, const char *fmt_str, int fmt_len,
+				FormatNode *format, bool strict, struct pg_tm * tm,
+				fsec_t *fsec, int *flags)
 {
-	FormatNode *format;
 	TmFromChar	tmfc;
 	char 	   *fmt_tmp = NULL;
 	char	   *date_str;
@@ -3900,12 +3945,21 @@ do_to_timestamp(text *date_txt, const char *fmt_str, int fmt_len, bool strict,
 	*fsec = 0;
 	fmask = 0;					/* bit mask for ValidateDate() */
 
-	if (fmt_len < 0) /* zero-terminated */
+	if (format) /* pre-parsed by to_datetime_compile_format() */
+		fmt_len = 0;
+	else if (fmt_len < 0) /* zero-terminated */
 		fmt_len = strlen(fmt_str);
 	else if (fmt_len > 0) /* not zero-terminated */
 		fmt_str = fmt_tmp = pnstrdup(fmt_str, fmt_len);
 
-	if (fmt_len)
+	if (format)
+	{
+		DCH_from_char(format, date_str, &tmfc, strict);
+
+		if (flags)
+			*flags = DCH_datetime_type(format);
+	}
+	else if (fmt_len)
 	{
 		bool		incache;
 
@@ -325,6 +325,15 @@ jsonb_from_cstring(char *json, int len)
 	PG_RETURN_POINTER(JsonbValueToJsonb(state.res));
 }
 
+/*
+ * Convert json text of given length into jsonb.
+ */
+Jsonb *
+JsonbFromCStringLen(char *json, int len)
+{
+	return DatumGetJsonb(jsonb_from_cstring(json, len));
+}
+
 static size_t
 checkStringLen(size_t len)
 {
@@ -2325,6 +2334,29 @@ JsonbMakeEmptyObject(void)
 	return JsonbValueToJsonb(&jbv);
 }
 
+/*
+ * Convert a scalar JsonbValue into a C string, stripping the quotes of
+ * strings.
+ */
+char *
+JsonbValueUnquote(JsonbValue *v)
+{
+	if (v->type == jbvString)
+		return pnstrdup(v->val.string.val, v->val.string.len);
+	else if (v->type == jbvBool)
+		return pstrdup(v->val.boolean ? "true" : "false");
+	else if (v->type == jbvNumeric)
+		return DatumGetCString(DirectFunctionCall1(numeric_out,
+								   PointerGetDatum(v->val.numeric)));
+	else if (v->type == jbvNull)
+		return pstrdup("null");
+	else
+	{
+		elog(ERROR, "unrecognized jsonb value type %d", v->type);
+		return NULL;
+	}
+}
+
 char *
 JsonbUnquote(Jsonb *jb)
 {
@@ -2334,20 +2366,7 @@ JsonbUnquote(Jsonb *jb)
 
 		JsonbExtractScalar(&jb->root, &v);
 
-		if (v.type == jbvString)
-			return pnstrdup(v.val.string.val, v.val.string.len);
-		else if (v.type == jbvBool)
-			return pstrdup(v.val.boolean ? "true" : "false");
-		else if (v.type == jbvNumeric)
-			return DatumGetCString(DirectFunctionCall1(numeric_out,
-									   PointerGetDatum(v.val.numeric)));
-		else if (v.type == jbvNull)
-			return pstrdup("null");
-		else
-		{
-			elog(ERROR, "unrecognized jsonb value type %d", v.type);
-			return NULL;
-		}
+		return JsonbValueUnquote(&v);
 	}
 	else
 		return JsonbToCString(NULL, &jb->root, VARSIZE(jb));
@@ -18,8 +18,10 @@
 #include "access/stratnum.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
+#include "miscadmin.h"
 #include "utils/builtins.h"
 #include "utils/jsonb.h"
+#include "utils/jsonpath.h"
 #include "utils/varlena.h"
 
 typedef struct PathHashStack
@@ -28,8 +30,72 @@ typedef struct PathHashStack
 	struct PathHashStack *parent;
 } PathHashStack;
 
+/*
+ * Extraction of GIN entries from jsonpath queries.
+ *
+ * A jsonpath predicate is translated into a tree of AND/OR nodes whose
+ * leaves are GIN entries: keys and key/value equalities for jsonb_ops,
+ * path hashes for jsonb_path_ops.  The tree is a necessary condition for
+ * the predicate to be true, so matches are always rechecked.  The tree is
+ * passed to the consistent functions through extra_data[0].
+ */
+typedef enum JsonPathGinNodeType
+{
+	JSP_GIN_OR,
+	JSP_GIN_AND,
+	JSP_GIN_ENTRY
+} JsonPathGinNodeType;
+
+typedef struct JsonPathGinNode JsonPathGinNode;
+
+struct JsonPathGinNode
+{
+	JsonPathGinNodeType type;
+	union
+	{
+		int			nargs;		/* OR and AND nodes */
+		int			entryIndex;	/* ENTRY nodes, after entries are emitted */
+		Datum		entryDatum;	/* ENTRY nodes, before entries are emitted */
+	}			val;
+	JsonPathGinNode *args[FLEXIBLE_ARRAY_MEMBER];	/* OR and AND nodes */
+};
+
+/* jsonb_ops: list of path items from the innermost to the outermost */
+typedef struct JsonPathGinPathItem
+{
+	struct JsonPathGinPathItem *parent;
+	Datum		keyName;		/* key entry for jpiKey, NULL otherwise */
+	JsonPathItemType type;
+} JsonPathGinPathItem;
+
+typedef union JsonPathGinPath
+{
+	JsonPathGinPathItem *items;	/* jsonb_ops */
+	uint32		hash;			/* jsonb_path_ops */
+} JsonPathGinPath;
+
+typedef struct JsonPathGinContext JsonPathGinContext;
+
+typedef bool (*JsonPathGinAddPathItemFunc) (JsonPathGinPath *path,
+											JsonPathItem *jsp);
+typedef List *(*JsonPathGinExtractNodesFunc) (JsonPathGinContext *cxt,
+											  JsonPathGinPath path,
+											  JsonbValue *scalar,
+											  List *nodes);
+
+struct JsonPathGinContext
+{
+	JsonPathGinAddPathItemFunc add_path_item;
+	JsonPathGinExtractNodesFunc extract_nodes;
+	bool		lax;
+};
+
 static Datum make_text_key(char flag, const char *str, int len);
 static Datum make_scalar_key(const JsonbValue *scalarVal, bool is_key);
+static Datum *extract_jsp_query(JsonPath *jp, bool pathOps, int32 *nentries,
+				  Pointer **extra_data);
+static GinTernaryValue execute_jsp_gin_node(JsonPathGinNode *node,
+					 void *check, bool ternary);
 
 /*
  *
@@ -181,6 +247,18 @@ gin_extract_jsonb_query(PG_FUNCTION_ARGS)
 		if (j == 0 && strategy == JsonbExistsAllStrategyNumber)
 			*searchMode = GIN_SEARCH_MODE_ALL;
 	}
+	else if (strategy == JsonbJsonpathPredicateStrategyNumber)
+	{
+		/* Query is a jsonpath predicate */
+		JsonPath   *jp = PG_GETARG_JSONPATH(0);
+		Pointer   **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+
+		entries = extract_jsp_query(jp, false, nentries, extra_data);
+
+		/* a predicate giving no entries requires a full index scan */
+		if (!entries)
+			*searchMode = GIN_SEARCH_MODE_ALL;
+	}
 	else
 	{
 		elog(ERROR, "unrecognized strategy number: %d", strategy);
@@ -198,8 +276,7 @@ gin_consistent_jsonb(PG_FUNCTION_ARGS)
 
 	/* Jsonb	   *query = PG_GETARG_JSONB(2); */
 	int32		nkeys = PG_GETARG_INT32(3);
-
-	/* Pointer	   *extra_data = (Pointer *) PG_GETARG_POINTER(4); */
+	Pointer    *extra_data = (Pointer *) PG_GETARG_POINTER(4);
 	bool	   *recheck = (bool *) PG_GETARG_POINTER(5);
 	bool		res = true;
 	int32		i;
@@ -256,6 +333,21 @@ gin_consistent_jsonb(PG_FUNCTION_ARGS)
 			}
 		}
 	}
+	else if (strategy == JsonbJsonpathPredicateStrategyNumber)
+	{
+		/*
+		 * The extracted entries only form a necessary condition for the
+		 * predicate, so we must always recheck.
+		 */
+		*recheck = true;
+
+		if (nkeys > 0)
+		{
+			Assert(extra_data && extra_data[0]);
+			res = execute_jsp_gin_node((JsonPathGinNode *) extra_data[0],
+									   check, false) != GIN_FALSE;
+		}
+	}
 	else
 		elog(ERROR, "unrecognized strategy number: %d", strategy);
 
@@ -270,8 +362,7 @@ gin_triconsistent_jsonb(PG_FUNCTION_ARGS)
 
 	/* Jsonb	   *query = PG_GETARG_JSONB(2); */
 	int32		nkeys = PG_GETARG_INT32(3);
-
-	/* Pointer	   *extra_data = (Pointer *) PG_GETARG_POINTER(4); */
+	Pointer    *extra_data = (Pointer *) PG_GETARG_POINTER(4);
 	GinTernaryValue res = GIN_MAYBE;
 	int32		i;
 
@@ -308,6 +399,19 @@ gin_triconsistent_jsonb(PG_FUNCTION_ARGS)
 			}
 		}
 	}
+	else if (strategy == JsonbJsonpathPredicateStrategyNumber)
+	{
+		if (nkeys > 0)
+		{
+			Assert(extra_data && extra_data[0]);
+			res = execute_jsp_gin_node((JsonPathGinNode *) extra_data[0],
+									   check, true);
+
+			/* the result always has to be rechecked */
+			if (res == GIN_TRUE)
+				res = GIN_MAYBE;
+		}
+	}
 	else
 		elog(ERROR, "unrecognized strategy number: %d", strategy);
 
@@ -320,9 +424,10 @@ gin_triconsistent_jsonb(PG_FUNCTION_ARGS)
  *
  * In a jsonb_path_ops index, the GIN keys are uint32 hashes, one per JSON
  * value; but the JSON key(s) leading to each value are also included in its
- * hash computation.  This means we can only support containment queries,
- * but the index can distinguish, for example, {"foo": 42} from {"bar": 42}
- * since different hashes will be generated.
+ * hash computation.  This means we can only support containment queries
+ * and jsonpath predicates comparing paths with scalars, but the index can
+ * distinguish, for example, {"foo": 42} from {"bar": 42} since different
+ * hashes will be generated.
  *
  */
 
@@ -432,18 +537,35 @@ gin_extract_jsonb_query_path(PG_FUNCTION_ARGS)
 	int32	   *searchMode = (int32 *) PG_GETARG_POINTER(6);
 	Datum	   *entries;
 
-	if (strategy != JsonbContainsStrategyNumber)
-		elog(ERROR, "unrecognized strategy number: %d", strategy);
+	if (strategy == JsonbContainsStrategyNumber)
+	{
+		/* Query is a jsonb, so just apply gin_extract_jsonb_path ... */
+		entries = (Datum *)
+			DatumGetPointer(DirectFunctionCall2(gin_extract_jsonb_path,
+												PG_GETARG_DATUM(0),
+												PointerGetDatum(nentries)));
+
+		/* ... although "contains {}" requires a full index scan */
+		if (*nentries == 0)
+			*searchMode = GIN_SEARCH_MODE_ALL;
+	}
+	else if (strategy == JsonbJsonpathPredicateStrategyNumber)
+	{
+		/* Query is a jsonpath predicate */
+		JsonPath   *jp = PG_GETARG_JSONPATH(0);
+		Pointer   **extra_data = (Pointer **) PG_GETARG_POINTER(4);
 
-	/* Query is a jsonb, so just apply gin_extract_jsonb_path ... */
-	entries = (Datum *)
-		DatumGetPointer(DirectFunctionCall2(gin_extract_jsonb_path,
-											PG_GETARG_DATUM(0),
-											PointerGetDatum(nentries)));
+		entries = extract_jsp_query(jp, true, nentries, extra_data);
 
-	/* ... although "contains {}" requires a full index scan */
-	if (*nentries == 0)
-		*searchMode = GIN_SEARCH_MODE_ALL;
+		/* a predicate giving no entries requires a full index scan */
+		if (!entries)
+			*searchMode = GIN_SEARCH_MODE_ALL;
+	}
+	else
+	{
+		elog(ERROR, "unrecognized strategy number: %d", strategy);
+		entries = NULL;			/* keep compiler quiet */
+	}
 
 	PG_RETURN_POINTER(entries);
 }
@@ -456,32 +578,43 @@ gin_consistent_jsonb_path(PG_FUNCTION_ARGS)
 
 	/* Jsonb	   *query = PG_GETARG_JSONB(2); */
 	int32		nkeys = PG_GETARG_INT32(3);
-
-	/* Pointer	   *extra_data = (Pointer *) PG_GETARG_POINTER(4); */
+	Pointer    *extra_data = (Pointer *) PG_GETARG_POINTER(4);
 	bool	   *recheck = (bool *) PG_GETARG_POINTER(5);
 	bool		res = true;
 	int32		i;
 
-	if (strategy != JsonbContainsStrategyNumber)
-		elog(ERROR, "unrecognized strategy number: %d", strategy);
-
 	/*
 	 * jsonb_path_ops is necessarily lossy, not only because of hash
 	 * collisions but also because it doesn't preserve complete information
 	 * about the structure of the JSON object.  Besides, there are some
 	 * special rules around the containment of raw scalars in arrays that are
-	 * not handled here.  So we must always recheck a match.  However, if not
-	 * all of the keys are present, the tuple certainly doesn't match.
+	 * not handled here.  So we must always recheck a match.
 	 */
 	*recheck = true;
-	for (i = 0; i < nkeys; i++)
+
+	if (strategy == JsonbContainsStrategyNumber)
 	{
-		if (!check[i])
+		/* if not all of the keys are present, the tuple doesn't match */
+		for (i = 0; i < nkeys; i++)
 		{
-			res = false;
-			break;
+			if (!check[i])
+			{
+				res = false;
+				break;
+			}
 		}
 	}
+	else if (strategy == JsonbJsonpathPredicateStrategyNumber)
+	{
+		if (nkeys > 0)
+		{
+			Assert(extra_data && extra_data[0]);
+			res = execute_jsp_gin_node((JsonPathGinNode *) extra_data[0],
+									   check, false) != GIN_FALSE;
+		}
+	}
+	else
+		elog(ERROR, "unrecognized strategy number: %d", strategy);
 
 	PG_RETURN_BOOL(res);
 }
@@ -494,27 +627,40 @@ gin_triconsistent_jsonb_path(PG_FUNCTION_ARGS)
 
 	/* Jsonb	   *query = PG_GETARG_JSONB(2); */
 	int32		nkeys = PG_GETARG_INT32(3);
-
-	/* Pointer	   *extra_data = (Pointer *) PG_GETARG_POINTER(4); */
+	Pointer    *extra_data = (Pointer *) PG_GETARG_POINTER(4);
 	GinTernaryValue res = GIN_MAYBE;
 	int32		i;
 
-	if (strategy != JsonbContainsStrategyNumber)
-		elog(ERROR, "unrecognized strategy number: %d", strategy);
-
 	/*
 	 * Note that we never return GIN_TRUE, only GIN_MAYBE or GIN_FALSE; this
 	 * corresponds to always forcing recheck in the regular consistent
 	 * function, for the reasons listed there.
 	 */
-	for (i = 0; i < nkeys; i++)
+	if (strategy == JsonbContainsStrategyNumber)
+	{
+		for (i = 0; i < nkeys; i++)
+		{
+			if (check[i] == GIN_FALSE)
+			{
+				res = GIN_FALSE;
+				break;
+			}
+		}
+	}
+	else if (strategy == JsonbJsonpathPredicateStrategyNumber)
 	{
-		if (check[i] == GIN_FALSE)
+		if (nkeys > 0)
 		{
-			res = GIN_FALSE;
-			break;
+			Assert(extra_data && extra_data[0]);
+			res = execute_jsp_gin_node((JsonPathGinNode *) extra_data[0],
+									   check, true);
+
+			if (res == GIN_TRUE)
+				res = GIN_MAYBE;
 		}
 	}
+	else
+		elog(ERROR, "unrecognized strategy number: %d", strategy);
 
 	PG_RETURN_GIN_TERNARY_VALUE(res);
 }
@@ -610,3 +756,571 @@ make_scalar_key(const JsonbValue *scalarVal, bool is_key)
 
 	return item;
 }
+
+/*
+ *
+ * jsonpath support for jsonb GIN opclasses
+ *
+ */
+
+static JsonPathGinNode *
+make_jsp_entry_node(Datum entry)
+{
+	JsonPathGinNode *node = palloc(offsetof(JsonPathGinNode, args));
+
+	node->type = JSP_GIN_ENTRY;
+	node->val.entryDatum = entry;
+
+	return node;
+}
+
+static JsonPathGinNode *
+make_jsp_entry_node_scalar(JsonbValue *scalar, bool iskey)
+{
+	return make_jsp_entry_node(make_scalar_key(scalar, iskey));
+}
+
+static JsonPathGinNode *
+make_jsp_expr_node(JsonPathGinNodeType type, int nargs)
+{
+	JsonPathGinNode *node = palloc(offsetof(JsonPathGinNode, args) +
+								   sizeof(node->args[0]) * nargs);
+
+	node->type = type;
+	node->val.nargs = nargs;
+
+	return node;
+}
+
+static JsonPathGinNode *
+make_jsp_expr_node_args(JsonPathGinNodeType type, List *args)
+{
+	JsonPathGinNode *node = make_jsp_expr_node(type, list_length(args));
+	ListCell   *lc;
+	int			i = 0;
+
+	foreach(lc, args)
+		node->args[i++] = lfirst(lc);
+
+	return node;
+}
+
+static JsonPathGinNode *
+make_jsp_expr_node_binary(JsonPathGinNodeType type,
+						  JsonPathGinNode *arg1, JsonPathGinNode *arg2)
+{
+	JsonPathGinNode *node = make_jsp_expr_node(type, 2);
+
+	node->args[0] = arg1;
+	node->args[1] = arg2;
+
+	return node;
+}
+
+/* Append a jsonpath item to the jsonb_ops path, false if unsupported */
+static bool
+jsonb_ops_add_path_item(JsonPathGinPath *path, JsonPathItem *jsp)
+{
+	JsonPathGinPathItem *pentry;
+	Datum		keyName;
+
+	switch (jsp->type)
+	{
+		case jpiRoot:
+			path->items = NULL;	/* reset path */
+			return true;
+
+		case jpiKey:
+			{
+				int32		len;
+				char	   *key = jspGetString(jsp, &len);
+
+				keyName = make_text_key(JGINFLAG_KEY, key, len);
+				break;
+			}
+
+		case jpiAny:
+		case jpiAnyKey:
+		case jpiAnyArray:
+		case jpiIndexArray:
+			keyName = PointerGetDatum(NULL);
+			break;
+
+		default:
+			/* other items like item methods are not supported */
+			return false;
+	}
+
+	pentry = palloc(sizeof(*pentry));
+
+	pentry->type = jsp->type;
+	pentry->keyName = keyName;
+	pentry->parent = path->items;
+
+	path->items = pentry;
+
+	return true;
+}
+
+/* Mix a jsonpath item into the jsonb_path_ops path hash, false if unsupported */
+static bool
+jsonb_path_ops_add_path_item(JsonPathGinPath *path, JsonPathItem *jsp)
+{
+	switch (jsp->type)
+	{
+		case jpiRoot:
+			path->hash = 0;		/* reset path hash */
+			return true;
+
+		case jpiKey:
+			{
+				JsonbValue	jbv;
+
+				jbv.type = jbvString;
+				jbv.val.string.val = jspGetString(jsp, &jbv.val.string.len);
+
+				JsonbHashScalarValue(&jbv, &path->hash);
+				return true;
+			}
+
+		case jpiIndexArray:
+		case jpiAnyArray:
+			return true;		/* array levels do not change the hash */
+
+		default:
+			/* wildcards and item methods are not supported */
+			return false;
+	}
+}
+
+static List *
+jsonb_ops_extract_nodes(JsonPathGinContext *cxt, JsonPathGinPath path,
+						JsonbValue *scalar, List *nodes)
+{
+	JsonPathGinPathItem *pentry;
+
+	/* every key of the path has to be present in the document */
+	for (pentry = path.items; pentry; pentry = pentry->parent)
+	{
+		if (pentry->type == jpiKey)
+			nodes = lappend(nodes, make_jsp_entry_node(pentry->keyName));
+	}
+
+	if (scalar)
+	{
+		JsonPathGinNode *node;
+
+		if (scalar->type == jbvString)
+		{
+			JsonPathGinPathItem *last = path.items;
+			GinTernaryValue key_entry;
+
+			/*
+			 * jsonb_ops indexes string array elements as keys, so we may need
+			 * a key entry, a non-key entry or any of both: arrays are
+			 * unwrapped automatically in lax mode, and .** can reach array
+			 * elements in strict mode.  A string root ($) is a raw scalar,
+			 * which is stored as an element of a pseudo array.
+			 */
+			if (cxt->lax)
+				key_entry = GIN_MAYBE;
+			else if (!last)		/* root ($) */
+				key_entry = GIN_TRUE;
+			else if (last->type == jpiAnyArray ||
+					 last->type == jpiIndexArray)
+				key_entry = GIN_TRUE;
+			else if (last->type == jpiAny)
+				key_entry = GIN_MAYBE;
+			else
+				key_entry = GIN_FALSE;
+
+			if (key_entry == GIN_MAYBE)
+				node = make_jsp_expr_node_binary(JSP_GIN_OR,
+									make_jsp_entry_node_scalar(scalar, true),
+									make_jsp_entry_node_scalar(scalar, false));
+			else
+				node = make_jsp_entry_node_scalar(scalar,
+												  key_entry == GIN_TRUE);
+		}
+		else
+			node = make_jsp_entry_node_scalar(scalar, false);
+
+		nodes = lappend(nodes, node);
+	}
+
+	return nodes;
+}
+
+static List *
+jsonb_path_ops_extract_nodes(JsonPathGinContext *cxt, JsonPathGinPath path,
+							 JsonbValue *scalar, List *nodes)
+{
+	if (scalar)
+	{
+		/* append path hash node for equality queries */
+		uint32		hash = path.hash;
+
+		JsonbHashScalarValue(scalar, &hash);
+
+		return lappend(nodes, make_jsp_entry_node(UInt32GetDatum(hash)));
+	}
+
+	/* jsonb_path_ops can't tell whether a path merely exists */
+	return nodes;
+}
+
+static JsonPathGinNode *extract_jsp_bool_expr(JsonPathGinContext *cxt,
+					  JsonPathGinPath path, JsonPathItem *jsp, bool not);
+
+/*
+ * Extract a list of nodes to be AND-ed from a path expression, optionally
+ * compared with a scalar.
+ */
+static List *
+extract_jsp_path_expr_nodes(JsonPathGinContext *cxt, JsonPathGinPath path,
+							JsonPathItem *jsp, JsonbValue *scalar)
+{
+	JsonPathItem next;
+	List	   *nodes = NIL;
+
+	for (;;)
+	{
+		switch (jsp->type)
+		{
+			case jpiCurrent:
+				break;
+
+			case jpiFilter:
+				{
+					JsonPathItem arg;
+					JsonPathGinNode *filter;
+
+					jspGetArg(jsp, &arg);
+
+					filter = extract_jsp_bool_expr(cxt, path, &arg, false);
+
+					if (filter)
+						nodes = lappend(nodes, filter);
+
+					break;
+				}
+
+			default:
+				if (!cxt->add_path_item(&path, jsp))
+
+					/*
+					 * The rest of the path is not supported by the opclass,
+					 * so return only the nodes extracted from filters.
+					 */
+					return nodes;
+				break;
+		}
+
+		if (!jspGetNext(jsp, &next))
+			break;
+
+		jsp = &next;
+	}
+
+	return cxt->extract_nodes(cxt, path, scalar, nodes);
+}
+
+/*
+ * Extract a node from a path expression, optionally compared with a scalar.
+ * NULL means that the path gives no conditions and a full scan is needed.
+ */
+static JsonPathGinNode *
+extract_jsp_path_expr(JsonPathGinContext *cxt, JsonPathGinPath path,
+					  JsonPathItem *jsp, JsonbValue *scalar)
+{
+	List	   *nodes = extract_jsp_path_expr_nodes(cxt, path, jsp, scalar);
+
+	if (nodes == NIL)
+		return NULL;
+
+	if (list_length(nodes) == 1)
+		return linitial(nodes);
+
+	return make_jsp_expr_node_args(JSP_GIN_AND, nodes);
+}
+
+/*
+ * Extract a node from a boolean jsonpath expression, possibly negated.
+ * NULL means that the expression gives no conditions.
+ */
+static JsonPathGinNode *
+extract_jsp_bool_expr(JsonPathGinContext *cxt, JsonPathGinPath path,
+					  JsonPathItem *jsp, bool not)
+{
+	check_stack_depth();
+
+	if (jspHasNext(jsp))
+		return NULL;			/* item methods applied to a predicate */
+
+	switch (jsp->type)
+	{
+		case jpiAnd:			/* expr && expr */
+		case jpiOr:				/* expr || expr */
+			{
+				JsonPathItem arg;
+				JsonPathGinNode *larg;
+				JsonPathGinNode *rarg;
+				JsonPathGinNodeType type;
+
+				/* apply De Morgan's laws for negated expressions */
+				type = not ^ (jsp->type == jpiAnd) ? JSP_GIN_AND : JSP_GIN_OR;
+
+				jspGetLeftArg(jsp, &arg);
+				larg = extract_jsp_bool_expr(cxt, path, &arg, not);
+
+				jspGetRightArg(jsp, &arg);
+				rarg = extract_jsp_bool_expr(cxt, path, &arg, not);
+
+				if (!larg || !rarg)
+				{
+					if (type == JSP_GIN_OR)
+						return NULL;
+
+					return larg ? larg : rarg;
+				}
+
+				return make_jsp_expr_node_binary(type, larg, rarg);
+			}
+
+		case jpiNot:			/* !expr */
+			{
+				JsonPathItem arg;
+
+				jspGetArg(jsp, &arg);
+
+				return extract_jsp_bool_expr(cxt, path, &arg, !not);
+			}
+
+		case jpiExists:			/* exists(path) */
+			{
+				JsonPathItem arg;
+
+				if (not)
+					return NULL;	/* NOT EXISTS is not supported */
+
+				jspGetArg(jsp, &arg);
+
+				return extract_jsp_path_expr(cxt, path, &arg, NULL);
+			}
+
+		case jpiLikeRegex:		/* path like_regex "pattern" */
+			{
+				JsonPathItem arg;
+
+				/* the pattern can match only an existing item of the path */
+				if (not)
+					return NULL;
+
+				jspInitByBuffer(&arg, jsp->base, jsp->content.like_regex.expr);
+
+				return extract_jsp_path_expr(cxt, path, &arg, NULL);
+			}
+
+		case jpiEqual:			/* path == scalar */
+			{
+				JsonPathItem left;
+				JsonPathItem right;
+				JsonPathItem *pathItem;
+				JsonPathItem *scalarItem;
+				JsonbValue	scalar;
+
+				/*
+				 * '!(path == scalar)' can't be supported, because it also
+				 * holds when some other item of the path is not equal to the
+				 * scalar.
+				 */
+				if (not)
+					return NULL;
+
+				jspGetLeftArg(jsp, &left);
+				jspGetRightArg(jsp, &right);
+
+				if (left.type <= jpiBool && !jspHasNext(&left))
+				{
+					scalarItem = &left;
+					pathItem = &right;
+				}
+				else if (right.type <= jpiBool && !jspHasNext(&right))
+				{
+					scalarItem = &right;
+					pathItem = &left;
+				}
+				else
+					return NULL;	/* one of operands must be a scalar */
+
+				switch (scalarItem->type)
+				{
+					case jpiNull:
+						scalar.type = jbvNull;
+						break;
+					case jpiBool:
+						scalar.type = jbvBool;
+						scalar.val.boolean = jspGetBool(scalarItem);
+						break;
+					case jpiNumeric:
+						scalar.type = jbvNumeric;
+						scalar.val.numeric = jspGetNumeric(scalarItem);
+						break;
+					case jpiString:
+						scalar.type = jbvString;
+						scalar.val.string.val =
+							jspGetString(scalarItem, &scalar.val.string.len);
+						break;
+					default:
+						elog(ERROR, "invalid scalar jsonpath item type: %d",
+							 scalarItem->type);
+						return NULL;
+				}
+
+				return extract_jsp_path_expr(cxt, path, pathItem, &scalar);
+			}
+
+		default:
+			/* other comparisons can't be answered by the index */
+			return NULL;
+	}
+}
+
+/* Recursively collect GIN entries of the tree, numbering them */
+static void
+emit_jsp_gin_entries(JsonPathGinNode *node, Datum **entries, int *nentries,
+					 int *allocated)
+{
+	check_stack_depth();
+
+	switch (node->type)
+	{
+		case JSP_GIN_ENTRY:
+			if (*nentries >= *allocated)
+			{
+				*allocated = *allocated ? *allocated * 2 : 8;
+				*entries = *entries ?
+					repalloc(*entries, sizeof(Datum) * *allocated) :
+					palloc(sizeof(Datum) * *allocated);
+			}
+
+			/* replace the datum with its index in the entry array */
+			(*entries)[*nentries] = node->val.entryDatum;
+			node->val.entryIndex = (*nentries)++;
+			break;
+
+		case JSP_GIN_OR:
+		case JSP_GIN_AND:
+			{
+				int			i;
+
+				for (i = 0; i < node->val.nargs; i++)
+					emit_jsp_gin_entries(node->args[i], entries, nentries,
+										 allocated);
+				break;
+			}
+	}
+}
+
+/*
+ * Extract GIN entries from a jsonpath predicate.  Returns NULL if nothing
+ * can be extracted, in which case a full index scan is needed.
+ */
+static Datum *
+extract_jsp_query(JsonPath *jp, bool pathOps, int32 *nentries,
+				  Pointer **extra_data)
+{
+	JsonPathGinContext cxt;
+	JsonPathItem root;
+	JsonPathGinNode *node;
+	JsonPathGinPath path = {0};
+	Datum	   *entries = NULL;
+	int			count = 0;
+	int			allocated = 0;
+
+	cxt.lax = (jp->header & JSONPATH_LAX) != 0;
+
+	if (pathOps)
+	{
+		cxt.add_path_item = jsonb_path_ops_add_path_item;
+		cxt.extract_nodes = jsonb_path_ops_extract_nodes;
+	}
+	else
+	{
+		cxt.add_path_item = jsonb_ops_add_path_item;
+		cxt.extract_nodes = jsonb_ops_extract_nodes;
+	}
+
+	jspInit(&root, jp);
+
+	node = extract_jsp_bool_expr(&cxt, path, &root, false);
+
+	*nentries = 0;
+
+	if (!node)
+		return NULL;
+
+	emit_jsp_gin_entries(node, &entries, &count, &allocated);
+
+	if (!count)
+		return NULL;
+
+	*nentries = count;
+	*extra_data = palloc0(sizeof(**extra_data) * count);
+	**extra_data = (Pointer) node;
+
+	return entries;
+}
+
+/*
+ * Evaluate the tree against the GIN check array, either bool[] for the
+ * consistent functions or GinTernaryValue[] for the triconsistent ones.
+ */
+static GinTernaryValue
+execute_jsp_gin_node(JsonPathGinNode *node, void *check, bool ternary)
+{
+	GinTernaryValue res;
+	GinTernaryValue v;
+	int			i;
+
+	switch (node->type)
+	{
+		case JSP_GIN_AND:
+			res = GIN_TRUE;
+			for (i = 0; i < node->val.nargs; i++)
+			{
+				v = execute_jsp_gin_node(node->args[i], check, ternary);
+				if (v == GIN_FALSE)
+					return GIN_FALSE;
+				else if (v == GIN_MAYBE)
+					res = GIN_MAYBE;
+			}
+			return res;
+
+		case JSP_GIN_OR:
+			res = GIN_FALSE;
+			for (i = 0; i < node->val.nargs; i++)
+			{
+				v = execute_jsp_gin_node(node->args[i], check, ternary);
+				if (v == GIN_TRUE)
+					return GIN_TRUE;
+				else if (v == GIN_MAYBE)
+					res = GIN_MAYBE;
+			}
+			return res;
+
+		case JSP_GIN_ENTRY:
+			{
+				int			index = node->val.entryIndex;
+
+				if (ternary)
+					return ((GinTernaryValue *) check)[index];
+				else
+					return ((bool *) check)[index] ? GIN_TRUE : GIN_FALSE;
+			}
+
+		default:
+			elog(ERROR, "invalid jsonpath gin node type: %d", node->type);
+			return GIN_FALSE;	/* keep compiler quiet */
+	}
+}
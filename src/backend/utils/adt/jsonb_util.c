@@ -442,6 +442,52 @@ getIthJsonbValueFromContainer(JsonbContainer *container, uint32 i)
 	return result;
 }
 
+/*
+ * Set up a positional cursor over elements of a Jsonb array.
+ */
+void
+JsonbArrayCursorInit(JsonbArrayCursor *cur, JsonbContainer *container)
+{
+	if (!JsonContainerIsArray(container))
+		elog(ERROR, "not a jsonb array");
+
+	cur->container = container;
+	cur->nElems = JsonContainerSize(container);
+	cur->dataProper = (char *) &container->children[cur->nElems];
+	cur->curIndex = -1;
+	cur->curDataOffset = 0;
+}
+
+/*
+ * Get i-th value of a Jsonb array into *result.
+ *
+ * The data offset is derived from the one of the previously fetched element
+ * when moving to an adjacent one, so scanning the array forwards or
+ * backwards does not look up offsets from scratch for each element.
+ * Returns false if the element does not exist.
+ */
+bool
+JsonbArrayCursorGet(JsonbArrayCursor *cur, uint32 i, JsonbValue *result)
+{
+	if (i >= cur->nElems)
+		return false;
+
+	if (cur->curIndex >= 0 && i == cur->curIndex + 1)
+		JBE_ADVANCE_OFFSET(cur->curDataOffset,
+						   cur->container->children[cur->curIndex]);
+	else if (cur->curIndex >= 0 && i == cur->curIndex - 1)
+		cur->curDataOffset -= getJsonbLength(cur->container, i);
+	else if (i != cur->curIndex)
+		cur->curDataOffset = getJsonbOffset(cur->container, i);
+
+	cur->curIndex = i;
+
+	fillJsonbValue(cur->container, i, cur->dataProper, cur->curDataOffset,
+				   result);
+
+	return true;
+}
+
 /*
  * A helper function to fill in a JsonbValue to represent an element of an
  * array, or a key or value of an object.
@@ -1320,6 +1366,24 @@ compareJsonbScalarValue(JsonbValue *aScalar, JsonbValue *bScalar)
 	return -1;
 }
 
+/*
+ * Compare two scalar values (excluding datetime) in the same order as
+ * compareJsonbContainers() does jsonb documents consisting of them, without
+ * building the documents.
+ */
+int
+compareJsonbScalars(JsonbValue *a, JsonbValue *b)
+{
+	Assert(a->type >= jbvNull && a->type <= jbvBool);
+	Assert(b->type >= jbvNull && b->type <= jbvBool);
+
+	if (a->type == b->type)
+		return compareJsonbScalarValue(a, b);
+
+	/* Type-defined order */
+	return (a->type > b->type) ? 1 : -1;
+}
+
 
 /*
  * Functions for manipulating the resizeable buffer used by convertJsonb and
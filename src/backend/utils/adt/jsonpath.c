@@ -11,25 +11,179 @@
  */
 
 #include "postgres.h"
+
+#include <math.h>
+
 #include "funcapi.h"
 #include "miscadmin.h"
+#include "access/sysattr.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
+#include "executor/execExpr.h"
 #include "lib/stringinfo.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/var.h"
 #include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/datetime.h"
 #include "utils/formatting.h"
 #include "utils/json.h"
+#include "utils/jsonapi.h"
 #include "utils/jsonpath.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
 #include "utils/varlena.h"
 
+/* Variable bound to a slot of compiled jsonpath, valid for one execution */
+typedef struct JsonPathVarSlot
+{
+	bool		computed;
+	JsonbValue	value;
+} JsonPathVarSlot;
+
+/* Cached result of a filter operand, valid for one evaluation of the filter */
+typedef struct JsonPathMemoSlot
+{
+	uint32		seq;			/* filter evaluation the result belongs to */
+	JsonPathExecResult res;
+	JsonValueList items;
+} JsonPathMemoSlot;
+
+/* Accessor of a path executed in one pass over json text */
+typedef struct JsonPathStreamStep
+{
+	JsonPathItemType type;		/* jpiKey, jpiIndexArray or jpiAnyArray */
+	char	   *key;
+	int32		keylen;
+	int32		index;
+} JsonPathStreamStep;
+
+/* Location of a result of a path executed over json text */
+typedef struct JsonPathStreamSpan
+{
+	int32		start;			/* offset of the value in json text */
+	int32		len;
+} JsonPathStreamSpan;
+
+/* Key accessor of a chain "$.a.b" looked up in the document of a memo */
+typedef struct JsonPathKeyMemoEntry
+{
+	int			parent;			/* entry of the preceding key, or -1 for $ */
+	char	   *key;
+	int32		keylen;
+	JsonbValue *value;			/* NULL if not an object member */
+	bool		resolved;		/* value is looked up in the document */
+} JsonPathKeyMemoEntry;
+
+/*
+ * Entries form a trie of key accessor chains, they can be added in advance
+ * and are kept on reset of the memo to another document.
+ */
+struct JsonPathKeyMemo
+{
+	Jsonb	   *json;
+	MemoryContext mcxt;			/* context of the looked up values */
+	int			nentries;
+	int			maxentries;
+	JsonPathKeyMemoEntry *entries;
+};
+
 typedef struct JsonPathExecContext
 {
 	List	   *vars;
+	JsonPathVarSlot *varSlots;		/* variables of compiled path, or NULL */
+	JsonPathMemoSlot *memo;			/* filter operand results, or NULL */
+	uint32		memoSeq;			/* last filter evaluation number */
+	uint32		filterSeq;			/* current filter evaluation number */
+	JsonbValue *foldArgs[2];		/* current $1 and $2 of reduce()/fold() */
 	bool		lax;
 	JsonbValue *root;				/* for $ evaluation */
 	int			innermostArraySize;	/* for LAST array index evaluation */
 } JsonPathExecContext;
 
+typedef struct JsonValueListIterator
+{
+	JsonValueListChunk *chunk;	/* current chunk, NULL at the start */
+	int			index;			/* index of the next item in the chunk */
+	int			count;			/* number of items returned */
+} JsonValueListIterator;
+
+typedef struct JsonTableScanState JsonTableScanState;
+typedef struct JsonTableJoinState JsonTableJoinState;
+
+struct JsonTableScanState
+{
+	JsonTableScanState *parent;
+	JsonTableJoinState *nested;
+	MemoryContext mcxt;
+	JsonPathCompiled *path;
+	List	   *args;
+	Jsonb	   *item;			/* context item of the path */
+	JsonPathIterator *pathIter;	/* lazy iterator, for ERROR ON ERROR */
+	JsonValueList found;		/* all items, for EMPTY ON ERROR */
+	JsonValueListIterator iter;
+	bool		isjson;			/* context item is json text */
+	text	   *json;			/* json text, if the path is executed on it */
+	JsonPathStreamSpan *spans;	/* locations of the items in json text */
+	int			nspans;
+	int			nextspan;
+	MemoryContext rowcxt;		/* current row item, reset for each row */
+	JsonPathKeyMemo *keys;		/* trie of the column paths, or NULL */
+	JsonExprDocCache doccache;	/* current item shared by the columns */
+	bool		needItem;		/* current item is read by the columns or
+								 * nested scans, otherwise only the items
+								 * are counted */
+	struct JsonTableContext *filter;	/* context of the quals pushed down
+										 * to the items, for the root scan */
+	Datum		current;
+	int			ordinal;
+	bool		currentIsNull;
+	bool		outerJoin;
+	bool		errorOnError;
+	bool		advanceNested;
+	bool		reset;
+};
+
+struct JsonTableJoinState
+{
+	union
+	{
+		struct
+		{
+			JsonTableJoinState *left;
+			JsonTableJoinState *right;
+			bool		cross;
+			bool		advanceRight;
+		}			join;
+		JsonTableScanState scan;
+	}			u;
+	bool		is_join;
+};
+
+/* random number to identify JsonTableContext */
+#define JSON_TABLE_CONTEXT_MAGIC	418352867
+
+typedef struct JsonTableContext
+{
+	int			magic;
+	struct
+	{
+		ExprState  *expr;
+		JsonTableScanState *scan;
+		bool		unused;			/* not needed by the query, NULL */
+	}		   *colexprs;
+	JsonTableScanState root;
+	ExprState  *pathexpr;		/* root path, if it is not constant */
+	JsonPathCache *pathcache;	/* compiled values of the root path */
+	TableFuncScanState *state;
+	ExprState  *rowqual;		/* quals on the root path columns, or NULL */
+	Bitmapset  *rowqualcols;	/* columns referenced by them */
+	MemoryContext rowqualcxt;	/* memory of a qual evaluation */
+	Datum	   *rowqualvalues;	/* values of rowqualcols computed by quals */
+	bool	   *rowqualnulls;
+	bool		rowqualmatched;	/* current root item passed the quals */
+} JsonTableContext;
+
 static inline JsonPathExecResult recursiveExecute(JsonPathExecContext *cxt,
 										   JsonPathItem *jsp, JsonbValue *jb,
 										   JsonValueList *found);
@@ -42,116 +196,218 @@ static inline JsonPathExecResult recursiveExecuteUnwrap(JsonPathExecContext *cxt
 
 static inline JsonbValue *wrapItemsInArray(const JsonValueList *items);
 
+static bool executeArrayFilter(JsonPathExecContext *cxt, JsonPathItem *filter,
+				   JsonbValue *jb, bool unwrap, JsonValueList *found,
+				   JsonPathExecResult *pres);
+
 static inline JsonbValue *wrapItem(JsonbValue *jbv);
 
+static JsonbValue *copyJsonbValue(JsonbValue *src);
+
 static Datum returnDATUM(void *arg, bool *isNull);
 
+static bool jspGetConstArrayIndex(JsonPathItem *jsp, int32 *index);
+
+static JsonTableJoinState *JsonTableInitPlanState(JsonTableContext *cxt,
+							Node *plan, JsonTableScanState *parent);
+
+static bool JsonTableNextRow(JsonTableScanState *scan);
+static Datum JsonTableGetValue(TableFuncScanState *state, int colnum,
+				  Oid typid, int32 typmod, bool *isnull);
+
+/*
+ * Items of JsonValueList with more than one item are stored by value in
+ * chunks, each chunk is twice larger than the previous one.  So collecting
+ * of n items takes O(log n) allocations instead of a list cell and a copy
+ * of JsonbValue for each item.
+ */
+#define JSON_VALUE_LIST_MIN_CHUNK	8
+#define JSON_VALUE_LIST_MAX_CHUNK	1024
+
+/*
+ * Get a free item at the tail of the list.  Chunks kept by
+ * JsonValueListReset() are reused before allocating new ones.
+ */
+static JsonbValue *
+JsonValueListAllocItem(JsonValueList *jvl)
+{
+	JsonValueListChunk *chunk = jvl->tail;
+
+	if (!chunk || chunk->nitems >= chunk->size)
+	{
+		if (chunk && chunk->next)
+			chunk = chunk->next;
+		else
+		{
+			JsonValueListChunk *prev = chunk;
+			int			size = prev ?
+				Min(prev->size * 2, JSON_VALUE_LIST_MAX_CHUNK) :
+				JSON_VALUE_LIST_MIN_CHUNK;
+
+			chunk = palloc(offsetof(JsonValueListChunk, items) +
+						   sizeof(JsonbValue) * size);
+			chunk->next = NULL;
+			chunk->size = size;
+
+			if (prev)
+				prev->next = chunk;
+			else
+				jvl->head = chunk;
+		}
+
+		chunk->nitems = 0;
+		jvl->tail = chunk;
+	}
+
+	return &chunk->items[chunk->nitems++];
+}
+
+/* Move the singleton item into the chunks before adding the second one */
 static inline void
-JsonValueListAppend(JsonValueList *jvl, JsonbValue *jbv)
+JsonValueListUnsingle(JsonValueList *jvl)
 {
 	if (jvl->singleton)
 	{
-		jvl->list = list_make2(jvl->singleton, jbv);
+		*JsonValueListAllocItem(jvl) = *jvl->singleton;
 		jvl->singleton = NULL;
 	}
-	else if (!jvl->list)
+}
+
+/* Append an item, the first one is referenced by pointer without copying */
+static inline void
+JsonValueListAppend(JsonValueList *jvl, JsonbValue *jbv)
+{
+	if (jvl->length <= 0)
 		jvl->singleton = jbv;
 	else
-		jvl->list = lappend(jvl->list, jbv);
+	{
+		JsonValueListUnsingle(jvl);
+		*JsonValueListAllocItem(jvl) = *jbv;
+	}
+
+	jvl->length++;
+}
+
+/* Append a copy of an item, which can be allocated on the stack */
+static inline void
+JsonValueListAppendCopy(JsonValueList *jvl, JsonbValue *jbv)
+{
+	if (jvl->length <= 0 && !jvl->head)
+		jvl->singleton = copyJsonbValue(jbv);
+	else
+	{
+		JsonValueListUnsingle(jvl);
+		*JsonValueListAllocItem(jvl) = *jbv;
+	}
+
+	jvl->length++;
 }
 
+/*
+ * Append all the items of jvl2, its chunks become the part of jvl1.  Spare
+ * chunks of an empty jvl1 kept by JsonValueListReset() follow them.
+ */
 static inline void
 JsonValueListConcat(JsonValueList *jvl1, JsonValueList jvl2)
 {
-	if (jvl1->singleton)
+	if (jvl2.length <= 0)
+		return;
+
+	if (jvl2.singleton)
+		JsonValueListAppend(jvl1, jvl2.singleton);
+	else if (jvl1->length <= 0)
 	{
-		if (jvl2.singleton)
-			jvl1->list = list_make2(jvl1->singleton, jvl2.singleton);
-		else
-			jvl1->list = lcons(jvl1->singleton, jvl2.list);
+		if (jvl1->head && !jvl2.tail->next)
+			jvl2.tail->next = jvl1->head;
 
-		jvl1->singleton = NULL;
+		*jvl1 = jvl2;
 	}
-	else if (jvl2.singleton)
+	else
 	{
-		if (jvl1->list)
-			jvl1->list = lappend(jvl1->list, jvl2.singleton);
-		else
-			jvl1->singleton = jvl2.singleton;
+		JsonValueListUnsingle(jvl1);
+		jvl1->tail->next = jvl2.head;
+		jvl1->tail = jvl2.tail;
+		jvl1->length += jvl2.length;
 	}
-	else if (jvl1->list)
-		jvl1->list = list_concat(jvl1->list, jvl2.list);
-	else
-		jvl1->list = jvl2.list;
 }
 
 static inline int
 JsonValueListLength(JsonValueList *jvl)
 {
-	return jvl->singleton ? 1 : list_length(jvl->list);
+	return jvl->length;
 }
 
 static inline bool
 JsonValueListIsEmpty(JsonValueList *jvl)
 {
-	return !jvl->singleton && list_length(jvl->list) <= 0;
+	return jvl->length <= 0;
 }
 
 static inline JsonbValue *
 JsonValueListHead(JsonValueList *jvl)
 {
-	return jvl->singleton ? jvl->singleton : linitial(jvl->list);
+	return jvl->singleton ? jvl->singleton : &jvl->head->items[0];
 }
 
+/* Forget all the items, the chunks can be freed by the owner of context */
 static inline void
 JsonValueListClear(JsonValueList *jvl)
 {
-	jvl->singleton = NULL;
-	jvl->list = NIL;
+	memset(jvl, 0, sizeof(*jvl));
 }
 
-static inline List *
-JsonValueListGetList(JsonValueList *jvl)
+/*
+ * Forget all the items keeping the chunks for new items.  The items
+ * returned before are overwritten by the new ones.
+ */
+static inline void
+JsonValueListReset(JsonValueList *jvl)
 {
-	if (jvl->singleton)
-		return list_make1(jvl->singleton);
+	jvl->singleton = NULL;
+	jvl->tail = jvl->head;
+	jvl->length = 0;
 
-	return jvl->list;
+	if (jvl->head)
+		jvl->head->nitems = 0;
 }
 
-typedef struct JsonValueListIterator
-{
-	ListCell   *lcell;
-} JsonValueListIterator;
-
-#define JsonValueListIteratorEnd ((ListCell *) -1)
-
 static inline JsonbValue *
 JsonValueListNext(const JsonValueList *jvl, JsonValueListIterator *it)
 {
-	if (it->lcell == JsonValueListIteratorEnd)
+	if (it->count >= jvl->length)
 		return NULL;
 
-	if (it->lcell)
-		it->lcell = lnext(it->lcell);
-	else
-	{
-		if (jvl->singleton)
-		{
-			it->lcell = JsonValueListIteratorEnd;
-			return jvl->singleton;
-		}
+	it->count++;
+
+	if (jvl->singleton)
+		return jvl->singleton;
 
-		it->lcell = list_head(jvl->list);
+	if (!it->chunk)
+	{
+		it->chunk = jvl->head;
+		it->index = 0;
 	}
 
-	if (!it->lcell)
+	while (it->index >= it->chunk->nitems)
 	{
-		it->lcell = JsonValueListIteratorEnd;
-		return NULL;
+		it->chunk = it->chunk->next;
+		it->index = 0;
 	}
 
-	return lfirst(it->lcell);
+	return &it->chunk->items[it->index++];
+}
+
+static inline List *
+JsonValueListGetList(JsonValueList *jvl)
+{
+	JsonValueListIterator it = { 0 };
+	JsonbValue *jbv;
+	List	   *list = NIL;
+
+	while ((jbv = JsonValueListNext(jvl, &it)))
+		list = lappend(list, jbv);
+
+	return list;
 }
 
 /*****************************INPUT/OUTPUT************************************/
@@ -270,6 +526,29 @@ flattenJsonPathParseItem(StringInfo buf, JsonPathParseItem *item,
 				*(int32*)(buf->data + arg) = chld;
 			}
 			break;
+		case jpiLikeRegex:
+			{
+				int32		offs;
+
+				appendBinaryStringInfo(buf,
+									   (char *) &item->value.like_regex.flags,
+									   sizeof(item->value.like_regex.flags));
+				offs = buf->len;
+				appendBinaryStringInfo(buf, (char *) &offs /* fake value */,
+									   sizeof(offs));
+				appendBinaryStringInfo(buf,
+									   (char *) &item->value.like_regex.patternlen,
+									   sizeof(item->value.like_regex.patternlen));
+				appendBinaryStringInfo(buf, item->value.like_regex.pattern,
+									   item->value.like_regex.patternlen);
+				appendStringInfoChar(buf, '\0');
+
+				chld = flattenJsonPathParseItem(buf, item->value.like_regex.expr,
+												allowCurrent,
+												insideArraySubscript);
+				*(int32 *)(buf->data + offs) = chld;
+			}
+			break;
 		case jpiNull:
 			break;
 		case jpiRoot:
@@ -495,6 +774,7 @@ operationPriority(JsonPathItemType op)
 		case jpiLessOrEqual:
 		case jpiGreaterOrEqual:
 		case jpiStartsWith:
+		case jpiLikeRegex:
 			return 2;
 		case jpiAdd:
 		case jpiSub:
@@ -575,6 +855,31 @@ printJsonPathItem(StringInfo buf, JsonPathItem *v, bool inKey, bool printBracket
 			if (printBracketes)
 				appendStringInfoChar(buf, ')');
 			break;
+		case jpiLikeRegex:
+			if (printBracketes)
+				appendStringInfoChar(buf, '(');
+			jspInitByBuffer(&elem, v->base, v->content.like_regex.expr);
+			printJsonPathItem(buf, &elem, false,
+							  operationPriority(elem.type) <=
+							  operationPriority(v->type));
+			appendBinaryStringInfo(buf, " like_regex ", 12);
+			escape_json(buf, v->content.like_regex.pattern);
+			if (v->content.like_regex.flags)
+			{
+				appendBinaryStringInfo(buf, " flag \"", 7);
+				if (v->content.like_regex.flags & JSP_REGEX_ICASE)
+					appendStringInfoChar(buf, 'i');
+				if (v->content.like_regex.flags & JSP_REGEX_SLINE)
+					appendStringInfoChar(buf, 's');
+				if (v->content.like_regex.flags & JSP_REGEX_MLINE)
+					appendStringInfoChar(buf, 'm');
+				if (v->content.like_regex.flags & JSP_REGEX_WSPACE)
+					appendStringInfoChar(buf, 'x');
+				appendStringInfoChar(buf, '"');
+			}
+			if (printBracketes)
+				appendStringInfoChar(buf, ')');
+			break;
 		case jpiPlus:
 		case jpiMinus:
 			if (printBracketes)
@@ -849,6 +1154,8 @@ void
 jspInitByBuffer(JsonPathItem *v, char *base, int32 pos)
 {
 	v->base = base;
+	v->compiled = NULL;
+	v->memo = -1;
 
 	read_byte(v->type, base, pos);
 
@@ -888,6 +1195,8 @@ jspInitByBuffer(JsonPathItem *v, char *base, int32 pos)
 		case jpiNumeric:
 		case jpiBool:
 			v->content.value.data = base + pos;
+			v->content.value.varno = -1;
+			v->content.value.format = NULL;
 			break;
 		case jpiAnd:
 		case jpiOr:
@@ -921,6 +1230,13 @@ jspInitByBuffer(JsonPathItem *v, char *base, int32 pos)
 		case jpiReduce:
 			read_int32(v->content.arg, base, pos);
 			break;
+		case jpiLikeRegex:
+			read_int32(v->content.like_regex.flags, base, pos);
+			read_int32(v->content.like_regex.expr, base, pos);
+			read_int32(v->content.like_regex.patternlen, base, pos);
+			v->content.like_regex.pattern = base + pos;
+			v->content.like_regex.regex = NULL;
+			break;
 		case jpiIndexArray:
 			read_int32(v->content.array.nelems, base, pos);
 			read_int32_n(v->content.array.elems, base, pos,
@@ -945,3073 +1261,6441 @@ jspInitByBuffer(JsonPathItem *v, char *base, int32 pos)
 	}
 }
 
-void
-jspGetArg(JsonPathItem *v, JsonPathItem *a)
+/*
+ * Fill the representation of a child node at given position, either from
+ * the compiled path or by decoding it from the buffer.
+ */
+static inline void
+jspInitChild(JsonPathItem *v, JsonPathItem *a, int32 pos)
 {
-	Assert(
-		v->type == jpiFilter ||
-		v->type == jpiNot ||
-		v->type == jpiIsUnknown ||
-		v->type == jpiExists ||
-		v->type == jpiPlus ||
-		v->type == jpiMinus ||
-		v->type == jpiDatetime ||
-		v->type == jpiMap ||
-		v->type == jpiArray ||
-		v->type == jpiReduce
-	);
-
-	jspInitByBuffer(a, v->base, v->content.arg);
+	if (v->compiled)
+		*a = *v->compiled[pos];
+	else
+		jspInitByBuffer(a, v->base, pos);
 }
 
-bool
-jspGetNext(JsonPathItem *v, JsonPathItem *a)
+/*
+ * Fold arithmetic on numeric constants into a new constant item.  Errors
+ * like division by zero are left to be reported at run time.
+ */
+static void
+jspFoldArithmetic(JsonPathCompiled *cp, int32 pos)
 {
-	if (jspHasNext(v))
+	JsonPathItem *v = cp->items[pos];
+	JsonPathItem *left;
+	JsonPathItem *right = NULL;
+	JsonPathItem *c;
+	Datum		ldatum;
+	Datum		rdatum = (Datum) 0;
+	Numeric		res = NULL;
+	MemoryContext mcxt = CurrentMemoryContext;
+
+	if (v->type == jpiPlus || v->type == jpiMinus)
+		left = cp->items[v->content.arg];
+	else
 	{
-		Assert(
-			v->type == jpiString ||
-			v->type == jpiNumeric ||
-			v->type == jpiBool ||
-			v->type == jpiNull ||
-			v->type == jpiKey ||
-			v->type == jpiAny ||
-			v->type == jpiAnyArray ||
-			v->type == jpiAnyKey ||
-			v->type == jpiIndexArray ||
-			v->type == jpiFilter ||
-			v->type == jpiCurrent ||
-			v->type == jpiExists ||
-			v->type == jpiRoot ||
-			v->type == jpiVariable ||
-			v->type == jpiLast ||
-			v->type == jpiAdd ||
-			v->type == jpiSub ||
-			v->type == jpiMul ||
-			v->type == jpiDiv ||
-			v->type == jpiMod ||
-			v->type == jpiPlus ||
-			v->type == jpiMinus ||
-			v->type == jpiEqual ||
-			v->type == jpiNotEqual ||
-			v->type == jpiGreater ||
-			v->type == jpiGreaterOrEqual ||
-			v->type == jpiLess ||
-			v->type == jpiLessOrEqual ||
-			v->type == jpiAnd ||
-			v->type == jpiOr ||
-			v->type == jpiNot ||
-			v->type == jpiIsUnknown ||
-			v->type == jpiType ||
-			v->type == jpiSize ||
-			v->type == jpiAbs ||
-			v->type == jpiFloor ||
-			v->type == jpiCeiling ||
-			v->type == jpiDouble ||
-			v->type == jpiDatetime ||
-			v->type == jpiKeyValue ||
-			v->type == jpiStartsWith ||
-			v->type == jpiMap ||
-			v->type == jpiSequence ||
-			v->type == jpiArray ||
-			v->type == jpiObject ||
-			v->type == jpiReduce ||
-			v->type == jpiFold ||
-			v->type == jpiFoldl ||
-			v->type == jpiFoldr ||
-			v->type == jpiMin ||
-			v->type == jpiMax
-		);
+		left = cp->items[v->content.args.left];
+		right = cp->items[v->content.args.right];
+	}
 
-		if (a)
-			jspInitByBuffer(a, v->base, v->nextPos);
-		return true;
+	if (left->type != jpiNumeric || jspHasNext(left) ||
+		(right && (right->type != jpiNumeric || jspHasNext(right))))
+		return;
+
+	ldatum = NumericGetDatum(jspGetNumeric(left));
+
+	if (right)
+		rdatum = NumericGetDatum(jspGetNumeric(right));
+
+	PG_TRY();
+	{
+		switch (v->type)
+		{
+			case jpiAdd:
+				res = DatumGetNumeric(DirectFunctionCall2(numeric_add,
+														  ldatum, rdatum));
+				break;
+			case jpiSub:
+				res = DatumGetNumeric(DirectFunctionCall2(numeric_sub,
+														  ldatum, rdatum));
+				break;
+			case jpiMul:
+				res = DatumGetNumeric(DirectFunctionCall2(numeric_mul,
+														  ldatum, rdatum));
+				break;
+			case jpiDiv:
+				res = DatumGetNumeric(DirectFunctionCall2(numeric_div,
+														  ldatum, rdatum));
+				break;
+			case jpiMod:
+				res = DatumGetNumeric(DirectFunctionCall2(numeric_mod,
+														  ldatum, rdatum));
+				break;
+			case jpiPlus:
+				res = DatumGetNumeric(ldatum);
+				break;
+			case jpiMinus:
+				res = DatumGetNumeric(DirectFunctionCall1(numeric_uminus,
+														  ldatum));
+				break;
+			default:
+				elog(ERROR, "unknown jsonpath arithmetic operation %d",
+					 v->type);
+		}
+	}
+	PG_CATCH();
+	{
+		if (ERRCODE_TO_CATEGORY(geterrcode()) != ERRCODE_DATA_EXCEPTION)
+			PG_RE_THROW();
+
+		FlushErrorState();
+		MemoryContextSwitchTo(mcxt);
+
+		res = NULL;
 	}
+	PG_END_TRY();
 
-	return false;
+	if (!res)
+		return;
+
+	/* the constant takes the place of the operation in the chain */
+	c = palloc(sizeof(*c));
+	*c = *left;
+	c->nextPos = v->nextPos;
+	c->content.value.data = (char *) res;
+
+	cp->items[pos] = c;
 }
 
-void
-jspGetLeftArg(JsonPathItem *v, JsonPathItem *a)
+/*
+ * Rough estimate of the cost of evaluating the item with its continuation.
+ * *safe is reset if the evaluation can throw an error instead of returning
+ * it as the unknown result of a predicate.
+ */
+static int
+jspEstimateCost(JsonPathCompiled *cp, JsonPathItem *v, bool *safe)
 {
-	Assert(
-		v->type == jpiAnd ||
-		v->type == jpiOr ||
-		v->type == jpiEqual ||
-		v->type == jpiNotEqual ||
-		v->type == jpiLess ||
-		v->type == jpiGreater ||
-		v->type == jpiLessOrEqual ||
-		v->type == jpiGreaterOrEqual ||
-		v->type == jpiAdd ||
-		v->type == jpiSub ||
-		v->type == jpiMul ||
-		v->type == jpiDiv ||
-		v->type == jpiMod ||
-		v->type == jpiStartsWith ||
-		v->type == jpiFold ||
-		v->type == jpiFoldl ||
-		v->type == jpiFoldr
-	);
+	int			cost = 0;
 
-	jspInitByBuffer(a, v->base, v->content.args.left);
-}
+	for (;;)
+	{
+		switch (v->type)
+		{
+			case jpiNull:
+			case jpiBool:
+			case jpiNumeric:
+			case jpiString:
+			case jpiRoot:
+			case jpiCurrent:
+			case jpiLast:
+			case jpiKey:
+			case jpiType:
+			case jpiSize:
+			case jpiAbs:
+			case jpiFloor:
+			case jpiCeiling:
+			case jpiDouble:
+				cost += 1;
+				break;
+			case jpiVariable:
+				/* absence of the variable is reported by an error */
+				*safe = false;
+				cost += 1;
+				break;
+			case jpiAnyArray:
+			case jpiAnyKey:
+			case jpiKeyValue:
+				cost += 5;
+				break;
+			case jpiAny:
+				cost += 50;
+				break;
+			case jpiIndexArray:
+				{
+					int32		index;
 
-void
-jspGetRightArg(JsonPathItem *v, JsonPathItem *a)
-{
-	Assert(
-		v->type == jpiAnd ||
-		v->type == jpiOr ||
-		v->type == jpiEqual ||
-		v->type == jpiNotEqual ||
-		v->type == jpiLess ||
-		v->type == jpiGreater ||
-		v->type == jpiLessOrEqual ||
-		v->type == jpiGreaterOrEqual ||
-		v->type == jpiAdd ||
-		v->type == jpiSub ||
-		v->type == jpiMul ||
-		v->type == jpiDiv ||
-		v->type == jpiMod ||
-		v->type == jpiStartsWith ||
-		v->type == jpiFold ||
-		v->type == jpiFoldl ||
-		v->type == jpiFoldr
-	);
+					/* subscripts out of range of integer are reported by errors */
+					if (!jspGetConstArrayIndex(v, &index))
+						*safe = false;
+					cost += 2 * v->content.array.nelems;
+				}
+				break;
+			case jpiFilter:
+				cost += 10 + 5 * jspEstimateCost(cp, cp->items[v->content.arg],
+												 safe);
+				break;
+			case jpiAnd:
+			case jpiOr:
+			case jpiEqual:
+			case jpiNotEqual:
+			case jpiLess:
+			case jpiGreater:
+			case jpiLessOrEqual:
+			case jpiGreaterOrEqual:
+			case jpiStartsWith:
+				cost += 1 +
+					jspEstimateCost(cp, cp->items[v->content.args.left], safe) +
+					jspEstimateCost(cp, cp->items[v->content.args.right], safe);
+				break;
+			case jpiNot:
+			case jpiIsUnknown:
+			case jpiExists:
+				cost += 1 + jspEstimateCost(cp, cp->items[v->content.arg],
+											safe);
+				break;
+			case jpiLikeRegex:
+				cost += 20 +
+					jspEstimateCost(cp, cp->items[v->content.like_regex.expr],
+									safe);
+				break;
+			case jpiDatetime:
+				/* invalid template is reported by an error */
+				if (v->content.arg)
+					*safe = false;
+				cost += 20;
+				break;
+			default:
+				/*
+				 * arithmetic errors are thrown, and so can be the ones of
+				 * expressions evaluated by constructors, map() and folds
+				 */
+				*safe = false;
+				cost += 10;
+				break;
+		}
 
-	jspInitByBuffer(a, v->base, v->content.args.right);
-}
+		if (!jspHasNext(v))
+			break;
 
-bool
-jspGetBool(JsonPathItem *v)
-{
-	Assert(v->type == jpiBool);
+		v = cp->items[v->nextPos];
+	}
 
-	return (bool)*v->content.value.data;
+	return cost;
 }
 
-Numeric
-jspGetNumeric(JsonPathItem *v)
+/*
+ * Is the item a path of key and wildcard accessors starting from @?
+ */
+static bool
+jspIsSimpleCurrentPath(JsonPathCompiled *cp, JsonPathItem *v)
 {
-	Assert(v->type == jpiNumeric);
+	if (v->type != jpiCurrent || !jspHasNext(v))
+		return false;
 
-	return (Numeric)v->content.value.data;
-}
+	while (jspHasNext(v))
+	{
+		v = cp->items[v->nextPos];
 
-char*
-jspGetString(JsonPathItem *v, int32 *len)
-{
-	Assert(
-		v->type == jpiKey ||
-		v->type == jpiString ||
-		v->type == jpiVariable
-	);
+		if (v->type != jpiKey && v->type != jpiAnyArray &&
+			v->type != jpiAnyKey)
+			return false;
+	}
 
-	if (len)
-		*len = v->content.value.datalen;
-	return v->content.value.data;
+	return true;
 }
 
-static inline JsonbValue *
-JsonbInitBinary(JsonbValue *jbv, Jsonb *jb)
+static bool
+jspSimplePathsEqual(JsonPathCompiled *cp, JsonPathItem *v1, JsonPathItem *v2)
 {
-	jbv->type = jbvBinary;
-	jbv->val.binary.data = &jb->root;
-	jbv->val.binary.len = VARSIZE_ANY_EXHDR(jb);
+	for (;;)
+	{
+		if (v1->type != v2->type)
+			return false;
 
-	return jbv;
+		if (v1->type == jpiKey &&
+			(v1->content.value.datalen != v2->content.value.datalen ||
+			 memcmp(v1->content.value.data, v2->content.value.data,
+					v1->content.value.datalen)))
+			return false;
+
+		if (!jspHasNext(v1) || !jspHasNext(v2))
+			return jspHasNext(v1) == jspHasNext(v2);
+
+		v1 = cp->items[v1->nextPos];
+		v2 = cp->items[v2->nextPos];
+	}
 }
 
-static inline JsonbValue *
-JsonbWrapInBinary(JsonbValue *jbv, JsonbValue *out)
+/*
+ * Collect simple paths compared in the filter predicate, excluding nested
+ * filters having their own @.
+ */
+static List *
+jspCollectFilterOperands(JsonPathCompiled *cp, int32 pos, List *operands)
 {
-	Jsonb	   *jb = JsonbValueToJsonb(jbv);
+	JsonPathItem *v = cp->items[pos];
 
-	if (!out)
-		out = palloc(sizeof(*out));
+	switch (v->type)
+	{
+		case jpiAnd:
+		case jpiOr:
+			operands = jspCollectFilterOperands(cp, v->content.args.left,
+												operands);
+			operands = jspCollectFilterOperands(cp, v->content.args.right,
+												operands);
+			break;
+		case jpiNot:
+		case jpiIsUnknown:
+			operands = jspCollectFilterOperands(cp, v->content.arg, operands);
+			break;
+		case jpiEqual:
+		case jpiNotEqual:
+		case jpiLess:
+		case jpiGreater:
+		case jpiLessOrEqual:
+		case jpiGreaterOrEqual:
+			if (jspIsSimpleCurrentPath(cp, cp->items[v->content.args.left]))
+				operands = lappend(operands, cp->items[v->content.args.left]);
+			if (jspIsSimpleCurrentPath(cp, cp->items[v->content.args.right]))
+				operands = lappend(operands, cp->items[v->content.args.right]);
+			break;
+		default:
+			break;
+	}
 
-	return JsonbInitBinary(out, jb);
+	return operands;
 }
 
-bool
-jspGetArraySubscript(JsonPathItem *v, JsonPathItem *from, JsonPathItem *to,
-					 int i)
+/*
+ * Compile-time optimizations of the item, its children are already compiled
+ * and optimized:
+ *
+ * - arithmetic on numeric constants is folded;
+ * - operands of && and || are swapped if the right one looks cheaper and
+ *   neither can throw an error, which keeps the three-valued result intact;
+ * - the same path compared more than once inside a filter is evaluated only
+ *   once for each item filtered.
+ */
+static void
+jspOptimizeItem(JsonPathCompiled *cp, int32 pos)
 {
-	Assert(v->type == jpiIndexArray);
+	JsonPathItem *v = cp->items[pos];
 
-	jspInitByBuffer(from, v->base, v->content.array.elems[i].from);
+	switch (v->type)
+	{
+		case jpiAdd:
+		case jpiSub:
+		case jpiMul:
+		case jpiDiv:
+		case jpiMod:
+		case jpiPlus:
+		case jpiMinus:
+			jspFoldArithmetic(cp, pos);
+			break;
+		case jpiAnd:
+		case jpiOr:
+			{
+				bool		safe = true;
+				int			lcost = jspEstimateCost(cp,
+										cp->items[v->content.args.left], &safe);
+				int			rcost = jspEstimateCost(cp,
+										cp->items[v->content.args.right], &safe);
 
-	if (!v->content.array.elems[i].to)
-		return false;
+				if (safe && rcost < lcost)
+				{
+					int32		left = v->content.args.left;
 
-	jspInitByBuffer(to, v->base, v->content.array.elems[i].to);
+					v->content.args.left = v->content.args.right;
+					v->content.args.right = left;
+				}
+			}
+			break;
+		case jpiFilter:
+			{
+				List	   *operands =
+					jspCollectFilterOperands(cp, v->content.arg, NIL);
+				ListCell   *lc1;
 
-	return true;
-}
+				foreach(lc1, operands)
+				{
+					JsonPathItem *op1 = lfirst(lc1);
+					ListCell   *lc2;
 
-void
-jspGetSequenceElement(JsonPathItem *v, int i, JsonPathItem *elem)
-{
-	Assert(v->type == jpiSequence);
+					if (op1->memo >= 0)
+						continue;
+
+					for_each_cell(lc2, lnext(lc1))
+					{
+						JsonPathItem *op2 = lfirst(lc2);
+
+						if (op2->memo < 0 &&
+							jspSimplePathsEqual(cp, op1, op2))
+						{
+							if (op1->memo < 0)
+								op1->memo = cp->nmemo++;
+
+							op2->memo = op1->memo;
+						}
+					}
+				}
 
-	jspInitByBuffer(elem, v->base, v->content.sequence.elems[i]);
+				list_free(operands);
+			}
+			break;
+		default:
+			break;
+	}
 }
 
-void
-jspGetObjectField(JsonPathItem *v, int i, JsonPathItem *key, JsonPathItem *val)
+/*
+ * Get regex compile flags for the XQuery flags of LIKE_REGEX predicate.
+ */
+int
+jspGetLikeRegexCflags(uint32 flags)
 {
-	Assert(v->type == jpiObject);
-	jspInitByBuffer(key, v->base, v->content.object.fields[i].key);
-	jspInitByBuffer(val, v->base, v->content.object.fields[i].val);
+	int			cflags = REG_ADVANCED;
+
+	if (flags & JSP_REGEX_ICASE)
+		cflags |= REG_ICASE;
+	if (flags & JSP_REGEX_MLINE)
+		cflags |= REG_NEWLINE;
+	if (flags & JSP_REGEX_SLINE)
+		cflags &= ~REG_NEWLINE;
+	if (flags & JSP_REGEX_WSPACE)
+		cflags |= REG_EXPANDED;
+
+	return cflags;
 }
 
-
-/********************Execute functions for JsonPath***************************/
+static void
+jspFreeLikeRegex(void *arg)
+{
+	pg_regfree((regex_t *) arg);
+}
 
 /*
- * Find value of jsonpath variable in a list of passing params
+ * Compile the pattern of LIKE_REGEX predicate once for all the executions
+ * of the compiled path.  The regex library allocates with malloc(), so the
+ * pattern is freed together with the memory context of the path.
  */
 static void
-computeJsonPathVariable(JsonPathItem *variable, List *vars, JsonbValue *value)
+jspCompileLikeRegex(JsonPathItem *v)
 {
-	ListCell			*cell;
-	JsonPathVariable	*var = NULL;
-	bool				isNull;
-	Datum				computedValue;
-	char				*varName;
-	int					varNameLength;
+	regex_t    *regex = palloc(sizeof(*regex));
+	MemoryContextCallback *cb;
 
-	Assert(variable->type == jpiVariable);
-	varName = jspGetString(variable, &varNameLength);
+	RE_compile(regex, v->content.like_regex.pattern,
+			   v->content.like_regex.patternlen,
+			   jspGetLikeRegexCflags(v->content.like_regex.flags),
+			   DEFAULT_COLLATION_OID);
 
-	foreach(cell, vars)
-	{
-		var = (JsonPathVariable*)lfirst(cell);
+	cb = palloc(sizeof(*cb));
+	cb->func = jspFreeLikeRegex;
+	cb->arg = regex;
+	MemoryContextRegisterResetCallback(CurrentMemoryContext, cb);
 
-		if (strncmp(varName, VARDATA_ANY(var->varName),
-				Min(varNameLength, VARSIZE_ANY_EXHDR(var->varName))) == 0)
-			break;
+	v->content.like_regex.regex = regex;
+}
 
-		var = NULL;
-	}
+/*
+ * Decode the node at given position and all its descendants into the item
+ * array of a compiled path.
+ */
+static void
+jspCompileItem(JsonPathCompiled *cp, char *base, int32 pos)
+{
+	JsonPathItem *v;
+	int			i;
 
-	if (var == NULL)
-		ereport(ERROR,
-				(errcode(ERRCODE_NO_DATA_FOUND),
-				 errmsg("could not find '%s' passed variable",
-						pnstrdup(varName, varNameLength))));
+	check_stack_depth();
 
-	computedValue = var->cb(var->cb_arg, &isNull);
+	v = palloc(sizeof(*v));
+	jspInitByBuffer(v, base, pos);
+	cp->items[pos] = v;
 
-	if (isNull)
-	{
-		value->type = jbvNull;
-		return;
-	}
+	if (jspHasNext(v))
+		jspCompileItem(cp, base, v->nextPos);
 
-	switch(var->typid)
+	switch (v->type)
 	{
-		case BOOLOID:
-			value->type = jbvBool;
-			value->val.boolean = DatumGetBool(computedValue);
-			break;
-		case NUMERICOID:
-			value->type = jbvNumeric;
-			value->val.numeric = DatumGetNumeric(computedValue);
+		case jpiAnd:
+		case jpiOr:
+		case jpiAdd:
+		case jpiSub:
+		case jpiMul:
+		case jpiDiv:
+		case jpiMod:
+		case jpiEqual:
+		case jpiNotEqual:
+		case jpiLess:
+		case jpiGreater:
+		case jpiLessOrEqual:
+		case jpiGreaterOrEqual:
+		case jpiStartsWith:
+		case jpiFold:
+		case jpiFoldl:
+		case jpiFoldr:
+			jspCompileItem(cp, base, v->content.args.left);
+			jspCompileItem(cp, base, v->content.args.right);
 			break;
+		case jpiNot:
+		case jpiExists:
+		case jpiIsUnknown:
+		case jpiPlus:
+		case jpiMinus:
+		case jpiFilter:
+		case jpiMap:
+		case jpiArray:
+		case jpiReduce:
+			/* argument is optional for some items */
+			if (v->content.arg)
+				jspCompileItem(cp, base, v->content.arg);
 			break;
-		case INT2OID:
-			value->type = jbvNumeric;
-			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
-												int2_numeric, computedValue));
+		case jpiDatetime:
+			if (v->content.arg)
+			{
+				JsonPathItem *tmpl;
+
+				jspCompileItem(cp, base, v->content.arg);
+
+				/* parse the template once instead of on every execution */
+				tmpl = cp->items[v->content.arg];
+
+				if (tmpl->type == jpiString)
+					tmpl->content.value.format =
+						to_datetime_compile_format(tmpl->content.value.data,
+												   tmpl->content.value.datalen);
+			}
 			break;
-		case INT4OID:
-			value->type = jbvNumeric;
-			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
-												int4_numeric, computedValue));
+		case jpiLikeRegex:
+			jspCompileItem(cp, base, v->content.like_regex.expr);
+			jspCompileLikeRegex(v);
 			break;
-		case INT8OID:
-			value->type = jbvNumeric;
-			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
-												int8_numeric, computedValue));
-			break;
-		case FLOAT4OID:
-			value->type = jbvNumeric;
-			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
-												float4_numeric, computedValue));
-			break;
-		case FLOAT8OID:
-			value->type = jbvNumeric;
-			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
-												float4_numeric, computedValue));
+		case jpiIndexArray:
+			for (i = 0; i < v->content.array.nelems; i++)
+			{
+				jspCompileItem(cp, base, v->content.array.elems[i].from);
+				if (v->content.array.elems[i].to)
+					jspCompileItem(cp, base, v->content.array.elems[i].to);
+			}
 			break;
-		case TEXTOID:
-		case VARCHAROID:
-			value->type = jbvString;
-			value->val.string.val = VARDATA_ANY(computedValue);
-			value->val.string.len = VARSIZE_ANY_EXHDR(computedValue);
+		case jpiSequence:
+			for (i = 0; i < v->content.sequence.nelems; i++)
+				jspCompileItem(cp, base, v->content.sequence.elems[i]);
 			break;
-		case DATEOID:
-		case TIMEOID:
-		case TIMETZOID:
-		case TIMESTAMPOID:
-		case TIMESTAMPTZOID:
-			value->type = jbvDatetime;
-			value->val.datetime.typid = var->typid;
-			value->val.datetime.typmod = var->typmod;
-			value->val.datetime.value = computedValue;
+		case jpiObject:
+			for (i = 0; i < v->content.object.nfields; i++)
+			{
+				jspCompileItem(cp, base, v->content.object.fields[i].key);
+				jspCompileItem(cp, base, v->content.object.fields[i].val);
+			}
 			break;
-		case JSONBOID:
+		case jpiVariable:
+			/* bind the variable to a slot shared by all its references */
+			for (i = 0; i < pos; i++)
 			{
-				Jsonb	   *jb = DatumGetJsonb(computedValue);
+				JsonPathItem *var = cp->items[i];
 
-				if (JB_ROOT_IS_SCALAR(jb))
-					JsonbExtractScalar(&jb->root, value);
-				else
-					JsonbInitBinary(value, jb);
+				if (var && var->type == jpiVariable &&
+					var->content.value.datalen == v->content.value.datalen &&
+					!memcmp(var->content.value.data, v->content.value.data,
+							v->content.value.datalen))
+				{
+					v->content.value.varno = var->content.value.varno;
+					break;
+				}
 			}
-			break;
-		case (Oid) -1: /* JsonbValue */
-			*value = *(JsonbValue *) DatumGetPointer(computedValue);
+
+			if (v->content.value.varno < 0)
+				v->content.value.varno = cp->nvars++;
 			break;
 		default:
-			ereport(ERROR,
-					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-					 errmsg("only bool, numeric and text types could be casted to supported jsonpath types")));
+			break;
 	}
+
+	/* children are resolved through the compiled item array from now on */
+	v->compiled = cp->items;
+
+	jspOptimizeItem(cp, pos);
 }
 
 /*
- * Convert jsonpath's scalar or variable node to actual jsonb value
+ * Get constant integer subscript of a single element accessor "[n]".
  */
-static void
-computeJsonPathItem(JsonPathExecContext *cxt, JsonPathItem *item, JsonbValue *value)
+static bool
+jspGetConstArrayIndex(JsonPathItem *jsp, int32 *index)
 {
-	switch(item->type)
-	{
-		case jpiNull:
-			value->type = jbvNull;
-			break;
-		case jpiBool:
-			value->type = jbvBool;
-			value->val.boolean = jspGetBool(item);
-			break;
-		case jpiNumeric:
-			value->type = jbvNumeric;
-			value->val.numeric = jspGetNumeric(item);
-			break;
-		case jpiString:
-			value->type = jbvString;
-			value->val.string.val = jspGetString(item, &value->val.string.len);
-			break;
-		case jpiVariable:
-			computeJsonPathVariable(item, cxt->vars, value);
-			break;
-		default:
-			elog(ERROR, "Wrong type");
-	}
-}
+	JsonPathItem from;
+	JsonPathItem to;
+	char	   *str;
+	char	   *end;
+	long		val;
+
+	if (jsp->content.array.nelems != 1 ||
+		jspGetArraySubscript(jsp, &from, &to, 0) ||
+		from.type != jpiNumeric)
+		return false;
+
+	str = DatumGetCString(DirectFunctionCall1(numeric_out,
+								NumericGetDatum(jspGetNumeric(&from))));
+
+	errno = 0;
+	val = strtol(str, &end, 10);
+
+	if (errno || *end || val < PG_INT32_MIN || val > PG_INT32_MAX)
+		return false;
 
+	*index = (int32) val;
+
+	return true;
+}
 
 /*
- * Returns jbv* type of of JsonbValue. Note, it never returns
- * jbvBinary as is - jbvBinary is used as mark of store naked
- * scalar value. To improve readability it defines jbvScalar
- * as alias to jbvBinary
+ * Extract accessors of a lax path "$.a[1][*].b" consisting only of member
+ * accessors, constant single element subscripts and array wildcards.  Such
+ * path can be executed in one pass over json text without its conversion
+ * into jsonb, see JsonPathIteratorInitJson().
  */
-#define jbvScalar jbvBinary
-static inline int
-JsonbType(JsonbValue *jb)
+static void
+jspCompileStream(JsonPathCompiled *cp)
 {
-	int type = jb->type;
+	JsonPathItem item = *cp->root;
+	JsonPathItem next;
+	int			nsteps = 0;
 
-	if (jb->type == jbvBinary)
+	cp->stream = NULL;
+	cp->nstream = 0;
+
+	if (!cp->lax || item.type != jpiRoot)
+		return;
+
+	while (jspGetNext(&item, &next))
 	{
-		JsonbContainer	*jbc = jb->val.binary.data;
+		item = next;
 
-		if (JsonContainerIsScalar(jbc))
-			type = jbvScalar;
-		else if (JsonContainerIsObject(jbc))
-			type = jbvObject;
-		else if (JsonContainerIsArray(jbc))
-			type = jbvArray;
-		else
-			elog(ERROR, "Unknown container type: 0x%08x", jbc->header);
+		if (item.type != jpiKey &&
+			item.type != jpiAnyArray &&
+			item.type != jpiIndexArray)
+			return;
+
+		nsteps++;
 	}
 
-	return type;
-}
+	if (!nsteps)
+		return;
 
-static const char *
-JsonbTypeName(JsonbValue *jb)
-{
-	JsonbValue jbvbuf;
+	cp->stream = palloc(sizeof(*cp->stream) * nsteps);
 
-	if (jb->type == jbvBinary)
+	item = *cp->root;
+
+	while (jspGetNext(&item, &next))
 	{
-		JsonbContainer *jbc = jb->val.binary.data;
+		JsonPathStreamStep *step = &cp->stream[cp->nstream++];
 
-		if (JsonContainerIsScalar(jbc))
-			jb = JsonbExtractScalar(jbc, &jbvbuf);
-		else if (JsonContainerIsArray(jbc))
-			return "array";
-		else if (JsonContainerIsObject(jbc))
-			return "object";
-		else
-			elog(ERROR, "Unknown container type: 0x%08x", jbc->header);
-	}
+		item = next;
+		step->type = item.type;
 
-	switch (jb->type)
-	{
-		case jbvObject:
-			return "object";
-		case jbvArray:
-			return "array";
-		case jbvNumeric:
-			return "number";
-		case jbvString:
-			return "string";
-		case jbvBool:
-			return "boolean";
-		case jbvNull:
-			return "null";
-		case jbvDatetime:
-			switch (jb->val.datetime.typid)
-			{
-				case DATEOID:
-					return "date";
-				case TIMEOID:
-					return "time without time zone";
-				case TIMETZOID:
-					return "time with time zone";
-				case TIMESTAMPOID:
-					return "timestamp without time zone";
-				case TIMESTAMPTZOID:
-					return "timestamp with time zone";
-				default:
-					elog(ERROR, "unknown jsonb value datetime type oid %d",
-						 jb->val.datetime.typid);
-			}
-			return "unknown";
-		default:
-			elog(ERROR, "Unknown jsonb value type: %d", jb->type);
-			return "unknown";
+		if (item.type == jpiKey)
+			step->key = jspGetString(&item, &step->keylen);
+		else if (item.type == jpiIndexArray &&
+				 !jspGetConstArrayIndex(&item, &step->index))
+		{
+			pfree(cp->stream);
+			cp->stream = NULL;
+			cp->nstream = 0;
+			return;
+		}
 	}
 }
 
-static int
-JsonbArraySize(JsonbValue *jb)
+/*
+ * Compile jsonpath in given memory context.  The result can be evaluated
+ * by executeCompiledJsonPath() any number of times.
+ */
+JsonPathCompiled *
+jspCompile(JsonPath *js, MemoryContext mcxt)
 {
-	if (jb->type == jbvArray)
-		return jb->val.array.nElems;
+	MemoryContext oldcxt = MemoryContextSwitchTo(mcxt);
+	JsonPathCompiled *cp = palloc(sizeof(*cp));
+	int32		size = VARSIZE(js) - JSONPATH_HDRSZ;
 
-	if (jb->type == jbvBinary)
-	{
-		JsonbContainer *jbc = jb->val.binary.data;
+	Assert((js->header & ~JSONPATH_LAX) == JSONPATH_VERSION);
 
-		if (JsonContainerIsArray(jbc) && !JsonContainerIsScalar(jbc))
-			return JsonContainerSize(jbc);
-	}
+	cp->path = palloc(VARSIZE(js));
+	memcpy(cp->path, js, VARSIZE(js));
+	cp->lax = (js->header & JSONPATH_LAX) != 0;
+	cp->items = palloc0(sizeof(*cp->items) * Max(size, 1));
+	cp->nvars = 0;
+	cp->nmemo = 0;
 
-	return -1;
-}
+	jspCompileItem(cp, cp->path->data, 0);
 
-static int
-compareNumeric(Numeric a, Numeric b)
-{
-	return	DatumGetInt32(
-				DirectFunctionCall2(
-					numeric_cmp,
-					PointerGetDatum(a),
-					PointerGetDatum(b)
-				)
-			);
+	cp->root = cp->items[0];
+
+	/* callers need not catch errors of a path which cannot throw them */
+	cp->nothrow = true;
+	(void) jspEstimateCost(cp, cp->root, &cp->nothrow);
+
+	jspCompileStream(cp);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return cp;
 }
 
-static inline JsonPathExecResult
-checkEquality(JsonbValue *jb1, JsonbValue *jb2, bool not)
+static bool
+jspItemHasDatetime(JsonPathItem *v)
 {
-	bool	eq = false;
-
-	if (jb1->type != jb2->type)
-	{
-		if (jb1->type == jbvNull || jb2->type == jbvNull)
-			return jperNotFound;
+	JsonPathItem arg;
+	JsonPathItem arg2;
+	int			i;
 
-		return jperError;
-	}
+	check_stack_depth();
 
-	switch (jb1->type)
+	switch (v->type)
 	{
-		case jbvNull:
-			eq = true;
-			break;
-		case jbvString:
-			eq = (jb1->val.string.len == jb2->val.string.len &&
-					memcmp(jb2->val.string.val, jb1->val.string.val,
-						   jb1->val.string.len) == 0);
+		case jpiDatetime:
+			return true;
+		case jpiAnd:
+		case jpiOr:
+		case jpiAdd:
+		case jpiSub:
+		case jpiMul:
+		case jpiDiv:
+		case jpiMod:
+		case jpiEqual:
+		case jpiNotEqual:
+		case jpiLess:
+		case jpiGreater:
+		case jpiLessOrEqual:
+		case jpiGreaterOrEqual:
+		case jpiStartsWith:
+		case jpiFold:
+		case jpiFoldl:
+		case jpiFoldr:
+			jspGetLeftArg(v, &arg);
+			jspGetRightArg(v, &arg2);
+			if (jspItemHasDatetime(&arg) || jspItemHasDatetime(&arg2))
+				return true;
 			break;
-		case jbvBool:
-			eq = (jb2->val.boolean == jb1->val.boolean);
+		case jpiNot:
+		case jpiExists:
+		case jpiIsUnknown:
+		case jpiPlus:
+		case jpiMinus:
+		case jpiFilter:
+		case jpiMap:
+		case jpiArray:
+		case jpiReduce:
+			/* argument is optional for some items */
+			if (v->content.arg)
+			{
+				jspGetArg(v, &arg);
+				if (jspItemHasDatetime(&arg))
+					return true;
+			}
 			break;
-		case jbvNumeric:
-			eq = (compareNumeric(jb1->val.numeric, jb2->val.numeric) == 0);
+		case jpiLikeRegex:
+			jspInitChild(v, &arg, v->content.like_regex.expr);
+			if (jspItemHasDatetime(&arg))
+				return true;
 			break;
-		case jbvDatetime:
-			{
-				PGFunction	eqfunc;
-
-				if (jb1->val.datetime.typid != jb2->val.datetime.typid)
-					return jperError;
-
-				/* TODO cross-type comparison */
-
-				switch (jb1->val.datetime.typid)
-				{
-					case DATEOID:
-						eqfunc = date_eq;
-						break;
-					case TIMEOID:
-						eqfunc = time_eq;
-						break;
-					case TIMETZOID:
-						eqfunc = timetz_eq;
-						break;
-					case TIMESTAMPOID:
-					case TIMESTAMPTZOID:
-						eqfunc = timestamp_eq;
-						break;
-					default:
-						elog(ERROR, "unknown jsonb value datetime type oid %d",
-							 jb1->val.datetime.typid);
-				}
-
-				eq = DatumGetBool(DirectFunctionCall2(eqfunc,
-													  jb1->val.datetime.value,
-													  jb2->val.datetime.value));
-				break;
+		case jpiIndexArray:
+			for (i = 0; i < v->content.array.nelems; i++)
+			{
+				if (jspGetArraySubscript(v, &arg, &arg2, i) &&
+					jspItemHasDatetime(&arg2))
+					return true;
+				if (jspItemHasDatetime(&arg))
+					return true;
 			}
-
-		case jbvBinary:
-		case jbvObject:
-		case jbvArray:
-			return jperError;
-
-		default:
-			elog(ERROR, "Unknown jsonb value type %d", jb1->type);
-	}
-
-	return (not ^ eq) ? jperOk : jperNotFound;
-}
-
-static JsonPathExecResult
-makeCompare(int32 op, JsonbValue *jb1, JsonbValue *jb2)
-{
-	int			cmp;
-	bool		res;
-
-	if (jb1->type != jb2->type)
-	{
-		if (jb1->type == jbvNull || jb2->type == jbvNull)
-			return jperNotFound;
-
-		return jperError;
-	}
-
-	switch (jb1->type)
-	{
-		case jbvNumeric:
-			cmp = compareNumeric(jb1->val.numeric, jb2->val.numeric);
-			break;
-		case jbvString:
-			cmp = varstr_cmp(jb1->val.string.val, jb1->val.string.len,
-							 jb2->val.string.val, jb2->val.string.len,
-							 DEFAULT_COLLATION_OID);
 			break;
-		case jbvDatetime:
+		case jpiSequence:
+			for (i = 0; i < v->content.sequence.nelems; i++)
 			{
-				PGFunction	cmpfunc;
-
-				if (jb1->val.datetime.typid != jb2->val.datetime.typid)
-					return jperError;
-
-				/* TODO cross-type comparison */
-
-				switch (jb1->val.datetime.typid)
-				{
-					case DATEOID:
-						cmpfunc = date_cmp;
-						break;
-					case TIMEOID:
-						cmpfunc = time_cmp;
-						break;
-					case TIMETZOID:
-						cmpfunc = timetz_cmp;
-						break;
-					case TIMESTAMPOID:
-					case TIMESTAMPTZOID:
-						cmpfunc = timestamp_cmp;
-						break;
-					default:
-						elog(ERROR, "unknown jsonb value datetime type oid %d",
-							 jb1->val.datetime.typid);
-				}
-
-				cmp = DatumGetInt32(DirectFunctionCall2(cmpfunc,
-													jb1->val.datetime.value,
-													jb2->val.datetime.value));
-				break;
+				jspGetSequenceElement(v, i, &arg);
+				if (jspItemHasDatetime(&arg))
+					return true;
 			}
-		default:
-			return jperError;
-	}
-
-	switch (op)
-	{
-		case jpiEqual:
-			res = (cmp == 0);
 			break;
-		case jpiNotEqual:
-			res = (cmp != 0);
-			break;
-		case jpiLess:
-			res = (cmp < 0);
-			break;
-		case jpiGreater:
-			res = (cmp > 0);
-			break;
-		case jpiLessOrEqual:
-			res = (cmp <= 0);
-			break;
-		case jpiGreaterOrEqual:
-			res = (cmp >= 0);
+		case jpiObject:
+			for (i = 0; i < v->content.object.nfields; i++)
+			{
+				jspGetObjectField(v, i, &arg, &arg2);
+				if (jspItemHasDatetime(&arg) || jspItemHasDatetime(&arg2))
+					return true;
+			}
 			break;
 		default:
-			elog(ERROR, "Unknown operation");
-			return jperError;
+			break;
 	}
 
-	return res ? jperOk : jperNotFound;
+	return jspGetNext(v, &arg) && jspItemHasDatetime(&arg);
 }
 
-static JsonbValue *
-copyJsonbValue(JsonbValue *src)
+/*
+ * Check whether the path contains .datetime() item methods, which are the
+ * only source of datetime items besides datetime PASSING variables.  The
+ * path is walked in its binary form, it is not compiled.
+ */
+bool
+jspHasDatetimeItems(JsonPath *js)
 {
-	JsonbValue	*dst = palloc(sizeof(*dst));
+	JsonPathItem v;
 
-	*dst = *src;
+	jspInit(&v, js);
 
-	return dst;
+	return jspItemHasDatetime(&v);
 }
 
-static inline JsonPathExecResult
-recursiveExecuteNext(JsonPathExecContext *cxt,
-					 JsonPathItem *cur, JsonPathItem *next,
-					 JsonbValue *v, JsonValueList *found, bool copy)
-{
-	JsonPathItem elem;
-	bool		hasNext;
+/* Number of distinct paths kept compiled by a path cache */
+#define JSONPATH_CACHE_SIZE		8
 
-	if (!cur)
-		hasNext = next != NULL;
-	else if (next)
-		hasNext = jspHasNext(cur);
-	else
-	{
-		next = &elem;
-		hasNext = jspGetNext(cur, next);
-	}
+typedef struct JsonPathCacheEntry
+{
+	JsonPathCompiled *path;
+	MemoryContext mcxt;			/* context the compiled path lives in */
+	uint64		lastUsed;		/* value of the use counter at the last hit */
+} JsonPathCacheEntry;
 
-	if (hasNext)
-		return recursiveExecute(cxt, next, v, found);
+struct JsonPathCache
+{
+	MemoryContext mcxt;
+	uint64		counter;		/* number of lookups */
+	int			nentries;
+	JsonPathCacheEntry entries[JSONPATH_CACHE_SIZE];
+};
+
+JsonPathCache *
+JsonPathCacheCreate(MemoryContext mcxt)
+{
+	JsonPathCache *cache = MemoryContextAllocZero(mcxt, sizeof(*cache));
 
-	if (found)
-		JsonValueListAppend(found, copy ? copyJsonbValue(v) : v);
+	cache->mcxt = mcxt;
 
-	return jperOk;
+	return cache;
 }
 
-static inline JsonPathExecResult
-recursiveExecuteAndUnwrap(JsonPathExecContext *cxt, JsonPathItem *jsp,
-						  JsonbValue *jb, JsonValueList *found)
+/*
+ * Get compiled jsonpath from the cache.  A path not found in the cache is
+ * compiled in place of the least recently used one, so the result is valid
+ * only until the next lookup.
+ */
+JsonPathCompiled *
+JsonPathCacheLookup(JsonPathCache *cache, JsonPath *jp)
 {
-	if (cxt->lax)
-	{
-		JsonValueList seq = { 0 };
-		JsonValueListIterator it = { 0 };
-		JsonPathExecResult res = recursiveExecute(cxt, jsp, jb, &seq);
-		JsonbValue *item;
+	JsonPathCacheEntry *entry = NULL;
+	int			i;
 
-		if (jperIsError(res))
-			return res;
+	for (i = 0; i < cache->nentries; i++)
+	{
+		JsonPathCacheEntry *e = &cache->entries[i];
 
-		while ((item = JsonValueListNext(&seq, &it)))
+		if (VARSIZE(e->path->path) == VARSIZE(jp) &&
+			!memcmp(e->path->path, jp, VARSIZE(jp)))
 		{
-			if (item->type == jbvArray)
-			{
-				JsonbValue *elem = item->val.array.elems;
-				JsonbValue *last = elem + item->val.array.nElems;
-
-				for (; elem < last; elem++)
-					JsonValueListAppend(found, copyJsonbValue(elem));
-			}
-			else if (item->type == jbvBinary &&
-					 JsonContainerIsArray(item->val.binary.data))
-			{
-				JsonbValue	elem;
-				JsonbIterator *it = JsonbIteratorInit(item->val.binary.data);
-				JsonbIteratorToken tok;
-
-				while ((tok = JsonbIteratorNext(&it, &elem, true)) != WJB_DONE)
-				{
-					if (tok == WJB_ELEM)
-						JsonValueListAppend(found, copyJsonbValue(&elem));
-				}
-			}
-			else
-				JsonValueListAppend(found, item);
+			e->lastUsed = ++cache->counter;
+			return e->path;
 		}
 
-		return jperOk;
+		if (!entry || e->lastUsed < entry->lastUsed)
+			entry = e;
 	}
 
-	return recursiveExecute(cxt, jsp, jb, found);
+	/* compiled paths live in their own contexts to be freed at once */
+	if (cache->nentries < JSONPATH_CACHE_SIZE)
+	{
+		entry = &cache->entries[cache->nentries++];
+		entry->mcxt = AllocSetContextCreate(cache->mcxt, "jsonpath cache",
+											ALLOCSET_SMALL_SIZES);
+	}
+	else
+		MemoryContextReset(entry->mcxt);
+
+	entry->path = jspCompile(jp, entry->mcxt);
+	entry->lastUsed = ++cache->counter;
+
+	return entry->path;
 }
 
-static JsonPathExecResult
-executeExpr(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *jb)
+void
+jspGetArg(JsonPathItem *v, JsonPathItem *a)
 {
-	JsonPathExecResult res;
-	JsonPathItem elem;
-	JsonValueList lseq = { 0 };
-	JsonValueList rseq = { 0 };
-	JsonValueListIterator lseqit = { 0 };
-	JsonbValue *lval;
-	bool		error = false;
-	bool		found = false;
-
-	jspGetLeftArg(jsp, &elem);
-	res = recursiveExecuteAndUnwrap(cxt, &elem, jb, &lseq);
-	if (jperIsError(res))
-		return jperError;
+	Assert(
+		v->type == jpiFilter ||
+		v->type == jpiNot ||
+		v->type == jpiIsUnknown ||
+		v->type == jpiExists ||
+		v->type == jpiPlus ||
+		v->type == jpiMinus ||
+		v->type == jpiDatetime ||
+		v->type == jpiMap ||
+		v->type == jpiArray ||
+		v->type == jpiReduce
+	);
 
-	jspGetRightArg(jsp, &elem);
-	res = recursiveExecuteAndUnwrap(cxt, &elem, jb, &rseq);
-	if (jperIsError(res))
-		return jperError;
+	jspInitChild(v, a, v->content.arg);
+}
 
-	while ((lval = JsonValueListNext(&lseq, &lseqit)))
+bool
+jspGetNext(JsonPathItem *v, JsonPathItem *a)
+{
+	if (jspHasNext(v))
 	{
-		JsonValueListIterator rseqit = { 0 };
-		JsonbValue *rval;
-
-		while ((rval = JsonValueListNext(&rseq, &rseqit)))
-		{
-			switch (jsp->type)
-			{
-				case jpiEqual:
-					res = checkEquality(lval, rval, false);
-					break;
+		Assert(
+			v->type == jpiString ||
+			v->type == jpiNumeric ||
+			v->type == jpiBool ||
+			v->type == jpiNull ||
+			v->type == jpiKey ||
+			v->type == jpiAny ||
+			v->type == jpiAnyArray ||
+			v->type == jpiAnyKey ||
+			v->type == jpiIndexArray ||
+			v->type == jpiFilter ||
+			v->type == jpiCurrent ||
+			v->type == jpiExists ||
+			v->type == jpiRoot ||
+			v->type == jpiVariable ||
+			v->type == jpiLast ||
+			v->type == jpiAdd ||
+			v->type == jpiSub ||
+			v->type == jpiMul ||
+			v->type == jpiDiv ||
+			v->type == jpiMod ||
+			v->type == jpiPlus ||
+			v->type == jpiMinus ||
+			v->type == jpiEqual ||
+			v->type == jpiNotEqual ||
+			v->type == jpiGreater ||
+			v->type == jpiGreaterOrEqual ||
+			v->type == jpiLess ||
+			v->type == jpiLessOrEqual ||
+			v->type == jpiAnd ||
+			v->type == jpiOr ||
+			v->type == jpiNot ||
+			v->type == jpiIsUnknown ||
+			v->type == jpiType ||
+			v->type == jpiSize ||
+			v->type == jpiAbs ||
+			v->type == jpiFloor ||
+			v->type == jpiCeiling ||
+			v->type == jpiDouble ||
+			v->type == jpiDatetime ||
+			v->type == jpiKeyValue ||
+			v->type == jpiStartsWith ||
+			v->type == jpiMap ||
+			v->type == jpiSequence ||
+			v->type == jpiArray ||
+			v->type == jpiObject ||
+			v->type == jpiReduce ||
+			v->type == jpiFold ||
+			v->type == jpiFoldl ||
+			v->type == jpiFoldr ||
+			v->type == jpiMin ||
+			v->type == jpiMax ||
+			v->type == jpiLikeRegex
+		);
+
+		if (a)
+			jspInitChild(v, a, v->nextPos);
+		return true;
+	}
+
+	return false;
+}
+
+void
+jspGetLeftArg(JsonPathItem *v, JsonPathItem *a)
+{
+	Assert(
+		v->type == jpiAnd ||
+		v->type == jpiOr ||
+		v->type == jpiEqual ||
+		v->type == jpiNotEqual ||
+		v->type == jpiLess ||
+		v->type == jpiGreater ||
+		v->type == jpiLessOrEqual ||
+		v->type == jpiGreaterOrEqual ||
+		v->type == jpiAdd ||
+		v->type == jpiSub ||
+		v->type == jpiMul ||
+		v->type == jpiDiv ||
+		v->type == jpiMod ||
+		v->type == jpiStartsWith ||
+		v->type == jpiFold ||
+		v->type == jpiFoldl ||
+		v->type == jpiFoldr
+	);
+
+	jspInitChild(v, a, v->content.args.left);
+}
+
+void
+jspGetRightArg(JsonPathItem *v, JsonPathItem *a)
+{
+	Assert(
+		v->type == jpiAnd ||
+		v->type == jpiOr ||
+		v->type == jpiEqual ||
+		v->type == jpiNotEqual ||
+		v->type == jpiLess ||
+		v->type == jpiGreater ||
+		v->type == jpiLessOrEqual ||
+		v->type == jpiGreaterOrEqual ||
+		v->type == jpiAdd ||
+		v->type == jpiSub ||
+		v->type == jpiMul ||
+		v->type == jpiDiv ||
+		v->type == jpiMod ||
+		v->type == jpiStartsWith ||
+		v->type == jpiFold ||
+		v->type == jpiFoldl ||
+		v->type == jpiFoldr
+	);
+
+	jspInitChild(v, a, v->content.args.right);
+}
+
+bool
+jspGetBool(JsonPathItem *v)
+{
+	Assert(v->type == jpiBool);
+
+	return (bool)*v->content.value.data;
+}
+
+Numeric
+jspGetNumeric(JsonPathItem *v)
+{
+	Assert(v->type == jpiNumeric);
+
+	return (Numeric)v->content.value.data;
+}
+
+char*
+jspGetString(JsonPathItem *v, int32 *len)
+{
+	Assert(
+		v->type == jpiKey ||
+		v->type == jpiString ||
+		v->type == jpiVariable
+	);
+
+	if (len)
+		*len = v->content.value.datalen;
+	return v->content.value.data;
+}
+
+static inline JsonbValue *
+JsonbInitBinary(JsonbValue *jbv, Jsonb *jb)
+{
+	jbv->type = jbvBinary;
+	jbv->val.binary.data = &jb->root;
+	jbv->val.binary.len = VARSIZE_ANY_EXHDR(jb);
+
+	return jbv;
+}
+
+static inline JsonbValue *
+JsonbWrapInBinary(JsonbValue *jbv, JsonbValue *out)
+{
+	Jsonb	   *jb = JsonbValueToJsonb(jbv);
+
+	if (!out)
+		out = palloc(sizeof(*out));
+
+	return JsonbInitBinary(out, jb);
+}
+
+bool
+jspGetArraySubscript(JsonPathItem *v, JsonPathItem *from, JsonPathItem *to,
+					 int i)
+{
+	Assert(v->type == jpiIndexArray);
+
+	jspInitChild(v, from, v->content.array.elems[i].from);
+
+	if (!v->content.array.elems[i].to)
+		return false;
+
+	jspInitChild(v, to, v->content.array.elems[i].to);
+
+	return true;
+}
+
+void
+jspGetSequenceElement(JsonPathItem *v, int i, JsonPathItem *elem)
+{
+	Assert(v->type == jpiSequence);
+
+	jspInitChild(v, elem, v->content.sequence.elems[i]);
+}
+
+void
+jspGetObjectField(JsonPathItem *v, int i, JsonPathItem *key, JsonPathItem *val)
+{
+	Assert(v->type == jpiObject);
+	jspInitChild(v, key, v->content.object.fields[i].key);
+	jspInitChild(v, val, v->content.object.fields[i].val);
+}
+
+
+/********************Execute functions for JsonPath***************************/
+
+/*
+ * Convert value of jsonpath variable to JsonbValue
+ */
+static void
+convertJsonPathVariable(JsonPathVariable *var, JsonbValue *value)
+{
+	bool				isNull;
+	Datum				computedValue;
+
+	computedValue = var->cb(var->cb_arg, &isNull);
+
+	if (isNull)
+	{
+		value->type = jbvNull;
+		return;
+	}
+
+	switch(var->typid)
+	{
+		case BOOLOID:
+			value->type = jbvBool;
+			value->val.boolean = DatumGetBool(computedValue);
+			break;
+		case NUMERICOID:
+			value->type = jbvNumeric;
+			value->val.numeric = DatumGetNumeric(computedValue);
+			break;
+		case INT2OID:
+			value->type = jbvNumeric;
+			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
+												int2_numeric, computedValue));
+			break;
+		case INT4OID:
+			value->type = jbvNumeric;
+			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
+												int4_numeric, computedValue));
+			break;
+		case INT8OID:
+			value->type = jbvNumeric;
+			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
+												int8_numeric, computedValue));
+			break;
+		case FLOAT4OID:
+			value->type = jbvNumeric;
+			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
+												float4_numeric, computedValue));
+			break;
+		case FLOAT8OID:
+			value->type = jbvNumeric;
+			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(
+												float8_numeric, computedValue));
+			break;
+		case TEXTOID:
+		case VARCHAROID:
+			value->type = jbvString;
+			value->val.string.val = VARDATA_ANY(computedValue);
+			value->val.string.len = VARSIZE_ANY_EXHDR(computedValue);
+			break;
+		case DATEOID:
+		case TIMEOID:
+		case TIMETZOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			value->type = jbvDatetime;
+			value->val.datetime.typid = var->typid;
+			value->val.datetime.typmod = var->typmod;
+			value->val.datetime.value = computedValue;
+			break;
+		case JSONBOID:
+			{
+				Jsonb	   *jb = DatumGetJsonb(computedValue);
+
+				if (JB_ROOT_IS_SCALAR(jb))
+					JsonbExtractScalar(&jb->root, value);
+				else
+					JsonbInitBinary(value, jb);
+			}
+			break;
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("only bool, numeric and text types could be casted to supported jsonpath types")));
+	}
+}
+
+/*
+ * Find jsonpath variable in a list of passing params and compute its value.
+ * A variable without name is a jsonb object of variables, its members are
+ * looked up in the object and used as is.
+ */
+static void
+getJsonPathVariable(List *vars, char *varName, int varNameLength,
+					JsonbValue *value)
+{
+	ListCell   *cell;
+
+	foreach(cell, vars)
+	{
+		JsonPathVariable *var = (JsonPathVariable *) lfirst(cell);
+
+		if (!var->varName)
+		{
+			Jsonb	   *jb = var->cb_arg;
+			JsonbValue	key;
+			JsonbValue *val;
+
+			key.type = jbvString;
+			key.val.string.val = varName;
+			key.val.string.len = varNameLength;
+
+			val = findJsonbValueFromContainer(&jb->root, JB_FOBJECT, &key);
+
+			if (val)
+			{
+				*value = *val;
+				return;
+			}
+		}
+		else if (VARSIZE_ANY_EXHDR(var->varName) == varNameLength &&
+				 !strncmp(varName, VARDATA_ANY(var->varName), varNameLength))
+		{
+			convertJsonPathVariable(var, value);
+			return;
+		}
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_NO_DATA_FOUND),
+			 errmsg("could not find '%s' passed variable",
+					pnstrdup(varName, varNameLength))));
+}
+
+/*
+ * Compute value of jsonpath variable.  $1 and $2 of reduce()/fold() are
+ * taken from the execution context.  Variables of compiled paths are looked
+ * up and converted only on their first reference in each execution.
+ */
+static void
+computeJsonPathVariable(JsonPathExecContext *cxt, JsonPathItem *variable,
+						JsonbValue *value)
+{
+	char	   *varName;
+	int			varNameLength;
+	int			varno = variable->content.value.varno;
+
+	Assert(variable->type == jpiVariable);
+	varName = jspGetString(variable, &varNameLength);
+
+	if (cxt->foldArgs[0] && varNameLength == 1 &&
+		(varName[0] == '1' || varName[0] == '2'))
+	{
+		*value = *cxt->foldArgs[varName[0] - '1'];
+		return;
+	}
+
+	if (varno >= 0 && cxt->varSlots)
+	{
+		JsonPathVarSlot *slot = &cxt->varSlots[varno];
+
+		if (!slot->computed)
+		{
+			getJsonPathVariable(cxt->vars, varName, varNameLength,
+								&slot->value);
+			slot->computed = true;
+		}
+
+		*value = slot->value;
+		return;
+	}
+
+	getJsonPathVariable(cxt->vars, varName, varNameLength, value);
+}
+
+/*
+ * Convert jsonpath's scalar or variable node to actual jsonb value
+ */
+static void
+computeJsonPathItem(JsonPathExecContext *cxt, JsonPathItem *item, JsonbValue *value)
+{
+	switch(item->type)
+	{
+		case jpiNull:
+			value->type = jbvNull;
+			break;
+		case jpiBool:
+			value->type = jbvBool;
+			value->val.boolean = jspGetBool(item);
+			break;
+		case jpiNumeric:
+			value->type = jbvNumeric;
+			value->val.numeric = jspGetNumeric(item);
+			break;
+		case jpiString:
+			value->type = jbvString;
+			value->val.string.val = jspGetString(item, &value->val.string.len);
+			break;
+		case jpiVariable:
+			computeJsonPathVariable(cxt, item, value);
+			break;
+		default:
+			elog(ERROR, "Wrong type");
+	}
+}
+
+
+/*
+ * Returns jbv* type of of JsonbValue. Note, it never returns
+ * jbvBinary as is - jbvBinary is used as mark of store naked
+ * scalar value. To improve readability it defines jbvScalar
+ * as alias to jbvBinary
+ */
+#define jbvScalar jbvBinary
+static inline int
+JsonbType(JsonbValue *jb)
+{
+	int type = jb->type;
+
+	if (jb->type == jbvBinary)
+	{
+		JsonbContainer	*jbc = jb->val.binary.data;
+
+		if (JsonContainerIsScalar(jbc))
+			type = jbvScalar;
+		else if (JsonContainerIsObject(jbc))
+			type = jbvObject;
+		else if (JsonContainerIsArray(jbc))
+			type = jbvArray;
+		else
+			elog(ERROR, "Unknown container type: 0x%08x", jbc->header);
+	}
+
+	return type;
+}
+
+static const char *
+JsonbTypeName(JsonbValue *jb)
+{
+	JsonbValue jbvbuf;
+
+	if (jb->type == jbvBinary)
+	{
+		JsonbContainer *jbc = jb->val.binary.data;
+
+		if (JsonContainerIsScalar(jbc))
+			jb = JsonbExtractScalar(jbc, &jbvbuf);
+		else if (JsonContainerIsArray(jbc))
+			return "array";
+		else if (JsonContainerIsObject(jbc))
+			return "object";
+		else
+			elog(ERROR, "Unknown container type: 0x%08x", jbc->header);
+	}
+
+	switch (jb->type)
+	{
+		case jbvObject:
+			return "object";
+		case jbvArray:
+			return "array";
+		case jbvNumeric:
+			return "number";
+		case jbvString:
+			return "string";
+		case jbvBool:
+			return "boolean";
+		case jbvNull:
+			return "null";
+		case jbvDatetime:
+			switch (jb->val.datetime.typid)
+			{
+				case DATEOID:
+					return "date";
+				case TIMEOID:
+					return "time without time zone";
+				case TIMETZOID:
+					return "time with time zone";
+				case TIMESTAMPOID:
+					return "timestamp without time zone";
+				case TIMESTAMPTZOID:
+					return "timestamp with time zone";
+				default:
+					elog(ERROR, "unknown jsonb value datetime type oid %d",
+						 jb->val.datetime.typid);
+			}
+			return "unknown";
+		default:
+			elog(ERROR, "Unknown jsonb value type: %d", jb->type);
+			return "unknown";
+	}
+}
+
+static int
+JsonbArraySize(JsonbValue *jb)
+{
+	if (jb->type == jbvArray)
+		return jb->val.array.nElems;
+
+	if (jb->type == jbvBinary)
+	{
+		JsonbContainer *jbc = jb->val.binary.data;
+
+		if (JsonContainerIsArray(jbc) && !JsonContainerIsScalar(jbc))
+			return JsonContainerSize(jbc);
+	}
+
+	return -1;
+}
+
+static int
+compareNumeric(Numeric a, Numeric b)
+{
+	int64		ia;
+	int64		ib;
+
+	/* compare integers without calling numeric functions */
+	if (numeric_get_int64(a, &ia) && numeric_get_int64(b, &ib))
+		return ia < ib ? -1 : ia > ib ? 1 : 0;
+
+	return	DatumGetInt32(
+				DirectFunctionCall2(
+					numeric_cmp,
+					PointerGetDatum(a),
+					PointerGetDatum(b)
+				)
+			);
+}
+
+/*
+ * Is the value a scalar which is stored in jsonb as is?  Datetime items
+ * are converted to strings.
+ */
+static inline bool
+isPlainJsonbScalar(JsonbValue *jbv)
+{
+	return jbv->type >= jbvNull && jbv->type <= jbvBool;
+}
+
+static inline JsonPathExecResult
+checkEquality(JsonbValue *jb1, JsonbValue *jb2, bool not)
+{
+	bool	eq = false;
+
+	if (jb1->type != jb2->type)
+	{
+		if (jb1->type == jbvNull || jb2->type == jbvNull)
+			return jperNotFound;
+
+		return jperError;
+	}
+
+	switch (jb1->type)
+	{
+		case jbvNull:
+			eq = true;
+			break;
+		case jbvString:
+			eq = (jb1->val.string.len == jb2->val.string.len &&
+					memcmp(jb2->val.string.val, jb1->val.string.val,
+						   jb1->val.string.len) == 0);
+			break;
+		case jbvBool:
+			eq = (jb2->val.boolean == jb1->val.boolean);
+			break;
+		case jbvNumeric:
+			eq = (compareNumeric(jb1->val.numeric, jb2->val.numeric) == 0);
+			break;
+		case jbvDatetime:
+			{
+				PGFunction	eqfunc;
+
+				if (jb1->val.datetime.typid != jb2->val.datetime.typid)
+					return jperError;
+
+				/* TODO cross-type comparison */
+
+				switch (jb1->val.datetime.typid)
+				{
+					case DATEOID:
+						eqfunc = date_eq;
+						break;
+					case TIMEOID:
+						eqfunc = time_eq;
+						break;
+					case TIMETZOID:
+						eqfunc = timetz_eq;
+						break;
+					case TIMESTAMPOID:
+					case TIMESTAMPTZOID:
+						eqfunc = timestamp_eq;
+						break;
+					default:
+						elog(ERROR, "unknown jsonb value datetime type oid %d",
+							 jb1->val.datetime.typid);
+				}
+
+				eq = DatumGetBool(DirectFunctionCall2(eqfunc,
+													  jb1->val.datetime.value,
+													  jb2->val.datetime.value));
+				break;
+			}
+
+		case jbvBinary:
+		case jbvObject:
+		case jbvArray:
+			return jperError;
+
+		default:
+			elog(ERROR, "Unknown jsonb value type %d", jb1->type);
+	}
+
+	return (not ^ eq) ? jperOk : jperNotFound;
+}
+
+static JsonPathExecResult
+makeCompare(int32 op, JsonbValue *jb1, JsonbValue *jb2)
+{
+	int			cmp;
+	bool		res;
+
+	if (jb1->type != jb2->type)
+	{
+		if (jb1->type == jbvNull || jb2->type == jbvNull)
+			return jperNotFound;
+
+		return jperError;
+	}
+
+	switch (jb1->type)
+	{
+		case jbvNumeric:
+			cmp = compareNumeric(jb1->val.numeric, jb2->val.numeric);
+			break;
+		case jbvString:
+			cmp = varstr_cmp(jb1->val.string.val, jb1->val.string.len,
+							 jb2->val.string.val, jb2->val.string.len,
+							 DEFAULT_COLLATION_OID);
+			break;
+		case jbvDatetime:
+			{
+				PGFunction	cmpfunc;
+
+				if (jb1->val.datetime.typid != jb2->val.datetime.typid)
+					return jperError;
+
+				/* TODO cross-type comparison */
+
+				switch (jb1->val.datetime.typid)
+				{
+					case DATEOID:
+						cmpfunc = date_cmp;
+						break;
+					case TIMEOID:
+						cmpfunc = time_cmp;
+						break;
+					case TIMETZOID:
+						cmpfunc = timetz_cmp;
+						break;
+					case TIMESTAMPOID:
+					case TIMESTAMPTZOID:
+						cmpfunc = timestamp_cmp;
+						break;
+					default:
+						elog(ERROR, "unknown jsonb value datetime type oid %d",
+							 jb1->val.datetime.typid);
+				}
+
+				cmp = DatumGetInt32(DirectFunctionCall2(cmpfunc,
+													jb1->val.datetime.value,
+													jb2->val.datetime.value));
+				break;
+			}
+		default:
+			return jperError;
+	}
+
+	switch (op)
+	{
+		case jpiEqual:
+			res = (cmp == 0);
+			break;
+		case jpiNotEqual:
+			res = (cmp != 0);
+			break;
+		case jpiLess:
+			res = (cmp < 0);
+			break;
+		case jpiGreater:
+			res = (cmp > 0);
+			break;
+		case jpiLessOrEqual:
+			res = (cmp <= 0);
+			break;
+		case jpiGreaterOrEqual:
+			res = (cmp >= 0);
+			break;
+		default:
+			elog(ERROR, "Unknown operation");
+			return jperError;
+	}
+
+	return res ? jperOk : jperNotFound;
+}
+
+static JsonbValue *
+copyJsonbValue(JsonbValue *src)
+{
+	JsonbValue	*dst = palloc(sizeof(*dst));
+
+	*dst = *src;
+
+	return dst;
+}
+
+static inline JsonPathExecResult
+recursiveExecuteNext(JsonPathExecContext *cxt,
+					 JsonPathItem *cur, JsonPathItem *next,
+					 JsonbValue *v, JsonValueList *found, bool copy)
+{
+	JsonPathItem elem;
+	bool		hasNext;
+
+	if (!cur)
+		hasNext = next != NULL;
+	else if (next)
+		hasNext = jspHasNext(cur);
+	else
+	{
+		next = &elem;
+		hasNext = jspGetNext(cur, next);
+	}
+
+	if (hasNext)
+		return recursiveExecute(cxt, next, v, found);
+
+	if (found)
+	{
+		if (copy)
+			JsonValueListAppendCopy(found, v);
+		else
+			JsonValueListAppend(found, v);
+	}
+
+	return jperOk;
+}
+
+static inline JsonPathExecResult
+recursiveExecuteAndUnwrap(JsonPathExecContext *cxt, JsonPathItem *jsp,
+						  JsonbValue *jb, JsonValueList *found)
+{
+	if (cxt->lax)
+	{
+		JsonValueList seq = { 0 };
+		JsonValueListIterator it = { 0 };
+		JsonPathExecResult res = recursiveExecute(cxt, jsp, jb, &seq);
+		JsonbValue *item;
+
+		if (jperIsError(res))
+			return res;
+
+		while ((item = JsonValueListNext(&seq, &it)))
+		{
+			if (item->type == jbvArray)
+			{
+				JsonbValue *elem = item->val.array.elems;
+				JsonbValue *last = elem + item->val.array.nElems;
+
+				for (; elem < last; elem++)
+					JsonValueListAppendCopy(found, elem);
+			}
+			else if (item->type == jbvBinary &&
+					 JsonContainerIsArray(item->val.binary.data))
+			{
+				JsonbValue	elem;
+				JsonbIterator *it = JsonbIteratorInit(item->val.binary.data);
+				JsonbIteratorToken tok;
+
+				while ((tok = JsonbIteratorNext(&it, &elem, true)) != WJB_DONE)
+				{
+					if (tok == WJB_ELEM)
+						JsonValueListAppendCopy(found, &elem);
+				}
+			}
+			else
+				JsonValueListAppend(found, item);
+		}
+
+		return jperOk;
+	}
+
+	return recursiveExecute(cxt, jsp, jb, found);
+}
+
+/*
+ * Evaluate an operand of comparison, reusing the result of the same path
+ * already compared during the current evaluation of the filter.
+ */
+static JsonPathExecResult
+executeComparisonOperand(JsonPathExecContext *cxt, JsonPathItem *jsp,
+						 JsonbValue *jb, JsonValueList *found)
+{
+	JsonPathMemoSlot *slot;
+
+	if (jsp->memo < 0 || !cxt->memo)
+		return recursiveExecuteAndUnwrap(cxt, jsp, jb, found);
+
+	slot = &cxt->memo[jsp->memo];
+
+	if (slot->seq != cxt->filterSeq)
+	{
+		/* the previous result is not used anymore, reuse its chunks */
+		JsonValueListReset(&slot->items);
+		slot->res = recursiveExecuteAndUnwrap(cxt, jsp, jb, &slot->items);
+		slot->seq = cxt->filterSeq;
+	}
+
+	*found = slot->items;
+
+	return slot->res;
+}
+
+static JsonPathExecResult
+executeExpr(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *jb)
+{
+	JsonPathExecResult res;
+	JsonPathItem elem;
+	JsonValueList lseq = { 0 };
+	JsonValueList rseq = { 0 };
+	JsonValueListIterator lseqit = { 0 };
+	JsonbValue *lval;
+	bool		error = false;
+	bool		found = false;
+
+	jspGetLeftArg(jsp, &elem);
+	res = executeComparisonOperand(cxt, &elem, jb, &lseq);
+	if (jperIsError(res))
+		return jperError;
+
+	jspGetRightArg(jsp, &elem);
+	res = executeComparisonOperand(cxt, &elem, jb, &rseq);
+	if (jperIsError(res))
+		return jperError;
+
+	while ((lval = JsonValueListNext(&lseq, &lseqit)))
+	{
+		JsonValueListIterator rseqit = { 0 };
+		JsonbValue *rval;
+
+		while ((rval = JsonValueListNext(&rseq, &rseqit)))
+		{
+			switch (jsp->type)
+			{
+				case jpiEqual:
+					res = checkEquality(lval, rval, false);
+					break;
 				case jpiNotEqual:
 					res = checkEquality(lval, rval, true);
 					break;
-				case jpiLess:
-				case jpiGreater:
-				case jpiLessOrEqual:
-				case jpiGreaterOrEqual:
-					res = makeCompare(jsp->type, lval, rval);
+				case jpiLess:
+				case jpiGreater:
+				case jpiLessOrEqual:
+				case jpiGreaterOrEqual:
+					res = makeCompare(jsp->type, lval, rval);
+					break;
+				default:
+					elog(ERROR, "Unknown operation");
+			}
+
+			if (res == jperOk)
+			{
+				if (cxt->lax)
+					return jperOk;
+
+				found = true;
+			}
+			else if (res == jperError)
+			{
+				if (!cxt->lax)
+					return jperError;
+
+				error = true;
+			}
+		}
+	}
+
+	if (found) /* possible only in strict mode */
+		return jperOk;
+
+	if (error) /* possible only in lax mode */
+		return jperError;
+
+	return jperNotFound;
+}
+
+/*
+ * Integer version of binary arithmetic operation giving the same results as
+ * the numeric one.  Operands have at most 16 decimal digits, so only
+ * multiplication can overflow.  Returns false if the operation needs to be
+ * done on numerics: on possible overflow, on division by zero for the
+ * numeric error, and for division whose numeric result has non-zero scale.
+ */
+static bool
+executeInt64ArithmOp(JsonPathItemType op, int64 l, int64 r, int64 *res)
+{
+	switch (op)
+	{
+		case jpiAdd:
+			*res = l + r;
+			return true;
+		case jpiSub:
+			*res = l - r;
+			return true;
+		case jpiMul:
+			if (l != (int64) ((int32) l) || r != (int64) ((int32) r))
+				return false;
+			*res = l * r;
+			return true;
+		case jpiMod:
+			if (r == 0)
+				return false;
+			*res = l % r;
+			return true;
+		default:
+			return false;
+	}
+}
+
+static JsonPathExecResult
+executeBinaryArithmExpr(JsonPathExecContext *cxt, JsonPathItem *jsp,
+						JsonbValue *jb, JsonValueList *found)
+{
+	JsonPathExecResult jper;
+	JsonPathItem elem;
+	JsonValueList lseq = { 0 };
+	JsonValueList rseq = { 0 };
+	JsonbValue *lval;
+	JsonbValue *rval;
+	JsonbValue	lvalbuf;
+	JsonbValue	rvalbuf;
+	Datum		ldatum;
+	Datum		rdatum;
+	Datum		res;
+	int64		lint;
+	int64		rint;
+	int64		ires;
+	bool		hasNext;
+	bool		additive = jsp->type == jpiAdd || jsp->type == jpiSub;
+
+	jspGetLeftArg(jsp, &elem);
+
+	jper = additive /* XXX standard */
+		? recursiveExecute(cxt, &elem, jb, &lseq)
+		: recursiveExecuteAndUnwrap(cxt, &elem, jb, &lseq);
+
+	if (jper == jperOk)
+	{
+		jspGetRightArg(jsp, &elem);
+		jper = additive /* XXX standard */
+				? recursiveExecute(cxt, &elem, jb, &rseq)
+				: recursiveExecuteAndUnwrap(cxt, &elem, jb, &rseq);
+	}
+
+	if (jper != jperOk ||
+		JsonValueListLength(&lseq) != 1 ||
+		JsonValueListLength(&rseq) != 1)
+		return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+
+	lval = JsonValueListHead(&lseq);
+
+	if (JsonbType(lval) == jbvScalar)
+		lval = JsonbExtractScalar(lval->val.binary.data, &lvalbuf);
+
+	if (lval->type != jbvNumeric)
+		return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+
+	rval = JsonValueListHead(&rseq);
+
+	if (JsonbType(rval) == jbvScalar)
+		rval = JsonbExtractScalar(rval->val.binary.data, &rvalbuf);
+
+	if (rval->type != jbvNumeric)
+		return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+
+	hasNext = jspGetNext(jsp, &elem);
+
+	if (!found && !hasNext)
+		return jperOk;
+
+	ldatum = NumericGetDatum(lval->val.numeric);
+	rdatum = NumericGetDatum(rval->val.numeric);
+
+	if (numeric_get_int64(lval->val.numeric, &lint) &&
+		numeric_get_int64(rval->val.numeric, &rint) &&
+		executeInt64ArithmOp(jsp->type, lint, rint, &ires))
+		res = NumericGetDatum(int64_to_numeric(ires));
+	else
+	{
+		switch (jsp->type)
+		{
+			case jpiAdd:
+				res = DirectFunctionCall2(numeric_add, ldatum, rdatum);
+				break;
+			case jpiSub:
+				res = DirectFunctionCall2(numeric_sub, ldatum, rdatum);
+				break;
+			case jpiMul:
+				res = DirectFunctionCall2(numeric_mul, ldatum, rdatum);
+				break;
+			case jpiDiv:
+				res = DirectFunctionCall2(numeric_div, ldatum, rdatum);
+				break;
+			case jpiMod:
+				res = DirectFunctionCall2(numeric_mod, ldatum, rdatum);
+				break;
+			default:
+				elog(ERROR, "unknown jsonpath arithmetic operation %d",
+					 jsp->type);
+		}
+	}
+
+	lval = palloc(sizeof(*lval));
+	lval->type = jbvNumeric;
+	lval->val.numeric = DatumGetNumeric(res);
+
+	return recursiveExecuteNext(cxt, jsp, &elem, lval, found, false);
+}
+
+static JsonPathExecResult
+executeUnaryArithmExpr(JsonPathExecContext *cxt, JsonPathItem *jsp,
+					   JsonbValue *jb,  JsonValueList *found)
+{
+	JsonPathExecResult jper;
+	JsonPathExecResult jper2;
+	JsonPathItem elem;
+	JsonValueList seq = { 0 };
+	JsonValueListIterator it = { 0 };
+	JsonbValue *val;
+	bool		hasNext;
+
+	jspGetArg(jsp, &elem);
+	jper = recursiveExecuteAndUnwrap(cxt, &elem, jb, &seq);
+
+	if (jperIsError(jper))
+		return jperMakeError(ERRCODE_JSON_NUMBER_NOT_FOUND);
+
+	jper = jperNotFound;
+
+	hasNext = jspGetNext(jsp, &elem);
+
+	while ((val = JsonValueListNext(&seq, &it)))
+	{
+		if (JsonbType(val) == jbvScalar)
+			JsonbExtractScalar(val->val.binary.data, val);
+
+		if (val->type == jbvNumeric)
+		{
+			if (!found && !hasNext)
+				return jperOk;
+		}
+		else if (!found && !hasNext)
+			continue; /* skip non-numerics processing */
+
+		if (val->type != jbvNumeric)
+			return jperMakeError(ERRCODE_JSON_NUMBER_NOT_FOUND);
+
+		switch (jsp->type)
+		{
+			case jpiPlus:
+				break;
+			case jpiMinus:
+				val->val.numeric =
+					DatumGetNumeric(DirectFunctionCall1(
+						numeric_uminus, NumericGetDatum(val->val.numeric)));
+				break;
+			default:
+				elog(ERROR, "unknown jsonpath arithmetic operation %d", jsp->type);
+		}
+
+		jper2 = recursiveExecuteNext(cxt, jsp, &elem, val, found, false);
+
+		if (jperIsError(jper2))
+			return jper2;
+
+		if (jper2 == jperOk)
+		{
+			if (!found)
+				return jperOk;
+			jper = jperOk;
+		}
+	}
+
+	return jper;
+}
+
+/*
+ * implements jpiAny node (** operator)
+ */
+static JsonPathExecResult
+recursiveAny(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *jb,
+			 JsonValueList *found, uint32 level, uint32 first, uint32 last)
+{
+	JsonPathExecResult	res = jperNotFound;
+	JsonbIterator		*it;
+	int32				r;
+	JsonbValue			v;
+
+	check_stack_depth();
+
+	if (level > last)
+		return res;
+
+	it = JsonbIteratorInit(jb->val.binary.data);
+
+	/*
+	 * Recursivly iterate over jsonb objects/arrays
+	 */
+	while((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+	{
+		if (r == WJB_KEY)
+		{
+			r = JsonbIteratorNext(&it, &v, true);
+			Assert(r == WJB_VALUE);
+		}
+
+		if (r == WJB_VALUE || r == WJB_ELEM)
+		{
+
+			if (level >= first)
+			{
+				/* check expression */
+				res = recursiveExecuteNext(cxt, NULL, jsp, &v, found, true);
+
+				if (jperIsError(res))
+					break;
+
+				if (res == jperOk && !found)
+					break;
+			}
+
+			if (level < last && v.type == jbvBinary)
+			{
+				res = recursiveAny(cxt, jsp, &v, found, level + 1, first, last);
+
+				if (jperIsError(res))
+					break;
+
+				if (res == jperOk && found == NULL)
+					break;
+			}
+		}
+	}
+
+	return res;
+}
+
+/*
+ * Look up the key of jpiKey item in the object container and execute the
+ * rest of the path for the value found.
+ */
+static JsonPathExecResult
+executeKeyProbe(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *key,
+				JsonbContainer *jbc, JsonValueList *found)
+{
+	JsonPathExecResult res;
+	JsonbValue *v = findJsonbValueFromContainer(jbc, JB_FOBJECT, key);
+
+	if (!v)
+		return jperNotFound;
+
+	res = recursiveExecuteNext(cxt, jsp, NULL, v, found, false);
+
+	if (jspHasNext(jsp) || !found)
+		pfree(v); /* free value if it was not added to found list */
+
+	return res;
+}
+
+/*
+ * Specialization of recursiveAny() for lax .**{first to last}.key: instead
+ * of running jpiKey on every item in the tree, only object containers (and
+ * objects directly inside array containers, which lax mode unwraps) are
+ * probed for the key, and scalars are just skipped.  Results are the same
+ * and come in the same order as from recursiveAny().
+ */
+static JsonPathExecResult
+recursiveAnyKey(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *key,
+				JsonbValue *jb, JsonValueList *found,
+				uint32 level, uint32 first, uint32 last)
+{
+	JsonPathExecResult	res = jperNotFound;
+	JsonbIterator		*it;
+	int32				r;
+	JsonbValue			v;
+
+	check_stack_depth();
+
+	if (level > last)
+		return res;
+
+	it = JsonbIteratorInit(jb->val.binary.data);
+
+	while ((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+	{
+		if (r == WJB_KEY)
+		{
+			r = JsonbIteratorNext(&it, &v, true);
+			Assert(r == WJB_VALUE);
+		}
+
+		if (r != WJB_VALUE && r != WJB_ELEM)
+			continue;
+
+		if (level >= first)
+		{
+			res = jperNotFound;
+
+			if (v.type != jbvBinary)
+				;	/* lax jpiKey yields nothing for scalars */
+			else if (JsonContainerIsObject(v.val.binary.data))
+				res = executeKeyProbe(cxt, jsp, key, v.val.binary.data, found);
+			else
+			{
+				/* lax jpiKey is applied to each element of an array */
+				JsonbIterator *eit = JsonbIteratorInit(v.val.binary.data);
+				JsonbValue	elem;
+
+				while ((r = JsonbIteratorNext(&eit, &elem, true)) != WJB_DONE)
+				{
+					if (r != WJB_ELEM)
+						continue;
+
+					if (elem.type != jbvBinary ||
+						!JsonContainerIsObject(elem.val.binary.data))
+					{
+						res = jperNotFound;
+						continue;
+					}
+
+					res = executeKeyProbe(cxt, jsp, key,
+										  elem.val.binary.data, found);
+
+					if (jperIsError(res))
+						break;
+
+					if (res == jperOk && !found)
+						break;
+				}
+			}
+
+			if (jperIsError(res))
+				break;
+
+			if (res == jperOk && !found)
+				break;
+		}
+
+		if (level < last && v.type == jbvBinary)
+		{
+			res = recursiveAnyKey(cxt, jsp, key, &v, found, level + 1,
+								  first, last);
+
+			if (jperIsError(res))
+				break;
+
+			if (res == jperOk && found == NULL)
+				break;
+		}
+	}
+
+	return res;
+}
+
+/*
+ * Execute jpiAny item followed by 'next' item (NULL if it is the last one).
+ */
+static JsonPathExecResult
+executeAny(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonPathItem *next,
+		   JsonbValue *jb, JsonValueList *found)
+{
+	JsonPathExecResult res = jperNotFound;
+	JsonbValue	jbvbuf;
+
+	/* first try without any intermediate steps */
+	if (jsp->content.anybounds.first == 0)
+	{
+		res = recursiveExecuteNext(cxt, jsp, next, jb, found, true);
+
+		if (res == jperOk && !found)
+			return res;
+	}
+
+	if (jb->type == jbvArray || jb->type == jbvObject)
+		jb = JsonbWrapInBinary(jb, &jbvbuf);
+
+	if (jb->type != jbvBinary)
+		return res;
+
+	if (next && next->type == jpiKey && cxt->lax)
+	{
+		JsonbValue	key;
+
+		key.type = jbvString;
+		key.val.string.val = jspGetString(next, &key.val.string.len);
+
+		return recursiveAnyKey(cxt, next, &key, jb, found, 1,
+							   jsp->content.anybounds.first,
+							   jsp->content.anybounds.last);
+	}
+
+	return recursiveAny(cxt, next, jb, found, 1,
+						jsp->content.anybounds.first,
+						jsp->content.anybounds.last);
+}
+
+static JsonPathExecResult
+getArrayIndex(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *jb,
+			  int32 *index)
+{
+	JsonbValue *jbv;
+	JsonValueList found = { 0 };
+	JsonbValue	tmp;
+	JsonPathExecResult res = recursiveExecute(cxt, jsp, jb, &found);
+
+	if (jperIsError(res))
+		return res;
+
+	if (JsonValueListLength(&found) != 1)
+		return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+
+	jbv = JsonValueListHead(&found);
+
+	if (JsonbType(jbv) == jbvScalar)
+		jbv = JsonbExtractScalar(jbv->val.binary.data, &tmp);
+
+	if (jbv->type != jbvNumeric)
+		return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+
+	*index = DatumGetInt32(DirectFunctionCall1(numeric_int4,
+							DirectFunctionCall2(numeric_trunc,
+											NumericGetDatum(jbv->val.numeric),
+											Int32GetDatum(0))));
+
+	return jperOk;
+}
+
+static JsonPathExecResult
+executeStartsWithPredicate(JsonPathExecContext *cxt, JsonPathItem *jsp,
+						   JsonbValue *jb)
+{
+	JsonPathExecResult res;
+	JsonPathItem elem;
+	JsonValueList lseq = { 0 };
+	JsonValueList rseq = { 0 };
+	JsonValueListIterator lit = { 0 };
+	JsonbValue *whole;
+	JsonbValue *initial;
+	JsonbValue	initialbuf;
+	bool		error = false;
+	bool		found = false;
+
+	jspGetRightArg(jsp, &elem);
+	res = recursiveExecute(cxt, &elem, jb, &rseq);
+	if (jperIsError(res))
+		return jperError;
+
+	if (JsonValueListLength(&rseq) != 1)
+		return jperError;
+
+	initial = JsonValueListHead(&rseq);
+
+	if (JsonbType(initial) == jbvScalar)
+		initial = JsonbExtractScalar(initial->val.binary.data, &initialbuf);
+
+	if (initial->type != jbvString)
+		return jperError;
+
+	jspGetLeftArg(jsp, &elem);
+	res = recursiveExecuteAndUnwrap(cxt, &elem, jb, &lseq);
+	if (jperIsError(res))
+		return jperError;
+
+	while ((whole = JsonValueListNext(&lseq, &lit)))
+	{
+		JsonbValue	wholebuf;
+
+		if (JsonbType(whole) == jbvScalar)
+			whole = JsonbExtractScalar(whole->val.binary.data, &wholebuf);
+
+		if (whole->type != jbvString)
+		{
+			if (!cxt->lax)
+				return jperError;
+
+			error = true;
+		}
+		else if (whole->val.string.len >= initial->val.string.len &&
+				 !memcmp(whole->val.string.val,
+						 initial->val.string.val,
+						 initial->val.string.len))
+		{
+			if (cxt->lax)
+				return jperOk;
+
+			found = true;
+		}
+	}
+
+	if (found) /* possible only in strict mode */
+		return jperOk;
+
+	if (error) /* possible only in lax mode */
+		return jperError;
+
+	return jperNotFound;
+}
+
+/*
+ * Execute LIKE_REGEX predicate.  The pattern of a compiled path is compiled
+ * only once with the path, otherwise the backend cache of regular
+ * expressions is used.
+ */
+static JsonPathExecResult
+executeLikeRegexPredicate(JsonPathExecContext *cxt, JsonPathItem *jsp,
+						  JsonbValue *jb)
+{
+	JsonPathExecResult res;
+	JsonPathItem elem;
+	JsonValueList seq = { 0 };
+	JsonValueListIterator it = { 0 };
+	JsonbValue *str;
+	text	   *pattern = NULL;
+	int			cflags = 0;
+	bool		error = false;
+	bool		found = false;
+
+	jspInitChild(jsp, &elem, jsp->content.like_regex.expr);
+	res = recursiveExecuteAndUnwrap(cxt, &elem, jb, &seq);
+	if (jperIsError(res))
+		return jperError;
+
+	while ((str = JsonValueListNext(&seq, &it)))
+	{
+		JsonbValue	strbuf;
+		bool		match;
+
+		if (JsonbType(str) == jbvScalar)
+			str = JsonbExtractScalar(str->val.binary.data, &strbuf);
+
+		if (str->type != jbvString)
+		{
+			if (!cxt->lax)
+				return jperError;
+
+			error = true;
+			continue;
+		}
+
+		if (jsp->content.like_regex.regex)
+			match = RE_execute(jsp->content.like_regex.regex,
+							   str->val.string.val, str->val.string.len,
+							   0, NULL);
+		else
+		{
+			if (!pattern)
+			{
+				pattern =
+					cstring_to_text_with_len(jsp->content.like_regex.pattern,
+											 jsp->content.like_regex.patternlen);
+				cflags = jspGetLikeRegexCflags(jsp->content.like_regex.flags);
+			}
+
+			match = RE_compile_and_execute(pattern,
+										   str->val.string.val,
+										   str->val.string.len,
+										   cflags, DEFAULT_COLLATION_OID,
+										   0, NULL);
+		}
+
+		if (match)
+		{
+			if (cxt->lax)
+				return jperOk;
+
+			found = true;
+		}
+	}
+
+	if (found) /* possible only in strict mode */
+		return jperOk;
+
+	if (error) /* possible only in lax mode */
+		return jperError;
+
+	return jperNotFound;
+}
+
+/*
+ * Read exactly 'ndigits' decimal digits.
+ */
+static inline bool
+readDatetimeDigits(const char **str, const char *end, int ndigits, int *val)
+{
+	const char *s = *str;
+
+	if (end - s < ndigits)
+		return false;
+
+	for (*val = 0; ndigits > 0; ndigits--, s++)
+	{
+		if (*s < '0' || *s > '9')
+			return false;
+
+		*val = *val * 10 + (*s - '0');
+	}
+
+	*str = s;
+
+	return true;
+}
+
+/*
+ * Recognize in a single pass canonical spellings of datetime values:
+ *
+ *	 YYYY-MM-DD [HH24:MI:SS [+-TZH[:TZM]]]
+ *
+ * which is what .datetime() without template is used for in most cases.
+ * Returns false if the string has some other shape or some of its fields
+ * are out of range, so the caller can fall back to the more lenient parsing
+ * by to_datetime().  Times without a date are left to the fallback too,
+ * because its "yyyy-mm-dd" templates come first and can read "10:11:12" as
+ * a date.
+ */
+static bool
+tryToParseIsoDatetime(const char *str, int len,
+					  Datum *value, Oid *typid, int32 *typmod)
+{
+	const char *end = str + len;
+	struct pg_tm tm;
+	bool		zoned = false;
+	int			tz = 0;
+	Timestamp	result;
+
+	memset(&tm, 0, sizeof(tm));
+
+	/* date part */
+	if (len < 10 || str[4] != '-' ||
+		!readDatetimeDigits(&str, end, 4, &tm.tm_year) ||
+		*str++ != '-' ||
+		!readDatetimeDigits(&str, end, 2, &tm.tm_mon) ||
+		str >= end || *str++ != '-' ||
+		!readDatetimeDigits(&str, end, 2, &tm.tm_mday))
+		return false;
+
+	if (tm.tm_year < 1 ||
+		tm.tm_mon < 1 || tm.tm_mon > MONTHS_PER_YEAR ||
+		tm.tm_mday < 1 ||
+		tm.tm_mday > day_tab[isleap(tm.tm_year)][tm.tm_mon - 1])
+		return false;
+
+	*typmod = -1;
+
+	if (str >= end)
+	{
+		*typid = DATEOID;
+		*value = DateADTGetDatum(date2j(tm.tm_year, tm.tm_mon, tm.tm_mday) -
+								 POSTGRES_EPOCH_JDATE);
+		return true;
+	}
+
+	/* time part */
+	if (*str++ != ' ' ||
+		!readDatetimeDigits(&str, end, 2, &tm.tm_hour) ||
+		str >= end || *str++ != ':' ||
+		!readDatetimeDigits(&str, end, 2, &tm.tm_min) ||
+		str >= end || *str++ != ':' ||
+		!readDatetimeDigits(&str, end, 2, &tm.tm_sec))
+		return false;
+
+	if (tm.tm_hour >= HOURS_PER_DAY ||
+		tm.tm_min >= MINS_PER_HOUR ||
+		tm.tm_sec >= SECS_PER_MINUTE)
+		return false;
+
+	/* time zone part */
+	if (str < end)
+	{
+		int			tzsign;
+		int			tzh;
+		int			tzm = 0;
+
+		if (end - str < 3 || *str++ != ' ' ||
+			(*str != '+' && *str != '-'))
+			return false;
+
+		tzsign = *str++ == '-' ? -1 : 1;
+
+		if (!readDatetimeDigits(&str, end, end - str == 1 ||
+								str[1] == ':' ? 1 : 2, &tzh))
+			return false;
+
+		if (str < end &&
+			(*str++ != ':' ||
+			 !readDatetimeDigits(&str, end, 2, &tzm) ||
+			 str < end))
+			return false;
+
+		if (tzh > MAX_TZDISP_HOUR || tzm >= MINS_PER_HOUR)
+			return false;
+
+		/* the same as DecodeTimezone(): seconds west of Greenwich */
+		tz = -tzsign * (tzh * SECS_PER_HOUR + tzm * SECS_PER_MINUTE);
+		zoned = true;
+	}
+
+	if (tm2timestamp(&tm, 0, zoned ? &tz : NULL, &result) != 0)
+		return false;
+
+	*typid = zoned ? TIMESTAMPTZOID : TIMESTAMPOID;
+	*value = TimestampGetDatum(result);
+
+	return true;
+}
+
+static bool
+tryToParseDatetime(const char *template, text *datetime,
+				   Datum *value, Oid *typid, int32 *typmod)
+{
+	MemoryContext mcxt = CurrentMemoryContext;
+	bool		ok = false;
+
+	PG_TRY();
+	{
+		*value = to_datetime(datetime, template, -1, true, typid, typmod);
+		ok = true;
+	}
+	PG_CATCH();
+	{
+		if (ERRCODE_TO_CATEGORY(geterrcode()) != ERRCODE_DATA_EXCEPTION)
+			PG_RE_THROW();
+
+		FlushErrorState();
+		MemoryContextSwitchTo(mcxt);
+	}
+	PG_END_TRY();
+
+	return ok;
+}
+
+static inline JsonPathExecResult
+appendBoolResult(JsonPathExecContext *cxt, JsonPathItem *jsp,
+				 JsonValueList *found, JsonPathExecResult res, bool needBool)
+{
+	JsonPathItem next;
+	JsonbValue	jbv;
+	bool		hasNext = jspGetNext(jsp, &next);
+
+	if (needBool)
+	{
+		Assert(!hasNext);
+		return res;
+	}
+
+	if (!found && !hasNext)
+		return jperOk;	/* found singleton boolean value */
+
+	if (jperIsError(res))
+		jbv.type = jbvNull;
+	else
+	{
+		jbv.type = jbvBool;
+		jbv.val.boolean = res == jperOk;
+	}
+
+	return recursiveExecuteNext(cxt, jsp, &next, &jbv, found, true);
+}
+
+/*
+ * Main executor function: walks on jsonpath structure and tries to find
+ * correspoding parts of jsonb. Note, jsonb and jsonpath values should be
+ * avaliable and untoasted during work because JsonPathItem, JsonbValue
+ * and found could have pointers into input values. If caller wants just to
+ * check matching of json by jsonpath then it doesn't provide a found arg.
+ * In this case executor works till first positive result and does not check
+ * the rest if it is possible. In other case it tries to find all satisfied
+ * results
+ */
+static JsonPathExecResult
+recursiveExecuteNoUnwrap(JsonPathExecContext *cxt, JsonPathItem *jsp,
+						 JsonbValue *jb, JsonValueList *found, bool needBool)
+{
+	JsonPathItem		elem;
+	JsonPathExecResult	res = jperNotFound;
+	bool				hasNext;
+
+	check_stack_depth();
+
+	switch(jsp->type) {
+		case jpiAnd:
+			jspGetLeftArg(jsp, &elem);
+			res = recursiveExecuteBool(cxt, &elem, jb);
+			if (res != jperNotFound)
+			{
+				JsonPathExecResult res2;
+
+				/*
+				 * SQL/JSON says that we should check second arg
+				 * in case of jperError
+				 */
+
+				jspGetRightArg(jsp, &elem);
+				res2 = recursiveExecuteBool(cxt, &elem, jb);
+
+				res = (res2 == jperOk) ? res : res2;
+			}
+			res = appendBoolResult(cxt, jsp, found, res, needBool);
+			break;
+		case jpiOr:
+			jspGetLeftArg(jsp, &elem);
+			res = recursiveExecuteBool(cxt, &elem, jb);
+			if (res != jperOk)
+			{
+				JsonPathExecResult res2;
+
+				jspGetRightArg(jsp, &elem);
+				res2 = recursiveExecuteBool(cxt, &elem, jb);
+
+				res = (res2 == jperNotFound) ? res : res2;
+			}
+			res = appendBoolResult(cxt, jsp, found, res, needBool);
+			break;
+		case jpiNot:
+			jspGetArg(jsp, &elem);
+			switch ((res = recursiveExecuteBool(cxt, &elem, jb)))
+			{
+				case jperOk:
+					res = jperNotFound;
+					break;
+				case jperNotFound:
+					res = jperOk;
+					break;
+				default:
+					break;
+			}
+			res = appendBoolResult(cxt, jsp, found, res, needBool);
+			break;
+		case jpiIsUnknown:
+			jspGetArg(jsp, &elem);
+			res = recursiveExecuteBool(cxt, &elem, jb);
+			res = jperIsError(res) ? jperOk : jperNotFound;
+			res = appendBoolResult(cxt, jsp, found, res, needBool);
+			break;
+		case jpiKey:
+			if (JsonbType(jb) == jbvObject)
+			{
+				JsonbValue	*v, key;
+				JsonbValue	obj;
+
+				if (jb->type == jbvObject)
+					jb = JsonbWrapInBinary(jb, &obj);
+
+				key.type = jbvString;
+				key.val.string.val = jspGetString(jsp, &key.val.string.len);
+
+				v = findJsonbValueFromContainer(jb->val.binary.data, JB_FOBJECT, &key);
+
+				if (v != NULL)
+				{
+					res = recursiveExecuteNext(cxt, jsp, NULL, v, found, false);
+
+					if (jspHasNext(jsp) || !found)
+						pfree(v); /* free value if it was not added to found list */
+				}
+				else if (!cxt->lax && found)
+					res = jperMakeError(ERRCODE_JSON_MEMBER_NOT_FOUND);
+			}
+			else if (!cxt->lax && found)
+				res = jperMakeError(ERRCODE_JSON_MEMBER_NOT_FOUND);
+			break;
+		case jpiRoot:
+			jb = cxt->root;
+			/* fall through */
+		case jpiCurrent:
+			{
+				JsonbValue *v;
+				JsonbValue	vbuf;
+				bool		copy = true;
+
+				if (JsonbType(jb) == jbvScalar)
+				{
+					if (jspHasNext(jsp))
+						v = &vbuf;
+					else
+					{
+						v = palloc(sizeof(*v));
+						copy = false;
+					}
+
+					JsonbExtractScalar(jb->val.binary.data, v);
+				}
+				else
+					v = jb;
+
+				res = recursiveExecuteNext(cxt, jsp, NULL, v, found, copy);
+				break;
+			}
+		case jpiAnyArray:
+			if (JsonbType(jb) == jbvArray)
+			{
+				hasNext = jspGetNext(jsp, &elem);
+
+				if (jb->type == jbvArray)
+				{
+					JsonbValue *el = jb->val.array.elems;
+					JsonbValue *last_el = el + jb->val.array.nElems;
+
+					for (; el < last_el; el++)
+					{
+						res = recursiveExecuteNext(cxt, jsp, &elem, el, found, true);
+
+						if (jperIsError(res))
+							break;
+
+						if (res == jperOk && !found)
+							break;
+					}
+				}
+				else if (!hasNext || elem.type != jpiFilter ||
+						 !executeArrayFilter(cxt, &elem, jb, true, found,
+											 &res))
+				{
+					JsonbValue	v;
+					JsonbIterator *it;
+					JsonbIteratorToken r;
+
+					it = JsonbIteratorInit(jb->val.binary.data);
+
+					while((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+					{
+						if (r == WJB_ELEM)
+						{
+							res = recursiveExecuteNext(cxt, jsp, &elem, &v, found, true);
+
+							if (jperIsError(res))
+								break;
+
+							if (res == jperOk && !found)
+								break;
+						}
+					}
+				}
+			}
+			else if (found)
+				res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
+			break;
+
+		case jpiIndexArray:
+			if (JsonbType(jb) == jbvArray)
+			{
+				int			innermostArraySize = cxt->innermostArraySize;
+				int			i;
+				int			size = JsonbArraySize(jb);
+				bool		binary = jb->type == jbvBinary;
+				JsonbArrayCursor cursor;
+
+				cxt->innermostArraySize = size; /* for LAST evaluation */
+
+				if (binary)
+					JsonbArrayCursorInit(&cursor, jb->val.binary.data);
+
+				hasNext = jspGetNext(jsp, &elem);
+
+				for (i = 0; i < jsp->content.array.nelems; i++)
+				{
+					JsonPathItem from;
+					JsonPathItem to;
+					int32		index;
+					int32		index_from;
+					int32		index_to;
+					bool		range = jspGetArraySubscript(jsp, &from, &to, i);
+
+					res = getArrayIndex(cxt, &from, jb, &index_from);
+
+					if (jperIsError(res))
+						break;
+
+					if (range)
+					{
+						res = getArrayIndex(cxt, &to, jb, &index_to);
+
+						if (jperIsError(res))
+							break;
+					}
+					else
+						index_to = index_from;
+
+					if (!cxt->lax &&
+						(index_from < 0 ||
+						 index_from > index_to ||
+						 index_to >= size))
+					{
+						res = jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+						break;
+					}
+
+					if (index_from < 0)
+						index_from = 0;
+
+					if (index_to >= size)
+						index_to = size - 1;
+
+					res = jperNotFound;
+
+					for (index = index_from; index <= index_to; index++)
+					{
+						JsonbValue	vbuf;
+						JsonbValue *v = &vbuf;
+
+						if (!binary)
+							v = &jb->val.array.elems[index];
+						else if (!JsonbArrayCursorGet(&cursor, (uint32) index,
+													  v))
+							continue;
+
+						res = recursiveExecuteNext(cxt, jsp, &elem, v, found,
+												   true);
+
+						if (jperIsError(res))
+							break;
+
+						if (res == jperOk && !found)
+							break;
+					}
+
+					if (jperIsError(res))
+						break;
+
+					if (res == jperOk && !found)
+						break;
+				}
+
+				cxt->innermostArraySize = innermostArraySize;
+			}
+			else if (JsonbType(jb) == jbvObject)
+			{
+				int			innermostArraySize = cxt->innermostArraySize;
+				int			i;
+				JsonbValue	bin;
+				JsonbValue *wrapped = NULL;
+
+				if (jb->type == jbvBinary)
+					jb = JsonbWrapInBinary(jb, &bin);
+
+				cxt->innermostArraySize = 1;
+
+				for (i = 0; i < jsp->content.array.nelems; i++)
+				{
+					JsonPathItem from;
+					JsonPathItem to;
+					JsonbValue *key;
+					JsonbValue	tmp;
+					JsonValueList keys = { 0 };
+					bool		range = jspGetArraySubscript(jsp, &from, &to, i);
+
+					if (range)
+					{
+						int		index_from;
+						int		index_to;
+
+						if (!cxt->lax)
+							return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+
+						if (!wrapped)
+							wrapped = wrapItem(jb);
+
+						res = getArrayIndex(cxt, &from, wrapped, &index_from);
+						if (jperIsError(res))
+							return res;
+
+						res = getArrayIndex(cxt, &to, wrapped, &index_to);
+						if (jperIsError(res))
+							return res;
+
+						res = jperNotFound;
+
+						if (index_from <= 0 && index_to >= 0)
+						{
+							res = recursiveExecuteNext(cxt, jsp, NULL, jb,
+													   found, true);
+							if (jperIsError(res))
+								return res;
+
+						}
+
+						if (res == jperOk && !found)
+							break;
+
+						continue;
+					}
+
+					res = recursiveExecute(cxt, &from, jb, &keys);
+
+					if (jperIsError(res))
+						return res;
+
+					if (JsonValueListLength(&keys) != 1)
+						return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+
+					key = JsonValueListHead(&keys);
+
+					if (JsonbType(key) == jbvScalar)
+						key = JsonbExtractScalar(key->val.binary.data, &tmp);
+
+					res = jperNotFound;
+
+					if (key->type == jbvNumeric && cxt->lax)
+					{
+						int			index = DatumGetInt32(
+								DirectFunctionCall1(numeric_int4,
+									DirectFunctionCall2(numeric_trunc,
+											NumericGetDatum(key->val.numeric),
+											Int32GetDatum(0))));
+
+						if (!index)
+						{
+							res = recursiveExecuteNext(cxt, jsp, NULL, jb,
+													   found, true);
+							if (jperIsError(res))
+								return res;
+						}
+					}
+					else if (key->type == jbvString)
+					{
+						key = findJsonbValueFromContainer(jb->val.binary.data,
+														  JB_FOBJECT, key);
+
+						if (key)
+						{
+							res = recursiveExecuteNext(cxt, jsp, NULL, key,
+													   found, false);
+							if (jperIsError(res))
+								return res;
+						}
+						else if (!cxt->lax)
+							return jperMakeError(ERRCODE_JSON_MEMBER_NOT_FOUND);
+					}
+					else
+						return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+
+					if (res == jperOk && !found)
+						break;
+				}
+
+				cxt->innermostArraySize = innermostArraySize;
+			}
+			else
+			{
+				if (cxt->lax)
+					res = recursiveExecuteNoUnwrap(cxt, jsp, wrapItem(jb),
+												   found, false);
+				else if (found)
+					res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
+			}
+			break;
+
+		case jpiLast:
+			{
+				JsonbValue	tmpjbv;
+				JsonbValue *lastjbv;
+				int			last;
+				bool		hasNext;
+
+				if (cxt->innermostArraySize < 0)
+					elog(ERROR,
+						 "evaluating jsonpath LAST outside of array subscript");
+
+				hasNext = jspGetNext(jsp, &elem);
+
+				if (!hasNext && !found)
+				{
+					res = jperOk;
+					break;
+				}
+
+				last = cxt->innermostArraySize - 1;
+
+				lastjbv = hasNext ? &tmpjbv : palloc(sizeof(*lastjbv));
+
+				lastjbv->type = jbvNumeric;
+				lastjbv->val.numeric = DatumGetNumeric(DirectFunctionCall1(
+											int4_numeric, Int32GetDatum(last)));
+
+				res = recursiveExecuteNext(cxt, jsp, &elem, lastjbv, found, hasNext);
+			}
+			break;
+		case jpiAnyKey:
+			if (JsonbType(jb) == jbvObject)
+			{
+				JsonbIterator	*it;
+				int32			r;
+				JsonbValue		v;
+				JsonbValue		bin;
+
+				if (jb->type == jbvObject)
+					jb = JsonbWrapInBinary(jb, &bin);
+
+				hasNext = jspGetNext(jsp, &elem);
+				it = JsonbIteratorInit(jb->val.binary.data);
+
+				while((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+				{
+					if (r == WJB_VALUE)
+					{
+						res = recursiveExecuteNext(cxt, jsp, &elem, &v, found, true);
+
+						if (jperIsError(res))
+							break;
+
+						if (res == jperOk && !found)
+							break;
+					}
+				}
+			}
+			else if (!cxt->lax && found)
+				res = jperMakeError(ERRCODE_JSON_OBJECT_NOT_FOUND);
+			break;
+		case jpiEqual:
+		case jpiNotEqual:
+		case jpiLess:
+		case jpiGreater:
+		case jpiLessOrEqual:
+		case jpiGreaterOrEqual:
+			res = executeExpr(cxt, jsp, jb);
+			res = appendBoolResult(cxt, jsp, found, res, needBool);
+			break;
+		case jpiAdd:
+		case jpiSub:
+		case jpiMul:
+		case jpiDiv:
+		case jpiMod:
+			res = executeBinaryArithmExpr(cxt, jsp, jb, found);
+			break;
+		case jpiPlus:
+		case jpiMinus:
+			res = executeUnaryArithmExpr(cxt, jsp, jb, found);
+			break;
+		case jpiFilter:
+			{
+				uint32		filterSeq = cxt->filterSeq;
+
+				/* invalidate cached operands of the previous item */
+				if (cxt->memo)
+					cxt->filterSeq = ++cxt->memoSeq;
+
+				jspGetArg(jsp, &elem);
+				res = recursiveExecuteBool(cxt, &elem, jb);
+
+				cxt->filterSeq = filterSeq;
+			}
+
+			if (res != jperOk)
+				res = jperNotFound;
+			else
+				res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, true);
+			break;
+		case jpiAny:
+			hasNext = jspGetNext(jsp, &elem);
+			res = executeAny(cxt, jsp, hasNext ? &elem : NULL, jb, found);
+			break;
+		case jpiExists:
+			jspGetArg(jsp, &elem);
+			res = recursiveExecute(cxt, &elem, jb, NULL);
+			res = appendBoolResult(cxt, jsp, found, res, needBool);
+			break;
+		case jpiNull:
+		case jpiBool:
+		case jpiNumeric:
+		case jpiString:
+		case jpiVariable:
+			{
+				JsonbValue	vbuf;
+				JsonbValue *v;
+				bool		hasNext = jspGetNext(jsp, &elem);
+
+				if (!hasNext && !found)
+				{
+					res = jperOk; /* skip evaluation */
+					break;
+				}
+
+				v = hasNext ? &vbuf : palloc(sizeof(*v));
+
+				computeJsonPathItem(cxt, jsp, v);
+
+				res = recursiveExecuteNext(cxt, jsp, &elem, v, found, hasNext);
+			}
+			break;
+		case jpiType:
+			{
+				JsonbValue *jbv = palloc(sizeof(*jbv));
+
+				jbv->type = jbvString;
+				jbv->val.string.val = pstrdup(JsonbTypeName(jb));
+				jbv->val.string.len = strlen(jbv->val.string.val);
+
+				res = recursiveExecuteNext(cxt, jsp, NULL, jbv, found, false);
+			}
+			break;
+		case jpiSize:
+			{
+				int			size = JsonbArraySize(jb);
+
+				if (size < 0)
+				{
+					if (!cxt->lax)
+					{
+						res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
+						break;
+					}
+
+					size = 1;
+				}
+
+				jb = palloc(sizeof(*jb));
+
+				jb->type = jbvNumeric;
+				jb->val.numeric =
+					DatumGetNumeric(DirectFunctionCall1(int4_numeric,
+														Int32GetDatum(size)));
+
+				res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, false);
+			}
+			break;
+		case jpiAbs:
+		case jpiFloor:
+		case jpiCeiling:
+			{
+				JsonbValue jbvbuf;
+
+				if (JsonbType(jb) == jbvScalar)
+					jb = JsonbExtractScalar(jb->val.binary.data, &jbvbuf);
+
+				if (jb->type == jbvNumeric)
+				{
+					Datum		datum = NumericGetDatum(jb->val.numeric);
+
+					switch (jsp->type)
+					{
+						case jpiAbs:
+							datum = DirectFunctionCall1(numeric_abs, datum);
+							break;
+						case jpiFloor:
+							datum = DirectFunctionCall1(numeric_floor, datum);
+							break;
+						case jpiCeiling:
+							datum = DirectFunctionCall1(numeric_ceil, datum);
+							break;
+						default:
+							break;
+					}
+
+					jb = palloc(sizeof(*jb));
+
+					jb->type = jbvNumeric;
+					jb->val.numeric = DatumGetNumeric(datum);
+
+					res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, false);
+				}
+				else
+					res = jperMakeError(ERRCODE_NON_NUMERIC_JSON_ITEM);
+			}
+			break;
+		case jpiDouble:
+			{
+				JsonbValue jbv;
+				bool		have_error = false;
+
+				if (JsonbType(jb) == jbvScalar)
+					jb = JsonbExtractScalar(jb->val.binary.data, &jbv);
+
+				/* conversion errors are returned, not thrown */
+				if (jb->type == jbvNumeric)
+				{
+					/* only check success of numeric to double cast */
+					(void) numeric_float8_opt_error(jb->val.numeric,
+													&have_error);
+					res = jperOk;
+				}
+				else if (jb->type == jbvString)
+				{
+					/* cast string as double */
+					char	   *str = pnstrdup(jb->val.string.val,
+											   jb->val.string.len);
+					double		val = float8in_internal_opt_error(str, NULL,
+														"double precision",
+														str, &have_error);
+
+					pfree(str);
+
+					/* infinity can not be represented by numeric */
+					if (!have_error && isinf(val))
+						have_error = true;
+
+					if (!have_error)
+					{
+						jb = &jbv;
+						jb->type = jbvNumeric;
+						jb->val.numeric = DatumGetNumeric(DirectFunctionCall1(
+										float8_numeric, Float8GetDatum(val)));
+					}
+
+					res = jperOk;
+				}
+				else
+					res = jperMakeError(ERRCODE_NON_NUMERIC_JSON_ITEM);
+
+				if (have_error)
+					res = jperMakeError(ERRCODE_NON_NUMERIC_JSON_ITEM);
+
+				if (res == jperOk)
+					res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, true);
+			}
+			break;
+		case jpiDatetime:
+			{
+				JsonbValue	jbvbuf;
+				Datum		value;
+				Oid			typid;
+				int32		typmod = -1;
+				bool		hasNext;
+
+				if (JsonbType(jb) == jbvScalar)
+					jb = JsonbExtractScalar(jb->val.binary.data, &jbvbuf);
+
+				if (jb->type == jbvNumeric && !jsp->content.arg)
+				{
+					/* Standard extension: unix epoch to timestamptz */
+					bool		have_error = false;
+					float8		unix_epoch =
+						numeric_float8_opt_error(jb->val.numeric, &have_error);
+
+					if (!have_error)
+						value = TimestampTzGetDatum(
+							float8_timestamptz_opt_error(unix_epoch,
+														 &have_error));
+
+					typid = TIMESTAMPTZOID;
+					res = have_error ?
+						jperMakeError(ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION) :
+						jperOk;
+				}
+				else if (jb->type == jbvString &&
+						 !jsp->content.arg &&
+						 tryToParseIsoDatetime(jb->val.string.val,
+											   jb->val.string.len,
+											   &value, &typid, &typmod))
+				{
+					/* canonical spelling recognized without to_datetime() */
+					res = jperOk;
+				}
+				else if (jb->type == jbvString)
+				{
+					text	   *datetime_txt =
+							cstring_to_text_with_len(jb->val.string.val,
+													 jb->val.string.len);
+
+					res = jperOk;
+
+					if (jsp->content.arg)
+					{
+						char	   *template_str;
+						int			template_len;
+						MemoryContext mcxt = CurrentMemoryContext;
+
+						jspGetArg(jsp, &elem);
+
+						if (elem.type != jpiString)
+							elog(ERROR, "invalid jsonpath item type for .datetime() argument");
+
+						template_str = jspGetString(&elem, &template_len);
+
+						PG_TRY();
+						{
+							/* use the template pre-parsed by jspCompile() */
+							if (elem.content.value.format)
+								value = to_datetime_compiled(datetime_txt,
+												elem.content.value.format,
+												false, &typid, &typmod);
+							else
+								value = to_datetime(datetime_txt,
+												template_str, template_len,
+												false,
+												&typid, &typmod);
+						}
+						PG_CATCH();
+						{
+							if (ERRCODE_TO_CATEGORY(geterrcode()) !=
+														ERRCODE_DATA_EXCEPTION)
+								PG_RE_THROW();
+
+							FlushErrorState();
+							MemoryContextSwitchTo(mcxt);
+
+							res = jperMakeError(ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION);
+						}
+						PG_END_TRY();
+					}
+					else
+					{
+						if (!tryToParseDatetime("yyyy-mm-dd HH24:MI:SS TZH:TZM",
+									datetime_txt, &value, &typid, &typmod) &&
+							!tryToParseDatetime("yyyy-mm-dd HH24:MI:SS TZH",
+									datetime_txt, &value, &typid, &typmod) &&
+							!tryToParseDatetime("yyyy-mm-dd HH24:MI:SS",
+									datetime_txt, &value, &typid, &typmod) &&
+							!tryToParseDatetime("yyyy-mm-dd",
+									datetime_txt, &value, &typid, &typmod) &&
+							!tryToParseDatetime("HH24:MI:SS TZH:TZM",
+									datetime_txt, &value, &typid, &typmod) &&
+							!tryToParseDatetime("HH24:MI:SS TZH",
+									datetime_txt, &value, &typid, &typmod) &&
+							!tryToParseDatetime("HH24:MI:SS",
+									datetime_txt, &value, &typid, &typmod))
+							res = jperMakeError(ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION);
+					}
+
+					pfree(datetime_txt);
+				}
+				else
+				{
+					res = jperMakeError(ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION);
+					break;
+				}
+
+				if (jperIsError(res))
+					break;
+
+				hasNext = jspGetNext(jsp, &elem);
+
+				if (!hasNext && !found)
+					break;
+
+				jb = hasNext ? &jbvbuf : palloc(sizeof(*jb));
+
+				jb->type = jbvDatetime;
+				jb->val.datetime.value = value;
+				jb->val.datetime.typid = typid;
+				jb->val.datetime.typmod = typmod;
+
+				res = recursiveExecuteNext(cxt, jsp, &elem, jb, found, hasNext);
+			}
+			break;
+		case jpiKeyValue:
+			if (JsonbType(jb) != jbvObject)
+				res = jperMakeError(ERRCODE_JSON_OBJECT_NOT_FOUND);
+			else
+			{
+				int32		r;
+				JsonbValue	bin;
+				JsonbValue	key;
+				JsonbValue	val;
+				JsonbValue	obj;
+				JsonbValue	keystr;
+				JsonbValue	valstr;
+				JsonbIterator *it;
+				JsonbParseState *ps = NULL;
+
+				hasNext = jspGetNext(jsp, &elem);
+
+				if (jb->type == jbvBinary
+					? !JsonContainerSize(jb->val.binary.data)
+					: !jb->val.object.nPairs)
+				{
+					res = jperNotFound;
+					break;
+				}
+
+				/* make template object */
+				obj.type = jbvBinary;
+
+				keystr.type = jbvString;
+				keystr.val.string.val = "key";
+				keystr.val.string.len = 3;
+
+				valstr.type = jbvString;
+				valstr.val.string.val = "value";
+				valstr.val.string.len = 5;
+
+				if (jb->type == jbvObject)
+					jb = JsonbWrapInBinary(jb, &bin);
+
+				it = JsonbIteratorInit(jb->val.binary.data);
+
+				while ((r = JsonbIteratorNext(&it, &key, true)) != WJB_DONE)
+				{
+					if (r == WJB_KEY)
+					{
+						Jsonb	   *jsonb;
+						JsonbValue  *keyval;
+
+						res = jperOk;
+
+						if (!hasNext && !found)
+							break;
+
+						r = JsonbIteratorNext(&it, &val, true);
+						Assert(r == WJB_VALUE);
+
+						pushJsonbValue(&ps, WJB_BEGIN_OBJECT, NULL);
+
+						pushJsonbValue(&ps, WJB_KEY, &keystr);
+						pushJsonbValue(&ps, WJB_VALUE, &key);
+
+
+						pushJsonbValue(&ps, WJB_KEY, &valstr);
+						pushJsonbValue(&ps, WJB_VALUE, &val);
+
+						keyval = pushJsonbValue(&ps, WJB_END_OBJECT, NULL);
+
+						jsonb = JsonbValueToJsonb(keyval);
+
+						obj.val.binary.data = &jsonb->root;
+						obj.val.binary.len = VARSIZE(jsonb) - VARHDRSZ;
+
+						res = recursiveExecuteNext(cxt, jsp, &elem, &obj, found, true);
+
+						if (jperIsError(res))
+							break;
+
+						if (res == jperOk && !found)
+							break;
+					}
+				}
+			}
+			break;
+		case jpiStartsWith:
+			res = executeStartsWithPredicate(cxt, jsp, jb);
+			res = appendBoolResult(cxt, jsp, found, res, needBool);
+			break;
+		case jpiLikeRegex:
+			res = executeLikeRegexPredicate(cxt, jsp, jb);
+			res = appendBoolResult(cxt, jsp, found, res, needBool);
+			break;
+		case jpiMap:
+			if (JsonbType(jb) != jbvArray)
+			{
+				if (cxt->lax)
+				{
+					JsonValueList reslist = { 0 };
+
+					jspGetArg(jsp, &elem);
+					res = recursiveExecute(cxt, &elem, jb, &reslist);
+
+					if (jperIsError(res))
+						return res;
+
+					if (JsonValueListLength(&reslist) != 1)
+						return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+
+					res = recursiveExecuteNext(cxt, jsp, NULL,
+											   JsonValueListHead(&reslist),
+											   found, true);
+				}
+				else
+					res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
+			}
+			else
+			{
+				JsonbValue	element_buf;
+				JsonbValue *element;
+				JsonbIterator *it = NULL;
+				JsonbIteratorToken tok;
+				JsonValueList result = { 0 };
+				int			size = JsonbArraySize(jb);
+				int			i;
+
+				jspGetArg(jsp, &elem);
+
+				if (jb->type == jbvBinary && size > 0)
+				{
+					element = &element_buf;
+					it = JsonbIteratorInit(jb->val.binary.data);
+					tok = JsonbIteratorNext(&it, &element_buf, false);
+					if (tok != WJB_BEGIN_ARRAY)
+						elog(ERROR, "unexpected jsonb token at the array start");
+				}
+
+				for (i = 0; i < size; i++)
+				{
+					JsonValueList reslist = { 0 };
+
+					if (it)
+					{
+						tok = JsonbIteratorNext(&it, element, true);
+						if (tok != WJB_ELEM)
+							break;
+					}
+					else
+						element = &jb->val.array.elems[i];
+
+					res = recursiveExecute(cxt, &elem, element, &reslist);
+
+					if (jperIsError(res))
+						break;
+
+					if (JsonValueListLength(&reslist) != 1)
+					{
+						res = jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+						break;
+					}
+
+					JsonValueListConcat(&result, reslist);
+				}
+
+				if (jperIsError(res))
 					break;
-				default:
-					elog(ERROR, "Unknown operation");
+
+				res = recursiveExecuteNext(cxt, jsp, NULL,
+										   wrapItemsInArray(&result),
+										   found, false);
 			}
+			break;
+		case jpiSequence:
+		{
+			JsonPathItem next;
+			bool		hasNext = jspGetNext(jsp, &next);
+			JsonValueList list;
+			JsonValueList *plist = hasNext ? &list : found;
+			JsonValueListIterator it;
+			int			i;
 
-			if (res == jperOk)
+			for (i = 0; i < jsp->content.sequence.nelems; i++)
 			{
-				if (cxt->lax)
-					return jperOk;
+				JsonbValue *v;
 
-				found = true;
+				if (hasNext)
+					memset(&list, 0, sizeof(list));
+
+				jspGetSequenceElement(jsp, i, &elem);
+				res = recursiveExecute(cxt, &elem, jb, plist);
+
+				if (jperIsError(res))
+					break;
+
+				if (!hasNext)
+				{
+					if (!found && res == jperOk)
+						break;
+					continue;
+				}
+
+				memset(&it, 0, sizeof(it));
+
+				while ((v = JsonValueListNext(&list, &it)))
+				{
+					res = recursiveExecute(cxt, &next, v, found);
+
+					if (jperIsError(res) || (!found && res == jperOk))
+					{
+						i = jsp->content.sequence.nelems;
+						break;
+					}
+				}
 			}
-			else if (res == jperError)
+
+			break;
+		}
+		case jpiArray:
 			{
-				if (!cxt->lax)
-					return jperError;
+				JsonValueList list = { 0 };
 
-				error = true;
+				if (jsp->content.arg)
+				{
+					jspGetArg(jsp, &elem);
+					res = recursiveExecute(cxt, &elem, jb, &list);
+
+					if (jperIsError(res))
+						break;
+				}
+
+				res = recursiveExecuteNext(cxt, jsp, NULL,
+										   wrapItemsInArray(&list),
+										   found, false);
 			}
-		}
-	}
+			break;
+		case jpiObject:
+			{
+				JsonbParseState *ps = NULL;
+				JsonbValue *obj;
+				int			i;
 
-	if (found) /* possible only in strict mode */
-		return jperOk;
+				pushJsonbValue(&ps, WJB_BEGIN_OBJECT, NULL);
 
-	if (error) /* possible only in lax mode */
-		return jperError;
+				for (i = 0; i < jsp->content.object.nfields; i++)
+				{
+					JsonbValue *jbv;
+					JsonbValue	jbvtmp;
+					JsonPathItem key;
+					JsonPathItem val;
+					JsonValueList key_list = { 0 };
+					JsonValueList val_list = { 0 };
 
-	return jperNotFound;
-}
+					jspGetObjectField(jsp, i, &key, &val);
 
-static JsonPathExecResult
-executeBinaryArithmExpr(JsonPathExecContext *cxt, JsonPathItem *jsp,
-						JsonbValue *jb, JsonValueList *found)
-{
-	JsonPathExecResult jper;
-	JsonPathItem elem;
-	JsonValueList lseq = { 0 };
-	JsonValueList rseq = { 0 };
-	JsonbValue *lval;
-	JsonbValue *rval;
-	JsonbValue	lvalbuf;
-	JsonbValue	rvalbuf;
-	Datum		ldatum;
-	Datum		rdatum;
-	Datum		res;
-	bool		hasNext;
-	bool		additive = jsp->type == jpiAdd || jsp->type == jpiSub;
+					recursiveExecute(cxt, &key, jb, &key_list);
 
-	jspGetLeftArg(jsp, &elem);
+					if (JsonValueListLength(&key_list) != 1)
+					{
+						res = jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+						break;
+					}
 
-	jper = additive /* XXX standard */
-		? recursiveExecute(cxt, &elem, jb, &lseq)
-		: recursiveExecuteAndUnwrap(cxt, &elem, jb, &lseq);
+					jbv = JsonValueListHead(&key_list);
 
-	if (jper == jperOk)
-	{
-		jspGetRightArg(jsp, &elem);
-		jper = additive /* XXX standard */
-				? recursiveExecute(cxt, &elem, jb, &rseq)
-				: recursiveExecuteAndUnwrap(cxt, &elem, jb, &rseq);
-	}
+					if (JsonbType(jbv) == jbvScalar)
+						jbv = JsonbExtractScalar(jbv->val.binary.data, &jbvtmp);
 
-	if (jper != jperOk ||
-		JsonValueListLength(&lseq) != 1 ||
-		JsonValueListLength(&rseq) != 1)
-		return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+					if (jbv->type != jbvString)
+					{
+						res = jperMakeError(ERRCODE_JSON_SCALAR_REQUIRED); /* XXX */
+						break;
+					}
 
-	lval = JsonValueListHead(&lseq);
+					pushJsonbValue(&ps, WJB_KEY, jbv);
 
-	if (JsonbType(lval) == jbvScalar)
-		lval = JsonbExtractScalar(lval->val.binary.data, &lvalbuf);
+					recursiveExecute(cxt, &val, jb, &val_list);
 
-	if (lval->type != jbvNumeric)
-		return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+					if (JsonValueListLength(&val_list) != 1)
+					{
+						res = jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+						break;
+					}
 
-	rval = JsonValueListHead(&rseq);
+					jbv = JsonValueListHead(&val_list);
+
+					if (jbv->type == jbvObject || jbv->type == jbvArray)
+						jbv = JsonbWrapInBinary(jbv, &jbvtmp);
+
+					pushJsonbValue(&ps, WJB_VALUE, jbv);
+				}
+
+				if (jperIsError(res))
+					break;
+
+				obj = pushJsonbValue(&ps, WJB_END_OBJECT, NULL);
+
+				res = recursiveExecuteNext(cxt, jsp, NULL, obj, found, false);
+			}
+			break;
+		case jpiReduce:
+		case jpiFold:
+		case jpiFoldl:
+		case jpiFoldr:
+			if (JsonbType(jb) != jbvArray)
+			{
+				if (cxt->lax)
+				{
+					if (jsp->type == jpiReduce)
+						res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, true);
+					else
+						res = recursiveExecute(cxt, jsp, wrapItem(jb), found);
+				}
+				else
+					res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
+			}
+			else
+			{
+				JsonbValue	jbv;
+				JsonbValue *result = NULL;
+				int			size = JsonbArraySize(jb);
+				int			i;
+				bool		foldr = jsp->type == jpiFoldr;
+
+				if (jsp->type == jpiReduce)
+					jspGetArg(jsp, &elem);
+				else
+				{
+					JsonValueList reslist = { 0 };
+
+					jspGetRightArg(jsp, &elem);
+					res = recursiveExecute(cxt, &elem, jb, &reslist);
+
+					if (jperIsError(res))
+						return res;
+
+					if (JsonValueListLength(&reslist) != 1)
+						return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+
+					result = JsonValueListHead(&reslist);
+
+					jspGetLeftArg(jsp, &elem);
+				}
+
+				if (jsp->type == jpiReduce && size == 1)
+				{
+					if (jb->type == jbvBinary)
+					{
+						result = getIthJsonbValueFromContainer(jb->val.binary.data, 0);
+						if (!result)
+						{
+							res = jperNotFound;
+							break;
+						}
+					}
+					else
+					{
+						Assert(jb->type == jbvArray);
+						result = &jb->val.array.elems[0];
+					}
+				}
+				else if (size)
+				{
+					JsonbValue *savedArgs[2];
+					int			accum = foldr ? 1 : 0;
+					JsonbIterator *it = NULL;
+					JsonbIteratorToken tok;
+					JsonbValue *element;
+					JsonbArrayCursor cursor;
+					bool		reverse = false;
+
+					if (jb->type == jbvBinary)
+					{
+						element = &jbv;
+
+						if (foldr)
+						{
+							/* walk the array backwards by element positions */
+							JsonbArrayCursorInit(&cursor, jb->val.binary.data);
+							reverse = true;
+						}
+						else
+						{
+							it = JsonbIteratorInit(jb->val.binary.data);
+							tok = JsonbIteratorNext(&it, &jbv, false);
+							if (tok != WJB_BEGIN_ARRAY)
+								elog(ERROR, "unexpected jsonb token at the array start");
+						}
+					}
 
-	if (JsonbType(rval) == jbvScalar)
-		rval = JsonbExtractScalar(rval->val.binary.data, &rvalbuf);
+					/*
+					 * $1 and $2 are passed through the context, saving the
+					 * ones of an outer reduce()/fold(); for foldr() the
+					 * accumulator is $2.
+					 */
+					savedArgs[0] = cxt->foldArgs[0];
+					savedArgs[1] = cxt->foldArgs[1];
 
-	if (rval->type != jbvNumeric)
-		return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+					for (i = 0; i < size; i++)
+					{
+						JsonValueList reslist = { 0 };
 
-	hasNext = jspGetNext(jsp, &elem);
+						if (it)
+						{
+							tok = JsonbIteratorNext(&it, element, true);
+							if (tok != WJB_ELEM)
+								break;
+						}
+						else if (reverse)
+						{
+							if (!JsonbArrayCursorGet(&cursor, size - i - 1,
+													 element))
+								break;
+						}
+						else if (foldr)
+							element = &jb->val.array.elems[size - i - 1];
+						else
+							element = &jb->val.array.elems[i];
 
-	if (!found && !hasNext)
-		return jperOk;
+						if (!i && jsp->type == jpiReduce)
+						{
+							result = copyJsonbValue(element);
+							continue;
+						}
 
-	ldatum = NumericGetDatum(lval->val.numeric);
-	rdatum = NumericGetDatum(rval->val.numeric);
+						cxt->foldArgs[accum] = result;
+						cxt->foldArgs[1 - accum] = element;
 
-	switch (jsp->type)
-	{
-		case jpiAdd:
-			res = DirectFunctionCall2(numeric_add, ldatum, rdatum);
-			break;
-		case jpiSub:
-			res = DirectFunctionCall2(numeric_sub, ldatum, rdatum);
-			break;
-		case jpiMul:
-			res = DirectFunctionCall2(numeric_mul, ldatum, rdatum);
-			break;
-		case jpiDiv:
-			res = DirectFunctionCall2(numeric_div, ldatum, rdatum);
-			break;
-		case jpiMod:
-			res = DirectFunctionCall2(numeric_mod, ldatum, rdatum);
-			break;
-		default:
-			elog(ERROR, "unknown jsonpath arithmetic operation %d", jsp->type);
-	}
+						res = recursiveExecute(cxt, &elem, jb, &reslist);
 
-	lval = palloc(sizeof(*lval));
-	lval->type = jbvNumeric;
-	lval->val.numeric = DatumGetNumeric(res);
+						if (!jperIsError(res) &&
+							JsonValueListLength(&reslist) != 1)
+							res = jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
 
-	return recursiveExecuteNext(cxt, jsp, &elem, lval, found, false);
-}
+						if (jperIsError(res))
+						{
+							cxt->foldArgs[0] = savedArgs[0];
+							cxt->foldArgs[1] = savedArgs[1];
+							return res;
+						}
 
-static JsonPathExecResult
-executeUnaryArithmExpr(JsonPathExecContext *cxt, JsonPathItem *jsp,
-					   JsonbValue *jb,  JsonValueList *found)
-{
-	JsonPathExecResult jper;
-	JsonPathExecResult jper2;
-	JsonPathItem elem;
-	JsonValueList seq = { 0 };
-	JsonValueListIterator it = { 0 };
-	JsonbValue *val;
-	bool		hasNext;
+						result = JsonValueListHead(&reslist);
+					}
 
-	jspGetArg(jsp, &elem);
-	jper = recursiveExecuteAndUnwrap(cxt, &elem, jb, &seq);
+					cxt->foldArgs[0] = savedArgs[0];
+					cxt->foldArgs[1] = savedArgs[1];
+				}
+				else if (jsp->type == jpiReduce)
+				{
+					res = jperNotFound;
+					break;
+				}
 
-	if (jperIsError(jper))
-		return jperMakeError(ERRCODE_JSON_NUMBER_NOT_FOUND);
+				res = recursiveExecuteNext(cxt, jsp, NULL, result, found, false);
+			}
+			break;
+		case jpiMin:
+		case jpiMax:
+			if (JsonbType(jb) != jbvArray)
+			{
+				if (cxt->lax)
+					res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, true);
+				else
+					res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
+			}
+			else
+			{
+				JsonbValue	jbvElementBuf;
+				JsonbValue *jbvElement;
+				JsonbValue *jbvResult = NULL;
+				Jsonb	   *jbResult = NULL;
+				JsonbIterator *it = NULL;
+				JsonbIteratorToken tok;
+				int			size = JsonbArraySize(jb);
+				int			i;
+				bool		isMax = jsp->type == jpiMax;
 
-	jper = jperNotFound;
+				if (jb->type == jbvBinary)
+				{
+					jbvElement = &jbvElementBuf;
+					it = JsonbIteratorInit(jb->val.binary.data);
+					tok = JsonbIteratorNext(&it, &jbvElementBuf, false);
+					if (tok != WJB_BEGIN_ARRAY)
+						elog(ERROR, "unexpected jsonb token at the array start");
+				}
 
-	hasNext = jspGetNext(jsp, &elem);
+				for (i = 0; i < size; i++)
+				{
+					if (it)
+					{
+						tok = JsonbIteratorNext(&it, jbvElement, true);
+						if (tok != WJB_ELEM)
+							break;
+					}
+					else
+						jbvElement = &jb->val.array.elems[i];
 
-	while ((val = JsonValueListNext(&seq, &it)))
-	{
-		if (JsonbType(val) == jbvScalar)
-			JsonbExtractScalar(val->val.binary.data, val);
+					if (!i)
+						jbvResult = it ? copyJsonbValue(jbvElement) : jbvElement;
+					else
+					{
+						Jsonb	   *jbElement = NULL;
+						int			cmp;
 
-		if (val->type == jbvNumeric)
-		{
-			if (!found && !hasNext)
-				return jperOk;
-		}
-		else if (!found && !hasNext)
-			continue; /* skip non-numerics processing */
+						if (isPlainJsonbScalar(jbvElement) &&
+							isPlainJsonbScalar(jbvResult))
+						{
+							/* compare scalars without building jsonbs */
+							if (jbvElement->type == jbvNumeric &&
+								jbvResult->type == jbvNumeric)
+								cmp = compareNumeric(jbvElement->val.numeric,
+													 jbvResult->val.numeric);
+							else
+								cmp = compareJsonbScalars(jbvElement, jbvResult);
+						}
+						else
+						{
+							jbElement = JsonbValueToJsonb(jbvElement);
 
-		if (val->type != jbvNumeric)
-			return jperMakeError(ERRCODE_JSON_NUMBER_NOT_FOUND);
+							if (!jbResult)
+								jbResult = JsonbValueToJsonb(jbvResult);
 
-		switch (jsp->type)
-		{
-			case jpiPlus:
-				break;
-			case jpiMinus:
-				val->val.numeric =
-					DatumGetNumeric(DirectFunctionCall1(
-						numeric_uminus, NumericGetDatum(val->val.numeric)));
-				break;
-			default:
-				elog(ERROR, "unknown jsonpath arithmetic operation %d", jsp->type);
-		}
+							cmp = compareJsonbContainers(&jbElement->root,
+														 &jbResult->root);
+						}
 
-		jper2 = recursiveExecuteNext(cxt, jsp, &elem, val, found, false);
+						if (isMax ? cmp > 0 : cmp < 0)
+						{
+							jbvResult = it ? copyJsonbValue(jbvElement) : jbvElement;
+							jbResult = jbElement;
+						}
+						else if (jbElement)
+							pfree(jbElement);
+					}
+				}
 
-		if (jperIsError(jper2))
-			return jper2;
+				if (!jbvResult)
+				{
+					res = jperNotFound;
+					break;
+				}
 
-		if (jper2 == jperOk)
-		{
-			if (!found)
-				return jperOk;
-			jper = jperOk;
-		}
+				res = recursiveExecuteNext(cxt, jsp, NULL, jbvResult, found,
+										   false);
+			}
+			break;
+		default:
+			elog(ERROR,"Wrong state: %d", jsp->type);
 	}
 
-	return jper;
+	return res;
 }
 
 /*
- * implements jpiAny node (** operator)
+ * Is the item a constant or a variable which can be compared with @?
  */
-static JsonPathExecResult
-recursiveAny(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *jb,
-			 JsonValueList *found, uint32 level, uint32 first, uint32 last)
+static inline bool
+jspIsFilterConstant(JsonPathItem *v)
 {
-	JsonPathExecResult	res = jperNotFound;
-	JsonbIterator		*it;
-	int32				r;
-	JsonbValue			v;
-
-	check_stack_depth();
+	return !jspHasNext(v) &&
+		(v->type == jpiNull || v->type == jpiBool ||
+		 v->type == jpiNumeric || v->type == jpiString ||
+		 v->type == jpiVariable);
+}
 
-	if (level > last)
-		return res;
+/*
+ * Is the filter predicate a comparison of @ with a constant or a variable?
+ * The operator is returned commuted so that @ is its left operand.
+ */
+static bool
+jspIsSimpleFilter(JsonPathItem *filter, JsonPathItemType *op,
+				  JsonPathItem *operand)
+{
+	JsonPathItem pred;
+	JsonPathItem left;
+	JsonPathItem right;
 
-	it = JsonbIteratorInit(jb->val.binary.data);
+	jspGetArg(filter, &pred);
 
-	/*
-	 * Recursivly iterate over jsonb objects/arrays
-	 */
-	while((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+	switch (pred.type)
 	{
-		if (r == WJB_KEY)
-		{
-			r = JsonbIteratorNext(&it, &v, true);
-			Assert(r == WJB_VALUE);
-		}
-
-		if (r == WJB_VALUE || r == WJB_ELEM)
-		{
-
-			if (level >= first)
-			{
-				/* check expression */
-				res = recursiveExecuteNext(cxt, NULL, jsp, &v, found, true);
-
-				if (jperIsError(res))
-					break;
-
-				if (res == jperOk && !found)
-					break;
-			}
+		case jpiEqual:
+		case jpiNotEqual:
+		case jpiLess:
+		case jpiGreater:
+		case jpiLessOrEqual:
+		case jpiGreaterOrEqual:
+			break;
+		default:
+			return false;
+	}
 
-			if (level < last && v.type == jbvBinary)
-			{
-				res = recursiveAny(cxt, jsp, &v, found, level + 1, first, last);
+	jspGetLeftArg(&pred, &left);
+	jspGetRightArg(&pred, &right);
 
-				if (jperIsError(res))
-					break;
+	if (left.type == jpiCurrent && !jspHasNext(&left) &&
+		jspIsFilterConstant(&right))
+	{
+		*op = pred.type;
+		*operand = right;
+		return true;
+	}
 
-				if (res == jperOk && found == NULL)
-					break;
-			}
+	if (right.type == jpiCurrent && !jspHasNext(&right) &&
+		jspIsFilterConstant(&left))
+	{
+		switch (pred.type)
+		{
+			case jpiLess:
+				*op = jpiGreater;
+				break;
+			case jpiGreater:
+				*op = jpiLess;
+				break;
+			case jpiLessOrEqual:
+				*op = jpiGreaterOrEqual;
+				break;
+			case jpiGreaterOrEqual:
+				*op = jpiLessOrEqual;
+				break;
+			default:
+				*op = pred.type;
+				break;
 		}
+
+		*operand = left;
+		return true;
 	}
 
-	return res;
+	return false;
 }
 
-static JsonPathExecResult
-getArrayIndex(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *jb,
-			  int32 *index)
+/*
+ * Apply a filter comparing @ with a constant or a variable to all the
+ * elements of a jsonb array.  The operand is evaluated once, and scalar
+ * elements are compared with it in a tight loop over the array entries, so
+ * that only the matching elements are passed to the next item.  Nested
+ * containers are filtered as usual, using lax unwrapping if requested.
+ *
+ * Returns false if the filter is not such a comparison or the operand is
+ * not a single scalar, the caller then filters the elements one by one.
+ */
+static bool
+executeArrayFilter(JsonPathExecContext *cxt, JsonPathItem *filter,
+				   JsonbValue *jb, bool unwrap, JsonValueList *found,
+				   JsonPathExecResult *pres)
 {
-	JsonbValue *jbv;
-	JsonValueList found = { 0 };
-	JsonbValue	tmp;
-	JsonPathExecResult res = recursiveExecute(cxt, jsp, jb, &found);
+	JsonPathExecResult res = jperNotFound;
+	JsonPathItemType op;
+	JsonPathItem operand;
+	JsonbArrayCursor cursor;
+	JsonbValue *rval = NULL;
+	JsonbValue	rvalbuf;
+	uint32		i;
 
-	if (jperIsError(res))
-		return res;
+	if (jb->type != jbvBinary || !jspIsSimpleFilter(filter, &op, &operand))
+		return false;
 
-	if (JsonValueListLength(&found) != 1)
-		return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+	JsonbArrayCursorInit(&cursor, jb->val.binary.data);
 
-	jbv = JsonValueListHead(&found);
+	if (cursor.nElems > 0)
+	{
+		JsonValueList operands = { 0 };
 
-	if (JsonbType(jbv) == jbvScalar)
-		jbv = JsonbExtractScalar(jbv->val.binary.data, &tmp);
+		res = recursiveExecuteAndUnwrap(cxt, &operand, jb, &operands);
 
-	if (jbv->type != jbvNumeric)
-		return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+		if (jperIsError(res))
+		{
+			/* the comparison is unknown for all the elements */
+			*pres = jperNotFound;
+			return true;
+		}
 
-	*index = DatumGetInt32(DirectFunctionCall1(numeric_int4,
-							DirectFunctionCall2(numeric_trunc,
-											NumericGetDatum(jbv->val.numeric),
-											Int32GetDatum(0))));
+		if (JsonValueListLength(&operands) != 1)
+			return false;
 
-	return jperOk;
-}
+		rval = JsonValueListHead(&operands);
 
-static JsonPathExecResult
-executeStartsWithPredicate(JsonPathExecContext *cxt, JsonPathItem *jsp,
-						   JsonbValue *jb)
-{
-	JsonPathExecResult res;
-	JsonPathItem elem;
-	JsonValueList lseq = { 0 };
-	JsonValueList rseq = { 0 };
-	JsonValueListIterator lit = { 0 };
-	JsonbValue *whole;
-	JsonbValue *initial;
-	JsonbValue	initialbuf;
-	bool		error = false;
-	bool		found = false;
+		if (JsonbType(rval) == jbvScalar)
+			rval = JsonbExtractScalar(rval->val.binary.data, &rvalbuf);
 
-	jspGetRightArg(jsp, &elem);
-	res = recursiveExecute(cxt, &elem, jb, &rseq);
-	if (jperIsError(res))
-		return jperError;
+		if (rval->type == jbvBinary || rval->type == jbvArray ||
+			rval->type == jbvObject)
+			return false;
+	}
 
-	if (JsonValueListLength(&rseq) != 1)
-		return jperError;
+	for (i = 0; i < cursor.nElems; i++)
+	{
+		JsonbValue	v;
 
-	initial = JsonValueListHead(&rseq);
+		JsonbArrayCursorGet(&cursor, i, &v);
+
+		if (v.type == jbvBinary)
+			res = unwrap ?
+				recursiveExecute(cxt, filter, &v, found) :
+				recursiveExecuteNoUnwrap(cxt, filter, &v, found, false);
+		else if (v.type != rval->type)
+			res = jperNotFound;	/* comparison is unknown or false */
+		else if ((op == jpiEqual ? checkEquality(&v, rval, false) :
+				  op == jpiNotEqual ? checkEquality(&v, rval, true) :
+				  makeCompare(op, &v, rval)) != jperOk)
+			res = jperNotFound;
+		else
+			res = recursiveExecuteNext(cxt, filter, NULL, &v, found, true);
 
-	if (JsonbType(initial) == jbvScalar)
-		initial = JsonbExtractScalar(initial->val.binary.data, &initialbuf);
+		if (jperIsError(res))
+			break;
 
-	if (initial->type != jbvString)
-		return jperError;
+		if (res == jperOk && !found)
+			break;
+	}
 
-	jspGetLeftArg(jsp, &elem);
-	res = recursiveExecuteAndUnwrap(cxt, &elem, jb, &lseq);
-	if (jperIsError(res))
-		return jperError;
+	*pres = res;
 
-	while ((whole = JsonValueListNext(&lseq, &lit)))
-	{
-		JsonbValue	wholebuf;
+	return true;
+}
 
-		if (JsonbType(whole) == jbvScalar)
-			whole = JsonbExtractScalar(whole->val.binary.data, &wholebuf);
+static JsonPathExecResult
+recursiveExecuteUnwrapArray(JsonPathExecContext *cxt, JsonPathItem *jsp,
+							JsonbValue *jb, JsonValueList *found)
+{
+	JsonPathExecResult res = jperNotFound;
 
-		if (whole->type != jbvString)
+	if (jb->type == jbvArray)
+	{
+		JsonbValue *elem = jb->val.array.elems;
+		JsonbValue *last = elem + jb->val.array.nElems;
+
+		for (; elem < last; elem++)
 		{
-			if (!cxt->lax)
-				return jperError;
+			res = recursiveExecuteNoUnwrap(cxt, jsp, elem, found, false);
 
-			error = true;
+			if (jperIsError(res))
+				break;
+			if (res == jperOk && !found)
+				break;
 		}
-		else if (whole->val.string.len >= initial->val.string.len &&
-				 !memcmp(whole->val.string.val,
-						 initial->val.string.val,
-						 initial->val.string.len))
-		{
-			if (cxt->lax)
-				return jperOk;
+	}
+	else if (jsp->type != jpiFilter ||
+			 !executeArrayFilter(cxt, jsp, jb, false, found, &res))
+	{
+		JsonbValue	v;
+		JsonbIterator *it;
+		JsonbIteratorToken tok;
 
-			found = true;
+		it = JsonbIteratorInit(jb->val.binary.data);
+
+		while ((tok = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+		{
+			if (tok == WJB_ELEM)
+			{
+				res = recursiveExecuteNoUnwrap(cxt, jsp, &v, found, false);
+				if (jperIsError(res))
+					break;
+				if (res == jperOk && !found)
+					break;
+			}
 		}
 	}
 
-	if (found) /* possible only in strict mode */
-		return jperOk;
+	return res;
+}
 
-	if (error) /* possible only in lax mode */
-		return jperError;
+static inline JsonPathExecResult
+recursiveExecuteUnwrap(JsonPathExecContext *cxt, JsonPathItem *jsp,
+					   JsonbValue *jb, JsonValueList *found)
+{
+	if (cxt->lax && JsonbType(jb) == jbvArray)
+		return recursiveExecuteUnwrapArray(cxt, jsp, jb, found);
 
-	return jperNotFound;
+	return recursiveExecuteNoUnwrap(cxt, jsp, jb, found, false);
 }
 
-static bool
-tryToParseDatetime(const char *template, text *datetime,
-				   Datum *value, Oid *typid, int32 *typmod)
+static inline JsonbValue *
+wrapItem(JsonbValue *jbv)
 {
-	MemoryContext mcxt = CurrentMemoryContext;
-	bool		ok = false;
+	JsonbParseState *ps = NULL;
+	JsonbValue	jbvbuf;
+	int			type = JsonbType(jbv);
 
-	PG_TRY();
+	if (type == jbvArray)
+		return jbv;
+
+	if (type == jbvScalar)
+		jbv = JsonbExtractScalar(jbv->val.binary.data, &jbvbuf);
+
+	pushJsonbValue(&ps, WJB_BEGIN_ARRAY, NULL);
+	pushJsonbValue(&ps, WJB_ELEM, jbv);
+	jbv = pushJsonbValue(&ps, WJB_END_ARRAY, NULL);
+
+	return JsonbWrapInBinary(jbv, NULL);
+}
+
+/*
+ * Is the item applied to each element of an array in lax mode?
+ */
+static inline bool
+jspAutoUnwrapsArray(JsonPathItemType type)
+{
+	switch (type)
 	{
-		*value = to_datetime(datetime, template, -1, true, typid, typmod);
-		ok = true;
+		case jpiKey:
+		case jpiAnyKey:
+	/*	case jpiAny: */
+		case jpiFilter:
+		/* all methods excluding type() and size() */
+		case jpiAbs:
+		case jpiFloor:
+		case jpiCeiling:
+		case jpiDouble:
+		case jpiDatetime:
+		case jpiKeyValue:
+			return true;
+
+		default:
+			return false;
 	}
-	PG_CATCH();
+}
+
+static inline JsonPathExecResult
+recursiveExecute(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *jb,
+				 JsonValueList *found)
+{
+	if (cxt->lax)
 	{
-		if (ERRCODE_TO_CATEGORY(geterrcode()) != ERRCODE_DATA_EXCEPTION)
-			PG_RE_THROW();
+		if (jspAutoUnwrapsArray(jsp->type))
+			return recursiveExecuteUnwrap(cxt, jsp, jb, found);
 
-		FlushErrorState();
-		MemoryContextSwitchTo(mcxt);
+		if (jsp->type == jpiAnyArray)
+			jb = wrapItem(jb);
 	}
-	PG_END_TRY();
 
-	return ok;
+	return recursiveExecuteNoUnwrap(cxt, jsp, jb, found, false);
 }
 
 static inline JsonPathExecResult
-appendBoolResult(JsonPathExecContext *cxt, JsonPathItem *jsp,
-				 JsonValueList *found, JsonPathExecResult res, bool needBool)
+recursiveExecuteBool(JsonPathExecContext *cxt, JsonPathItem *jsp,
+					 JsonbValue *jb)
 {
-	JsonPathItem next;
-	JsonbValue	jbv;
-	bool		hasNext = jspGetNext(jsp, &next);
+	if (jspHasNext(jsp))
+		elog(ERROR, "boolean jsonpath item can not have next item");
 
-	if (needBool)
+	switch (jsp->type)
 	{
-		Assert(!hasNext);
-		return res;
-	}
-
-	if (!found && !hasNext)
-		return jperOk;	/* found singleton boolean value */
+		case jpiAnd:
+		case jpiOr:
+		case jpiNot:
+		case jpiIsUnknown:
+		case jpiEqual:
+		case jpiNotEqual:
+		case jpiGreater:
+		case jpiGreaterOrEqual:
+		case jpiLess:
+		case jpiLessOrEqual:
+		case jpiExists:
+		case jpiStartsWith:
+		case jpiLikeRegex:
+			break;
 
-	if (jperIsError(res))
-		jbv.type = jbvNull;
-	else
-	{
-		jbv.type = jbvBool;
-		jbv.val.boolean = res == jperOk;
+		default:
+			elog(ERROR, "invalid boolean jsonpath item type: %d", jsp->type);
+			break;
 	}
 
-	return recursiveExecuteNext(cxt, jsp, &next, &jbv, found, true);
+	return recursiveExecuteNoUnwrap(cxt, jsp, jb, NULL, true);
 }
 
 /*
- * Main executor function: walks on jsonpath structure and tries to find
- * correspoding parts of jsonb. Note, jsonb and jsonpath values should be
- * avaliable and untoasted during work because JsonPathItem, JsonbValue
- * and found could have pointers into input values. If caller wants just to
- * check matching of json by jsonpath then it doesn't provide a found arg.
- * In this case executor works till first positive result and does not check
- * the rest if it is possible. In other case it tries to find all satisfied
- * results
+ * Public interface to jsonpath executor
  */
+static void
+initJsonPathExecContext(JsonPathExecContext *cxt, bool lax, int nvars,
+						int nmemo, List *vars, Jsonb *json, JsonbValue *root)
+{
+	cxt->vars = vars;
+	cxt->varSlots = nvars > 0 ? palloc0(sizeof(*cxt->varSlots) * nvars) : NULL;
+	cxt->memo = nmemo > 0 ? palloc0(sizeof(*cxt->memo) * nmemo) : NULL;
+	cxt->memoSeq = 0;
+	cxt->filterSeq = 0;
+	cxt->foldArgs[0] = NULL;
+	cxt->foldArgs[1] = NULL;
+	cxt->lax = lax;
+	cxt->root = JsonbInitBinary(root, json);
+	cxt->innermostArraySize = -1;
+}
+
 static JsonPathExecResult
-recursiveExecuteNoUnwrap(JsonPathExecContext *cxt, JsonPathItem *jsp,
-						 JsonbValue *jb, JsonValueList *found, bool needBool)
+executeJsonPathItem(JsonPathItem *jsp, bool lax, int nvars, int nmemo,
+					List *vars, Jsonb *json, JsonValueList *foundJson)
 {
-	JsonPathItem		elem;
-	JsonPathExecResult	res = jperNotFound;
-	bool				hasNext;
+	JsonPathExecContext cxt;
+	JsonbValue		jbv;
 
-	check_stack_depth();
+	initJsonPathExecContext(&cxt, lax, nvars, nmemo, vars, json, &jbv);
 
-	switch(jsp->type) {
-		case jpiAnd:
-			jspGetLeftArg(jsp, &elem);
-			res = recursiveExecuteBool(cxt, &elem, jb);
-			if (res != jperNotFound)
-			{
-				JsonPathExecResult res2;
+	return recursiveExecute(&cxt, jsp, &jbv, foundJson);
+}
 
-				/*
-				 * SQL/JSON says that we should check second arg
-				 * in case of jperError
-				 */
+JsonPathExecResult
+executeJsonPath(JsonPath *path, List *vars, Jsonb *json, JsonValueList *foundJson)
+{
+	JsonPathItem	jsp;
 
-				jspGetRightArg(jsp, &elem);
-				res2 = recursiveExecuteBool(cxt, &elem, jb);
+	jspInit(&jsp, path);
 
-				res = (res2 == jperOk) ? res : res2;
-			}
-			res = appendBoolResult(cxt, jsp, found, res, needBool);
-			break;
-		case jpiOr:
-			jspGetLeftArg(jsp, &elem);
-			res = recursiveExecuteBool(cxt, &elem, jb);
-			if (res != jperOk)
-			{
-				JsonPathExecResult res2;
+	return executeJsonPathItem(&jsp, (path->header & JSONPATH_LAX) != 0,
+							   0, 0, vars, json, foundJson);
+}
 
-				jspGetRightArg(jsp, &elem);
-				res2 = recursiveExecuteBool(cxt, &elem, jb);
+/*
+ * Execute compiled jsonpath, its items are not decoded again.
+ */
+JsonPathExecResult
+executeCompiledJsonPath(JsonPathCompiled *path, List *vars, Jsonb *json,
+						JsonValueList *foundJson)
+{
+	JsonPathItem	jsp = *path->root;
 
-				res = (res2 == jperNotFound) ? res : res2;
-			}
-			res = appendBoolResult(cxt, jsp, found, res, needBool);
-			break;
-		case jpiNot:
-			jspGetArg(jsp, &elem);
-			switch ((res = recursiveExecuteBool(cxt, &elem, jb)))
-			{
-				case jperOk:
-					res = jperNotFound;
-					break;
-				case jperNotFound:
-					res = jperOk;
-					break;
-				default:
-					break;
-			}
-			res = appendBoolResult(cxt, jsp, found, res, needBool);
-			break;
-		case jpiIsUnknown:
-			jspGetArg(jsp, &elem);
-			res = recursiveExecuteBool(cxt, &elem, jb);
-			res = jperIsError(res) ? jperOk : jperNotFound;
-			res = appendBoolResult(cxt, jsp, found, res, needBool);
-			break;
-		case jpiKey:
-			if (JsonbType(jb) == jbvObject)
-			{
-				JsonbValue	*v, key;
-				JsonbValue	obj;
+	return executeJsonPathItem(&jsp, path->lax, path->nvars, path->nmemo,
+							   vars, json, foundJson);
+}
 
-				if (jb->type == jbvObject)
-					jb = JsonbWrapInBinary(jb, &obj);
+/*
+ * Lazy jsonpath iterator.
+ *
+ * The path is executed item by item of its chain.  Array and object
+ * wildcards (including lax unwrapping of arrays) are not expanded at once,
+ * but keep a jsonb iterator over the container in a frame of the iterator
+ * stack.  Other items are executed by the usual executor for each value
+ * separately.  So only the current value of each accessor level is kept
+ * and the execution stops as soon as the caller stops fetching items.
+ */
+typedef struct JsonPathIteratorFrame
+{
+	JsonPathItem step;			/* item applied to the values of the frame */
+	bool		hasStep;		/* no step: values are results of the path */
+	bool		unwrap;			/* lax unwrapping of arrays is allowed */
+	bool		container;		/* values come from jsonb iterator */
+	JsonbIterator *it;			/* jsonb iterator over the container */
+	JsonbIteratorToken tok;		/* WJB_ELEM or WJB_VALUE */
+	JsonbValue	val;			/* current value of jsonb iterator */
+	JsonValueList found;		/* values computed by the executor */
+	JsonValueListIterator iter;
+} JsonPathIteratorFrame;
+
+struct JsonPathIterator
+{
+	JsonPathExecContext cxt;
+	JsonbValue	root;
+	int			depth;			/* number of active frames */
+	JsonPathIteratorFrame *frames;
+};
 
-				key.type = jbvString;
-				key.val.string.val = jspGetString(jsp, &key.val.string.len);
+/*
+ * Push a frame applying jsonpath item to the value produced by an outer
+ * frame.
+ */
+static JsonPathExecResult
+pushJsonPathIteratorStep(JsonPathIterator *it, JsonPathItem *step,
+						 JsonbValue *jb, bool unwrap)
+{
+	JsonPathExecContext *cxt = &it->cxt;
+	JsonPathIteratorFrame *frame = &it->frames[it->depth];
+	JsonPathExecResult res;
+	JsonPathItem cur;
 
-				v = findJsonbValueFromContainer(jb->val.binary.data, JB_FOBJECT, &key);
+	if (jb->type == jbvBinary)
+	{
+		int			type = JsonbType(jb);
 
-				if (v != NULL)
-				{
-					res = recursiveExecuteNext(cxt, jsp, NULL, v, found, false);
+		frame->container = true;
 
-					if (jspHasNext(jsp) || !found)
-						pfree(v); /* free value if it was not added to found list */
-				}
-				else if (!cxt->lax && found)
-					res = jperMakeError(ERRCODE_JSON_MEMBER_NOT_FOUND);
-			}
-			else if (!cxt->lax && found)
-				res = jperMakeError(ERRCODE_JSON_MEMBER_NOT_FOUND);
-			break;
-		case jpiRoot:
-			jb = cxt->root;
-			/* fall through */
-		case jpiCurrent:
-			{
-				JsonbValue *v;
-				JsonbValue	vbuf;
-				bool		copy = true;
+		if (cxt->lax && unwrap && type == jbvArray &&
+			jspAutoUnwrapsArray(step->type))
+		{
+			/* apply the same item to each array element */
+			frame->step = *step;
+			frame->hasStep = true;
+			frame->unwrap = false;
+			frame->tok = WJB_ELEM;
+		}
+		else if ((step->type == jpiAnyArray && type == jbvArray) ||
+				 (step->type == jpiAnyKey && type == jbvObject))
+		{
+			/* continue with the next item for each element or member */
+			frame->hasStep = jspGetNext(step, &frame->step);
+			frame->unwrap = true;
+			frame->tok = step->type == jpiAnyArray ? WJB_ELEM : WJB_VALUE;
+		}
+		else
+			frame->container = false;
 
-				if (JsonbType(jb) == jbvScalar)
-				{
-					if (jspHasNext(jsp))
-						v = &vbuf;
-					else
-					{
-						v = palloc(sizeof(*v));
-						copy = false;
-					}
+		/* filter scalar elements of the array at once, if possible */
+		if (frame->container && type == jbvArray && frame->hasStep &&
+			frame->step.type == jpiFilter)
+		{
+			JsonPathItem filter = frame->step;
 
-					JsonbExtractScalar(jb->val.binary.data, v);
-				}
-				else
-					v = jb;
+			cur = filter;
+			cur.nextPos = 0;
 
-				res = recursiveExecuteNext(cxt, jsp, NULL, v, found, copy);
-				break;
-			}
-		case jpiAnyArray:
-			if (JsonbType(jb) == jbvArray)
-			{
-				hasNext = jspGetNext(jsp, &elem);
+			JsonValueListReset(&frame->found);
+			memset(&frame->iter, 0, sizeof(frame->iter));
 
-				if (jb->type == jbvArray)
-				{
-					JsonbValue *el = jb->val.array.elems;
-					JsonbValue *last_el = el + jb->val.array.nElems;
+			if (executeArrayFilter(cxt, &cur, jb, frame->unwrap,
+								   &frame->found, &res))
+			{
+				if (jperIsError(res))
+					return res;
 
-					for (; el < last_el; el++)
-					{
-						res = recursiveExecuteNext(cxt, jsp, &elem, el, found, true);
+				frame->container = false;
+				frame->hasStep = jspGetNext(&filter, &frame->step);
+				frame->unwrap = true;
+				it->depth++;
 
-						if (jperIsError(res))
-							break;
+				return jperOk;
+			}
+		}
 
-						if (res == jperOk && !found)
-							break;
-					}
-				}
-				else
-				{
-					JsonbValue	v;
-					JsonbIterator *it;
-					JsonbIteratorToken r;
+		if (frame->container)
+		{
+			frame->it = JsonbIteratorInit(jb->val.binary.data);
+			it->depth++;
+			return jperOk;
+		}
+	}
 
-					it = JsonbIteratorInit(jb->val.binary.data);
+	JsonValueListReset(&frame->found);
+	memset(&frame->iter, 0, sizeof(frame->iter));
 
-					while((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
-					{
-						if (r == WJB_ELEM)
-						{
-							res = recursiveExecuteNext(cxt, jsp, &elem, &v, found, true);
+	if (cxt->lax && step->type == jpiAny && jspGetNext(step, &cur) &&
+		cur.type == jpiKey)
+	{
+		/* execute .**.key as a single step using the key probing */
+		JsonPathItem key = cur;
 
-							if (jperIsError(res))
-								break;
+		key.nextPos = 0;
 
-							if (res == jperOk && !found)
-								break;
-						}
-					}
-				}
-			}
-			else if (found)
-				res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
-			break;
+		res = executeAny(cxt, step, &key, jb, &frame->found);
 
-		case jpiIndexArray:
-			if (JsonbType(jb) == jbvArray)
-			{
-				int			innermostArraySize = cxt->innermostArraySize;
-				int			i;
-				int			size = JsonbArraySize(jb);
-				bool		binary = jb->type == jbvBinary;
+		if (jperIsError(res))
+			return res;
 
-				cxt->innermostArraySize = size; /* for LAST evaluation */
+		frame->hasStep = jspGetNext(&cur, &frame->step);
+		frame->unwrap = true;
+		it->depth++;
 
-				hasNext = jspGetNext(jsp, &elem);
+		return jperOk;
+	}
 
-				for (i = 0; i < jsp->content.array.nelems; i++)
-				{
-					JsonPathItem from;
-					JsonPathItem to;
-					int32		index;
-					int32		index_from;
-					int32		index_to;
-					bool		range = jspGetArraySubscript(jsp, &from, &to, i);
+	/* execute the single item, without its continuation */
+	cur = *step;
+	cur.nextPos = 0;
 
-					res = getArrayIndex(cxt, &from, jb, &index_from);
+	res = unwrap ?
+		recursiveExecute(cxt, &cur, jb, &frame->found) :
+		recursiveExecuteNoUnwrap(cxt, &cur, jb, &frame->found, false);
 
-					if (jperIsError(res))
-						break;
+	if (jperIsError(res))
+		return res;
 
-					if (range)
-					{
-						res = getArrayIndex(cxt, &to, jb, &index_to);
+	frame->hasStep = jspGetNext(step, &frame->step);
+	frame->unwrap = true;
+	it->depth++;
 
-						if (jperIsError(res))
-							break;
-					}
-					else
-						index_to = index_from;
+	return jperOk;
+}
 
-					if (!cxt->lax &&
-						(index_from < 0 ||
-						 index_from > index_to ||
-						 index_to >= size))
-					{
-						res = jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
-						break;
-					}
+/*
+ * Create memo of key accessor chains for the document, it is allocated in the
+ * current memory context and is valid as long as the document.
+ */
+JsonPathKeyMemo *
+JsonPathKeyMemoCreate(Jsonb *json)
+{
+	JsonPathKeyMemo *memo = palloc0(sizeof(*memo));
 
-					if (index_from < 0)
-						index_from = 0;
+	memo->json = json;
+	memo->mcxt = CurrentMemoryContext;
 
-					if (index_to >= size)
-						index_to = size - 1;
+	return memo;
+}
 
-					res = jperNotFound;
+/*
+ * Switch the memo to another document, values of the new document are
+ * allocated in the current memory context.  Entries of the trie are kept.
+ */
+void
+JsonPathKeyMemoReset(JsonPathKeyMemo *memo, Jsonb *json)
+{
+	int			i;
 
-					for (index = index_from; index <= index_to; index++)
-					{
-						JsonbValue *v = binary ?
-							getIthJsonbValueFromContainer(jb->val.binary.data,
-														  (uint32) index) :
-							&jb->val.array.elems[index];
+	memo->json = json;
+	memo->mcxt = CurrentMemoryContext;
 
-						if (v == NULL)
-							continue;
+	for (i = 0; i < memo->nentries; i++)
+	{
+		memo->entries[i].value = NULL;
+		memo->entries[i].resolved = false;
+	}
+}
 
-						res = recursiveExecuteNext(cxt, jsp, &elem, v, found,
-												   !binary);
+/* Find the child entry of the trie for the key, add it if it is absent */
+static int
+getJsonPathKeyMemoEntry(JsonPathKeyMemo *memo, int parent, char *key,
+						int32 keylen)
+{
+	JsonPathKeyMemoEntry *entry;
+	int			i;
 
-						if (jperIsError(res))
-							break;
+	for (i = 0; i < memo->nentries; i++)
+	{
+		entry = &memo->entries[i];
 
-						if (res == jperOk && !found)
-							break;
-					}
+		if (entry->parent == parent && entry->keylen == keylen &&
+			!memcmp(entry->key, key, keylen))
+			return i;
+	}
 
-					if (jperIsError(res))
-						break;
+	/* the trie lives as long as the memo itself */
+	if (memo->nentries >= memo->maxentries)
+	{
+		memo->maxentries = memo->maxentries ? memo->maxentries * 2 : 8;
+		memo->entries = memo->entries ?
+			repalloc(memo->entries, sizeof(*memo->entries) * memo->maxentries) :
+			MemoryContextAlloc(GetMemoryChunkContext(memo),
+							   sizeof(*memo->entries) * memo->maxentries);
+	}
 
-					if (res == jperOk && !found)
-						break;
-				}
+	entry = &memo->entries[memo->nentries];
+	entry->parent = parent;
+	entry->key = MemoryContextAlloc(GetMemoryChunkContext(memo), keylen);
+	memcpy(entry->key, key, keylen);
+	entry->keylen = keylen;
+	entry->value = NULL;
+	entry->resolved = false;
 
-				cxt->innermostArraySize = innermostArraySize;
-			}
-			else if (JsonbType(jb) == jbvObject)
-			{
-				int			innermostArraySize = cxt->innermostArraySize;
-				int			i;
-				JsonbValue	bin;
-				JsonbValue *wrapped = NULL;
+	return memo->nentries++;
+}
 
-				if (jb->type == jbvBinary)
-					jb = JsonbWrapInBinary(jb, &bin);
+/*
+ * Merge the leading key accessors "$.a.b" of the path into the trie of the
+ * memo in advance, so that the paths sharing a prefix of the chain navigate
+ * it only once per document.
+ */
+void
+JsonPathKeyMemoAddPath(JsonPathKeyMemo *memo, JsonPathCompiled *path)
+{
+	JsonPathItem item = *path->root;
+	JsonPathItem next;
+	int			parent = -1;
 
-				cxt->innermostArraySize = 1;
+	if (item.type != jpiRoot)
+		return;
 
-				for (i = 0; i < jsp->content.array.nelems; i++)
-				{
-					JsonPathItem from;
-					JsonPathItem to;
-					JsonbValue *key;
-					JsonbValue	tmp;
-					JsonValueList keys = { 0 };
-					bool		range = jspGetArraySubscript(jsp, &from, &to, i);
+	while (jspGetNext(&item, &next) && next.type == jpiKey)
+	{
+		char	   *key;
+		int32		keylen;
 
-					if (range)
-					{
-						int		index_from;
-						int		index_to;
+		item = next;
+		key = jspGetString(&item, &keylen);
+		parent = getJsonPathKeyMemoEntry(memo, parent, key, keylen);
+	}
+}
 
-						if (!cxt->lax)
-							return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+/*
+ * Look up the leading key accessors "$.a.b" of the path in the document of
+ * the memo.  Members are looked up only once for all the paths sharing the
+ * memo, returns the value of the longest prefix of the chain consisting of
+ * object members and its last key accessor, or NULL if there is no such
+ * prefix.  In both lax and strict modes the prefix evaluates exactly to the
+ * returned value, so the execution can continue from its last accessor.
+ */
+static JsonbValue *
+lookupJsonPathKeyMemo(JsonPathKeyMemo *memo, JsonPathCompiled *path,
+					  JsonPathItem *last)
+{
+	JsonPathItem item = *path->root;
+	JsonPathItem next;
+	JsonbValue	root;
+	JsonbValue *value = NULL;
+	int			parent = -1;
 
-						if (!wrapped)
-							wrapped = wrapItem(jb);
+	if (item.type != jpiRoot)
+		return NULL;
 
-						res = getArrayIndex(cxt, &from, wrapped, &index_from);
-						if (jperIsError(res))
-							return res;
+	while (jspGetNext(&item, &next) && next.type == jpiKey)
+	{
+		JsonPathKeyMemoEntry *entry;
+		char	   *key;
+		int32		keylen;
+		int			i;
 
-						res = getArrayIndex(cxt, &to, wrapped, &index_to);
-						if (jperIsError(res))
-							return res;
+		item = next;
+		key = jspGetString(&item, &keylen);
+		i = getJsonPathKeyMemoEntry(memo, parent, key, keylen);
+		entry = &memo->entries[i];
 
-						res = jperNotFound;
+		if (!entry->resolved)
+		{
+			JsonbValue *obj = parent < 0 ?
+				JsonbInitBinary(&root, memo->json) :
+				memo->entries[parent].value;
 
-						if (index_from <= 0 && index_to >= 0)
-						{
-							res = recursiveExecuteNext(cxt, jsp, NULL, jb,
-													   found, true);
-							if (jperIsError(res))
-								return res;
+			if (JsonbType(obj) == jbvObject && obj->type == jbvBinary)
+			{
+				MemoryContext oldcxt = MemoryContextSwitchTo(memo->mcxt);
+				JsonbValue	k;
 
-						}
+				k.type = jbvString;
+				k.val.string.val = key;
+				k.val.string.len = keylen;
 
-						if (res == jperOk && !found)
-							break;
+				entry->value = findJsonbValueFromContainer(obj->val.binary.data,
+														   JB_FOBJECT, &k);
+				MemoryContextSwitchTo(oldcxt);
+			}
 
-						continue;
-					}
+			entry->resolved = true;
+		}
 
-					res = recursiveExecute(cxt, &from, jb, &keys);
+		if (!entry->value)
+			break;
 
-					if (jperIsError(res))
-						return res;
+		value = entry->value;
+		*last = item;
+		parent = i;
+	}
 
-					if (JsonValueListLength(&keys) != 1)
-						return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+	return value;
+}
 
-					key = JsonValueListHead(&keys);
+/*
+ * Start lazy execution of compiled jsonpath.  All the state of the iterator
+ * is allocated in the current memory context.  Leading key accessors of the
+ * path are looked up in the memo, if it is given.
+ */
+JsonPathIterator *
+JsonPathIteratorInit(JsonPathCompiled *path, List *vars, Jsonb *json,
+					 JsonPathKeyMemo *memo)
+{
+	JsonPathIterator *it = palloc0(sizeof(*it));
+	JsonPathIteratorFrame *frame;
+	JsonPathItem item = *path->root;
+	JsonPathItem next;
+	JsonPathItem last;
+	JsonbValue *start = NULL;
+	int			nitems = 1;
 
-					if (JsonbType(key) == jbvScalar)
-						key = JsonbExtractScalar(key->val.binary.data, &tmp);
+	while (jspGetNext(&item, &next))
+	{
+		item = next;
+		nitems++;
+	}
 
-					res = jperNotFound;
+	/* each item needs at most two frames, one more for the root value */
+	it->frames = palloc0(sizeof(*it->frames) * (2 * nitems + 1));
 
-					if (key->type == jbvNumeric && cxt->lax)
-					{
-						int			index = DatumGetInt32(
-								DirectFunctionCall1(numeric_int4,
-									DirectFunctionCall2(numeric_trunc,
-											NumericGetDatum(key->val.numeric),
-											Int32GetDatum(0))));
+	initJsonPathExecContext(&it->cxt, path->lax, path->nvars, path->nmemo,
+							vars, json, &it->root);
 
-						if (!index)
-						{
-							res = recursiveExecuteNext(cxt, jsp, NULL, jb,
-													   found, true);
-							if (jperIsError(res))
-								return res;
-						}
-					}
-					else if (key->type == jbvString)
-					{
-						key = findJsonbValueFromContainer(jb->val.binary.data,
-														  JB_FOBJECT, key);
+	if (memo)
+	{
+		Assert(memo->json == json);
+		start = lookupJsonPathKeyMemo(memo, path, &last);
+	}
 
-						if (key)
-						{
-							res = recursiveExecuteNext(cxt, jsp, NULL, key,
-													   found, false);
-							if (jperIsError(res))
-								return res;
-						}
-						else if (!cxt->lax)
-							return jperMakeError(ERRCODE_JSON_MEMBER_NOT_FOUND);
-					}
-					else
-						return jperMakeError(ERRCODE_INVALID_JSON_SUBSCRIPT);
+	frame = &it->frames[0];
+	frame->unwrap = true;
+	frame->container = false;
 
-					if (res == jperOk && !found)
-						break;
-				}
+	if (start)
+	{
+		/* continue after the key accessors, the memo value is not changed */
+		frame->hasStep = jspGetNext(&last, &frame->step);
+		JsonValueListAppendCopy(&frame->found, start);
+	}
+	else
+	{
+		frame->step = *path->root;
+		frame->hasStep = true;
+		JsonValueListAppend(&frame->found, &it->root);
+	}
 
-				cxt->innermostArraySize = innermostArraySize;
-			}
-			else
-			{
-				if (cxt->lax)
-					res = recursiveExecuteNoUnwrap(cxt, jsp, wrapItem(jb),
-												   found, false);
-				else if (found)
-					res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
-			}
-			break;
+	it->depth = 1;
 
-		case jpiLast:
-			{
-				JsonbValue	tmpjbv;
-				JsonbValue *lastjbv;
-				int			last;
-				bool		hasNext;
+	return it;
+}
 
-				if (cxt->innermostArraySize < 0)
-					elog(ERROR,
-						 "evaluating jsonpath LAST outside of array subscript");
+/*
+ * Fetch next item of jsonpath.  Returns jperOk and the item, jperNotFound
+ * at the end of the sequence, or error.  The item is valid until the next
+ * call, the iterator is finished after an error.
+ */
+JsonPathExecResult
+JsonPathIteratorNext(JsonPathIterator *it, JsonbValue **item)
+{
+	*item = NULL;
 
-				hasNext = jspGetNext(jsp, &elem);
+	while (it->depth > 0)
+	{
+		JsonPathIteratorFrame *frame = &it->frames[it->depth - 1];
+		JsonPathExecResult res;
+		JsonbValue *jb = NULL;
 
-				if (!hasNext && !found)
+		if (frame->container)
+		{
+			JsonbIteratorToken tok;
+
+			while ((tok = JsonbIteratorNext(&frame->it, &frame->val, true))
+				   != WJB_DONE)
+			{
+				if (tok == frame->tok)
 				{
-					res = jperOk;
+					jb = &frame->val;
 					break;
 				}
+			}
+		}
+		else
+			jb = JsonValueListNext(&frame->found, &frame->iter);
 
-				last = cxt->innermostArraySize - 1;
+		if (!jb)
+		{
+			/* the frame is exhausted, its chunks are reused by the next one */
+			it->depth--;
+			continue;
+		}
 
-				lastjbv = hasNext ? &tmpjbv : palloc(sizeof(*lastjbv));
+		if (!frame->hasStep)
+		{
+			*item = jb;
+			return jperOk;
+		}
 
-				lastjbv->type = jbvNumeric;
-				lastjbv->val.numeric = DatumGetNumeric(DirectFunctionCall1(
-											int4_numeric, Int32GetDatum(last)));
+		res = pushJsonPathIteratorStep(it, &frame->step, jb, frame->unwrap);
 
-				res = recursiveExecuteNext(cxt, jsp, &elem, lastjbv, found, hasNext);
-			}
-			break;
-		case jpiAnyKey:
-			if (JsonbType(jb) == jbvObject)
-			{
-				JsonbIterator	*it;
-				int32			r;
-				JsonbValue		v;
-				JsonbValue		bin;
+		if (jperIsError(res))
+		{
+			it->depth = 0;
+			return res;
+		}
+	}
 
-				if (jb->type == jbvObject)
-					jb = JsonbWrapInBinary(jb, &bin);
+	return jperNotFound;
+}
 
-				hasNext = jspGetNext(jsp, &elem);
-				it = JsonbIteratorInit(jb->val.binary.data);
+/*
+ * Execution of simple paths over json text.
+ *
+ * Accessors of the path are matched against the values reported by the json
+ * parser, the only values converted into jsonb are the results.  Values not
+ * matched by the path are skipped by detaching the semantic actions, so that
+ * the parser only lexes them.  The parser reads the actions of a container
+ * or a member before calling its start action, so the end action of the
+ * value being skipped is still called and attaches them back.
+ *
+ * The caller may need only a few results.  Once they are collected, matching
+ * stops and the rest of the text is only lexed.  The results can still be
+ * discarded by a duplicate key of an object they were found in, so the keys
+ * of such objects, and only them, are watched until the objects end.
+ */
 
-				while((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
-				{
-					if (r == WJB_VALUE)
-					{
-						res = recursiveExecuteNext(cxt, jsp, &elem, &v, found, true);
+/* Container matched by an accessor of the path */
+typedef struct JsonPathStreamLevel
+{
+	int			step;			/* accessor applied to the container */
+	bool		unwrap;			/* array elements get the same accessor */
+	int32		index;			/* number of the current array element */
+	int			mark;			/* number of results before the object */
+	bool		object;			/* the container is an object */
+} JsonPathStreamLevel;
+
+typedef struct JsonPathStreamState
+{
+	JsonLexContext *lex;
+	JsonSemAction *sem;
+	JsonSemAction actions;		/* semantic actions to attach back */
+	JsonPathStreamStep *steps;
+	int			nsteps;
+	int			next;			/* accessor applied to the next value, or -1 */
+	bool		nextUnwrapped;	/* next value is an element of unwrapped array */
+	bool		skipping;		/* the current container is skipped */
+	bool		skipRest;		/* the rest of the current array is skipped */
+	char	   *capture;		/* start of the resulting container */
+	char	   *valueStart;		/* start of the current member or element */
+	JsonPathStreamLevel *levels;
+	int			nlevels;
+	int			maxlevels;
+	JsonbValue *results;		/* resulting values, or */
+	JsonPathStreamSpan *spans;	/* their locations, if only they are needed */
+	int			nresults;
+	int			maxresults;
+	int			limit;			/* number of results needed, or 0 if all */
+	bool		done;			/* the limit is reached */
+	int			depth;			/* nesting of containers after that */
+} JsonPathStreamState;
+
+static void jspStreamObjectFieldStart(void *arg, char *fname, bool isnull);
 
-						if (jperIsError(res))
-							break;
+static inline void
+jspStreamDetach(JsonPathStreamState *state)
+{
+	JsonSemAction *sem = state->sem;
+
+	sem->object_start = NULL;
+	sem->object_end = NULL;
+	sem->array_start = NULL;
+	sem->array_end = NULL;
+	sem->object_field_start = NULL;
+	sem->object_field_end = NULL;
+	sem->array_element_start = NULL;
+	sem->array_element_end = NULL;
+	sem->scalar = NULL;
+}
 
-						if (res == jperOk && !found)
-							break;
-					}
-				}
-			}
-			else if (!cxt->lax && found)
-				res = jperMakeError(ERRCODE_JSON_OBJECT_NOT_FOUND);
-			break;
-		case jpiEqual:
-		case jpiNotEqual:
-		case jpiLess:
-		case jpiGreater:
-		case jpiLessOrEqual:
-		case jpiGreaterOrEqual:
-			res = executeExpr(cxt, jsp, jb);
-			res = appendBoolResult(cxt, jsp, found, res, needBool);
-			break;
-		case jpiAdd:
-		case jpiSub:
-		case jpiMul:
-		case jpiDiv:
-		case jpiMod:
-			res = executeBinaryArithmExpr(cxt, jsp, jb, found);
-			break;
-		case jpiPlus:
-		case jpiMinus:
-			res = executeUnaryArithmExpr(cxt, jsp, jb, found);
-			break;
-		case jpiFilter:
-			jspGetArg(jsp, &elem);
-			res = recursiveExecuteBool(cxt, &elem, jb);
-			if (res != jperOk)
-				res = jperNotFound;
-			else
-				res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, true);
-			break;
-		case jpiAny:
-			{
-				JsonbValue jbvbuf;
+static void
+jspStreamWatchContainerStart(void *arg)
+{
+	((JsonPathStreamState *) arg)->depth++;
+}
 
-				hasNext = jspGetNext(jsp, &elem);
+static void
+jspStreamWatchContainerEnd(void *arg)
+{
+	((JsonPathStreamState *) arg)->depth--;
+}
 
-				/* first try without any intermediate steps */
-				if (jsp->content.anybounds.first == 0)
-				{
-					res = recursiveExecuteNext(cxt, jsp, &elem, jb, found, true);
+static void
+jspStreamWatchFieldStart(void *arg, char *fname, bool isnull)
+{
+	JsonPathStreamState *state = arg;
+	JsonPathStreamLevel *level;
+	JsonPathStreamStep *step;
 
-					if (res == jperOk && !found)
-							break;
-				}
+	if (state->depth > 0)
+		return;
 
-				if (jb->type == jbvArray || jb->type == jbvObject)
-					jb = JsonbWrapInBinary(jb, &jbvbuf);
+	level = &state->levels[state->nlevels - 1];
+	step = &state->steps[level->step];
 
-				if (jb->type == jbvBinary)
-					res = recursiveAny(cxt, hasNext ? &elem : NULL, jb, found,
-									   1,
-									   jsp->content.anybounds.first,
-									   jsp->content.anybounds.last);
-				break;
-			}
-		case jpiExists:
-			jspGetArg(jsp, &elem);
-			res = recursiveExecute(cxt, &elem, jb, NULL);
-			res = appendBoolResult(cxt, jsp, found, res, needBool);
-			break;
-		case jpiNull:
-		case jpiBool:
-		case jpiNumeric:
-		case jpiString:
-		case jpiVariable:
-			{
-				JsonbValue	vbuf;
-				JsonbValue *v;
-				bool		hasNext = jspGetNext(jsp, &elem);
+	/* duplicate key discards the results, so matching is resumed */
+	if (strlen(fname) == step->keylen && !memcmp(fname, step->key, step->keylen))
+	{
+		state->done = false;
+		*state->sem = state->actions;
+		jspStreamObjectFieldStart(arg, fname, isnull);
+	}
+}
 
-				if (!hasNext && !found)
-				{
-					res = jperOk; /* skip evaluation */
-					break;
-				}
+/*
+ * Attach the semantic actions back.  After the limit is reached, only the
+ * keys of the enclosing objects are watched, if there are any.
+ */
+static void
+jspStreamAttach(JsonPathStreamState *state)
+{
+	JsonSemAction *sem = state->sem;
+	int			i;
 
-				v = hasNext ? &vbuf : palloc(sizeof(*v));
+	if (!state->done)
+	{
+		*sem = state->actions;
+		return;
+	}
 
-				computeJsonPathItem(cxt, jsp, v);
+	jspStreamDetach(state);
+	state->depth = 0;
 
-				res = recursiveExecuteNext(cxt, jsp, &elem, v, found, hasNext);
-			}
+	for (i = 0; i < state->nlevels; i++)
+	{
+		if (state->levels[i].object)
+		{
+			sem->object_start = jspStreamWatchContainerStart;
+			sem->object_end = jspStreamWatchContainerEnd;
+			sem->array_start = jspStreamWatchContainerStart;
+			sem->array_end = jspStreamWatchContainerEnd;
+			sem->object_field_start = jspStreamWatchFieldStart;
 			break;
-		case jpiType:
-			{
-				JsonbValue *jbv = palloc(sizeof(*jbv));
+		}
+	}
+}
 
-				jbv->type = jbvString;
-				jbv->val.string.val = pstrdup(JsonbTypeName(jb));
-				jbv->val.string.len = strlen(jbv->val.string.val);
+static void
+jspStreamCheckLimit(JsonPathStreamState *state)
+{
+	if (state->limit > 0 && state->nresults >= state->limit)
+	{
+		state->done = true;
+		jspStreamAttach(state);
+	}
+}
 
-				res = recursiveExecuteNext(cxt, jsp, NULL, jbv, found, false);
-			}
-			break;
-		case jpiSize:
-			{
-				int			size = JsonbArraySize(jb);
+static JsonbValue *
+jspStreamAddResult(JsonPathStreamState *state)
+{
+	JsonbValue *res;
 
-				if (size < 0)
-				{
-					if (!cxt->lax)
-					{
-						res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
-						break;
-					}
+	if (state->nresults >= state->maxresults)
+	{
+		state->maxresults = state->maxresults ? state->maxresults * 2 : 8;
+		state->results = state->results ?
+			repalloc(state->results,
+					 sizeof(*state->results) * state->maxresults) :
+			palloc(sizeof(*state->results) * state->maxresults);
+	}
 
-					size = 1;
-				}
+	res = &state->results[state->nresults++];
 
-				jb = palloc(sizeof(*jb));
+	jspStreamCheckLimit(state);
 
-				jb->type = jbvNumeric;
-				jb->val.numeric =
-					DatumGetNumeric(DirectFunctionCall1(int4_numeric,
-														Int32GetDatum(size)));
+	return res;
+}
 
-				res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, false);
-			}
-			break;
-		case jpiAbs:
-		case jpiFloor:
-		case jpiCeiling:
-			{
-				JsonbValue jbvbuf;
+static void
+jspStreamAddSpan(JsonPathStreamState *state, char *start)
+{
+	JsonPathStreamSpan *span;
 
-				if (JsonbType(jb) == jbvScalar)
-					jb = JsonbExtractScalar(jb->val.binary.data, &jbvbuf);
+	if (state->nresults >= state->maxresults)
+	{
+		state->maxresults *= 2;
+		state->spans = repalloc(state->spans,
+								sizeof(*state->spans) * state->maxresults);
+	}
 
-				if (jb->type == jbvNumeric)
-				{
-					Datum		datum = NumericGetDatum(jb->val.numeric);
+	span = &state->spans[state->nresults++];
+	span->start = start - state->lex->input;
+	span->len = state->lex->prev_token_terminator - start;
 
-					switch (jsp->type)
-					{
-						case jpiAbs:
-							datum = DirectFunctionCall1(numeric_abs, datum);
-							break;
-						case jpiFloor:
-							datum = DirectFunctionCall1(numeric_floor, datum);
-							break;
-						case jpiCeiling:
-							datum = DirectFunctionCall1(numeric_ceil, datum);
-							break;
-						default:
-							break;
-					}
+	jspStreamCheckLimit(state);
+}
 
-					jb = palloc(sizeof(*jb));
+/*
+ * Start a value of the given kind.  Returns the accessor applied to it,
+ * nsteps if the value is a result of the path, or -1 if it is not matched.
+ */
+static int
+jspStreamStartValue(JsonPathStreamState *state, JsonTokenType kind)
+{
+	int			step = state->next;
 
-					jb->type = jbvNumeric;
-					jb->val.numeric = DatumGetNumeric(datum);
+	state->next = -1;
 
-					res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, false);
-				}
-				else
-					res = jperMakeError(ERRCODE_NON_NUMERIC_JSON_ITEM);
-			}
-			break;
-		case jpiDouble:
-			{
-				JsonbValue jbv;
-				MemoryContext mcxt = CurrentMemoryContext;
+	if (step < 0)
+		return -1;
 
-				if (JsonbType(jb) == jbvScalar)
-					jb = JsonbExtractScalar(jb->val.binary.data, &jbv);
+	/* lax member accessor unwraps only one level of arrays */
+	if (state->nextUnwrapped && kind == JSON_TOKEN_ARRAY_START)
+		return -1;
 
-				PG_TRY();
-				{
-					if (jb->type == jbvNumeric)
-					{
-						/* only check success of numeric to double cast */
-						DirectFunctionCall1(numeric_float8,
-											NumericGetDatum(jb->val.numeric));
-						res = jperOk;
-					}
-					else if (jb->type == jbvString)
-					{
-						/* cast string as double */
-						char	   *str = pnstrdup(jb->val.string.val,
-												   jb->val.string.len);
-						Datum		val = DirectFunctionCall1(
-											float8in, CStringGetDatum(str));
-						pfree(str);
+	/* lax array accessors are applied to other values wrapped into array */
+	while (step < state->nsteps && kind != JSON_TOKEN_ARRAY_START &&
+		   state->steps[step].type != jpiKey)
+	{
+		if (state->steps[step].type == jpiIndexArray &&
+			state->steps[step].index != 0)
+			return -1;
 
-						jb = &jbv;
-						jb->type = jbvNumeric;
-						jb->val.numeric = DatumGetNumeric(DirectFunctionCall1(
-														float8_numeric, val));
-						res = jperOk;
+		step++;
+	}
 
-					}
-					else
-						res = jperMakeError(ERRCODE_NON_NUMERIC_JSON_ITEM);
-				}
-				PG_CATCH();
-				{
-					if (ERRCODE_TO_CATEGORY(geterrcode()) !=
-														ERRCODE_DATA_EXCEPTION)
-						PG_RE_THROW();
+	return step;
+}
 
-					FlushErrorState();
-					MemoryContextSwitchTo(mcxt);
-					res = jperMakeError(ERRCODE_NON_NUMERIC_JSON_ITEM);
-				}
-				PG_END_TRY();
+static void
+jspStreamStartContainer(JsonPathStreamState *state, JsonTokenType kind)
+{
+	int			step = jspStreamStartValue(state, kind);
+	JsonPathStreamLevel *level;
 
-				if (res == jperOk)
-					res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, true);
-			}
-			break;
-		case jpiDatetime:
-			{
-				JsonbValue	jbvbuf;
-				Datum		value;
-				Oid			typid;
-				int32		typmod = -1;
-				bool		hasNext;
+	if (step < 0 || step >= state->nsteps ||
+		(kind == JSON_TOKEN_OBJECT_START &&
+		 state->steps[step].type != jpiKey))
+	{
+		if (step >= state->nsteps)
+			state->capture = state->lex->token_start;
+		else
+			state->skipping = true;
 
-				if (JsonbType(jb) == jbvScalar)
-					jb = JsonbExtractScalar(jb->val.binary.data, &jbvbuf);
+		jspStreamDetach(state);
+		return;
+	}
 
-				if (jb->type == jbvNumeric && !jsp->content.arg)
-				{
-					/* Standard extension: unix epoch to timestamptz */
-					MemoryContext mcxt = CurrentMemoryContext;
+	if (state->nlevels >= state->maxlevels)
+	{
+		state->maxlevels = state->maxlevels ? state->maxlevels * 2 : 8;
+		state->levels = state->levels ?
+			repalloc(state->levels, sizeof(*state->levels) * state->maxlevels) :
+			palloc(sizeof(*state->levels) * state->maxlevels);
+	}
 
-					PG_TRY();
-					{
-						Datum		unix_epoch =
-								DirectFunctionCall1(numeric_float8,
-											NumericGetDatum(jb->val.numeric));
+	level = &state->levels[state->nlevels++];
+	level->step = step;
+	level->unwrap = state->steps[step].type == jpiKey;
+	level->index = -1;
+	level->mark = state->nresults;
+	level->object = kind == JSON_TOKEN_OBJECT_START;
+}
 
-						value = DirectFunctionCall1(float8_timestamptz,
-													unix_epoch);
-						typid = TIMESTAMPTZOID;
-						res = jperOk;
-					}
-					PG_CATCH();
-					{
-						if (ERRCODE_TO_CATEGORY(geterrcode()) !=
-														ERRCODE_DATA_EXCEPTION)
-							PG_RE_THROW();
+static void
+jspStreamEndContainer(JsonPathStreamState *state)
+{
+	if (state->capture && state->spans)
+	{
+		jspStreamAddSpan(state, state->capture);
+		state->capture = NULL;
+	}
+	else if (state->capture)
+	{
+		char	   *end = state->lex->prev_token_terminator;
+		Jsonb	   *jb = JsonbFromCStringLen(state->capture,
+											 end - state->capture);
 
-						FlushErrorState();
-						MemoryContextSwitchTo(mcxt);
+		JsonbInitBinary(jspStreamAddResult(state), jb);
+		state->capture = NULL;
+	}
+	else if (state->skipping)
+		state->skipping = false;
+	else
+		state->nlevels--;
 
-						res = jperMakeError(ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION);
-					}
-					PG_END_TRY();
-				}
-				else if (jb->type == jbvString)
-				{
+	state->skipRest = false;
+	jspStreamAttach(state);
+}
 
-					text	   *datetime_txt =
-							cstring_to_text_with_len(jb->val.string.val,
-													 jb->val.string.len);
+static void
+jspStreamObjectStart(void *arg)
+{
+	jspStreamStartContainer(arg, JSON_TOKEN_OBJECT_START);
+}
 
-					res = jperOk;
+static void
+jspStreamArrayStart(void *arg)
+{
+	jspStreamStartContainer(arg, JSON_TOKEN_ARRAY_START);
+}
 
-					if (jsp->content.arg)
-					{
-						text	   *template_txt;
-						char	   *template_str;
-						int			template_len;
-						MemoryContext mcxt = CurrentMemoryContext;
+static void
+jspStreamContainerEnd(void *arg)
+{
+	jspStreamEndContainer(arg);
+}
 
-						jspGetArg(jsp, &elem);
+static void
+jspStreamObjectFieldStart(void *arg, char *fname, bool isnull)
+{
+	JsonPathStreamState *state = arg;
+	JsonPathStreamLevel *level = &state->levels[state->nlevels - 1];
+	JsonPathStreamStep *step = &state->steps[level->step];
 
-						if (elem.type != jpiString)
-							elog(ERROR, "invalid jsonpath item type for .datetime() argument");
+	if (strlen(fname) == step->keylen && !memcmp(fname, step->key, step->keylen))
+	{
+		/* the last one of duplicate keys wins, as in jsonb */
+		state->nresults = level->mark;
+		state->next = level->step + 1;
+		state->nextUnwrapped = false;
+		state->valueStart = state->lex->token_start;
+	}
+	else
+		jspStreamDetach(state);
+}
 
-						template_str = jspGetString(&elem, &template_len);
-						template_txt = cstring_to_text_with_len(template_str,
-																template_len);
+static void
+jspStreamArrayElementStart(void *arg, bool isnull)
+{
+	JsonPathStreamState *state = arg;
+	JsonPathStreamLevel *level = &state->levels[state->nlevels - 1];
+	JsonPathStreamStep *step = &state->steps[level->step];
 
-						PG_TRY();
-						{
-							value = to_datetime(datetime_txt,
-												template_str, template_len,
-												false,
-												&typid, &typmod);
-						}
-						PG_CATCH();
-						{
-							if (ERRCODE_TO_CATEGORY(geterrcode()) !=
-														ERRCODE_DATA_EXCEPTION)
-								PG_RE_THROW();
+	level->index++;
+	state->valueStart = state->lex->token_start;
 
-							FlushErrorState();
-							MemoryContextSwitchTo(mcxt);
+	if (level->unwrap)
+	{
+		state->next = level->step;
+		state->nextUnwrapped = true;
+	}
+	else if (step->type == jpiAnyArray || level->index == step->index)
+	{
+		state->next = level->step + 1;
+		state->nextUnwrapped = false;
+	}
+	else
+	{
+		/* elements following the subscripted one are not needed */
+		state->skipRest = level->index > step->index;
+		jspStreamDetach(state);
+	}
+}
 
-							res = jperMakeError(ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION);
-						}
-						PG_END_TRY();
+static void
+jspStreamValueEnd(void *arg)
+{
+	JsonPathStreamState *state = arg;
 
-						pfree(template_txt);
-					}
-					else
-					{
-						if (!tryToParseDatetime("yyyy-mm-dd HH24:MI:SS TZH:TZM",
-									datetime_txt, &value, &typid, &typmod) &&
-							!tryToParseDatetime("yyyy-mm-dd HH24:MI:SS TZH",
-									datetime_txt, &value, &typid, &typmod) &&
-							!tryToParseDatetime("yyyy-mm-dd HH24:MI:SS",
-									datetime_txt, &value, &typid, &typmod) &&
-							!tryToParseDatetime("yyyy-mm-dd",
-									datetime_txt, &value, &typid, &typmod) &&
-							!tryToParseDatetime("HH24:MI:SS TZH:TZM",
-									datetime_txt, &value, &typid, &typmod) &&
-							!tryToParseDatetime("HH24:MI:SS TZH",
-									datetime_txt, &value, &typid, &typmod) &&
-							!tryToParseDatetime("HH24:MI:SS",
-									datetime_txt, &value, &typid, &typmod))
-							res = jperMakeError(ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION);
-					}
+	if (!state->skipRest)
+		jspStreamAttach(state);
+}
 
-					pfree(datetime_txt);
-				}
-				else
-				{
-					res = jperMakeError(ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION);
-					break;
-				}
+static void
+jspStreamObjectFieldEnd(void *arg, char *fname, bool isnull)
+{
+	jspStreamValueEnd(arg);
+}
 
-				if (jperIsError(res))
-					break;
+static void
+jspStreamArrayElementEnd(void *arg, bool isnull)
+{
+	jspStreamValueEnd(arg);
+}
 
-				hasNext = jspGetNext(jsp, &elem);
+static void
+jspStreamScalar(void *arg, char *token, JsonTokenType tokentype)
+{
+	JsonPathStreamState *state = arg;
+	JsonbValue *res;
 
-				if (!hasNext && !found)
-					break;
+	if (jspStreamStartValue(state, tokentype) < state->nsteps)
+		return;
 
-				jb = hasNext ? &jbvbuf : palloc(sizeof(*jb));
+	if (state->spans)
+	{
+		jspStreamAddSpan(state, state->valueStart);
+		return;
+	}
 
-				jb->type = jbvDatetime;
-				jb->val.datetime.value = value;
-				jb->val.datetime.typid = typid;
-				jb->val.datetime.typmod = typmod;
+	res = jspStreamAddResult(state);
 
-				res = recursiveExecuteNext(cxt, jsp, &elem, jb, found, hasNext);
-			}
+	switch (tokentype)
+	{
+		case JSON_TOKEN_STRING:
+			res->type = jbvString;
+			res->val.string.val = token;
+			res->val.string.len = strlen(token);
+			break;
+		case JSON_TOKEN_NUMBER:
+			res->type = jbvNumeric;
+			res->val.numeric = DatumGetNumeric(DirectFunctionCall3(numeric_in,
+											   CStringGetDatum(token),
+											   ObjectIdGetDatum(InvalidOid),
+											   Int32GetDatum(-1)));
+			break;
+		case JSON_TOKEN_TRUE:
+		case JSON_TOKEN_FALSE:
+			res->type = jbvBool;
+			res->val.boolean = tokentype == JSON_TOKEN_TRUE;
+			break;
+		case JSON_TOKEN_NULL:
+			res->type = jbvNull;
 			break;
-		case jpiKeyValue:
-			if (JsonbType(jb) != jbvObject)
-				res = jperMakeError(ERRCODE_JSON_OBJECT_NOT_FOUND);
-			else
-			{
-				int32		r;
-				JsonbValue	bin;
-				JsonbValue	key;
-				JsonbValue	val;
-				JsonbValue	obj;
-				JsonbValue	keystr;
-				JsonbValue	valstr;
-				JsonbIterator *it;
-				JsonbParseState *ps = NULL;
+		default:
+			elog(ERROR, "invalid json token type %d", tokentype);
+	}
+}
 
-				hasNext = jspGetNext(jsp, &elem);
+/*
+ * Execute the path, which must have been recognized by jspCompileStream(),
+ * over json text.  If spans is true, only locations of the results are
+ * collected and the results are not converted into jsonb.  If limit is not
+ * 0, no more than limit results are collected.
+ */
+static void
+jspStreamExecute(JsonPathStreamState *state, JsonPathCompiled *path,
+				 text *json, bool spans, int limit)
+{
+	JsonSemAction sem;
+
+	Assert(path->stream);
+
+	memset(state, 0, sizeof(*state));
+	memset(&sem, 0, sizeof(sem));
+
+	sem.semstate = state;
+	sem.object_start = jspStreamObjectStart;
+	sem.object_end = jspStreamContainerEnd;
+	sem.array_start = jspStreamArrayStart;
+	sem.array_end = jspStreamContainerEnd;
+	sem.object_field_start = jspStreamObjectFieldStart;
+	sem.object_field_end = jspStreamObjectFieldEnd;
+	sem.array_element_start = jspStreamArrayElementStart;
+	sem.array_element_end = jspStreamArrayElementEnd;
+	sem.scalar = jspStreamScalar;
+
+	state->lex = makeJsonLexContext(json, true);
+	state->sem = &sem;
+	state->actions = sem;
+	state->steps = path->stream;
+	state->nsteps = path->nstream;
+	state->next = 0;
+	state->valueStart = state->lex->input;
+	state->limit = limit;
+
+	if (spans)
+	{
+		state->maxresults = 8;
+		state->spans = palloc(sizeof(*state->spans) * state->maxresults);
+	}
 
-				if (jb->type == jbvBinary
-					? !JsonContainerSize(jb->val.binary.data)
-					: !jb->val.object.nPairs)
-				{
-					res = jperNotFound;
-					break;
-				}
+	pg_parse_json(state->lex, &sem);
+}
 
-				/* make template object */
-				obj.type = jbvBinary;
+/*
+ * Execute the path, which must have been recognized by jspCompileStream(),
+ * over json text and return iterator over its results.  Unlike the lazy
+ * iterator, the results are computed at once, so the caller passes the
+ * number of results it needs, or 0 if it needs all of them.
+ */
+JsonPathIterator *
+JsonPathIteratorInitJson(JsonPathCompiled *path, text *json, int limit)
+{
+	JsonPathIterator *it = palloc0(sizeof(*it));
+	JsonPathStreamState state;
+	int			i;
 
-				keystr.type = jbvString;
-				keystr.val.string.val = "key";
-				keystr.val.string.len = 3;
+	jspStreamExecute(&state, path, json, false, limit);
 
-				valstr.type = jbvString;
-				valstr.val.string.val = "value";
-				valstr.val.string.len = 5;
+	it->frames = palloc0(sizeof(*it->frames));
+	it->frames[0].hasStep = false;
+	it->frames[0].container = false;
 
-				if (jb->type == jbvObject)
-					jb = JsonbWrapInBinary(jb, &bin);
+	for (i = 0; i < state.nresults; i++)
+		JsonValueListAppend(&it->frames[0].found, &state.results[i]);
 
-				it = JsonbIteratorInit(jb->val.binary.data);
+	it->depth = 1;
 
-				while ((r = JsonbIteratorNext(&it, &key, true)) != WJB_DONE)
-				{
-					if (r == WJB_KEY)
-					{
-						Jsonb	   *jsonb;
-						JsonbValue  *keyval;
+	return it;
+}
 
-						res = jperOk;
+/*
+ * Execute the path, which must have been recognized by jspCompileStream(),
+ * over json text and return the number of its results and their locations.
+ */
+static int
+jspStreamSpans(JsonPathCompiled *path, text *json, JsonPathStreamSpan **spans)
+{
+	JsonPathStreamState state;
 
-						if (!hasNext && !found)
-							break;
+	jspStreamExecute(&state, path, json, true, 0);
 
-						r = JsonbIteratorNext(&it, &val, true);
-						Assert(r == WJB_VALUE);
+	*spans = state.spans;
 
-						pushJsonbValue(&ps, WJB_BEGIN_OBJECT, NULL);
+	return state.nresults;
+}
 
-						pushJsonbValue(&ps, WJB_KEY, &keystr);
-						pushJsonbValue(&ps, WJB_VALUE, &key);
+/*
+ * Get compiled jsonpath cached in fn_extra, the last few distinct paths are
+ * kept compiled.
+ */
+static JsonPathCompiled *
+getCachedJsonPath(FunctionCallInfo fcinfo, JsonPath *jp)
+{
+	if (!fcinfo->flinfo->fn_extra)
+		fcinfo->flinfo->fn_extra =
+			JsonPathCacheCreate(fcinfo->flinfo->fn_mcxt);
 
+	return JsonPathCacheLookup(fcinfo->flinfo->fn_extra, jp);
+}
 
-						pushJsonbValue(&ps, WJB_KEY, &valstr);
-						pushJsonbValue(&ps, WJB_VALUE, &val);
+/********************Example functions for JsonPath***************************/
 
-						keyval = pushJsonbValue(&ps, WJB_END_OBJECT, NULL);
+static Datum
+returnDATUM(void *arg, bool *isNull)
+{
+	*isNull = false;
+	return	PointerGetDatum(arg);
+}
 
-						jsonb = JsonbValueToJsonb(keyval);
+/*
+ * Convert jsonb object into list of vars for executor.  The object itself is
+ * passed, its members are looked up only when the path references them.
+ */
+static List*
+makePassingVars(Jsonb *jb)
+{
+	JsonPathVariable *jpv;
 
-						obj.val.binary.data = &jsonb->root;
-						obj.val.binary.len = VARSIZE(jsonb) - VARHDRSZ;
+	if (!JB_ROOT_IS_OBJECT(jb))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("passing variable json is not a object")));
 
-						res = recursiveExecuteNext(cxt, jsp, &elem, &obj, found, true);
+	jpv = palloc0(sizeof(*jpv));
+	jpv->varName = NULL;
+	jpv->typid = JSONBOID;
+	jpv->typmod = -1;
+	jpv->cb = returnDATUM;
+	jpv->cb_arg = jb;
 
-						if (jperIsError(res))
-							break;
+	return list_make1(jpv);
+}
 
-						if (res == jperOk && !found)
-							break;
-					}
-				}
-			}
+static void
+throwJsonPathError(JsonPathExecResult res)
+{
+	if (!jperIsError(res))
+		return;
+
+	switch (jperGetError(res))
+	{
+		case ERRCODE_JSON_ARRAY_NOT_FOUND:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("SQL/JSON array not found")));
 			break;
-		case jpiStartsWith:
-			res = executeStartsWithPredicate(cxt, jsp, jb);
-			res = appendBoolResult(cxt, jsp, found, res, needBool);
+		case ERRCODE_JSON_OBJECT_NOT_FOUND:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("SQL/JSON object not found")));
 			break;
-		case jpiMap:
-			if (JsonbType(jb) != jbvArray)
-			{
-				if (cxt->lax)
-				{
-					JsonValueList reslist = { 0 };
-
-					jspGetArg(jsp, &elem);
-					res = recursiveExecute(cxt, &elem, jb, &reslist);
+		case ERRCODE_JSON_MEMBER_NOT_FOUND:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("SQL/JSON member not found")));
+			break;
+		case ERRCODE_JSON_NUMBER_NOT_FOUND:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("SQL/JSON number not found")));
+			break;
+		case ERRCODE_JSON_SCALAR_REQUIRED:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("SQL/JSON scalar required")));
+			break;
+		case ERRCODE_SINGLETON_JSON_ITEM_REQUIRED:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("Singleton SQL/JSON item required")));
+			break;
+		case ERRCODE_NON_NUMERIC_JSON_ITEM:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("Non-numeric SQL/JSON item")));
+			break;
+		case ERRCODE_INVALID_JSON_SUBSCRIPT:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("Invalid SQL/JSON subscript")));
+			break;
+		case ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("Invalid argument for SQL/JSON datetime function")));
+			break;
+		default:
+			ereport(ERROR,
+					(errcode(jperGetError(res)),
+					 errmsg("Unknown SQL/JSON error")));
+			break;
+	}
+}
 
-					if (jperIsError(res))
-						return res;
+/*
+ * Fetch next item of lazy jsonpath iterator, the item is copied so that it
+ * stays valid after the next fetch.  Errors are thrown, or returned in
+ * *error if it is not NULL.
+ */
+static JsonbValue *
+JsonPathIteratorNextOrError(JsonPathIterator *it, bool *error)
+{
+	JsonbValue *jbv;
+	JsonPathExecResult res = JsonPathIteratorNext(it, &jbv);
 
-					if (JsonValueListLength(&reslist) != 1)
-						return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+	if (jperIsError(res))
+	{
+		if (!error)
+			throwJsonPathError(res);
 
-					res = recursiveExecuteNext(cxt, jsp, NULL,
-											   JsonValueListHead(&reslist),
-											   found, true);
-				}
-				else
-					res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
-			}
-			else
-			{
-				JsonbValue	element_buf;
-				JsonbValue *element;
-				JsonbIterator *it = NULL;
-				JsonbIteratorToken tok;
-				JsonValueList result = { 0 };
-				int			size = JsonbArraySize(jb);
-				int			i;
+		*error = true;
+		return NULL;
+	}
 
-				jspGetArg(jsp, &elem);
+	return jbv ? copyJsonbValue(jbv) : NULL;
+}
 
-				if (jb->type == jbvBinary && size > 0)
-				{
-					element = &element_buf;
-					it = JsonbIteratorInit(jb->val.binary.data);
-					tok = JsonbIteratorNext(&it, &element_buf, false);
-					if (tok != WJB_BEGIN_ARRAY)
-						elog(ERROR, "unexpected jsonb token at the array start");
-				}
+static Datum
+__jsonpath_exists(PG_FUNCTION_ARGS)
+{
+	Jsonb				*jb = PG_GETARG_JSONB(0);
+	JsonPath			*jp = PG_GETARG_JSONPATH(1);
+	JsonPathExecResult	res;
+	List				*vars = NIL;
 
-				for (i = 0; i < size; i++)
-				{
-					JsonValueList reslist = { 0 };
+	if (PG_NARGS() == 3)
+		vars = makePassingVars(PG_GETARG_JSONB(2));
 
-					if (it)
-					{
-						tok = JsonbIteratorNext(&it, element, true);
-						if (tok != WJB_ELEM)
-							break;
-					}
-					else
-						element = &jb->val.array.elems[i];
+	res = executeCompiledJsonPath(getCachedJsonPath(fcinfo, jp), vars, jb,
+								  NULL);
 
-					res = recursiveExecute(cxt, &elem, element, &reslist);
+	PG_FREE_IF_COPY(jb, 0);
+	PG_FREE_IF_COPY(jp, 1);
 
-					if (jperIsError(res))
-						break;
+	throwJsonPathError(res);
 
-					if (JsonValueListLength(&reslist) != 1)
-					{
-						res = jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
-						break;
-					}
+	PG_RETURN_BOOL(res == jperOk);
+}
 
-					JsonValueListConcat(&result, reslist);
-				}
+Datum
+_jsonpath_exists2(PG_FUNCTION_ARGS)
+{
+	return __jsonpath_exists(fcinfo);
+}
 
-				if (jperIsError(res))
-					break;
+Datum
+_jsonpath_exists3(PG_FUNCTION_ARGS)
+{
+	return __jsonpath_exists(fcinfo);
+}
 
-				res = recursiveExecuteNext(cxt, jsp, NULL,
-										   wrapItemsInArray(&result),
-										   found, false);
-			}
-			break;
-		case jpiSequence:
-		{
-			JsonPathItem next;
-			bool		hasNext = jspGetNext(jsp, &next);
-			JsonValueList list;
-			JsonValueList *plist = hasNext ? &list : found;
-			JsonValueListIterator it;
-			int			i;
+static inline Datum
+_jsonpath_predicate(FunctionCallInfo fcinfo, List *vars)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	JsonPath   *jp = PG_GETARG_JSONPATH(1);
+	JsonbValue *jbv;
+	JsonPathIterator *it;
 
-			for (i = 0; i < jsp->content.sequence.nelems; i++)
-			{
-				JsonbValue *v;
+	it = JsonPathIteratorInit(getCachedJsonPath(fcinfo, jp), vars, jb, NULL);
 
-				if (hasNext)
-					memset(&list, 0, sizeof(list));
+	/* only the singleton is needed, so do not fetch more than two items */
+	jbv = JsonPathIteratorNextOrError(it, NULL);
 
-				jspGetSequenceElement(jsp, i, &elem);
-				res = recursiveExecute(cxt, &elem, jb, plist);
+	if (!jbv || JsonPathIteratorNextOrError(it, NULL))
+		throwJsonPathError(jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED));
 
-				if (jperIsError(res))
-					break;
+	if (JsonbType(jbv) == jbvScalar)
+		JsonbExtractScalar(jbv->val.binary.data, jbv);
 
-				if (!hasNext)
-				{
-					if (!found && res == jperOk)
-						break;
-					continue;
-				}
+	PG_FREE_IF_COPY(jb, 0);
+	PG_FREE_IF_COPY(jp, 1);
 
-				memset(&it, 0, sizeof(it));
+	if (jbv->type == jbvNull)
+		PG_RETURN_NULL();
 
-				while ((v = JsonValueListNext(&list, &it)))
-				{
-					res = recursiveExecute(cxt, &next, v, found);
+	if (jbv->type != jbvBool)
+		PG_RETURN_NULL(); /* XXX */
 
-					if (jperIsError(res) || (!found && res == jperOk))
-					{
-						i = jsp->content.sequence.nelems;
-						break;
-					}
-				}
-			}
+	PG_RETURN_BOOL(jbv->val.boolean);
+}
 
-			break;
-		}
-		case jpiArray:
-			{
-				JsonValueList list = { 0 };
+Datum
+_jsonpath_predicate2(PG_FUNCTION_ARGS)
+{
+	return _jsonpath_predicate(fcinfo, NIL);
+}
 
-				if (jsp->content.arg)
-				{
-					jspGetArg(jsp, &elem);
-					res = recursiveExecute(cxt, &elem, jb, &list);
+Datum
+_jsonpath_predicate3(PG_FUNCTION_ARGS)
+{
+	return _jsonpath_predicate(fcinfo, makePassingVars(PG_GETARG_JSONB(2)));
+}
 
-					if (jperIsError(res))
-						break;
-				}
+static Datum
+__jsonpath_object(FunctionCallInfo fcinfo, bool safe)
+{
+	FuncCallContext	*funcctx;
+	JsonbValue		*v;
 
-				res = recursiveExecuteNext(cxt, jsp, NULL,
-										   wrapItemsInArray(&list),
-										   found, false);
-			}
-			break;
-		case jpiObject:
-			{
-				JsonbParseState *ps = NULL;
-				JsonbValue *obj;
-				int			i;
+	if (SRF_IS_FIRSTCALL())
+	{
+		JsonPath			*jp = PG_GETARG_JSONPATH(1);
+		Jsonb				*jb;
+		JsonPathExecResult	res;
+		MemoryContext		oldcontext;
+		List				*vars = NIL;
 
-				pushJsonbValue(&ps, WJB_BEGIN_OBJECT, NULL);
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
-				for (i = 0; i < jsp->content.object.nfields; i++)
-				{
-					JsonbValue *jbv;
-					JsonbValue	jbvtmp;
-					JsonPathItem key;
-					JsonPathItem val;
-					JsonValueList key_list = { 0 };
-					JsonValueList val_list = { 0 };
+		jb = PG_GETARG_JSONB_COPY(0);
+		if (PG_NARGS() == 3)
+			vars = makePassingVars(PG_GETARG_JSONB(2));
 
-					jspGetObjectField(jsp, i, &key, &val);
+		if (safe)
+		{
+			/* an error suppresses all the items, so collect them at once */
+			JsonValueList found = { 0 };
 
-					recursiveExecute(cxt, &key, jb, &key_list);
+			res = executeJsonPath(jp, vars, jb, &found);
 
-					if (JsonValueListLength(&key_list) != 1)
-					{
-						res = jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
-						break;
-					}
+			if (jperIsError(res))
+				JsonValueListClear(&found);
 
-					jbv = JsonValueListHead(&key_list);
+			funcctx->user_fctx = JsonValueListGetList(&found);
+		}
+		else
+			funcctx->user_fctx =
+				JsonPathIteratorInit(jspCompile(jp, CurrentMemoryContext),
+									 vars, jb, NULL);
 
-					if (JsonbType(jbv) == jbvScalar)
-						jbv = JsonbExtractScalar(jbv->val.binary.data, &jbvtmp);
+		PG_FREE_IF_COPY(jp, 1);
 
-					if (jbv->type != jbvString)
-					{
-						res = jperMakeError(ERRCODE_JSON_SCALAR_REQUIRED); /* XXX */
-						break;
-					}
+		MemoryContextSwitchTo(oldcontext);
+	}
 
-					pushJsonbValue(&ps, WJB_KEY, jbv);
+	funcctx = SRF_PERCALL_SETUP();
 
-					recursiveExecute(cxt, &val, jb, &val_list);
+	if (safe)
+	{
+		List	   *found = funcctx->user_fctx;
 
-					if (JsonValueListLength(&val_list) != 1)
-					{
-						res = jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
-						break;
-					}
+		if (!found)
+			SRF_RETURN_DONE(funcctx);
 
-					jbv = JsonValueListHead(&val_list);
+		v = linitial(found);
+		funcctx->user_fctx = list_delete_first(found);
+	}
+	else
+	{
+		/* items are fetched on demand */
+		MemoryContext oldcontext =
+			MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+		JsonPathExecResult res = JsonPathIteratorNext(funcctx->user_fctx, &v);
 
-					if (jbv->type == jbvObject || jbv->type == jbvArray)
-						jbv = JsonbWrapInBinary(jbv, &jbvtmp);
+		MemoryContextSwitchTo(oldcontext);
 
-					pushJsonbValue(&ps, WJB_VALUE, jbv);
-				}
+		throwJsonPathError(res);
 
-				if (jperIsError(res))
-					break;
+		if (!v)
+			SRF_RETURN_DONE(funcctx);
+	}
 
-				obj = pushJsonbValue(&ps, WJB_END_OBJECT, NULL);
+	SRF_RETURN_NEXT(funcctx, JsonbGetDatum(JsonbValueToJsonb(v)));
+}
 
-				res = recursiveExecuteNext(cxt, jsp, NULL, obj, found, false);
-			}
-			break;
-		case jpiReduce:
-		case jpiFold:
-		case jpiFoldl:
-		case jpiFoldr:
-			if (JsonbType(jb) != jbvArray)
-			{
-				if (cxt->lax)
-				{
-					if (jsp->type == jpiReduce)
-						res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, true);
-					else
-						res = recursiveExecute(cxt, jsp, wrapItem(jb), found);
-				}
-				else
-					res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
-			}
-			else
-			{
-				JsonbValue	jbv;
-				JsonbValue *result = NULL;
-				int			size = JsonbArraySize(jb);
-				int			i;
-				bool		foldr = jsp->type == jpiFoldr;
 
-				if (jsp->type == jpiReduce)
-					jspGetArg(jsp, &elem);
-				else
-				{
-					JsonValueList reslist = { 0 };
+Datum
+_jsonpath_object2(PG_FUNCTION_ARGS)
+{
+	return __jsonpath_object(fcinfo, false);
+}
 
-					jspGetRightArg(jsp, &elem);
-					res = recursiveExecute(cxt, &elem, jb, &reslist);
+Datum
+_jsonpath_object3(PG_FUNCTION_ARGS)
+{
+	return __jsonpath_object(fcinfo, false);
+}
 
-					if (jperIsError(res))
-						return res;
+Datum
+_jsonpath_object_safe2(PG_FUNCTION_ARGS)
+{
+	return __jsonpath_object(fcinfo, true);
+}
 
-					if (JsonValueListLength(&reslist) != 1)
-						return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+Datum
+_jsonpath_object_safe3(PG_FUNCTION_ARGS)
+{
+	return __jsonpath_object(fcinfo, true);
+}
 
-					result = JsonValueListHead(&reslist);
+/********************Interface to pgsql's executor***************************/
 
-					jspGetLeftArg(jsp, &elem);
-				}
+/*
+ * In the following functions, recoverable data errors are returned in
+ * *error, if it is not NULL, so that ON ERROR behavior could be applied
+ * without throwing and catching an error.
+ */
+bool
+JsonbPathExists(Jsonb *jb, JsonPathCompiled *jp, List *vars, bool *error)
+{
+	JsonPathExecResult res = executeCompiledJsonPath(jp, vars, jb, NULL);
 
-				if (jsp->type == jpiReduce && size == 1)
-				{
-					if (jb->type == jbvBinary)
-					{
-						result = getIthJsonbValueFromContainer(jb->val.binary.data, 0);
-						if (!result)
-						{
-							res = jperNotFound;
-							break;
-						}
-					}
-					else
-					{
-						Assert(jb->type == jbvArray);
-						result = &jb->val.array.elems[0];
-					}
-				}
-				else if (size)
-				{
-					JsonPathVariable *v1 = palloc(sizeof(*v1));
-					JsonPathVariable *v2 = palloc(sizeof(*v2));
-					JsonbIterator *it = NULL;
-					JsonbIteratorToken tok;
-					JsonbValue *element;
+	if (jperIsError(res))
+	{
+		if (!error)
+			throwJsonPathError(res);
 
-					if (jb->type == jbvBinary)
-					{
-						if (foldr)
-						{
-							/* unpack array for reverse iteration */
-							JsonbParseState *ps = NULL;
+		*error = true;
+		return false;
+	}
 
-							jb = pushJsonbValue(&ps, WJB_ELEM, jb);
-						}
-						else
-						{
-							element = &jbv;
-							it = JsonbIteratorInit(jb->val.binary.data);
-							tok = JsonbIteratorNext(&it, &jbv, false);
-							if (tok != WJB_BEGIN_ARRAY)
-								elog(ERROR, "unexpected jsonb token at the array start");
-						}
-					}
+	return res == jperOk;
+}
 
-					v1->cb = returnDATUM;
-					v2->cb = returnDATUM;
-					v1->varName = cstring_to_text_with_len("1", 1);
-					v2->varName = cstring_to_text_with_len("2", 1);
-					v1->typid = (Oid) -1; /* raw JsonbValue */
-					v2->typid = (Oid) -1;
-					v1->typmod = -1;
-					v2->typmod = -1;
+static inline JsonbValue *
+wrapItemsInArray(const JsonValueList *items)
+{
+	JsonbParseState *ps = NULL;
+	JsonValueListIterator it = { 0 };
+	JsonbValue *jbv;
 
-					cxt->vars = lcons(v1, lcons(v2, cxt->vars));
+	pushJsonbValue(&ps, WJB_BEGIN_ARRAY, NULL);
 
-					if (foldr)
-					{
-						/* swap $1 and $2 for foldr() */
-						JsonPathVariable *tmp = v1;
+	while ((jbv = JsonValueListNext(items, &it)))
+	{
+		JsonbValue	bin;
 
-						v1 = v2;
-						v2 = tmp;
-					}
+		if (jbv->type == jbvBinary &&
+			JsonContainerIsScalar(jbv->val.binary.data))
+			JsonbExtractScalar(jbv->val.binary.data, jbv);
 
-					for (i = 0; i < size; i++)
-					{
-						JsonValueList reslist = { 0 };
+		if (jbv->type == jbvObject || jbv->type == jbvArray)
+			jbv = JsonbWrapInBinary(jbv, &bin);
 
-						if (it)
-						{
-							tok = JsonbIteratorNext(&it, element, true);
-							if (tok != WJB_ELEM)
-								break;
-						}
-						else if (foldr)
-							element = &jb->val.array.elems[size - i - 1];
-						else
-							element = &jb->val.array.elems[i];
+		pushJsonbValue(&ps, WJB_ELEM, jbv);
+	}
 
-						if (!i && jsp->type == jpiReduce)
-						{
-							result = copyJsonbValue(element);
-							continue;
-						}
+	return pushJsonbValue(&ps, WJB_END_ARRAY, NULL);
+}
 
-						v1->cb_arg = result;
-						v2->cb_arg = element;
+bool
+JsonPathIteratorExists(JsonPathIterator *it, bool *error)
+{
+	return JsonPathIteratorNextOrError(it, error) != NULL;
+}
 
-						res = recursiveExecute(cxt, &elem, jb, &reslist);
+Jsonb *
+JsonPathIteratorQuery(JsonPathIterator *it, JsonWrapper wrapper, bool *empty,
+					  bool *error)
+{
+	JsonbValue *first;
+	JsonbValue *second;
+	bool		wrap;
+	JsonValueList found = { 0 };
 
-						if (jperIsError(res))
-							return res;
+	/* all the items are fetched only if they are wrapped into array */
+	first = JsonPathIteratorNextOrError(it, error);
 
-						if (JsonValueListLength(&reslist) != 1)
-							return jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED);
+	if (!first)
+	{
+		*empty = !error || !*error;
+		return NULL;
+	}
 
-						result = JsonValueListHead(&reslist);
-					}
+	second = JsonPathIteratorNextOrError(it, error);
 
-					cxt->vars = list_delete_first(list_delete_first(cxt->vars));
-				}
-				else if (jsp->type == jpiReduce)
-				{
-					res = jperNotFound;
-					break;
-				}
+	if (error && *error)
+		return NULL;
 
-				res = recursiveExecuteNext(cxt, jsp, NULL, result, found, false);
-			}
-			break;
-		case jpiMin:
-		case jpiMax:
-			if (JsonbType(jb) != jbvArray)
-			{
-				if (cxt->lax)
-					res = recursiveExecuteNext(cxt, jsp, NULL, jb, found, true);
-				else
-					res = jperMakeError(ERRCODE_JSON_ARRAY_NOT_FOUND);
-			}
-			else
-			{
-				JsonbValue	jbvElementBuf;
-				JsonbValue *jbvElement;
-				JsonbValue *jbvResult = NULL;
-				Jsonb	   *jbResult = NULL;
-				JsonbIterator *it = NULL;
-				JsonbIteratorToken tok;
-				int			size = JsonbArraySize(jb);
-				int			i;
-				bool		isMax = jsp->type == jpiMax;
+	if (wrapper == JSW_NONE)
+		wrap = false;
+	else if (wrapper == JSW_UNCONDITIONAL)
+		wrap = true;
+	else if (wrapper == JSW_CONDITIONAL)
+		wrap = second ||
+			   IsAJsonbScalar(first) ||
+			   (first->type == jbvBinary &&
+				JsonContainerIsScalar(first->val.binary.data));
+	else
+	{
+		elog(ERROR, "unrecognized json wrapper %d", wrapper);
+		wrap = false;
+	}
 
-				if (jb->type == jbvBinary)
-				{
-					jbvElement = &jbvElementBuf;
-					it = JsonbIteratorInit(jb->val.binary.data);
-					tok = JsonbIteratorNext(&it, &jbvElementBuf, false);
-					if (tok != WJB_BEGIN_ARRAY)
-						elog(ERROR, "unexpected jsonb token at the array start");
-				}
+	if (wrap)
+	{
+		JsonbValue *jbv;
 
-				for (i = 0; i < size; i++)
-				{
-					if (it)
-					{
-						tok = JsonbIteratorNext(&it, jbvElement, true);
-						if (tok != WJB_ELEM)
-							break;
-					}
-					else
-						jbvElement = &jb->val.array.elems[i];
+		JsonValueListAppend(&found, first);
 
-					if (!i)
-					{
-						jbvResult = it ? copyJsonbValue(jbvElement) : jbvElement;
+		for (jbv = second; jbv; jbv = JsonPathIteratorNextOrError(it, error))
+			JsonValueListAppend(&found, jbv);
 
-						if (size > 1)
-							jbResult = JsonbValueToJsonb(jbvResult);
-					}
-					else
-					{
-						Jsonb	   *jbElement = JsonbValueToJsonb(jbvElement);
-						int			cmp = compareJsonbContainers(&jbElement->root,
-																 &jbResult->root);
+		if (error && *error)
+			return NULL;
 
-						if (isMax ? cmp > 0 : cmp < 0)
-						{
-							jbvResult = it ? copyJsonbValue(jbvElement) : jbvElement;
-							jbResult = jbElement;
-						}
-					}
-				}
+		return JsonbValueToJsonb(wrapItemsInArray(&found));
+	}
 
-				if (!jbvResult)
-				{
-					res = jperNotFound;
-					break;
-				}
+	if (second)
+	{
+		if (error)
+		{
+			*error = true;
+			return NULL;
+		}
 
-				res = recursiveExecuteNext(cxt, jsp, NULL, jbvResult, found,
-										   false);
-			}
-			break;
-		default:
-			elog(ERROR,"Wrong state: %d", jsp->type);
+		ereport(ERROR,
+				(errcode(ERRCODE_MORE_THAN_ONE_JSON_ITEM),
+				 errmsg("more than one SQL/JSON item")));
 	}
 
-	return res;
+	return JsonbValueToJsonb(first);
 }
 
-static JsonPathExecResult
-recursiveExecuteUnwrapArray(JsonPathExecContext *cxt, JsonPathItem *jsp,
-							JsonbValue *jb, JsonValueList *found)
+Jsonb *
+JsonbPathQuery(Jsonb *jb, JsonPathCompiled *jp, JsonWrapper wrapper,
+			   bool *empty, bool *error, List *vars, JsonPathKeyMemo *memo)
 {
-	JsonPathExecResult res = jperNotFound;
+	return JsonPathIteratorQuery(JsonPathIteratorInit(jp, vars, jb, memo),
+								 wrapper, empty, error);
+}
 
-	if (jb->type == jbvArray)
-	{
-		JsonbValue *elem = jb->val.array.elems;
-		JsonbValue *last = elem + jb->val.array.nElems;
+JsonbValue *
+JsonPathIteratorValue(JsonPathIterator *it, bool *empty, bool *error)
+{
+	JsonbValue *res;
 
-		for (; elem < last; elem++)
-		{
-			res = recursiveExecuteNoUnwrap(cxt, jsp, elem, found, false);
+	/* only the singleton is needed, so do not fetch more than two items */
+	res = JsonPathIteratorNextOrError(it, error);
 
-			if (jperIsError(res))
-				break;
-			if (res == jperOk && !found)
-				break;
+	*empty = !res && (!error || !*error);
+
+	if (!res)
+		return NULL;
+
+	if (JsonPathIteratorNextOrError(it, error) || (error && *error))
+	{
+		if (error)
+		{
+			*error = true;
+			return NULL;
 		}
+
+		ereport(ERROR,
+				(errcode(ERRCODE_MORE_THAN_ONE_JSON_ITEM),
+				 errmsg("more than one SQL/JSON item")));
 	}
-	else
-	{
-		JsonbValue	v;
-		JsonbIterator *it;
-		JsonbIteratorToken tok;
 
-		it = JsonbIteratorInit(jb->val.binary.data);
+	if (res->type == jbvBinary &&
+		JsonContainerIsScalar(res->val.binary.data))
+		JsonbExtractScalar(res->val.binary.data, res);
 
-		while ((tok = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+	if (!IsAJsonbScalar(res))
+	{
+		if (error)
 		{
-			if (tok == WJB_ELEM)
-			{
-				res = recursiveExecuteNoUnwrap(cxt, jsp, &v, found, false);
-				if (jperIsError(res))
-					break;
-				if (res == jperOk && !found)
-					break;
-			}
+			*error = true;
+			return NULL;
 		}
+
+		ereport(ERROR,
+				(errcode(ERRCODE_JSON_SCALAR_REQUIRED),
+				 errmsg("SQL/JSON scalar required")));
 	}
 
+	if (res->type == jbvNull)
+		return NULL;
+
 	return res;
 }
 
-static inline JsonPathExecResult
-recursiveExecuteUnwrap(JsonPathExecContext *cxt, JsonPathItem *jsp,
-					   JsonbValue *jb, JsonValueList *found)
+JsonbValue *
+JsonbPathValue(Jsonb *jb, JsonPathCompiled *jp, bool *empty, bool *error,
+			   List *vars, JsonPathKeyMemo *memo)
 {
-	if (cxt->lax && JsonbType(jb) == jbvArray)
-		return recursiveExecuteUnwrapArray(cxt, jsp, jb, found);
+	return JsonPathIteratorValue(JsonPathIteratorInit(jp, vars, jb, memo),
+								 empty, error);
+}
 
-	return recursiveExecuteNoUnwrap(cxt, jsp, jb, found, false);
+/************************ JSON_TABLE functions ***************************/
+
+/*
+ * Returns private data from executor state. Ensure validity by check with
+ * MAGIC number.
+ */
+static inline JsonTableContext *
+GetJsonTableContext(TableFuncScanState *state, const char *fname)
+{
+	JsonTableContext *result;
+
+	if (!IsA(state, TableFuncScanState))
+		elog(ERROR, "%s called with invalid TableFuncScanState", fname);
+	result = (JsonTableContext *) state->opaque;
+	if (result->magic != JSON_TABLE_CONTEXT_MAGIC)
+		elog(ERROR, "%s called with invalid TableFuncScanState", fname);
+
+	return result;
 }
 
-static inline JsonbValue *
-wrapItem(JsonbValue *jbv)
+/* Recursively initialize JSON_TABLE scan state */
+static void
+JsonTableInitScanState(JsonTableContext *cxt, JsonTableScanState *scan,
+					   JsonTableParentNode *node, JsonTableScanState *parent,
+					   List *args, MemoryContext mcxt)
 {
-	JsonbParseState *ps = NULL;
-	JsonbValue	jbvbuf;
-	int			type = JsonbType(jbv);
+	ListCell   *lc;
+
+	scan->parent = parent;
+	scan->outerJoin = node->outerJoin;
+	scan->errorOnError = node->errorOnError;
+	scan->path = !node->path ? NULL :
+		jspCompile(DatumGetJsonPath(node->path->constvalue),
+				   CurrentMemoryContext);
+	scan->args = args;
+	scan->mcxt = AllocSetContextCreate(mcxt, "JsonTableContext",
+									   ALLOCSET_DEFAULT_SIZES);
+	scan->rowcxt = AllocSetContextCreate(scan->mcxt, "JsonTableRowContext",
+										 ALLOCSET_DEFAULT_SIZES);
+	scan->nested = node->child ?
+		JsonTableInitPlanState(cxt, node->child, scan) : NULL;
+	scan->needItem = scan->nested != NULL;
+	scan->filter = NULL;
+	scan->item = NULL;
+	scan->pathIter = NULL;
+	scan->isjson = false;
+	scan->json = NULL;
+	scan->keys = NULL;
+	memset(&scan->doccache, 0, sizeof(scan->doccache));
+	scan->current = PointerGetDatum(NULL);
+	scan->currentIsNull = true;
+	scan->reset = false;
+	scan->advanceNested = false;
+	scan->ordinal = 0;
+
+	foreach(lc, node->colnos)
+		cxt->colexprs[lfirst_int(lc)].scan = scan;
+}
 
-	if (type == jbvArray)
-		return jbv;
+/* Recursively initialize JSON_TABLE scan state */
+static JsonTableJoinState *
+JsonTableInitPlanState(JsonTableContext *cxt, Node *plan,
+					   JsonTableScanState *parent)
+{
+	JsonTableJoinState *state = palloc0(sizeof(*state));
 
-	if (type == jbvScalar)
-		jbv = JsonbExtractScalar(jbv->val.binary.data, &jbvbuf);
+	if (IsA(plan, JsonTableSiblingNode))
+	{
+		JsonTableSiblingNode *join = castNode(JsonTableSiblingNode, plan);
 
-	pushJsonbValue(&ps, WJB_BEGIN_ARRAY, NULL);
-	pushJsonbValue(&ps, WJB_ELEM, jbv);
-	jbv = pushJsonbValue(&ps, WJB_END_ARRAY, NULL);
+		state->is_join = true;
+		state->u.join.cross = join->cross;
+		state->u.join.left = JsonTableInitPlanState(cxt, join->larg, parent);
+		state->u.join.right = JsonTableInitPlanState(cxt, join->rarg, parent);
+	}
+	else
+	{
+		JsonTableParentNode *node = castNode(JsonTableParentNode, plan);
 
-	return JsonbWrapInBinary(jbv, NULL);
+		state->is_join = false;
+
+		JsonTableInitScanState(cxt, &state->u.scan, node, parent,
+							   parent->args, parent->mcxt);
+	}
+
+	return state;
 }
 
-static inline JsonPathExecResult
-recursiveExecute(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbValue *jb,
-				 JsonValueList *found)
+/*
+ * Make the column expression evaluated on the items of the scan share its
+ * row item, and merge the leading key accessors of the column path into the
+ * trie of the scan.  Then the prefixes shared by the column paths are
+ * navigated only once per row item.
+ */
+static void
+JsonTableInitColumn(JsonTableScanState *scan, JsonExpr *colexpr,
+					ExprState *estate)
 {
-	if (cxt->lax)
+	int			i;
+
+	for (i = 0; i < estate->steps_len; i++)
 	{
-		switch (jsp->type)
-		{
-			case jpiKey:
-			case jpiAnyKey:
-		/*	case jpiAny: */
-			case jpiFilter:
-			/* all methods excluding type() and size() */
-			case jpiAbs:
-			case jpiFloor:
-			case jpiCeiling:
-			case jpiDouble:
-			case jpiDatetime:
-			case jpiKeyValue:
-				return recursiveExecuteUnwrap(cxt, jsp, jb, found);
+		ExprEvalStep *op = &estate->steps[i];
 
-			case jpiAnyArray:
-				jb = wrapItem(jb);
-				break;
+		/* the step of the column JsonExpr itself, reading the jsonb item */
+		if (ExecEvalStepOp(estate, op) != EEOP_JSONEXPR ||
+			op->d.jsonexpr.jsexpr != colexpr ||
+			op->d.jsonexpr.formatted_expr)
+			continue;
 
-			default:
-				break;
+		if (!scan->keys)
+		{
+			scan->keys = JsonPathKeyMemoCreate(NULL);
+			scan->doccache.pinned = true;
 		}
-	}
 
-	return recursiveExecuteNoUnwrap(cxt, jsp, jb, found, false);
+		if (op->d.jsonexpr.path)
+			JsonPathKeyMemoAddPath(scan->keys, op->d.jsonexpr.path);
+
+		op->d.jsonexpr.doccache = &scan->doccache;
+	}
 }
 
-static inline JsonPathExecResult
-recursiveExecuteBool(JsonPathExecContext *cxt, JsonPathItem *jsp,
-					 JsonbValue *jb)
+/*
+ * Get the PASSING arguments of the document expression.  They are bound
+ * directly to the path variables, and, unlike the opaque state, live as long
+ * as the scan node, so invariant ones are evaluated only once per execution
+ * of the plan.  The evaluation of the document expression prepares them for
+ * each document.
+ */
+static List *
+JsonTableGetPassingArgs(ExprState *docexpr, JsonExpr *ci)
 {
-	if (jspHasNext(jsp))
-		elog(ERROR, "boolean jsonpath item can not have next item");
+	int			i;
 
-	switch (jsp->type)
+	for (i = 0; i < docexpr->steps_len; i++)
 	{
-		case jpiAnd:
-		case jpiOr:
-		case jpiNot:
-		case jpiIsUnknown:
-		case jpiEqual:
-		case jpiNotEqual:
-		case jpiGreater:
-		case jpiGreaterOrEqual:
-		case jpiLess:
-		case jpiLessOrEqual:
-		case jpiExists:
-		case jpiStartsWith:
-			break;
+		ExprEvalStep *op = &docexpr->steps[i];
 
-		default:
-			elog(ERROR, "invalid boolean jsonpath item type: %d", jsp->type);
-			break;
+		if (ExecEvalStepOp(docexpr, op) == EEOP_JSONEXPR &&
+			op->d.jsonexpr.jsexpr == ci)
+			return op->d.jsonexpr.args;
 	}
 
-	return recursiveExecuteNoUnwrap(cxt, jsp, jb, NULL, true);
+	elog(ERROR, "JSON_TABLE document expression not found");
+	return NIL;
 }
 
 /*
- * Public interface to jsonpath executor
+ * JsonTableInitOpaque
+ *		Fill in TableFuncScanState->opaque for JsonTable processor
  */
-JsonPathExecResult
-executeJsonPath(JsonPath *path, List *vars, Jsonb *json, JsonValueList *foundJson)
+static void
+JsonTableInitOpaque(TableFuncScanState *state, int natts)
 {
-	JsonPathExecContext cxt;
-	JsonPathItem	jsp;
-	JsonbValue		jbv;
+	JsonTableContext *cxt;
+	PlanState  *ps = &state->ss.ps;
+	TableFuncScan *tfs = castNode(TableFuncScan, ps->plan);
+	TableFunc  *tf = tfs->tablefunc;
+	JsonExpr   *ci = castNode(JsonExpr, tf->docexpr);
+	JsonTableParentNode *root = castNode(JsonTableParentNode, tf->plan);
+	List	   *args;
+	ListCell   *lc;
+	ListCell   *lc2;
+	int			i;
+
+	cxt = palloc0(sizeof(JsonTableContext));
+	cxt->magic = JSON_TABLE_CONTEXT_MAGIC;
+	cxt->state = state;
+
+	args = JsonTableGetPassingArgs(state->docexpr, ci);
+
+	cxt->colexprs = palloc(sizeof(*cxt->colexprs) * natts);
+
+	JsonTableInitScanState(cxt, &cxt->root, root, NULL, args,
+						   CurrentMemoryContext);
+
+	/* json text document is converted into jsonb only if needed */
+	if (exprType(ci->formatted_expr ? ci->formatted_expr : ci->raw_expr) ==
+		JSONOID)
+		cxt->root.isjson = true;
+
+	/* non-constant root path is evaluated for each document */
+	if (!root->path)
+	{
+		cxt->pathexpr = ExecInitExpr((Expr *) ci->path_spec, ps);
+		cxt->pathcache = JsonPathCacheCreate(CurrentMemoryContext);
+	}
 
-	jspInit(&jsp, path);
+	/* column expressions are already initialized by the scan node */
+	i = 0;
+	forboth(lc, state->colexprs, lc2, tf->colexprs)
+	{
+		JsonTableScanState *scan = cxt->colexprs[i].scan;
 
-	cxt.vars = vars;
-	cxt.lax = (path->header & JSONPATH_LAX) != 0;
-	cxt.root = JsonbInitBinary(&jbv, json);
-	cxt.innermostArraySize = -1;
+		cxt->colexprs[i].expr = (ExprState *) lfirst(lc);
+		cxt->colexprs[i].unused = bms_is_member(i, tfs->unusedcols);
 
-	return recursiveExecute(&cxt, &jsp, &jbv, foundJson);
-}
+		if (cxt->colexprs[i].expr && !cxt->colexprs[i].unused)
+		{
+			JsonTableInitColumn(scan, castNode(JsonExpr, lfirst(lc2)),
+								cxt->colexprs[i].expr);
+			scan->needItem = true;
+		}
 
-/********************Example functions for JsonPath***************************/
+		i++;
+	}
 
-static Datum
-returnDATUM(void *arg, bool *isNull)
-{
-	*isNull = false;
-	return	PointerGetDatum(arg);
-}
+	/* quals pushed down by the planner are checked on the root items */
+	if (tfs->rowqual)
+	{
+		int			attidx = -1;
+		Bitmapset  *attrs = NULL;
 
-static Datum
-returnNULL(void *arg, bool *isNull)
-{
-	*isNull = true;
-	return Int32GetDatum(0);
+		cxt->rowqual = ExecInitQual(tfs->rowqual, ps);
+
+		pull_varattnos((Node *) tfs->rowqual, tfs->scan.scanrelid, &attrs);
+
+		while ((attidx = bms_next_member(attrs, attidx)) >= 0)
+			cxt->rowqualcols =
+				bms_add_member(cxt->rowqualcols,
+							   attidx + FirstLowInvalidHeapAttributeNumber - 1);
+
+		cxt->rowqualcxt = AllocSetContextCreate(cxt->root.mcxt,
+												"JsonTableRowQualContext",
+												ALLOCSET_DEFAULT_SIZES);
+		cxt->rowqualvalues = palloc(sizeof(Datum) * natts);
+		cxt->rowqualnulls = palloc(sizeof(bool) * natts);
+		cxt->root.filter = cxt;
+		cxt->root.needItem = true;
+	}
+
+	state->opaque = cxt;
 }
 
 /*
- * Convert jsonb object into list of vars for executor
+ * Reset scan iterator to the beginning of the item list.  The lazy iterator
+ * is simply restarted.
  */
-static List*
-makePassingVars(Jsonb *jb)
+static void
+JsonTableRescan(JsonTableScanState *scan)
 {
-	JsonbValue		v;
-	JsonbIterator	*it;
-	int32			r;
-	List			*vars = NIL;
+	if (scan->errorOnError && scan->item && scan->path)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(scan->mcxt);
 
-	it = JsonbIteratorInit(&jb->root);
+		scan->pathIter = JsonPathIteratorInit(scan->path, scan->args,
+											  scan->item, NULL);
+		MemoryContextSwitchTo(oldcxt);
+	}
 
-	r =  JsonbIteratorNext(&it, &v, true);
+	memset(&scan->iter, 0, sizeof(scan->iter));
+	scan->nextspan = 0;
+	scan->current = PointerGetDatum(NULL);
+	scan->currentIsNull = true;
+	scan->advanceNested = false;
+	scan->ordinal = 0;
+}
 
-	if (r != WJB_BEGIN_OBJECT)
-		ereport(ERROR,
-				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-				 errmsg("passing variable json is not a object")));
+/* Reset context item of a scan, execute JSON path and reset a scan */
+static void
+JsonTableResetContextItem(JsonTableScanState *scan, Datum item)
+{
+	MemoryContext oldcxt;
+	JsonPathExecResult res;
 
-	while((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+	JsonValueListClear(&scan->found);
+
+	/* nested scans have their own child contexts, so keep them */
+	MemoryContextResetOnly(scan->mcxt);
+
+	oldcxt = MemoryContextSwitchTo(scan->mcxt);
+
+	/*
+	 * PASSING arguments may depend on the outer row, so evaluate them once
+	 * per document here: nested scans share them, and their own contexts
+	 * are reset for every parent row.
+	 */
+	if (!scan->parent)
 	{
-		if (r == WJB_KEY)
+		ListCell   *lc;
+
+		foreach(lc, scan->args)
 		{
-			JsonPathVariable	*jpv = palloc0(sizeof(*jpv));
+			JsonPathVariableEvalContext *var = lfirst(lc);
+			bool		isnull;
+
+			(void) EvalJsonPathVar(var, &isnull);
+		}
+	}
 
-			jpv->varName = cstring_to_text_with_len(v.val.string.val,
-													v.val.string.len);
+	scan->pathIter = NULL;
+	scan->json = NULL;
+	scan->item = NULL;
 
-			JsonbIteratorNext(&it, &v, true);
+	if (!scan->isjson)
+		scan->item = DatumGetJsonb(item);
+	else if (scan->path && scan->path->stream)
+	{
+		/*
+		 * Simple lax path is executed on json text.  Only locations of the
+		 * items are collected, each item is converted into jsonb when its
+		 * row is fetched, so the whole document is never converted.  Such
+		 * paths raise no errors.  The json parser can not be suspended, so
+		 * all the locations are collected in one pass before the first row
+		 * is produced, which takes memory proportional to the number of
+		 * items.  This does not matter much, since the scan node stores all
+		 * the rows in its tuplestore anyway.
+		 */
+		scan->json = DatumGetTextPP(item);
+		scan->nspans = jspStreamSpans(scan->path, scan->json,
+											&scan->spans);
+	}
+	else
+	{
+		text	   *json = DatumGetTextPP(item);
 
-			jpv->cb = returnDATUM;
+		scan->item = JsonbFromCStringLen(VARDATA_ANY(json),
+										 VARSIZE_ANY_EXHDR(json));
+	}
 
-			switch(v.type)
-			{
-				case jbvBool:
-					jpv->typid = BOOLOID;
-					jpv->cb_arg = DatumGetPointer(BoolGetDatum(v.val.boolean));
-					break;
-				case jbvNull:
-					jpv->cb = returnNULL;
-					break;
-				case jbvString:
-					jpv->typid = TEXTOID;
-					jpv->cb_arg = cstring_to_text_with_len(v.val.string.val,
-														   v.val.string.len);
-					break;
-				case jbvNumeric:
-					jpv->typid = NUMERICOID;
-					jpv->cb_arg = v.val.numeric;
-					break;
-				case jbvBinary:
-					jpv->typid = JSONBOID;
-					jpv->cb_arg = JsonbValueToJsonb(&v);
-					break;
-				default:
-					elog(ERROR, "unsupported type in passing variable json");
-			}
+	/*
+	 * Errors are thrown by the lazy iterator during the scan.  Otherwise
+	 * the items are collected at once, because an error should empty the
+	 * whole result of the scan.  NULL root path produces no items.
+	 */
+	if (!scan->errorOnError && scan->item && scan->path)
+	{
+		res = executeCompiledJsonPath(scan->path, scan->args, scan->item,
+									  &scan->found);
 
-			vars = lappend(vars, jpv);
-		}
+		if (jperIsError(res))
+			JsonValueListClear(&scan->found);	/* EMPTY ON ERROR case */
 	}
 
-	return vars;
+	MemoryContextSwitchTo(oldcxt);
+
+	JsonTableRescan(scan);
 }
 
-static void
-throwJsonPathError(JsonPathExecResult res)
+/* Fetch next item of the scan path */
+static JsonbValue *
+JsonTableScanNextItem(JsonTableScanState *scan)
 {
-	if (!jperIsError(res))
-		return;
+	MemoryContext oldcxt;
+	JsonPathExecResult res;
+	JsonbValue *jbv;
 
-	switch (jperGetError(res))
+	if (!scan->pathIter)
+		return JsonValueListNext(&scan->found, &scan->iter);
+
+	oldcxt = MemoryContextSwitchTo(scan->mcxt);
+	res = JsonPathIteratorNext(scan->pathIter, &jbv);
+	MemoryContextSwitchTo(oldcxt);
+
+	throwJsonPathError(res);
+
+	return jbv;
+}
+
+/*
+ * Fetch next item of the scan path and make it the current row item.
+ * Returns false at the end of the scan.
+ */
+static bool
+JsonTableSetNextRowItem(JsonTableScanState *scan)
+{
+	MemoryContext oldcxt;
+
+	if (!scan->needItem)
 	{
-		case ERRCODE_JSON_ARRAY_NOT_FOUND:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("SQL/JSON array not found")));
-			break;
-		case ERRCODE_JSON_OBJECT_NOT_FOUND:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("SQL/JSON object not found")));
-			break;
-		case ERRCODE_JSON_MEMBER_NOT_FOUND:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("SQL/JSON member not found")));
-			break;
-		case ERRCODE_JSON_NUMBER_NOT_FOUND:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("SQL/JSON number not found")));
-			break;
-		case ERRCODE_JSON_SCALAR_REQUIRED:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("SQL/JSON scalar required")));
-			break;
-		case ERRCODE_SINGLETON_JSON_ITEM_REQUIRED:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("Singleton SQL/JSON item required")));
-			break;
-		case ERRCODE_NON_NUMERIC_JSON_ITEM:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("Non-numeric SQL/JSON item")));
-			break;
-		case ERRCODE_INVALID_JSON_SUBSCRIPT:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("Invalid SQL/JSON subscript")));
-			break;
-		case ERRCODE_INVALID_ARGUMENT_FOR_JSON_DATETIME_FUNCTION:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("Invalid argument for SQL/JSON datetime function")));
-			break;
-		default:
-			ereport(ERROR,
-					(errcode(jperGetError(res)),
-					 errmsg("Unknown SQL/JSON error")));
-			break;
+		/* item is only counted, so it is not converted into jsonb */
+		if (scan->json)
+		{
+			if (scan->nextspan >= scan->nspans)
+				return false;
+
+			scan->nextspan++;
+		}
+		else if (!JsonTableScanNextItem(scan))
+			return false;
+
+		scan->current = (Datum) 0;
+		scan->currentIsNull = false;
+
+		return true;
 	}
-}
 
-static Datum
-__jsonpath_exists(PG_FUNCTION_ARGS)
-{
-	Jsonb				*jb = PG_GETARG_JSONB(0);
-	JsonPath			*jp = PG_GETARG_JSONPATH(1);
-	JsonPathExecResult	res;
-	List				*vars = NIL;
+	if (scan->json)
+	{
+		JsonPathStreamSpan *span;
 
-	if (PG_NARGS() == 3)
-		vars = makePassingVars(PG_GETARG_JSONB(2));
+		if (scan->nextspan >= scan->nspans)
+			return false;
 
-	res = executeJsonPath(jp, vars, jb, NULL);
+		span = &scan->spans[scan->nextspan++];
 
-	PG_FREE_IF_COPY(jb, 0);
-	PG_FREE_IF_COPY(jp, 1);
+		/* only the item of the current row is kept */
+		MemoryContextReset(scan->rowcxt);
+		oldcxt = MemoryContextSwitchTo(scan->rowcxt);
+		scan->current = JsonbGetDatum(
+			JsonbFromCStringLen(VARDATA_ANY(scan->json) + span->start,
+								span->len));
+	}
+	else
+	{
+		JsonbValue *jbv = JsonTableScanNextItem(scan);
 
-	throwJsonPathError(res);
+		if (!jbv)
+			return false;
 
-	PG_RETURN_BOOL(res == jperOk);
-}
+		/* only the item of the current row is kept */
+		MemoryContextReset(scan->rowcxt);
+		oldcxt = MemoryContextSwitchTo(scan->rowcxt);
+		scan->current = JsonbGetDatum(JsonbValueToJsonb(jbv));
+	}
 
-Datum
-_jsonpath_exists2(PG_FUNCTION_ARGS)
-{
-	return __jsonpath_exists(fcinfo);
-}
+	scan->currentIsNull = false;
 
-Datum
-_jsonpath_exists3(PG_FUNCTION_ARGS)
-{
-	return __jsonpath_exists(fcinfo);
+	/* members of the new item are looked up along with it */
+	if (scan->keys)
+	{
+		JsonPathKeyMemoReset(scan->keys, DatumGetJsonb(scan->current));
+
+		scan->doccache.item = scan->current;
+		scan->doccache.doc = scan->current;
+		scan->doccache.jsonb = scan->current;
+		scan->doccache.keys = scan->keys;
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return true;
 }
 
-static inline Datum
-_jsonpath_predicate(FunctionCallInfo fcinfo, List *vars)
+/*
+ * Check the pushed down quals on the current item of the root scan.  Only
+ * the columns referenced by the quals are computed, into the scan tuple.
+ * If the item matches, their values are kept for the rows of the item, so
+ * that JsonTableGetValue() does not compute them again.  Non-matching items
+ * are counted as removed by the filter, like rows rejected by ExecScan().
+ */
+static bool
+JsonTableRowQualMatches(JsonTableContext *cxt)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB(0);
-	JsonPath   *jp = PG_GETARG_JSONPATH(1);
-	JsonbValue *jbv;
-	JsonValueList found = { 0 };
-	JsonPathExecResult res;
+	TableFuncScanState *state = cxt->state;
+	ExprContext *econtext = state->ss.ps.ps_ExprContext;
+	TupleTableSlot *slot = state->ss.ss_ScanTupleSlot;
+	TupleTableSlot *save_scantuple = econtext->ecxt_scantuple;
+	TupleDesc	tupdesc = slot->tts_tupleDescriptor;
+	MemoryContext oldcxt;
+	int			colno = -1;
+	bool		isnull;
+	bool		res;
 
-	res = executeJsonPath(jp, vars, jb, &found);
+	cxt->rowqualmatched = false;
 
-	throwJsonPathError(res);
+	MemoryContextReset(cxt->rowqualcxt);
+	oldcxt = MemoryContextSwitchTo(cxt->rowqualcxt);
 
-	if (JsonValueListLength(&found) != 1)
-		throwJsonPathError(jperMakeError(ERRCODE_SINGLETON_JSON_ITEM_REQUIRED));
+	ExecClearTuple(slot);
+	memset(slot->tts_isnull, true, sizeof(bool) * tupdesc->natts);
 
-	jbv = JsonValueListHead(&found);
+	while ((colno = bms_next_member(cxt->rowqualcols, colno)) >= 0)
+		slot->tts_values[colno] =
+			JsonTableGetValue(state, colno,
+							  tupdesc->attrs[colno]->atttypid,
+							  tupdesc->attrs[colno]->atttypmod,
+							  &slot->tts_isnull[colno]);
 
-	if (JsonbType(jbv) == jbvScalar)
-		JsonbExtractScalar(jbv->val.binary.data, jbv);
+	ExecStoreVirtualTuple(slot);
 
-	PG_FREE_IF_COPY(jb, 0);
-	PG_FREE_IF_COPY(jp, 1);
+	econtext->ecxt_scantuple = slot;
+	res = DatumGetBool(ExecEvalExpr(cxt->rowqual, econtext, &isnull));
+	econtext->ecxt_scantuple = save_scantuple;
 
-	if (jbv->type == jbvNull)
-		PG_RETURN_NULL();
+	MemoryContextSwitchTo(oldcxt);
 
-	if (jbv->type != jbvBool)
-		PG_RETURN_NULL(); /* XXX */
+	if (res)
+	{
+		colno = -1;
 
-	PG_RETURN_BOOL(jbv->val.boolean);
-}
+		while ((colno = bms_next_member(cxt->rowqualcols, colno)) >= 0)
+		{
+			cxt->rowqualvalues[colno] = slot->tts_values[colno];
+			cxt->rowqualnulls[colno] = slot->tts_isnull[colno];
+		}
 
-Datum
-_jsonpath_predicate2(PG_FUNCTION_ARGS)
-{
-	return _jsonpath_predicate(fcinfo, NIL);
-}
+		cxt->rowqualmatched = true;
+	}
+	else
+		InstrCountFiltered1(&state->ss.ps, 1);
 
-Datum
-_jsonpath_predicate3(PG_FUNCTION_ARGS)
-{
-	return _jsonpath_predicate(fcinfo, makePassingVars(PG_GETARG_JSONB(2)));
+	return res;
 }
 
-static Datum
-__jsonpath_object(FunctionCallInfo fcinfo, bool safe)
+/*
+ * JsonTableSetDocument
+ *		Install the input document
+ */
+static void
+JsonTableSetDocument(TableFuncScanState *state, Datum value)
 {
-	FuncCallContext	*funcctx;
-	List			*found;
-	JsonbValue		*v;
-	ListCell		*c;
+	JsonTableContext *cxt = GetJsonTableContext(state, "JsonTableSetDocument");
 
-	if (SRF_IS_FIRSTCALL())
+	if (cxt->pathexpr)
 	{
-		JsonPath			*jp = PG_GETARG_JSONPATH(1);
-		Jsonb				*jb;
-		JsonPathExecResult	res;
-		MemoryContext		oldcontext;
-		List				*vars = NIL;
-		JsonValueList		found = { 0 };
+		ExprContext *econtext = state->ss.ps.ps_ExprContext;
+		MemoryContext oldcxt =
+			MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+		bool		isnull;
+		Datum		path = ExecEvalExpr(cxt->pathexpr, econtext, &isnull);
 
-		funcctx = SRF_FIRSTCALL_INIT();
-		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+		cxt->root.path = isnull ? NULL :
+			JsonPathCacheLookup(cxt->pathcache, DatumGetJsonPath(path));
 
-		jb = PG_GETARG_JSONB_COPY(0);
-		if (PG_NARGS() == 3)
-			vars = makePassingVars(PG_GETARG_JSONB(2));
+		MemoryContextSwitchTo(oldcxt);
+	}
 
-		res = executeJsonPath(jp, vars, jb, &found);
+	JsonTableResetContextItem(&cxt->root, value);
+}
 
-		if (jperIsError(res))
-		{
-			if (safe)
-				JsonValueListClear(&found);
-			else
-				throwJsonPathError(res);
-		}
+/* Recursively rewind scans of a join state, keeping their item lists */
+static void
+JsonTableRescanRecursive(JsonTableJoinState *state)
+{
+	if (state->is_join)
+	{
+		JsonTableRescanRecursive(state->u.join.left);
+		JsonTableRescanRecursive(state->u.join.right);
+		state->u.join.advanceRight = false;
+	}
+	else
+	{
+		JsonTableRescan(&state->u.scan);
+		if (state->u.scan.nested)
+			JsonTableRescanRecursive(state->u.scan.nested);
+	}
+}
 
-		PG_FREE_IF_COPY(jp, 1);
+/*
+ * Fetch next row from a cross/union joined scan.
+ *
+ * Returns false at the end of a scan, true otherwise.
+ */
+static bool
+JsonTableNextJoinRow(JsonTableJoinState *state)
+{
+	if (!state->is_join)
+		return JsonTableNextRow(&state->u.scan);
 
-		funcctx->user_fctx = JsonValueListGetList(&found);
+	if (state->u.join.advanceRight)
+	{
+		/* fetch next inner row */
+		if (JsonTableNextJoinRow(state->u.join.right))
+			return true;
 
-		MemoryContextSwitchTo(oldcontext);
+		/* inner rows are exhausted */
+		if (state->u.join.cross)
+			state->u.join.advanceRight = false;	/* next outer row */
+		else
+			return false;	/* end of scan */
 	}
 
-	funcctx = SRF_PERCALL_SETUP();
-	found = funcctx->user_fctx;
+	while (!state->u.join.advanceRight)
+	{
+		/* fetch next outer row */
+		bool		left = JsonTableNextJoinRow(state->u.join.left);
 
-	c = list_head(found);
+		if (state->u.join.cross)
+		{
+			if (!left)
+				return false;	/* end of scan */
 
-	if (c == NULL)
-		SRF_RETURN_DONE(funcctx);
+			JsonTableRescanRecursive(state->u.join.right);
 
-	v = lfirst(c);
-	funcctx->user_fctx = list_delete_first(found);
+			if (!JsonTableNextJoinRow(state->u.join.right))
+				continue;	/* next outer row */
 
-	SRF_RETURN_NEXT(funcctx, JsonbGetDatum(JsonbValueToJsonb(v)));
-}
+			state->u.join.advanceRight = true;	/* next inner row */
+		}
+		else if (!left)
+		{
+			if (!JsonTableNextJoinRow(state->u.join.right))
+				return false;	/* end of scan */
 
+			state->u.join.advanceRight = true;	/* next inner row */
+		}
 
-Datum
-_jsonpath_object2(PG_FUNCTION_ARGS)
-{
-	return __jsonpath_object(fcinfo, false);
-}
+		break;
+	}
 
-Datum
-_jsonpath_object3(PG_FUNCTION_ARGS)
-{
-	return __jsonpath_object(fcinfo, false);
+	return true;
 }
 
-Datum
-_jsonpath_object_safe2(PG_FUNCTION_ARGS)
+/*
+ * Recursively request re-evaluation of nested scans on the next fetch.
+ * Current items are cleared so that columns of the scans not reached
+ * for the new parent row are NULL.
+ */
+static void
+JsonTableJoinReset(JsonTableJoinState *state)
 {
-	return __jsonpath_object(fcinfo, true);
-}
+	if (state->is_join)
+	{
+		JsonTableJoinReset(state->u.join.left);
+		JsonTableJoinReset(state->u.join.right);
+		state->u.join.advanceRight = false;
+	}
+	else
+	{
+		state->u.scan.reset = true;
+		state->u.scan.advanceNested = false;
+		state->u.scan.current = PointerGetDatum(NULL);
+		state->u.scan.currentIsNull = true;
 
-Datum
-_jsonpath_object_safe3(PG_FUNCTION_ARGS)
-{
-	return __jsonpath_object(fcinfo, true);
+		if (state->u.scan.nested)
+			JsonTableJoinReset(state->u.scan.nested);
+	}
 }
 
-/********************Interface to pgsql's executor***************************/
-bool
-JsonbPathExists(Jsonb *jb, JsonPath *jp, List *vars)
+/*
+ * Fetch next row from a simple scan with outer/inner joined nested subscans.
+ *
+ * Returns false at the end of a scan, true otherwise.
+ */
+static bool
+JsonTableNextRow(JsonTableScanState *scan)
 {
-	JsonPathExecResult res = executeJsonPath(jp, vars, jb, NULL);
+	/* reset context item if requested */
+	if (scan->reset)
+	{
+		Assert(!scan->parent->currentIsNull);
+		JsonTableResetContextItem(scan, scan->parent->current);
+		scan->reset = false;
+	}
 
-	throwJsonPathError(res);
+	if (scan->advanceNested)
+	{
+		/* fetch next nested row */
+		scan->advanceNested = JsonTableNextJoinRow(scan->nested);
 
-	return res == jperOk;
-}
+		if (scan->advanceNested)
+			return true;
+	}
 
-static inline JsonbValue *
-wrapItemsInArray(const JsonValueList *items)
-{
-	JsonbParseState *ps = NULL;
-	JsonValueListIterator it = { 0 };
-	JsonbValue *jbv;
+	for (;;)
+	{
+		/* fetch next row */
+		if (!JsonTableSetNextRowItem(scan))
+		{
+			scan->current = PointerGetDatum(NULL);
+			scan->currentIsNull = true;
+			return false;	/* end of scan */
+		}
 
-	pushJsonbValue(&ps, WJB_BEGIN_ARRAY, NULL);
+		scan->ordinal++;
 
-	while ((jbv = JsonValueListNext(items, &it)))
-	{
-		JsonbValue	bin;
+		/* items not matching the pushed down quals produce no rows */
+		if (scan->filter && !JsonTableRowQualMatches(scan->filter))
+			continue;
 
-		if (jbv->type == jbvBinary &&
-			JsonContainerIsScalar(jbv->val.binary.data))
-			JsonbExtractScalar(jbv->val.binary.data, jbv);
+		if (!scan->nested)
+			break;
 
-		if (jbv->type == jbvObject || jbv->type == jbvArray)
-			jbv = JsonbWrapInBinary(jbv, &bin);
+		JsonTableJoinReset(scan->nested);
 
-		pushJsonbValue(&ps, WJB_ELEM, jbv);
+		scan->advanceNested = JsonTableNextJoinRow(scan->nested);
+
+		if (scan->advanceNested || scan->outerJoin)
+			break;
 	}
 
-	return pushJsonbValue(&ps, WJB_END_ARRAY, NULL);
+	return true;
 }
 
-Jsonb *
-JsonbPathQuery(Jsonb *jb, JsonPath *jp, JsonWrapper wrapper,
-			   bool *empty, List *vars)
+/*
+ * JsonTableFetchRow
+ *		Prepare the next "current" tuple for upcoming GetValue calls.
+ *		Returns FALSE if the row-filter expression returned no more rows.
+ */
+static bool
+JsonTableFetchRow(TableFuncScanState *state)
 {
-	JsonbValue *first;
-	bool		wrap;
-	JsonValueList found = { 0 };
-	JsonPathExecResult jper = executeJsonPath(jp, vars, jb, &found);
-	int			count;
-
-	throwJsonPathError(jper);
+	JsonTableContext *cxt = GetJsonTableContext(state, "JsonTableFetchRow");
 
-	count = JsonValueListLength(&found);
+	return JsonTableNextRow(&cxt->root);
+}
 
-	first = count ? JsonValueListHead(&found) : NULL;
+/*
+ * JsonTableGetValue
+ *		Return the value for column number 'colnum' for the current row.
+ *
+ * This leaks memory, so be sure to reset often the context in which it's
+ * called.
+ */
+static Datum
+JsonTableGetValue(TableFuncScanState *state, int colnum,
+				  Oid typid, int32 typmod, bool *isnull)
+{
+	JsonTableContext *cxt = GetJsonTableContext(state, "JsonTableGetValue");
+	ExprContext *econtext = state->ss.ps.ps_ExprContext;
+	ExprState  *estate = cxt->colexprs[colnum].expr;
+	JsonTableScanState *scan = cxt->colexprs[colnum].scan;
+	Datum		result;
 
-	if (!first)
-		wrap = false;
-	else if (wrapper == JSW_NONE)
-		wrap = false;
-	else if (wrapper == JSW_UNCONDITIONAL)
-		wrap = true;
-	else if (wrapper == JSW_CONDITIONAL)
-		wrap = count > 1 ||
-			   IsAJsonbScalar(first) ||
-			   (first->type == jbvBinary &&
-				JsonContainerIsScalar(first->val.binary.data));
-	else
+	if (cxt->rowqualmatched && bms_is_member(colnum, cxt->rowqualcols))
 	{
-		elog(ERROR, "unrecognized json wrapper %d", wrapper);
-		wrap = false;
+		/* already computed by the pushed down quals */
+		result = cxt->rowqualvalues[colnum];
+		*isnull = cxt->rowqualnulls[colnum];
+	}
+	else if (scan->currentIsNull ||	/* NULL from outer/union join */
+			 cxt->colexprs[colnum].unused)
+	{
+		result = (Datum) 0;
+		*isnull = true;
 	}
+	else if (estate)			/* regular column */
+	{
+		Datum		save_datum = econtext->caseValue_datum;
+		bool		save_isNull = econtext->caseValue_isNull;
 
-	if (wrap)
-		return JsonbValueToJsonb(wrapItemsInArray(&found));
+		/* column expression reads the row item through a CaseTestExpr */
+		econtext->caseValue_datum = scan->current;
+		econtext->caseValue_isNull = false;
 
-	if (count > 1)
-		ereport(ERROR,
-				(errcode(ERRCODE_MORE_THAN_ONE_JSON_ITEM),
-				 errmsg("more than one SQL/JSON item")));
+		result = ExecEvalExpr(estate, econtext, isnull);
 
-	if (first)
-		return JsonbValueToJsonb(first);
+		econtext->caseValue_datum = save_datum;
+		econtext->caseValue_isNull = save_isNull;
+	}
+	else
+	{
+		result = Int32GetDatum(scan->ordinal);	/* ordinality column */
+		*isnull = false;
+	}
 
-	*empty = true;
-	return NULL;
+	return result;
 }
 
-JsonbValue *
-JsonbPathValue(Jsonb *jb, JsonPath *jp, bool *empty, List *vars)
+/*
+ * JsonTableDestroyOpaque
+ */
+static void
+JsonTableDestroyOpaque(TableFuncScanState *state)
 {
-	JsonbValue *res;
-	JsonValueList found = { 0 };
-	JsonPathExecResult jper = executeJsonPath(jp, vars, jb, &found);
-	int			count;
-
-	throwJsonPathError(jper);
-
-	count = JsonValueListLength(&found);
-
-	*empty = !count;
-
-	if (*empty)
-		return NULL;
-
-	if (count > 1)
-		ereport(ERROR,
-				(errcode(ERRCODE_MORE_THAN_ONE_JSON_ITEM),
-				 errmsg("more than one SQL/JSON item")));
-
-	res = JsonValueListHead(&found);
+	JsonTableContext *cxt = GetJsonTableContext(state, "JsonTableDestroyOpaque");
 
-	if (res->type == jbvBinary &&
-		JsonContainerIsScalar(res->val.binary.data))
-		JsonbExtractScalar(res->val.binary.data, res);
+	/* not valid anymore */
+	cxt->magic = 0;
 
-	if (!IsAJsonbScalar(res))
-		ereport(ERROR,
-				(errcode(ERRCODE_JSON_SCALAR_REQUIRED),
-				 errmsg("SQL/JSON scalar required")));
+	/* this also deletes the contexts of all nested scans */
+	MemoryContextDelete(cxt->root.mcxt);
 
-	if (res->type == jbvNull)
-		return NULL;
+	pfree(cxt->colexprs);
+	if (cxt->rowqualvalues)
+	{
+		pfree(cxt->rowqualvalues);
+		pfree(cxt->rowqualnulls);
+	}
+	pfree(cxt);
 
-	return res;
+	state->opaque = NULL;
 }
+
+const TableFuncRoutine JsonbTableRoutine =
+{
+	JsonTableInitOpaque,
+	JsonTableSetDocument,
+	NULL,
+	NULL,
+	NULL,
+	JsonTableFetchRow,
+	JsonTableGetValue,
+	JsonTableDestroyOpaque
+};
@@ -14,8 +14,10 @@
 %{
 #include "postgres.h"
 
+#include "catalog/pg_collation.h"
 #include "fmgr.h"
 #include "nodes/pg_list.h"
+#include "regex/regex.h"
 #include "utils/builtins.h"
 #include "utils/jsonpath.h"
 
@@ -209,6 +211,55 @@ makeItemObject(List *fields)
 	return v;
 }
 
+static JsonPathParseItem *
+makeItemLikeRegex(JsonPathParseItem *expr, string *pattern, string *flags)
+{
+	JsonPathParseItem *v = makeItemType(jpiLikeRegex);
+	regex_t		regex;
+	int			i;
+
+	v->value.like_regex.expr = expr;
+	v->value.like_regex.pattern = pattern->val;
+	v->value.like_regex.patternlen = pattern->len;
+	v->value.like_regex.flags = 0;
+
+	for (i = 0; flags && i < flags->len; i++)
+	{
+		switch (flags->val[i])
+		{
+			case 'i':
+				v->value.like_regex.flags |= JSP_REGEX_ICASE;
+				break;
+			case 's':
+				v->value.like_regex.flags &= ~JSP_REGEX_MLINE;
+				v->value.like_regex.flags |= JSP_REGEX_SLINE;
+				break;
+			case 'm':
+				v->value.like_regex.flags &= ~JSP_REGEX_SLINE;
+				v->value.like_regex.flags |= JSP_REGEX_MLINE;
+				break;
+			case 'x':
+				v->value.like_regex.flags |= JSP_REGEX_WSPACE;
+				break;
+			default:
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("bad jsonpath representation"),
+						 errdetail("unrecognized flag of LIKE_REGEX predicate at or near \"%s\"",
+								   flags->val + i)));
+				break;
+		}
+	}
+
+	/* check that the pattern is valid */
+	RE_compile(&regex, pattern->val, pattern->len,
+			   jspGetLikeRegexCflags(v->value.like_regex.flags),
+			   DEFAULT_COLLATION_OID);
+	pg_regfree(&regex);
+
+	return v;
+}
+
 %}
 
 /* BISON Declarations */
@@ -232,7 +283,7 @@ makeItemObject(List *fields)
 %token	<str>		STRING_P NUMERIC_P INT_P EXISTS_P STRICT_P LAX_P LAST_P
 %token	<str>		ABS_P SIZE_P TYPE_P FLOOR_P DOUBLE_P CEILING_P DATETIME_P
 %token	<str>		KEYVALUE_P MAP_P REDUCE_P FOLD_P FOLDL_P FOLDR_P
-%token	<str>		MIN_P MAX_P
+%token	<str>		MIN_P MAX_P LIKE_REGEX_P FLAG_P
 
 %token	<str>		OR_P AND_P NOT_P
 %token	<str>		LESS_P LESSEQUAL_P EQUAL_P NOTEQUAL_P GREATEREQUAL_P GREATER_P
@@ -335,9 +386,10 @@ predicate:
 	| '(' predicate ')' IS_P UNKNOWN_P	{ $$ = makeItemUnary(jpiIsUnknown, $2); }
 	| pexpr STARTS_P WITH_P starts_with_initial
 		{ $$ = makeItemBinary(jpiStartsWith, $1, $4); }
-/* Left for the future (needs XQuery support)
-	| pexpr LIKE_REGEX pattern [FLAG_P flags]	{ $$ = ...; };
-*/
+	| pexpr LIKE_REGEX_P STRING_P
+		{ $$ = makeItemLikeRegex($1, &$3, NULL); }
+	| pexpr LIKE_REGEX_P STRING_P FLAG_P STRING_P
+		{ $$ = makeItemLikeRegex($1, &$3, &$5); }
 	;
 
 starts_with_initial:
@@ -479,6 +531,8 @@ key_name:
 	| FOLDR_P
 	| MIN_P
 	| MAX_P
+	| LIKE_REGEX_P
+	| FLAG_P
 	;
 
 method:
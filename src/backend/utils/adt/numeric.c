@@ -464,7 +464,7 @@ static void free_var(NumericVar *var);
 static void zero_var(NumericVar *var);
 
 static const char *set_var_from_str(const char *str, const char *cp,
-				 NumericVar *dest);
+				 NumericVar *dest, bool *have_error);
 static void set_var_from_num(Numeric value, NumericVar *dest);
 static void init_var_from_num(Numeric num, NumericVar *dest);
 static void set_var_from_var(NumericVar *value, NumericVar *dest);
@@ -472,10 +472,12 @@ static char *get_str_from_var(NumericVar *var);
 static char *get_str_from_var_sci(NumericVar *var, int rscale);
 
 static Numeric make_result(NumericVar *var);
+static Numeric make_result_opt_error(NumericVar *var, bool *have_error);
 
 static void apply_typmod(NumericVar *var, int32 typmod);
+static Numeric numeric_in_internal(char *str, int32 typmod, bool *have_error);
 
-static int32 numericvar_to_int32(NumericVar *var);
+static int32 numericvar_to_int32(NumericVar *var, bool *have_error);
 static bool numericvar_to_int64(NumericVar *var, int64 *result);
 static void int64_to_numericvar(int64 val, NumericVar *var);
 #ifdef HAVE_INT128
@@ -564,6 +566,28 @@ numeric_in(PG_FUNCTION_ARGS)
 	Oid			typelem = PG_GETARG_OID(1);
 #endif
 	int32		typmod = PG_GETARG_INT32(2);
+
+	PG_RETURN_NUMERIC(numeric_in_internal(str, typmod, NULL));
+}
+
+/*
+ * Convert a string to numeric without typmod.  If have_error is not NULL,
+ * invalid input syntax or an out of range value sets *have_error instead of
+ * throwing an error.
+ */
+Numeric
+numeric_in_opt_error(char *str, bool *have_error)
+{
+	return numeric_in_internal(str, -1, have_error);
+}
+
+/*
+ * Guts of numeric_in().  Only errors of the input string are returned in
+ * *have_error, typmod violations are always thrown.
+ */
+static Numeric
+numeric_in_internal(char *str, int32 typmod, bool *have_error)
+{
 	Numeric		res;
 	const char *cp;
 
@@ -588,10 +612,7 @@ numeric_in(PG_FUNCTION_ARGS)
 		while (*cp)
 		{
 			if (!isspace((unsigned char) *cp))
-				ereport(ERROR,
-						(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-						 errmsg("invalid input syntax for type %s: \"%s\"",
-								"numeric", str)));
+				goto invalid_syntax;
 			cp++;
 		}
 	}
@@ -604,7 +625,13 @@ numeric_in(PG_FUNCTION_ARGS)
 
 		init_var(&value);
 
-		cp = set_var_from_str(str, cp, &value);
+		cp = set_var_from_str(str, cp, &value, have_error);
+
+		if (!cp)
+		{
+			free_var(&value);
+			return NULL;
+		}
 
 		/*
 		 * We duplicate a few lines of code here because we would like to
@@ -615,20 +642,34 @@ numeric_in(PG_FUNCTION_ARGS)
 		while (*cp)
 		{
 			if (!isspace((unsigned char) *cp))
-				ereport(ERROR,
-						(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-						 errmsg("invalid input syntax for type %s: \"%s\"",
-								"numeric", str)));
+			{
+				free_var(&value);
+				goto invalid_syntax;
+			}
 			cp++;
 		}
 
 		apply_typmod(&value, typmod);
 
-		res = make_result(&value);
+		res = make_result_opt_error(&value, have_error);
 		free_var(&value);
 	}
 
-	PG_RETURN_NUMERIC(res);
+	return res;
+
+invalid_syntax:
+	if (have_error)
+	{
+		*have_error = true;
+		return NULL;
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+			 errmsg("invalid input syntax for type %s: \"%s\"",
+					"numeric", str)));
+
+	return NULL;				/* keep compiler quiet */
 }
 
 
@@ -671,6 +712,72 @@ numeric_is_nan(Numeric num)
 	return NUMERIC_IS_NAN(num);
 }
 
+/*
+ * numeric_get_int64() -
+ *
+ *	Get the value of an integral Numeric having zero display scale and at
+ *	most 16 decimal digits, so that the sum or difference of two such values
+ *	always fits into int64.  Returns false for other values.  Unlike
+ *	numeric_int8(), this does not allocate any memory.
+ */
+bool
+numeric_get_int64(Numeric num, int64 *result)
+{
+	NumericDigit *digits;
+	int			ndigits;
+	int			weight;
+	int			i;
+	int64		val;
+
+	if (NUMERIC_IS_NAN(num) || NUMERIC_DSCALE(num) != 0)
+		return false;
+
+	ndigits = NUMERIC_NDIGITS(num);
+
+	if (ndigits == 0)
+	{
+		*result = 0;
+		return true;
+	}
+
+	weight = NUMERIC_WEIGHT(num);
+
+	if (weight < 0 || weight >= 16 / DEC_DIGITS || ndigits > weight + 1)
+		return false;
+
+	digits = NUMERIC_DIGITS(num);
+	val = 0;
+
+	/* stripped trailing digits are real zeroes, as in numericvar_to_int64 */
+	for (i = 0; i <= weight; i++)
+		val = val * NBASE + (i < ndigits ? digits[i] : 0);
+
+	*result = NUMERIC_SIGN(num) == NUMERIC_NEG ? -val : val;
+	return true;
+}
+
+/*
+ * int64_to_numeric() -
+ *
+ *	Convert int64 to Numeric.
+ */
+Numeric
+int64_to_numeric(int64 val)
+{
+	Numeric		res;
+	NumericVar	result;
+
+	init_var(&result);
+
+	int64_to_numericvar(val, &result);
+
+	res = make_result(&result);
+
+	free_var(&result);
+
+	return res;
+}
+
 /*
  * numeric_maximum_size() -
  *
@@ -1536,7 +1643,7 @@ width_bucket_numeric(PG_FUNCTION_ARGS)
 	}
 
 	/* if result exceeds the range of a legal int4, we ereport here */
-	result = numericvar_to_int32(&result_var);
+	result = numericvar_to_int32(&result_var, NULL);
 
 	free_var(&count_var);
 	free_var(&result_var);
@@ -2921,65 +3028,79 @@ Datum
 numeric_int4(PG_FUNCTION_ARGS)
 {
 	Numeric		num = PG_GETARG_NUMERIC(0);
+
+	PG_RETURN_INT32(numeric_int4_opt_error(num, NULL));
+}
+
+/*
+ * Convert numeric to int4.  If have_error is not NULL, NaN or out of range
+ * value sets *have_error instead of throwing an error.
+ */
+int32
+numeric_int4_opt_error(Numeric num, bool *have_error)
+{
 	NumericVar	x;
-	int32		result;
 
 	/* XXX would it be better to return NULL? */
 	if (NUMERIC_IS_NAN(num))
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return 0;
+		}
+
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("cannot convert NaN to integer")));
+	}
 
 	/* Convert to variable format, then convert to int4 */
 	init_var_from_num(num, &x);
-	result = numericvar_to_int32(&x);
-	PG_RETURN_INT32(result);
+	return numericvar_to_int32(&x, have_error);
 }
 
 /*
  * Given a NumericVar, convert it to an int32. If the NumericVar
  * exceeds the range of an int32, raise the appropriate error via
- * ereport(). The input NumericVar is *not* free'd.
+ * ereport(), or set *have_error and return 0 if have_error is not NULL.
+ * The input NumericVar is *not* free'd.
  */
 static int32
-numericvar_to_int32(NumericVar *var)
+numericvar_to_int32(NumericVar *var, bool *have_error)
 {
 	int32		result;
 	int64		val;
 
-	if (!numericvar_to_int64(var, &val))
-		ereport(ERROR,
-				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
-				 errmsg("integer out of range")));
+	if (numericvar_to_int64(var, &val))
+	{
+		/* Down-convert to int4 */
+		result = (int32) val;
 
-	/* Down-convert to int4 */
-	result = (int32) val;
+		/* Test for overflow by reverse-conversion. */
+		if ((int64) result == val)
+			return result;
+	}
 
-	/* Test for overflow by reverse-conversion. */
-	if ((int64) result != val)
-		ereport(ERROR,
-				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
-				 errmsg("integer out of range")));
+	if (have_error)
+	{
+		*have_error = true;
+		return 0;
+	}
 
-	return result;
+	ereport(ERROR,
+			(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+			 errmsg("integer out of range")));
+
+	return 0;					/* keep compiler quiet */
 }
 
 Datum
 int8_numeric(PG_FUNCTION_ARGS)
 {
 	int64		val = PG_GETARG_INT64(0);
-	Numeric		res;
-	NumericVar	result;
-
-	init_var(&result);
-
-	int64_to_numericvar(val, &result);
-
-	res = make_result(&result);
-
-	free_var(&result);
 
-	PG_RETURN_NUMERIC(res);
+	PG_RETURN_NUMERIC(int64_to_numeric(val));
 }
 
 
@@ -2987,24 +3108,51 @@ Datum
 numeric_int8(PG_FUNCTION_ARGS)
 {
 	Numeric		num = PG_GETARG_NUMERIC(0);
+
+	PG_RETURN_INT64(numeric_int8_opt_error(num, NULL));
+}
+
+/*
+ * Convert numeric to int8.  If have_error is not NULL, NaN or out of range
+ * value sets *have_error instead of throwing an error.
+ */
+int64
+numeric_int8_opt_error(Numeric num, bool *have_error)
+{
 	NumericVar	x;
 	int64		result;
 
 	/* XXX would it be better to return NULL? */
 	if (NUMERIC_IS_NAN(num))
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return 0;
+		}
+
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("cannot convert NaN to bigint")));
+	}
 
 	/* Convert to variable format and thence to int8 */
 	init_var_from_num(num, &x);
 
 	if (!numericvar_to_int64(&x, &result))
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return 0;
+		}
+
 		ereport(ERROR,
 				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
 				 errmsg("bigint out of range")));
+	}
 
-	PG_RETURN_INT64(result);
+	return result;
 }
 
 
@@ -3031,34 +3179,52 @@ Datum
 numeric_int2(PG_FUNCTION_ARGS)
 {
 	Numeric		num = PG_GETARG_NUMERIC(0);
+
+	PG_RETURN_INT16(numeric_int2_opt_error(num, NULL));
+}
+
+/*
+ * Convert numeric to int2.  If have_error is not NULL, NaN or out of range
+ * value sets *have_error instead of throwing an error.
+ */
+int16
+numeric_int2_opt_error(Numeric num, bool *have_error)
+{
 	NumericVar	x;
 	int64		val;
-	int16		result;
 
 	/* XXX would it be better to return NULL? */
 	if (NUMERIC_IS_NAN(num))
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return 0;
+		}
+
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("cannot convert NaN to smallint")));
+	}
 
 	/* Convert to variable format and thence to int8 */
 	init_var_from_num(num, &x);
 
-	if (!numericvar_to_int64(&x, &val))
-		ereport(ERROR,
-				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
-				 errmsg("smallint out of range")));
-
-	/* Down-convert to int2 */
-	result = (int16) val;
+	/* Test for overflow of int2 by reverse-conversion */
+	if (!numericvar_to_int64(&x, &val) || (int64) (int16) val != val)
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return 0;
+		}
 
-	/* Test for overflow by reverse-conversion. */
-	if ((int64) result != val)
 		ereport(ERROR,
 				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
 				 errmsg("smallint out of range")));
+	}
 
-	PG_RETURN_INT16(result);
+	return (int16) val;
 }
 
 
@@ -3078,7 +3244,7 @@ float8_numeric(PG_FUNCTION_ARGS)
 	init_var(&result);
 
 	/* Assume we need not worry about leading/trailing spaces */
-	(void) set_var_from_str(buf, buf, &result);
+	(void) set_var_from_str(buf, buf, &result, NULL);
 
 	res = make_result(&result);
 
@@ -3092,20 +3258,32 @@ Datum
 numeric_float8(PG_FUNCTION_ARGS)
 {
 	Numeric		num = PG_GETARG_NUMERIC(0);
+
+	PG_RETURN_FLOAT8(numeric_float8_opt_error(num, NULL));
+}
+
+/*
+ * Convert numeric to float8.  If have_error is not NULL, an out of range
+ * value sets *have_error instead of throwing an error.
+ */
+double
+numeric_float8_opt_error(Numeric num, bool *have_error)
+{
 	char	   *tmp;
-	Datum		result;
+	double		result;
 
 	if (NUMERIC_IS_NAN(num))
-		PG_RETURN_FLOAT8(get_float8_nan());
+		return get_float8_nan();
 
 	tmp = DatumGetCString(DirectFunctionCall1(numeric_out,
 											  NumericGetDatum(num)));
 
-	result = DirectFunctionCall1(float8in, CStringGetDatum(tmp));
+	result = float8in_internal_opt_error(tmp, NULL, "double precision", tmp,
+										 have_error);
 
 	pfree(tmp);
 
-	PG_RETURN_DATUM(result);
+	return result;
 }
 
 
@@ -3144,7 +3322,7 @@ float4_numeric(PG_FUNCTION_ARGS)
 	init_var(&result);
 
 	/* Assume we need not worry about leading/trailing spaces */
-	(void) set_var_from_str(buf, buf, &result);
+	(void) set_var_from_str(buf, buf, &result, NULL);
 
 	res = make_result(&result);
 
@@ -5443,13 +5621,16 @@ zero_var(NumericVar *var)
  *
  * cp is the place to actually start parsing; str is what to use in error
  * reports.  (Typically cp would be the same except advanced over spaces.)
+ * If have_error is not NULL, invalid input sets *have_error and returns NULL
+ * instead of throwing an error.
  */
 static const char *
-set_var_from_str(const char *str, const char *cp, NumericVar *dest)
+set_var_from_str(const char *str, const char *cp, NumericVar *dest,
+				 bool *have_error)
 {
 	bool		have_dp = FALSE;
 	int			i;
-	unsigned char *decdigits;
+	unsigned char *decdigits = NULL;
 	int			sign = NUMERIC_POS;
 	int			dweight = -1;
 	int			ddigits;
@@ -5483,10 +5664,7 @@ set_var_from_str(const char *str, const char *cp, NumericVar *dest)
 	}
 
 	if (!isdigit((unsigned char) *cp))
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-				 errmsg("invalid input syntax for type %s: \"%s\"",
-						"numeric", str)));
+		goto invalid_syntax;
 
 	decdigits = (unsigned char *) palloc(strlen(cp) + DEC_DIGITS * 2);
 
@@ -5507,10 +5685,7 @@ set_var_from_str(const char *str, const char *cp, NumericVar *dest)
 		else if (*cp == '.')
 		{
 			if (have_dp)
-				ereport(ERROR,
-						(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-						 errmsg("invalid input syntax for type %s: \"%s\"",
-								"numeric", str)));
+				goto invalid_syntax;
 			have_dp = TRUE;
 			cp++;
 		}
@@ -5531,10 +5706,7 @@ set_var_from_str(const char *str, const char *cp, NumericVar *dest)
 		cp++;
 		exponent = strtol(cp, &endptr, 10);
 		if (endptr == cp)
-			ereport(ERROR,
-					(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-					 errmsg("invalid input syntax for type %s: \"%s\"",
-							"numeric", str)));
+			goto invalid_syntax;
 		cp = endptr;
 
 		/*
@@ -5546,9 +5718,18 @@ set_var_from_str(const char *str, const char *cp, NumericVar *dest)
 		 * for consistency use the same ereport errcode/text as make_result().
 		 */
 		if (exponent >= INT_MAX / 2 || exponent <= -(INT_MAX / 2))
+		{
+			if (have_error)
+			{
+				pfree(decdigits);
+				*have_error = true;
+				return NULL;
+			}
+
 			ereport(ERROR,
 					(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
 					 errmsg("value overflows numeric format")));
+		}
 		dweight += (int) exponent;
 		dscale -= (int) exponent;
 		if (dscale < 0)
@@ -5598,6 +5779,22 @@ set_var_from_str(const char *str, const char *cp, NumericVar *dest)
 
 	/* Return end+1 position for caller */
 	return cp;
+
+invalid_syntax:
+	if (have_error)
+	{
+		if (decdigits)
+			pfree(decdigits);
+		*have_error = true;
+		return NULL;
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+			 errmsg("invalid input syntax for type %s: \"%s\"",
+					"numeric", str)));
+
+	return NULL;				/* keep compiler quiet */
 }
 
 
@@ -5921,6 +6118,19 @@ get_str_from_var_sci(NumericVar *var, int rscale)
  */
 static Numeric
 make_result(NumericVar *var)
+{
+	return make_result_opt_error(var, NULL);
+}
+
+/*
+ * make_result_opt_error() -
+ *
+ *	Same as make_result(), but if have_error is not NULL, an overflow of the
+ *	packed format sets *have_error and returns NULL instead of throwing an
+ *	error.
+ */
+static Numeric
+make_result_opt_error(NumericVar *var, bool *have_error)
 {
 	Numeric		result;
 	NumericDigit *digits = var->digits;
@@ -5991,9 +6201,17 @@ make_result(NumericVar *var)
 	/* Check for overflow of int16 fields */
 	if (NUMERIC_WEIGHT(result) != weight ||
 		NUMERIC_DSCALE(result) != var->dscale)
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return NULL;
+		}
+
 		ereport(ERROR,
 				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
 				 errmsg("value overflows numeric format")));
+	}
 
 	dump_numeric("make_result()", result);
 	return result;
@@ -117,6 +117,56 @@ static ArrayType *build_regexp_match_result(regexp_matches_ctx *matchctx);
 static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
 
 
+/*
+ * RE_compile - compile a RE into the caller's storage, without caching
+ *
+ *	regex --- where to put the compiled pattern, to be freed by pg_regfree()
+ *	pat, pat_len --- the pattern, need not be null-terminated
+ *	cflags --- compile options for the pattern
+ *	collation --- collation to use for LC_CTYPE-dependent behavior
+ *
+ * Pattern is given in the database encoding.  Nothing needs to be freed if
+ * an error is thrown.
+ */
+void
+RE_compile(regex_t *regex, char *pat, int pat_len, int cflags, Oid collation)
+{
+	pg_wchar   *pattern;
+	int			pattern_len;
+	int			regcomp_result;
+	char		errMsg[100];
+
+	/* Convert pattern string to wide characters */
+	pattern = (pg_wchar *) palloc((pat_len + 1) * sizeof(pg_wchar));
+	pattern_len = pg_mb2wchar_with_len(pat, pattern, pat_len);
+
+	regcomp_result = pg_regcomp(regex,
+								pattern,
+								pattern_len,
+								cflags,
+								collation);
+
+	pfree(pattern);
+
+	if (regcomp_result != REG_OKAY)
+	{
+		/* re didn't compile (no need for pg_regfree, if so) */
+
+		/*
+		 * Here and in other places in this file, do CHECK_FOR_INTERRUPTS
+		 * before reporting a regex error.  This is so that if the regex
+		 * library aborts and returns REG_CANCEL, we don't print an error
+		 * message that implies the regex was invalid.
+		 */
+		CHECK_FOR_INTERRUPTS();
+
+		pg_regerror(regcomp_result, regex, errMsg, sizeof(errMsg));
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_REGULAR_EXPRESSION),
+				 errmsg("invalid regular expression: %s", errMsg)));
+	}
+}
+
 /*
  * RE_compile_and_cache - compile a RE, caching if possible
  *
@@ -134,12 +184,8 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 {
 	int			text_re_len = VARSIZE_ANY_EXHDR(text_re);
 	char	   *text_re_val = VARDATA_ANY(text_re);
-	pg_wchar   *pattern;
-	int			pattern_len;
 	int			i;
-	int			regcomp_result;
 	cached_re_str re_temp;
-	char		errMsg[100];
 
 	/*
 	 * Look for a match among previously compiled REs.  Since the data
@@ -171,38 +217,7 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	 * Couldn't find it, so try to compile the new RE.  To avoid leaking
 	 * resources on failure, we build into the re_temp local.
 	 */
-
-	/* Convert pattern string to wide characters */
-	pattern = (pg_wchar *) palloc((text_re_len + 1) * sizeof(pg_wchar));
-	pattern_len = pg_mb2wchar_with_len(text_re_val,
-									   pattern,
-									   text_re_len);
-
-	regcomp_result = pg_regcomp(&re_temp.cre_re,
-								pattern,
-								pattern_len,
-								cflags,
-								collation);
-
-	pfree(pattern);
-
-	if (regcomp_result != REG_OKAY)
-	{
-		/* re didn't compile (no need for pg_regfree, if so) */
-
-		/*
-		 * Here and in other places in this file, do CHECK_FOR_INTERRUPTS
-		 * before reporting a regex error.  This is so that if the regex
-		 * library aborts and returns REG_CANCEL, we don't print an error
-		 * message that implies the regex was invalid.
-		 */
-		CHECK_FOR_INTERRUPTS();
-
-		pg_regerror(regcomp_result, &re_temp.cre_re, errMsg, sizeof(errMsg));
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_REGULAR_EXPRESSION),
-				 errmsg("invalid regular expression: %s", errMsg)));
-	}
+	RE_compile(&re_temp.cre_re, text_re_val, text_re_len, cflags, collation);
 
 	/*
 	 * We use malloc/free for the cre_pat field because the storage has to
@@ -301,7 +316,7 @@ RE_wchar_execute(regex_t *re, pg_wchar *data, int data_len,
  * Data is given in the database encoding.  We internally
  * convert to array of pg_wchar which is what Spencer's regex package wants.
  */
-static bool
+bool
 RE_execute(regex_t *re, char *dat, int dat_len,
 		   int nmatch, regmatch_t *pmatch)
 {
@@ -335,7 +350,7 @@ RE_execute(regex_t *re, char *dat, int dat_len,
  * Both pattern and data are given in the database encoding.  We internally
  * convert to array of pg_wchar which is what Spencer's regex package wants.
  */
-static bool
+bool
 RE_compile_and_execute(text *text_re, char *dat, int dat_len,
 					   int cflags, Oid collation,
 					   int nmatch, regmatch_t *pmatch)
@@ -7515,6 +7515,25 @@ get_rule_expr_paren(Node *node, deparse_context *context,
 		appendStringInfoChar(context->buf, ')');
 }
 
+/*
+ * get_json_path_spec		- Parse back a JSON path specification
+ *
+ * Non-constant paths are parenthesized, because only simple expressions are
+ * accepted by the grammar there.
+ */
+static void
+get_json_path_spec(Node *path_spec, deparse_context *context, bool showimplicit)
+{
+	if (IsA(path_spec, Const))
+		get_const_expr((Const *) path_spec, context, -1);
+	else
+	{
+		appendStringInfoChar(context->buf, '(');
+		get_rule_expr(path_spec, context, showimplicit);
+		appendStringInfoChar(context->buf, ')');
+	}
+}
+
 static void
 get_json_behavior(JsonBehavior *behavior, deparse_context *context,
 				  const char *on)
@@ -8755,6 +8774,10 @@ get_rule_expr(Node *node, deparse_context *context,
 					case IS_JSON_EXISTS:
 						appendStringInfoString(buf, "JSON_EXISTS(");
 						break;
+					default:
+						elog(ERROR, "unexpected JsonExpr type: %d",
+							 (int) jexpr->op);
+						break;
 				}
 
 				get_rule_expr(jexpr->raw_expr, context, false);
@@ -8778,7 +8801,7 @@ get_rule_expr(Node *node, deparse_context *context,
 
 				appendStringInfoString(buf, ", ");
 
-				get_const_expr(jexpr->path_spec, context, -1);
+				get_json_path_spec(jexpr->path_spec, context, showimplicit);
 
 				if (jexpr->passing.values)
 				{
@@ -9575,16 +9598,14 @@ get_sublink_expr(SubLink *sublink, deparse_context *context)
 
 
 /* ----------
- * get_tablefunc			- Parse back a table function
+ * get_xmltable			- Parse back a XMLTABLE function
  * ----------
  */
 static void
-get_tablefunc(TableFunc *tf, deparse_context *context, bool showimplicit)
+get_xmltable(TableFunc *tf, deparse_context *context, bool showimplicit)
 {
 	StringInfo	buf = context->buf;
 
-	/* XMLTABLE is the only existing implementation.  */
-
 	appendStringInfoString(buf, "XMLTABLE(");
 
 	if (tf->ns_uris != NIL)
@@ -9688,6 +9709,273 @@ get_tablefunc(TableFunc *tf, deparse_context *context, bool showimplicit)
 	appendStringInfoChar(buf, ')');
 }
 
+/*
+ * get_json_table_min_colno - lowest column number belonging to a JSON_TABLE
+ * plan node, or -1 if the node has no columns at all
+ */
+static int
+get_json_table_min_colno(Node *node)
+{
+	if (IsA(node, JsonTableSiblingNode))
+	{
+		JsonTableSiblingNode *n = (JsonTableSiblingNode *) node;
+		int			l = get_json_table_min_colno(n->larg);
+		int			r = get_json_table_min_colno(n->rarg);
+
+		return l < 0 ? r : r < 0 ? l : Min(l, r);
+	}
+	else
+	{
+		JsonTableParentNode *n = castNode(JsonTableParentNode, node);
+		int			colno = n->colnos ? linitial_int(n->colnos) : -1;
+
+		if (n->child)
+		{
+			int			c = get_json_table_min_colno(n->child);
+
+			if (colno < 0 || (c >= 0 && c < colno))
+				colno = c;
+		}
+
+		return colno;
+	}
+}
+
+/*
+ * get_json_table_nested_paths - flatten sibling joins into a list of
+ * child JsonTableParentNodes
+ */
+static List *
+get_json_table_nested_paths(Node *node, List *paths)
+{
+	if (IsA(node, JsonTableSiblingNode))
+	{
+		JsonTableSiblingNode *n = (JsonTableSiblingNode *) node;
+
+		paths = get_json_table_nested_paths(n->larg, paths);
+		return get_json_table_nested_paths(n->rarg, paths);
+	}
+
+	return lappend(paths, castNode(JsonTableParentNode, node));
+}
+
+/*
+ * get_json_table_column - Parse back a single JSON_TABLE column
+ */
+static void
+get_json_table_column(TableFunc *tf, int colnum, deparse_context *context,
+					  bool showimplicit)
+{
+	StringInfo	buf = context->buf;
+	char	   *colname = strVal(list_nth(tf->colnames, colnum));
+	JsonExpr   *colexpr = (JsonExpr *) list_nth(tf->colexprs, colnum);
+
+	appendStringInfoString(buf, quote_identifier(colname));
+
+	if (!colexpr)
+	{
+		appendStringInfoString(buf, " FOR ORDINALITY");
+		return;
+	}
+
+	appendStringInfo(buf, " %s",
+					 format_type_with_typemod(list_nth_oid(tf->coltypes,
+														   colnum),
+											  list_nth_int(tf->coltypmods,
+														   colnum)));
+
+	if (colexpr->op == IS_JSON_QUERY)
+		appendStringInfoString(buf,
+							   colexpr->returning.format.type ==
+							   JS_FORMAT_JSONB ?
+							   " FORMAT JSONB" : " FORMAT JSON");
+
+	appendStringInfoString(buf, " PATH ");
+	get_const_expr(castNode(Const, colexpr->path_spec), context, -1);
+
+	if (colexpr->wrapper == JSW_CONDITIONAL)
+		appendStringInfoString(buf, " WITH CONDITIONAL WRAPPER");
+
+	if (colexpr->wrapper == JSW_UNCONDITIONAL)
+		appendStringInfoString(buf, " WITH UNCONDITIONAL WRAPPER");
+
+	if (colexpr->omit_quotes)
+		appendStringInfoString(buf, " OMIT QUOTES");
+
+	if (colexpr->on_empty.btype != JSON_BEHAVIOR_NULL)
+		get_json_behavior(&colexpr->on_empty, context, "EMPTY");
+
+	if (colexpr->on_error.btype != JSON_BEHAVIOR_NULL)
+		get_json_behavior(&colexpr->on_error, context, "ERROR");
+}
+
+/*
+ * get_json_table_columns - Parse back JSON_TABLE columns of a plan node,
+ * placing NESTED PATH clauses at the position of their first column
+ */
+static void
+get_json_table_columns(TableFunc *tf, JsonTableParentNode *node,
+					   deparse_context *context, bool showimplicit)
+{
+	StringInfo	buf = context->buf;
+	List	   *nested = node->child ?
+		get_json_table_nested_paths(node->child, NIL) : NIL;
+	ListCell   *lc_col = list_head(node->colnos);
+	ListCell   *lc_nested = list_head(nested);
+	bool		first = true;
+
+	appendStringInfoString(buf, " COLUMNS (");
+
+	while (lc_col || lc_nested)
+	{
+		JsonTableParentNode *child = lc_nested ? lfirst(lc_nested) : NULL;
+		int			childcolno = child ? get_json_table_min_colno((Node *) child) : -1;
+
+		if (!first)
+			appendStringInfoString(buf, ", ");
+		first = false;
+
+		if (lc_col && (!child || childcolno < 0 ||
+					   lfirst_int(lc_col) < childcolno))
+		{
+			get_json_table_column(tf, lfirst_int(lc_col), context,
+								  showimplicit);
+			lc_col = lnext(lc_col);
+		}
+		else
+		{
+			appendStringInfoString(buf, "NESTED PATH ");
+			get_const_expr(child->path, context, -1);
+			appendStringInfo(buf, " AS %s", quote_identifier(child->name));
+			get_json_table_columns(tf, child, context, showimplicit);
+			lc_nested = lnext(lc_nested);
+		}
+	}
+
+	appendStringInfoChar(buf, ')');
+}
+
+/*
+ * get_json_table_plan - Parse back a JSON_TABLE plan
+ */
+static void
+get_json_table_plan(Node *node, deparse_context *context, bool parenthesize)
+{
+	StringInfo	buf = context->buf;
+
+	if (IsA(node, JsonTableSiblingNode))
+	{
+		JsonTableSiblingNode *n = (JsonTableSiblingNode *) node;
+
+		if (parenthesize)
+			appendStringInfoChar(buf, '(');
+
+		get_json_table_plan(n->larg, context,
+							!IsA(n->larg, JsonTableSiblingNode) ||
+							castNode(JsonTableSiblingNode, n->larg)->cross != n->cross);
+		appendStringInfoString(buf, n->cross ? " CROSS " : " UNION ");
+		get_json_table_plan(n->rarg, context, true);
+
+		if (parenthesize)
+			appendStringInfoChar(buf, ')');
+	}
+	else
+	{
+		JsonTableParentNode *n = castNode(JsonTableParentNode, node);
+
+		if (parenthesize && n->child)
+			appendStringInfoChar(buf, '(');
+
+		appendStringInfoString(buf, quote_identifier(n->name));
+
+		if (n->child)
+		{
+			appendStringInfoString(buf, n->outerJoin ? " OUTER " : " INNER ");
+			get_json_table_plan(n->child, context, true);
+
+			if (parenthesize)
+				appendStringInfoChar(buf, ')');
+		}
+	}
+}
+
+/* ----------
+ * get_json_table			- Parse back a JSON_TABLE function
+ * ----------
+ */
+static void
+get_json_table(TableFunc *tf, deparse_context *context, bool showimplicit)
+{
+	StringInfo	buf = context->buf;
+	JsonExpr   *jexpr = castNode(JsonExpr, tf->docexpr);
+	JsonTableParentNode *root = castNode(JsonTableParentNode, tf->plan);
+
+	appendStringInfoString(buf, "JSON_TABLE(");
+
+	get_rule_expr(jexpr->raw_expr, context, showimplicit);
+
+	if (jexpr->format.type != JS_FORMAT_DEFAULT)
+		appendStringInfoString(buf,
+							   jexpr->format.type == JS_FORMAT_JSONB ?
+							   " FORMAT JSONB" : " FORMAT JSON");
+
+	appendStringInfoString(buf, ", ");
+
+	get_json_path_spec(root->path ? (Node *) root->path : jexpr->path_spec,
+					   context, showimplicit);
+
+	appendStringInfo(buf, " AS %s", quote_identifier(root->name));
+
+	if (jexpr->passing.values)
+	{
+		ListCell   *lc1,
+				   *lc2;
+		bool		needcomma = false;
+
+		appendStringInfoString(buf, " PASSING ");
+
+		forboth(lc1, jexpr->passing.names,
+				lc2, jexpr->passing.values)
+		{
+			if (needcomma)
+				appendStringInfoString(buf, ", ");
+			needcomma = true;
+
+			get_rule_expr((Node *) lfirst(lc2), context, showimplicit);
+			appendStringInfo(buf, " AS %s",
+							 quote_identifier(((Value *) lfirst(lc1))->val.str));
+		}
+	}
+
+	get_json_table_columns(tf, root, context, showimplicit);
+
+	if (root->child)
+	{
+		appendStringInfoString(buf, " PLAN (");
+		get_json_table_plan((Node *) root, context, false);
+		appendStringInfoChar(buf, ')');
+	}
+
+	if (jexpr->on_error.btype != JSON_BEHAVIOR_EMPTY)
+		get_json_behavior(&jexpr->on_error, context, "ERROR");
+
+	appendStringInfoChar(buf, ')');
+}
+
+/* ----------
+ * get_tablefunc			- Parse back a table function
+ * ----------
+ */
+static void
+get_tablefunc(TableFunc *tf, deparse_context *context, bool showimplicit)
+{
+	/* XMLTABLE and JSON_TABLE have different syntax */
+	if (tf->functype == TFT_XMLTABLE)
+		get_xmltable(tf, context, showimplicit);
+	else
+		get_json_table(tf, context, showimplicit);
+}
+
 /* ----------
  * get_from_clause			- Parse back a FROM clause
  *
@@ -73,6 +73,7 @@ static Timestamp dt2local(Timestamp dt, int timezone);
 static void AdjustIntervalForTypmod(Interval *interval, int32 typmod);
 static TimestampTz timestamp2timestamptz(Timestamp timestamp);
 static Timestamp timestamptz2timestamp(TimestampTz timestamp);
+static Timestamp timestamp_in_internal(char *str, bool withtz, bool *have_error);
 
 
 /* common code for timestamptypmodin and timestamptztypmodin */
@@ -148,6 +149,33 @@ timestamp_in(PG_FUNCTION_ARGS)
 #endif
 	int32		typmod = PG_GETARG_INT32(2);
 	Timestamp	result;
+
+	result = timestamp_in_opt_error(str, NULL);
+
+	AdjustTimestampForTypmod(&result, typmod);
+
+	PG_RETURN_TIMESTAMP(result);
+}
+
+/*
+ * Convert a string to timestamp without typmod.  If have_error is not
+ * NULL, invalid or out of range input sets *have_error instead of throwing
+ * an error.
+ */
+Timestamp
+timestamp_in_opt_error(char *str, bool *have_error)
+{
+	return timestamp_in_internal(str, false, have_error);
+}
+
+/*
+ * Guts of timestamp_in() and timestamptz_in(), without typmod.  The time
+ * zone of the input is applied if withtz is true.
+ */
+static Timestamp
+timestamp_in_internal(char *str, bool withtz, bool *have_error)
+{
+	Timestamp	result;
 	fsec_t		fsec;
 	struct pg_tm tt,
 			   *tm = &tt;
@@ -164,15 +192,32 @@ timestamp_in(PG_FUNCTION_ARGS)
 	if (dterr == 0)
 		dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
 	if (dterr != 0)
-		DateTimeParseError(dterr, str, "timestamp");
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return 0;
+		}
+
+		DateTimeParseError(dterr, str, withtz ?
+						   "timestamp with time zone" : "timestamp");
+	}
 
 	switch (dtype)
 	{
 		case DTK_DATE:
-			if (tm2timestamp(tm, fsec, NULL, &result) != 0)
+			if (tm2timestamp(tm, fsec, withtz ? &tz : NULL, &result) != 0)
+			{
+				if (have_error)
+				{
+					*have_error = true;
+					return 0;
+				}
+
 				ereport(ERROR,
 						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 						 errmsg("timestamp out of range: \"%s\"", str)));
+			}
 			break;
 
 		case DTK_EPOCH:
@@ -188,6 +233,12 @@ timestamp_in(PG_FUNCTION_ARGS)
 			break;
 
 		case DTK_INVALID:
+			if (have_error)
+			{
+				*have_error = true;
+				return 0;
+			}
+
 			ereport(ERROR,
 					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 			  errmsg("date/time value \"%s\" is no longer supported", str)));
@@ -196,14 +247,12 @@ timestamp_in(PG_FUNCTION_ARGS)
 			break;
 
 		default:
-			elog(ERROR, "unexpected dtype %d while parsing timestamp \"%s\"",
-				 dtype, str);
+			elog(ERROR, "unexpected dtype %d while parsing %s \"%s\"",
+				 dtype, withtz ? "timestamptz" : "timestamp", str);
 			TIMESTAMP_NOEND(result);
 	}
 
-	AdjustTimestampForTypmod(&result, typmod);
-
-	PG_RETURN_TIMESTAMP(result);
+	return result;
 }
 
 /* timestamp_out()
@@ -388,64 +437,25 @@ timestamptz_in(PG_FUNCTION_ARGS)
 #endif
 	int32		typmod = PG_GETARG_INT32(2);
 	TimestampTz result;
-	fsec_t		fsec;
-	struct pg_tm tt,
-			   *tm = &tt;
-	int			tz;
-	int			dtype;
-	int			nf;
-	int			dterr;
-	char	   *field[MAXDATEFIELDS];
-	int			ftype[MAXDATEFIELDS];
-	char		workbuf[MAXDATELEN + MAXDATEFIELDS];
-
-	dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
-						  field, ftype, MAXDATEFIELDS, &nf);
-	if (dterr == 0)
-		dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
-	if (dterr != 0)
-		DateTimeParseError(dterr, str, "timestamp with time zone");
-
-	switch (dtype)
-	{
-		case DTK_DATE:
-			if (tm2timestamp(tm, fsec, &tz, &result) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range: \"%s\"", str)));
-			break;
-
-		case DTK_EPOCH:
-			result = SetEpochTimestamp();
-			break;
-
-		case DTK_LATE:
-			TIMESTAMP_NOEND(result);
-			break;
-
-		case DTK_EARLY:
-			TIMESTAMP_NOBEGIN(result);
-			break;
-
-		case DTK_INVALID:
-			ereport(ERROR,
-					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-			  errmsg("date/time value \"%s\" is no longer supported", str)));
-
-			TIMESTAMP_NOEND(result);
-			break;
 
-		default:
-			elog(ERROR, "unexpected dtype %d while parsing timestamptz \"%s\"",
-				 dtype, str);
-			TIMESTAMP_NOEND(result);
-	}
+	result = timestamptz_in_opt_error(str, NULL);
 
 	AdjustTimestampForTypmod(&result, typmod);
 
 	PG_RETURN_TIMESTAMPTZ(result);
 }
 
+/*
+ * Convert a string to timestamp with time zone without typmod.  If
+ * have_error is not NULL, invalid or out of range input sets *have_error
+ * instead of throwing an error.
+ */
+TimestampTz
+timestamptz_in_opt_error(char *str, bool *have_error)
+{
+	return timestamp_in_internal(str, true, have_error);
+}
+
 /*
  * Try to parse a timezone specification, and return its timezone offset value
  * if it's acceptable.  Otherwise, an error is thrown.
@@ -710,13 +720,33 @@ Datum
 float8_timestamptz(PG_FUNCTION_ARGS)
 {
 	float8		seconds = PG_GETARG_FLOAT8(0);
+
+	PG_RETURN_TIMESTAMP(float8_timestamptz_opt_error(seconds, NULL));
+}
+
+/*
+ * Convert UNIX epoch to timestamptz.  If have_error is not NULL, NaN or
+ * out of range input sets *have_error instead of throwing an error.
+ */
+TimestampTz
+float8_timestamptz_opt_error(float8 seconds, bool *have_error)
+{
+	float8		epoch = seconds;
 	TimestampTz result;
 
 	/* Deal with NaN and infinite inputs ... */
 	if (isnan(seconds))
+	{
+		if (have_error)
+		{
+			*have_error = true;
+			return 0;
+		}
+
 		ereport(ERROR,
 				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 				 errmsg("timestamp cannot be NaN")));
+	}
 
 	if (isinf(seconds))
 	{
@@ -732,9 +762,17 @@ float8_timestamptz(PG_FUNCTION_ARGS)
 			(float8) SECS_PER_DAY * (DATETIME_MIN_JULIAN - UNIX_EPOCH_JDATE)
 			|| seconds >=
 			(float8) SECS_PER_DAY * (TIMESTAMP_END_JULIAN - UNIX_EPOCH_JDATE))
+		{
+			if (have_error)
+			{
+				*have_error = true;
+				return 0;
+			}
+
 			ereport(ERROR,
 					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 					 errmsg("timestamp out of range: \"%g\"", seconds)));
+		}
 
 		/* Convert UNIX epoch to Postgres epoch */
 		seconds -= ((POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY);
@@ -744,13 +782,20 @@ float8_timestamptz(PG_FUNCTION_ARGS)
 
 		/* Recheck in case roundoff produces something just out of range */
 		if (!IS_VALID_TIMESTAMP(result))
+		{
+			if (have_error)
+			{
+				*have_error = true;
+				return 0;
+			}
+
 			ereport(ERROR,
 					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-					 errmsg("timestamp out of range: \"%g\"",
-							PG_GETARG_FLOAT8(0))));
+					 errmsg("timestamp out of range: \"%g\"", epoch)));
+		}
 	}
 
-	PG_RETURN_TIMESTAMP(result);
+	return result;
 }
 
 /* timestamptz_out()
@@ -4944,6 +4989,16 @@ timestamp_timestamptz(PG_FUNCTION_ARGS)
 
 static TimestampTz
 timestamp2timestamptz(Timestamp timestamp)
+{
+	return timestamp2timestamptz_opt_error(timestamp, NULL);
+}
+
+/*
+ * Convert timestamp to timestamp with time zone.  If have_error is not NULL,
+ * an out of range timestamp sets *have_error instead of throwing an error.
+ */
+TimestampTz
+timestamp2timestamptz_opt_error(Timestamp timestamp, bool *have_error)
 {
 	TimestampTz result;
 	struct pg_tm tt,
@@ -4956,19 +5011,28 @@ timestamp2timestamptz(Timestamp timestamp)
 	else
 	{
 		if (timestamp2tm(timestamp, NULL, tm, &fsec, NULL, NULL) != 0)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-					 errmsg("timestamp out of range")));
+			goto out_of_range;
 
 		tz = DetermineTimeZoneOffset(tm, session_timezone);
 
 		if (tm2timestamp(tm, fsec, &tz, &result) != 0)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-					 errmsg("timestamp out of range")));
+			goto out_of_range;
 	}
 
 	return result;
+
+out_of_range:
+	if (have_error)
+	{
+		*have_error = true;
+		return 0;
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+			 errmsg("timestamp out of range")));
+
+	return 0;					/* keep compiler quiet */
 }
 
 /* timestamptz_timestamp()
@@ -4984,6 +5048,16 @@ timestamptz_timestamp(PG_FUNCTION_ARGS)
 
 static Timestamp
 timestamptz2timestamp(TimestampTz timestamp)
+{
+	return timestamptz2timestamp_opt_error(timestamp, NULL);
+}
+
+/*
+ * Convert timestamp with time zone to timestamp.  If have_error is not NULL,
+ * an out of range timestamp sets *have_error instead of throwing an error.
+ */
+Timestamp
+timestamptz2timestamp_opt_error(TimestampTz timestamp, bool *have_error)
 {
 	Timestamp	result;
 	struct pg_tm tt,
@@ -4995,14 +5069,19 @@ timestamptz2timestamp(TimestampTz timestamp)
 		result = timestamp;
 	else
 	{
-		if (timestamp2tm(timestamp, &tz, tm, &fsec, NULL, NULL) != 0)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-					 errmsg("timestamp out of range")));
-		if (tm2timestamp(tm, fsec, NULL, &result) != 0)
+		if (timestamp2tm(timestamp, &tz, tm, &fsec, NULL, NULL) != 0 ||
+			tm2timestamp(tm, fsec, NULL, &result) != 0)
+		{
+			if (have_error)
+			{
+				*have_error = true;
+				return 0;
+			}
+
 			ereport(ERROR,
 					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 					 errmsg("timestamp out of range")));
+		}
 	}
 	return result;
 }
@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	201704211
+#define CATALOG_VERSION_NO	201704212
 
 #endif
@@ -18,6 +18,7 @@
 
 /* forward reference to avoid circularity */
 struct ArrayRefState;
+struct JsonExprDocCache;
 
 /* Bits in ExprState->flags (see also execnodes.h for public flag bits): */
 /* expression's interpreter has been initialized */
@@ -584,15 +585,28 @@ typedef struct ExprEvalStep
 			ExprState  *default_on_empty;
 			ExprState  *default_on_error;
 			List	   *args;
+			struct JsonPathCompiled *path;	/* compiled constant path_spec */
+			ExprState  *path_spec;	/* non-constant path_spec */
+			struct JsonPathCache *pathcache;	/* its compiled values */
 
 			void	   *cache;
 
+			/* context item shared with other JsonExprs of the ExprState */
+			struct JsonExprDocCache *doccache;
+
 			struct
 			{
 				struct JsonScalarCoercionExprState
 				{
 					Node	   *result_expr;
 					ExprState  *result_expr_state;
+					PGFunction	direct_cast;	/* cast function to call
+												 * directly, if any */
+					/* its variant returning errors in *error */
+					Datum		(*direct_cast_opt_error) (Datum value,
+														  bool *error);
+					/* input function returning errors in *error, if any */
+					Datum		(*input_opt_error) (char *str, bool *error);
 					bool		coerce_via_io;
 					bool		initialized;
 				} 			string,
@@ -645,6 +659,53 @@ typedef struct ArrayRefState
 	bool		prevnull;
 } ArrayRefState;
 
+/*
+ * Non-inline data for SQL/JSON expressions: the context item of the current
+ * row shared by all JsonExprs of an ExprState having equal context item
+ * expressions, so that it is detoasted and converted to jsonb only once per
+ * row, and memo of the object members looked up by their paths.  json
+ * context items are converted to jsonb only for the paths which can not be
+ * executed directly on json text.  An owner of the JsonExprs, like a
+ * JSON_TABLE scan for its column expressions, can pin the cache and fill it
+ * by itself for each jsonb context item.
+ */
+typedef struct JsonExprDocCache
+{
+	MemoryContext mcxt;			/* per-tuple context the cached data are
+								 * allocated in, NULL if the cache is empty */
+	MemoryContextCallback cb;	/* empties the cache on reset of mcxt */
+	Datum		item;			/* raw context item */
+	Datum		doc;			/* detoasted formatted context item */
+	Datum		jsonb;			/* jsonb document, 0 until json is converted */
+	bool		isnull;			/* document is NULL after formatting */
+	struct JsonPathKeyMemo *keys;	/* members looked up in the document */
+	bool		pinned;			/* filled by the owner, mcxt is not used */
+} JsonExprDocCache;
+
+/*
+ * Value of a SQL/JSON PASSING argument not depending on the current row,
+ * kept for the whole execution of the plan.  It is recomputed only when the
+ * PARAM_EXEC Params it refers to change, so their values at the time of the
+ * evaluation are kept along with it.
+ */
+typedef struct JsonPathVariableParam
+{
+	int			paramid;
+	int16		typlen;
+	bool		typbyval;
+	bool		isnull;
+	Datum		value;
+} JsonPathVariableParam;
+
+typedef struct JsonPathVariableCache
+{
+	MemoryContext mcxt;			/* context of the value and of the Params */
+	int16		typlen;			/* type of the argument */
+	bool		typbyval;
+	int			nparams;
+	JsonPathVariableParam params[FLEXIBLE_ARRAY_MEMBER];
+} JsonPathVariableCache;
+
 extern void ExecReadyInterpretedExpr(ExprState *state);
 
 extern ExprEvalOp ExecEvalStepOp(ExprState *state, ExprEvalStep *op);
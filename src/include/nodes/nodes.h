@@ -192,6 +192,8 @@ typedef enum NodeTag
 	T_IntoClause,
 	T_NextValueExpr,
 	T_JsonExpr,
+	T_JsonTableParentNode,
+	T_JsonTableSiblingNode,
 
 	/*
 	 * TAGS FOR EXPRESSION STATE NODES (execnodes.h)
@@ -1387,7 +1387,7 @@ typedef enum JsonQuotes
 	JS_QUOTES_OMIT
 } JsonQuotes;
 
-typedef char *JsonPathSpec;
+typedef Node *JsonPathSpec;
 
 typedef struct JsonOutput
 {
@@ -1440,7 +1440,7 @@ typedef struct JsonTableColumn
 	JsonTableColumnType coltype;
 	char	   *name;
 	TypeName   *typename;
-	JsonPathSpec pathspec;
+	char	   *pathspec;
 	char	   *pathname;
 	JsonFormat	format;
 	JsonWrapper	wrapper;
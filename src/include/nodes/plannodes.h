@@ -527,6 +527,10 @@ typedef struct TableFuncScan
 {
 	Scan		scan;
 	TableFunc  *tablefunc;		/* table function node */
+	Bitmapset  *unusedcols;		/* JSON_TABLE columns not needed by the
+								 * query, they are not evaluated */
+	List	   *rowqual;		/* quals on the JSON_TABLE root path columns,
+								 * evaluated on each of its items */
 } TableFuncScan;
 
 /* ----------------
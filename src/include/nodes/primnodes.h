@@ -74,11 +74,21 @@ typedef struct RangeVar
 } RangeVar;
 
 /*
- * TableFunc - node for a table function, such as XMLTABLE.
+ * TableFuncType - kinds of table functions
+ */
+typedef enum TableFuncType
+{
+	TFT_XMLTABLE,
+	TFT_JSON_TABLE
+} TableFuncType;
+
+/*
+ * TableFunc - node for a table function, such as XMLTABLE or JSON_TABLE.
  */
 typedef struct TableFunc
 {
 	NodeTag		type;
+	TableFuncType functype;		/* XMLTABLE or JSON_TABLE */
 	List	   *ns_uris;		/* list of namespace uri */
 	List	   *ns_names;		/* list of namespace names */
 	Node	   *docexpr;		/* input document expression */
@@ -91,6 +101,7 @@ typedef struct TableFunc
 	List	   *coldefexprs;	/* list of column default expressions */
 	Bitmapset  *notnulls;		/* nullability flag for each output column */
 	int			ordinalitycol;	/* counts from 0; -1 if none specified */
+	Node	   *plan;			/* JSON_TABLE plan */
 	int			location;		/* token location, or -1 if unknown */
 } TableFunc;
 
@@ -1156,7 +1167,8 @@ typedef enum JsonExprOp
 {
 	IS_JSON_VALUE,				/* JSON_VALUE(item, args, path, behavior) */
 	IS_JSON_QUERY,				/* JSON_QUERY(item, args, path, behavior) */
-	IS_JSON_EXISTS				/* JSON_EXISTS(item, args, path, behavior) */
+	IS_JSON_EXISTS,				/* JSON_EXISTS(item, args, path, behavior) */
+	IS_JSON_TABLE				/* JSON_TABLE(item, args, path, behavior) */
 } JsonExprOp;
 
 typedef enum JsonEncoding
@@ -1233,7 +1245,7 @@ typedef struct JsonExpr
 	bool		coerce_via_io;	/* coerce result using type input function */
 	Oid			coerce_via_io_collation; /* collation for conversion through I/O */
 	JsonFormat	format;			/* context item format (JSON/JSONB) */
-	Const	   *path_spec;		/* JSON path specification */
+	Node	   *path_spec;		/* JSON path specification expression */
 	JsonPassing	passing;		/* PASSING clause arguments */
 	JsonReturning returning;	/* RETURNING clause type/format info */
 	JsonBehavior on_empty;		/* ON EMPTY behavior */
@@ -1243,6 +1255,34 @@ typedef struct JsonExpr
 	int			location;		/* token location, or -1 if unknown */
 } JsonExpr;
 
+/*
+ * JsonTableParentNode -
+ *		transformed representation of parent JSON_TABLE plan node
+ */
+typedef struct JsonTableParentNode
+{
+	NodeTag		type;
+	Const	   *path;			/* jsonpath constant, NULL if the root path
+								 * is computed by the document expression */
+	char	   *name;			/* path name */
+	Node	   *child;			/* nested columns, if any */
+	bool		outerJoin;		/* outer or inner join for nested columns? */
+	List	   *colnos;			/* integer list of this path's column numbers */
+	bool		errorOnError;	/* ERROR/EMPTY ON ERROR behavior */
+} JsonTableParentNode;
+
+/*
+ * JsonTableSiblingNode -
+ *		transformed representation of joined sibling JSON_TABLE plan node
+ */
+typedef struct JsonTableSiblingNode
+{
+	NodeTag		type;
+	Node	   *larg;			/* left join node */
+	Node	   *rarg;			/* right join node */
+	bool		cross;			/* cross or union join? */
+} JsonTableSiblingNode;
+
 /* ----------------
  * NullTest
  *
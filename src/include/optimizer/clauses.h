@@ -72,6 +72,7 @@ extern Var *find_forced_null_var(Node *clause);
 
 extern bool is_pseudo_constant_clause(Node *clause);
 extern bool is_pseudo_constant_clause_relids(Node *clause, Relids relids);
+extern bool is_execution_invariant_clause(Node *clause);
 
 extern int	NumRelids(Node *clause);
 
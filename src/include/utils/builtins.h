@@ -60,6 +60,10 @@ extern float get_float4_nan(void);
 extern int	is_infinite(double val);
 extern double float8in_internal(char *num, char **endptr_p,
 				  const char *type_name, const char *orig_string);
+extern double float8in_internal_opt_error(char *num, char **endptr_p,
+							const char *type_name, const char *orig_string,
+							bool *have_error);
+extern float4 float8_float4_opt_error(float8 num, bool *have_error);
 extern char *float8out_internal(double num);
 extern int	float4_cmp_internal(float4 a, float4 b);
 extern int	float8_cmp_internal(float8 a, float8 b);
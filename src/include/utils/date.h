@@ -70,6 +70,13 @@ typedef struct
 /* date.c */
 extern int32 anytime_typmod_check(bool istz, int32 typmod);
 extern double date2timestamp_no_overflow(DateADT dateVal);
+extern Timestamp date2timestamp_opt_error(DateADT dateVal, bool *have_error);
+extern TimestampTz date2timestamptz_opt_error(DateADT dateVal,
+						   bool *have_error);
+extern DateADT timestamp2date_opt_error(Timestamp timestamp, bool *have_error);
+extern DateADT timestamptz2date_opt_error(TimestampTz timestamp,
+						   bool *have_error);
+extern DateADT date_in_opt_error(char *str, bool *have_error);
 extern void EncodeSpecialDate(DateADT dt, char *str);
 extern DateADT GetSQLCurrentDate(void);
 extern TimeTzADT *GetSQLCurrentTime(int32 typmod);
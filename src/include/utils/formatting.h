@@ -19,6 +19,9 @@
 
 #include "fmgr.h"
 
+/* parsed datetime format picture, opaque outside of formatting.c */
+typedef struct FormatNode FormatNode;
+
 
 extern char *str_tolower(const char *buff, size_t nbytes, Oid collid);
 extern char *str_toupper(const char *buff, size_t nbytes, Oid collid);
@@ -30,5 +33,8 @@ extern char *asc_initcap(const char *buff, size_t nbytes);
 
 extern Datum to_datetime(text *date_txt, const char *fmt, int fmt_len,
 						 bool strict, Oid *typid, int32 *typmod);
+extern FormatNode *to_datetime_compile_format(const char *fmt, int fmt_len);
+extern Datum to_datetime_compiled(text *date_txt, FormatNode *format,
+								  bool strict, Oid *typid, int32 *typmod);
 
 #endif
@@ -35,6 +35,7 @@ typedef enum
 #define JsonbExistsStrategyNumber		9
 #define JsonbExistsAnyStrategyNumber	10
 #define JsonbExistsAllStrategyNumber	11
+#define JsonbJsonpathPredicateStrategyNumber	16
 
 /*
  * In the standard jsonb_ops GIN opclass for jsonb, we choose to index both
@@ -364,16 +365,36 @@ typedef struct JsonbIterator
 	struct JsonbIterator *parent;
 } JsonbIterator;
 
+/*
+ * Positional cursor over elements of an array container.  Unlike
+ * JsonbIterator it can visit elements in any order, and moving to an
+ * adjacent element in either direction costs no more than the iterator's
+ * step.
+ */
+typedef struct JsonbArrayCursor
+{
+	JsonbContainer *container;
+	uint32		nElems;
+	char	   *dataProper;
+	int64		curIndex;		/* current element, or -1 */
+	uint32		curDataOffset;	/* data offset of the current element */
+} JsonbArrayCursor;
+
 
 /* Support functions */
 extern uint32 getJsonbOffset(const JsonbContainer *jc, int index);
 extern uint32 getJsonbLength(const JsonbContainer *jc, int index);
 extern int	compareJsonbContainers(JsonbContainer *a, JsonbContainer *b);
+extern int	compareJsonbScalars(JsonbValue *a, JsonbValue *b);
 extern JsonbValue *findJsonbValueFromContainer(JsonbContainer *sheader,
 							uint32 flags,
 							JsonbValue *key);
 extern JsonbValue *getIthJsonbValueFromContainer(JsonbContainer *sheader,
 							  uint32 i);
+extern void JsonbArrayCursorInit(JsonbArrayCursor *cur,
+					 JsonbContainer *container);
+extern bool JsonbArrayCursorGet(JsonbArrayCursor *cur, uint32 i,
+					JsonbValue *result);
 extern JsonbValue *pushJsonbValue(JsonbParseState **pstate,
 			   JsonbIteratorToken seq, JsonbValue *jbVal);
 extern JsonbIterator *JsonbIteratorInit(JsonbContainer *container);
@@ -392,6 +413,8 @@ extern char *JsonbToCStringIndent(StringInfo out, JsonbContainer *in,
 					 int estimated_len);
 extern Jsonb *JsonbMakeEmptyArray(void);
 extern Jsonb *JsonbMakeEmptyObject(void);
+extern Jsonb *JsonbFromCStringLen(char *json, int len);
+extern char *JsonbValueUnquote(JsonbValue *v);
 extern char *JsonbUnquote(Jsonb *jb);
 extern JsonbValue *JsonbExtractScalar(JsonbContainer *jbc, JsonbValue *res);
 
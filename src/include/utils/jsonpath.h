@@ -15,8 +15,10 @@
 #define JSONPATH_H
 
 #include "fmgr.h"
+#include "executor/tablefunc.h"
 #include "utils/jsonb.h"
 #include "nodes/pg_list.h"
+#include "regex/regex.h"
 
 typedef struct
 {
@@ -92,8 +94,15 @@ typedef enum JsonPathItemType {
 		jpiFoldr,
 		jpiMin,
 		jpiMax,
+		jpiLikeRegex,
 } JsonPathItemType;
 
+/* XQuery regex mode flags for LIKE_REGEX predicate */
+#define JSP_REGEX_ICASE		0x01	/* i flag, case insensitive */
+#define JSP_REGEX_SLINE		0x02	/* s flag, single-line mode */
+#define JSP_REGEX_MLINE		0x04	/* m flag, multi-line mode */
+#define JSP_REGEX_WSPACE	0x08	/* x flag, expanded syntax */
+
 
 /*
  * Support functions to parse/construct binary value.
@@ -115,6 +124,18 @@ typedef struct JsonPathItem {
 	 */
 	char			*base;
 
+	/*
+	 * pre-decoded items of a compiled path indexed by their positions,
+	 * NULL if the path is decoded on the fly
+	 */
+	struct JsonPathItem **compiled;
+
+	/*
+	 * slot caching the result of a path compared inside a filter, if the
+	 * same path is compared there more than once, or -1
+	 */
+	int32			memo;
+
 	union {
 		/* classic operator with two operands: and, or etc */
 		struct {
@@ -156,7 +177,17 @@ typedef struct JsonPathItem {
 		struct {
 			char		*data;  /* for bool, numeric and string/key */
 			int32		datalen; /* filled only for string/key */
+			int32		varno;	/* variable slot in compiled path, or -1 */
+			struct FormatNode *format;	/* compiled .datetime() template */
 		} value;
+
+		struct {
+			int32		expr;
+			char	   *pattern;
+			int32		patternlen;
+			uint32		flags;
+			regex_t	   *regex;	/* compiled pattern of compiled path */
+		} like_regex;
 	} content;
 } JsonPathItem;
 
@@ -177,6 +208,38 @@ extern void jspGetSequenceElement(JsonPathItem *v, int i, JsonPathItem *elem);
 extern void jspGetObjectField(JsonPathItem *v, int i,
 							  JsonPathItem *key, JsonPathItem *val);
 
+/*
+ * Compiled jsonpath: all the items are decoded once and linked together, so
+ * that repeated evaluations of the same path do not decode its binary
+ * representation again.
+ */
+typedef struct JsonPathCompiled
+{
+	JsonPath	   *path;		/* private copy of the compiled path */
+	bool			lax;
+	JsonPathItem  **items;		/* decoded items indexed by their positions */
+	JsonPathItem   *root;
+	int				nvars;		/* number of distinct variables referenced */
+	int				nmemo;		/* number of filter operand cache slots */
+	bool			nothrow;	/* execution cannot throw data errors */
+	struct JsonPathStreamStep *stream;	/* accessors of a path executable
+										 * in one pass over json text, or
+										 * NULL */
+	int				nstream;
+} JsonPathCompiled;
+
+extern JsonPathCompiled *jspCompile(JsonPath *js, MemoryContext mcxt);
+extern bool jspHasDatetimeItems(JsonPath *js);
+
+/* Small LRU cache of compiled paths for paths computed at execution time */
+typedef struct JsonPathCache JsonPathCache;
+
+extern JsonPathCache *JsonPathCacheCreate(MemoryContext mcxt);
+extern JsonPathCompiled *JsonPathCacheLookup(JsonPathCache *cache,
+											 JsonPath *jp);
+
+extern int	jspGetLikeRegexCflags(uint32 flags);
+
 /*
  * Parsing
  */
@@ -229,6 +292,13 @@ struct JsonPathParseItem {
 			uint32	len;
 			char	*val; /* could not be not null-terminated */
 		} string;
+
+		struct {
+			JsonPathParseItem *expr;
+			char	*pattern; /* could not be not null-terminated */
+			uint32	patternlen;
+			uint32	flags;
+		} like_regex;
 	} value;
 };
 
@@ -262,7 +332,8 @@ typedef uint64 JsonPathExecResult;
 typedef Datum (*JsonPathVariable_cb)(void *, bool *);
 
 typedef struct JsonPathVariable	{
-	text					*varName;
+	text					*varName;	/* NULL for jsonb object of
+										 * variables passed in cb_arg */
 	Oid						typid;
 	int32					typmod;
 	JsonPathVariable_cb		cb;
@@ -277,12 +348,24 @@ typedef struct JsonPathVariableEvalContext
 	Datum		value;
 	bool		isnull;
 	bool		evaluated;
+	struct JsonPathVariableCache *cache;	/* for invariant arguments */
 } JsonPathVariableEvalContext;
 
+/* Chunk of items of JsonValueList, items are stored by value */
+typedef struct JsonValueListChunk
+{
+	struct JsonValueListChunk *next;
+	int			nitems;			/* number of used items */
+	int			size;			/* allocated number of items */
+	JsonbValue	items[FLEXIBLE_ARRAY_MEMBER];
+} JsonValueListChunk;
+
 typedef struct JsonValueList
 {
-	JsonbValue *singleton;
-	List	   *list;
+	JsonbValue *singleton;		/* the only item, not copied */
+	JsonValueListChunk *head;	/* chunks, if there is more than one item */
+	JsonValueListChunk *tail;
+	int			length;
 } JsonValueList;
 
 JsonPathExecResult	executeJsonPath(JsonPath *path,
@@ -290,12 +373,50 @@ JsonPathExecResult	executeJsonPath(JsonPath *path,
 									Jsonb *json,
 									JsonValueList *foundJson);
 
-extern bool   JsonbPathExists(Jsonb *, JsonPath *path, List *vars);
-extern JsonbValue *JsonbPathValue(Jsonb *jb, JsonPath *jp, bool *empty,
-								  List *vars);
-extern Jsonb *JsonbPathQuery(Jsonb *jb, JsonPath *jp, JsonWrapper wrapper,
-							 bool *empty, List *vars);
-
+JsonPathExecResult	executeCompiledJsonPath(JsonPathCompiled *path,
+											List *vars,
+											Jsonb *json,
+											JsonValueList *foundJson);
+
+typedef struct JsonPathIterator JsonPathIterator;
+
+/* Members of leading key accessor chains looked up in one document */
+typedef struct JsonPathKeyMemo JsonPathKeyMemo;
+
+extern JsonPathKeyMemo *JsonPathKeyMemoCreate(Jsonb *json);
+extern void JsonPathKeyMemoReset(JsonPathKeyMemo *memo, Jsonb *json);
+extern void JsonPathKeyMemoAddPath(JsonPathKeyMemo *memo,
+								   JsonPathCompiled *path);
+
+extern JsonPathIterator *JsonPathIteratorInit(JsonPathCompiled *path,
+											  List *vars, Jsonb *json,
+											  JsonPathKeyMemo *memo);
+extern JsonPathIterator *JsonPathIteratorInitJson(JsonPathCompiled *path,
+												  text *json, int limit);
+extern JsonPathExecResult JsonPathIteratorNext(JsonPathIterator *it,
+											   JsonbValue **item);
+
+extern bool   JsonPathIteratorExists(JsonPathIterator *it, bool *error);
+extern JsonbValue *JsonPathIteratorValue(JsonPathIterator *it, bool *empty,
+										 bool *error);
+extern Jsonb *JsonPathIteratorQuery(JsonPathIterator *it, JsonWrapper wrapper,
+									bool *empty, bool *error);
+
+extern bool   JsonbPathExists(Jsonb *, JsonPathCompiled *path, List *vars,
+							  bool *error);
+extern JsonbValue *JsonbPathValue(Jsonb *jb, JsonPathCompiled *jp,
+								  bool *empty, bool *error, List *vars,
+								  JsonPathKeyMemo *memo);
+extern Jsonb *JsonbPathQuery(Jsonb *jb, JsonPathCompiled *jp,
+							 JsonWrapper wrapper, bool *empty, bool *error,
+							 List *vars, JsonPathKeyMemo *memo);
+
+extern void InitJsonPathVar(JsonPathVariableEvalContext *var,
+							const char *name, Expr *expr,
+							struct PlanState *parent);
+extern void ResetJsonPathVar(JsonPathVariableEvalContext *var);
 extern Datum EvalJsonPathVar(void *cxt, bool *isnull);
 
+extern const TableFuncRoutine JsonbTableRoutine;
+
 #endif
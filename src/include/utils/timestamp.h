@@ -77,6 +77,14 @@ extern bool TimestampDifferenceExceeds(TimestampTz start_time,
 						   int msec);
 
 extern TimestampTz time_t_to_timestamptz(pg_time_t tm);
+extern TimestampTz float8_timestamptz_opt_error(float8 seconds,
+							 bool *have_error);
+extern Timestamp timestamp_in_opt_error(char *str, bool *have_error);
+extern TimestampTz timestamptz_in_opt_error(char *str, bool *have_error);
+extern TimestampTz timestamp2timestamptz_opt_error(Timestamp timestamp,
+								bool *have_error);
+extern Timestamp timestamptz2timestamp_opt_error(TimestampTz timestamp,
+								bool *have_error);
 extern pg_time_t timestamptz_to_time_t(TimestampTz t);
 
 extern const char *timestamptz_to_str(TimestampTz t);
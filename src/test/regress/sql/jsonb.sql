@@ -684,6 +684,19 @@ SELECT count(*) FROM testjsonb WHERE j ? 'public';
 SELECT count(*) FROM testjsonb WHERE j ? 'bar';
 SELECT count(*) FROM testjsonb WHERE j ?| ARRAY['public','disabled'];
 SELECT count(*) FROM testjsonb WHERE j ?& ARRAY['public','disabled'];
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == null';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == "CC"';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == "CC" && true == $.public';
+SELECT count(*) FROM testjsonb WHERE j @? '$.age == 25';
+SELECT count(*) FROM testjsonb WHERE j @? '$.age == 25.0';
+SELECT count(*) FROM testjsonb WHERE j @? '$.array[*] == "foo"';
+SELECT count(*) FROM testjsonb WHERE j @? '$.array[*] == "bar"';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait like_regex "^C"';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.public)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.bar)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.public) || exists($.disabled)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.public) && exists($.disabled)';
 
 CREATE INDEX jidx ON testjsonb USING gin (j);
 SET enable_seqscan = off;
@@ -701,6 +714,21 @@ SELECT count(*) FROM testjsonb WHERE j ? 'public';
 SELECT count(*) FROM testjsonb WHERE j ? 'bar';
 SELECT count(*) FROM testjsonb WHERE j ?| ARRAY['public','disabled'];
 SELECT count(*) FROM testjsonb WHERE j ?& ARRAY['public','disabled'];
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == null';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == "CC"';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == "CC" && true == $.public';
+SELECT count(*) FROM testjsonb WHERE j @? '$.age == 25';
+SELECT count(*) FROM testjsonb WHERE j @? '$.age == 25.0';
+SELECT count(*) FROM testjsonb WHERE j @? '$.array[*] == "foo"';
+SELECT count(*) FROM testjsonb WHERE j @? '$.array[*] == "bar"';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait like_regex "^C"';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.public)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.bar)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.public) || exists($.disabled)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.public) && exists($.disabled)';
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == "CC"';
 
 -- array exists - array elements should behave as keys (for GIN index scans too)
 CREATE INDEX jidx_array ON testjsonb USING gin((j->'array'));
@@ -750,10 +778,33 @@ SELECT count(*) FROM testjsonb WHERE j @> '{"age":25}';
 SELECT count(*) FROM testjsonb WHERE j @> '{"age":25.0}';
 -- exercise GIN_SEARCH_MODE_ALL
 SELECT count(*) FROM testjsonb WHERE j @> '{}';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == null';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == "CC"';
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == "CC" && true == $.public';
+SELECT count(*) FROM testjsonb WHERE j @? '$.age == 25';
+SELECT count(*) FROM testjsonb WHERE j @? '$.age == 25.0';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($)';
+SELECT count(*) FROM testjsonb WHERE j @? 'exists($.public)';
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM testjsonb WHERE j @? '$.wait == "CC"';
 
 RESET enable_seqscan;
 DROP INDEX jidx;
 
+-- raw scalar strings are indexed as string array elements
+CREATE TEMP TABLE jsonb_scalars (j jsonb);
+INSERT INTO jsonb_scalars VALUES ('"x"'), ('"y"'), ('["x"]'), ('{"x": "x"}');
+SELECT count(*) FROM jsonb_scalars WHERE j @? 'strict $ == "x"';
+SELECT count(*) FROM jsonb_scalars WHERE j @? 'strict $ ? (@ == "x")';
+CREATE INDEX jsonb_scalars_idx ON jsonb_scalars USING gin (j);
+SET enable_seqscan = off;
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM jsonb_scalars WHERE j @? 'strict $ == "x"';
+SELECT count(*) FROM jsonb_scalars WHERE j @? 'strict $ == "x"';
+SELECT count(*) FROM jsonb_scalars WHERE j @? 'strict $ ? (@ == "x")';
+RESET enable_seqscan;
+DROP TABLE jsonb_scalars;
+
 -- nested tests
 SELECT '{"ff":{"a":12,"b":16}}'::jsonb;
 SELECT '{"ff":{"a":12,"b":16},"qq":123}'::jsonb;
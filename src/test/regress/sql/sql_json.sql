@@ -367,6 +367,8 @@ SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x)' PASSING 1 AS x);
 SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x)' PASSING '1' AS x);
 SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x && @ < $y)' PASSING 0 AS x, 2 AS y);
 SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x && @ < $y)' PASSING 0 AS x, 1 AS y);
+SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x && @ < $xy)' PASSING 2 AS xy, 0 AS x);
+SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x && @ < $x + 1)' PASSING 1.5::float8 AS x);
 
 -- JSON_VALUE
 
@@ -411,9 +413,35 @@ SELECT JSON_VALUE(jsonb '"\"aaa\""', '$' RETURNING jsonb);
 SELECT JSON_VALUE(jsonb '"aaa"', '$' RETURNING int);
 SELECT JSON_VALUE(jsonb '"aaa"', '$' RETURNING int ERROR ON ERROR);
 SELECT JSON_VALUE(jsonb '"aaa"', '$' RETURNING int DEFAULT 111 ON ERROR);
+SELECT JSON_VALUE(jsonb '"1e1000"', '$.double()' RETURNING int DEFAULT 111 ON ERROR);
+SELECT JSON_VALUE(jsonb '1e1000', '$.datetime()' RETURNING int DEFAULT 111 ON ERROR);
 SELECT JSON_VALUE(jsonb '"123"', '$' RETURNING int) + 234;
 
 SELECT JSON_VALUE(jsonb '"2017-02-20"', '$' RETURNING date) + 9;
+SELECT JSON_VALUE(jsonb '2.5', '$' RETURNING int);
+SELECT JSON_VALUE(jsonb '12345678901', '$' RETURNING bigint);
+SELECT JSON_VALUE(jsonb '12345678901', '$' RETURNING int);
+SELECT JSON_VALUE(jsonb '12345678901', '$' RETURNING int ERROR ON ERROR);
+SELECT JSON_VALUE(jsonb '0.25', '$' RETURNING float8);
+SELECT JSON_VALUE(jsonb 'true', '$' RETURNING int);
+SELECT JSON_VALUE(jsonb '"true"', '$' RETURNING bool);
+SELECT JSON_VALUE(jsonb '"10-03-2017 12:34"', '$.datetime("dd-mm-yyyy HH24:MI")' RETURNING date);
+
+-- Errors of coercions to common scalar types are returned without throwing
+SELECT JSON_VALUE(jsonb '"1e5"', '$' RETURNING int2 DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(jsonb '1e5', '$' RETURNING int2 DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(jsonb '"12345678901234567890"', '$' RETURNING int8 DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(jsonb '1e39', '$' RETURNING float4 DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(jsonb '"1e39"', '$' RETURNING float4 DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(jsonb '"1,5"', '$' RETURNING float8 DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(jsonb '" 1.5 "', '$' RETURNING numeric DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(jsonb '"1.5.5"', '$' RETURNING numeric DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(jsonb '" yes "', '$' RETURNING bool DEFAULT false ON ERROR);
+SELECT JSON_VALUE(jsonb '"maybe"', '$' RETURNING bool DEFAULT false ON ERROR);
+SELECT JSON_VALUE(jsonb '"2017-02-30"', '$' RETURNING date DEFAULT '2017-01-01' ON ERROR);
+SELECT JSON_VALUE(jsonb '"2017-02-20 25:00"', '$' RETURNING timestamp NULL ON ERROR);
+SELECT JSON_VALUE(jsonb '"2017-02-20 12:00 +03"', '$' RETURNING timestamptz NULL ON ERROR) IS NOT NULL;
+SELECT JSON_VALUE(jsonb '"invalid"', '$' RETURNING timestamptz NULL ON ERROR);
 
 -- Test NULL checks execution in domain types
 CREATE DOMAIN sqljson_int_not_null AS int NOT NULL;
@@ -568,12 +596,161 @@ SELECT * FROM unnest((JSON_QUERY(jsonb '{"reca": [{"a": 1, "t": ["foo", []]}, {"
 
 -- Conversion to array types
 SELECT JSON_QUERY(jsonb '[1,2,null,"3"]', '$[*]' RETURNING int[] WITH WRAPPER);
+SELECT JSON_QUERY(jsonb '{"a": [{"b": 1}, {"c": {"b": 2}}, 3], "b": 4}', 'lax $.**.b' WITH WRAPPER);
 SELECT * FROM unnest(JSON_QUERY(jsonb '[{"a": 1, "t": ["foo", []]}, {"a": 2, "jb": [{}, true]}]', '$' RETURNING sqljson_rec[]));
 
 -- Conversion to domain types
 SELECT JSON_QUERY(jsonb '{"a": 1}', '$.a' RETURNING sqljson_int_not_null);
 SELECT JSON_QUERY(jsonb '{"a": 1}', '$.b' RETURNING sqljson_int_not_null);
 
+-- Context item shared by several SQL/JSON expressions
+SELECT
+	JSON_VALUE(js FORMAT JSONB, '$.a.b' RETURNING int) b,
+	JSON_VALUE(js FORMAT JSONB, '$.a.c') c,
+	JSON_QUERY(js FORMAT JSONB, '$.a') a,
+	JSON_QUERY(js FORMAT JSONB, 'lax $.a.b' WITH WRAPPER) lax_b,
+	JSON_VALUE(js FORMAT JSONB, 'strict $.a.d' DEFAULT 'none' ON ERROR) d
+FROM
+	(VALUES
+		('{"a": {"b": 1, "c": "x"}}'),
+		('{"a": {"b": 2}}'),
+		('[{"a": {"b": 3}}, {"a": {"b": 4}}]'),
+		('{"a": [{"b": 5}]}'),
+		('1'),
+		('{"a": {"b": 6, "d": "y"}}')
+	) t(js);
+
+-- SQL/JSON query functions on json context items
+SELECT
+	JSON_VALUE(js, '$.a.b' RETURNING int) b,
+	JSON_QUERY(js, '$.a') a,
+	JSON_QUERY(js, '$.c[1]') c1,
+	JSON_QUERY(js, '$.c[*].d' WITH WRAPPER) d,
+	JSON_EXISTS(js, '$.e') e
+FROM
+	(VALUES
+		('{"a": {"b": 1}, "c": [{"d": 2}, {"d": [3]}, {"d": 4}], "e": null}'),
+		('[{"a": {"b": 2, "b": 3}}, [{"a": {"b": 4}}]]'),
+		('{"a": 5, "c": {"d": "x"}, "a": {"b": "6"}}'),
+		('"s"')
+	) t(js);
+
+SELECT
+	JSON_VALUE(js, '$[1]' RETURNING text) "[1]",
+	JSON_VALUE(js, '$[0].a' RETURNING text) "[0].a",
+	JSON_QUERY(js, '$[*][0]' WITH WRAPPER) "[*][0]"
+FROM
+	(VALUES
+		('[1, "2", 3]'),
+		('{"a": "x"}'),
+		('[[1, 2], {"a": "y"}, 3]'),
+		('[]')
+	) t(js);
+
+-- duplicate keys discard the items found before the limit is reached
+SELECT
+	JSON_EXISTS(js, '$.a[*]') e,
+	JSON_VALUE(js, '$.a[*]' RETURNING text) v,
+	JSON_QUERY(js, '$.a[*]') q
+FROM
+	(VALUES
+		('{"a": [1, {"b": [2]}], "a": []}'),
+		('{"a": [1, 2], "b": {"a": [3]}}'),
+		('{"a": [1], "c": [{"a": 2}], "a": [3], "d": 4}'),
+		('{"a": [1, 2, 3]}')
+	) t(js);
+
+SELECT JSON_QUERY(json '{"a": [1, 2, 3]}', '$.a[*] ? (@ > 1)' WITH WRAPPER);
+SELECT JSON_VALUE(json '{"a": 1}', 'strict $.b' ERROR ON ERROR);
+
+-- Non-constant path specifications
+SELECT
+	JSON_VALUE(js, path) v,
+	JSON_QUERY(js, path WITH WRAPPER) q,
+	JSON_EXISTS(js, path) e
+FROM
+	(VALUES
+		('$.a'),
+		('$.b[*]'),
+		('strict $.c'),
+		(NULL)
+	) t(path),
+	(VALUES (jsonb '{"a": 1, "b": [2, 3]}')) d(js);
+
+SELECT JSON_VALUE(jsonb '{"ab": 1}', ('$.' || 'ab'));
+
+PREPARE json_path_param(jsonpath) AS
+	SELECT JSON_QUERY(jsonb '{"a": {"b": 1}}', $1);
+EXECUTE json_path_param('$.a');
+EXECUTE json_path_param('$.a.b');
+DEALLOCATE json_path_param;
+
+SELECT JSON_VALUE(jsonb '1', 1);
+
+-- Constant folding of SQL/JSON functions
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT
+	JSON_VALUE(jsonb '{"a": 1}', '$.a' RETURNING int),
+	JSON_EXISTS(jsonb '[1]', 'strict $[1]'),
+	JSON_QUERY(jsonb '{"a": [1]}', '$.a' ERROR ON ERROR);
+
+-- Stable RETURNING type coercion is not folded
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT JSON_VALUE(jsonb '"2018-01-01"', '$' RETURNING timestamptz);
+
+-- Expressions that can meet datetime items are not folded
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT
+	JSON_QUERY(jsonb '"2017-03-10"', '$.datetime()'),
+	JSON_EXISTS(jsonb '[1]', '$' PASSING date '2018-01-01' AS d);
+
+PREPARE json_passing_param(int) AS
+	SELECT JSON_EXISTS(js, '$[*] ? (@ == $x)' PASSING $1 AS x)
+	FROM (VALUES (jsonb '[1, 2]'), (jsonb '[3]')) t(js);
+EXECUTE json_passing_param(3);
+EXECUTE json_passing_param(1);
+DEALLOCATE json_passing_param;
+
+-- PASSING arguments of PL/pgSQL simple expressions change between calls
+DO $$
+BEGIN
+	FOR i IN 1..3 LOOP
+		RAISE NOTICE '% % %', i,
+			JSON_VALUE(jsonb '{"a": 1}', '$.a + $v' PASSING i AS v RETURNING int),
+			JSON_EXISTS(jsonb '[1, 2]', '$[*] ? (@ > $v)' PASSING i AS v);
+	END LOOP;
+END
+$$;
+
+-- Invariant PASSING arguments are evaluated once per execution of the plan,
+-- and again only when the outer values they refer to change
+CREATE FUNCTION json_passing_arg(int) RETURNS int STABLE LANGUAGE plpgsql AS $$
+BEGIN
+	RAISE NOTICE 'json_passing_arg(%)', $1;
+	RETURN $1;
+END
+$$;
+
+SELECT JSON_VALUE(js, '$ + $x' PASSING json_passing_arg(10) AS x RETURNING int)
+FROM (SELECT to_jsonb(i) FROM generate_series(1, 5) i) t(js);
+
+SELECT o.i, s.v
+FROM
+	(VALUES (1), (1), (2)) o(i),
+	LATERAL (
+		SELECT JSON_VALUE(js, '$ + $x' PASSING json_passing_arg(o.i) AS x RETURNING int) v
+		FROM (VALUES (jsonb '10'), (jsonb '20')) t(js)
+		OFFSET 0
+	) s;
+
+SELECT t.n, jt.a
+FROM
+	(VALUES (1, jsonb '[1, 2, 5]'), (2, jsonb '[3, 0]')) t(n, js),
+	JSON_TABLE(js, '$[*] ? (@ < $x)' PASSING json_passing_arg(3) AS x
+		COLUMNS (a int PATH '$')) jt;
+
+DROP FUNCTION json_passing_arg(int);
+
 -- Test constraints
 
 CREATE TABLE test_json_constraints (
@@ -671,6 +848,162 @@ FROM
 	) jt
 	ON true;
 
+-- JSON_TABLE: non-constant root path
+SELECT t.path, jt.*
+FROM
+	(VALUES ('$.a[*]'), ('$.b[*]'), (NULL)) t(path),
+	JSON_TABLE(jsonb '{"a": [1, 2], "b": [3]}', t.path COLUMNS (x int PATH '$')) jt;
+
+-- JSON_TABLE over json text
+SELECT *
+FROM JSON_TABLE(
+	json '{"a": [{"b": 1, "c": [1, 2]}, {"b": "x"}, 3, [4, 5]]}',
+	'$.a[*]'
+	COLUMNS (
+		id FOR ORDINALITY,
+		item text FORMAT JSON PATH '$',
+		b text PATH '$.b',
+		NESTED PATH '$.c[*]' COLUMNS (c int PATH '$')
+	)
+) jt;
+
+SELECT *
+FROM
+	(VALUES
+		(json '{"a": [1, 2], "a": [3]}'),
+		(json '[{"a": 4}, {"a": [5, 6]}]')
+	) vals(js),
+	JSON_TABLE(vals.js, '$.a[*]' COLUMNS (a int PATH '$')) jt;
+
+SELECT * FROM JSON_TABLE(json '[1, 2, 3]', '$[*] ? (@ > 1)' COLUMNS (a int PATH '$')) jt;
+
+SELECT * FROM JSON_TABLE('[1, "a"]' FORMAT JSON, '$[*]' COLUMNS (a text PATH '$')) jt;
+
+-- only the current row item of each JSON_TABLE path is kept
+SELECT count(*), sum(a), sum(b)
+FROM
+	(SELECT jsonb_agg(jsonb_build_object('a', i, 'b', jsonb_build_array(i, -i)))
+	 FROM generate_series(1, 10000) i) t(js),
+	JSON_TABLE(t.js, '$[*]'
+		COLUMNS (a int PATH '$.a', NESTED PATH '$.b[*]' COLUMNS (b int PATH '$'))) jt;
+
+SELECT count(*), sum(a), sum(b)
+FROM
+	(SELECT jsonb_agg(jsonb_build_object('a', i, 'b', jsonb_build_array(i, -i)))
+	 FROM generate_series(1, 10000) i) t(js),
+	JSON_TABLE(t.js::json, '$[*]'
+		COLUMNS (a int PATH '$.a', NESTED PATH '$.b[*]' COLUMNS (b int PATH '$'))) jt;
+
+-- JSON_TABLE columns sharing path prefixes
+SELECT *
+FROM JSON_TABLE(
+	jsonb '[{"a": {"b": {"x": 1, "y": "2"}, "z": true}}, {"a": {"b": 3}}, {"a": [{"b": {"x": 4}}]}, 5]',
+	'$[*]'
+	COLUMNS (
+		x int PATH '$.a.b.x',
+		y text PATH '$.a.b.y',
+		b jsonb FORMAT JSON PATH '$.a.b',
+		z bool PATH '$.a.z',
+		sx int PATH 'strict $.a.b.x',
+		NESTED PATH '$.a.b' COLUMNS (nx int PATH '$.x')
+	)
+) jt;
+
+-- JSON_TABLE columns not needed by the query are not evaluated
+SELECT a
+FROM JSON_TABLE(
+	jsonb '[1, 2]', '$[*]'
+	COLUMNS (
+		a int PATH '$',
+		b int PATH 'strict $.x' ERROR ON ERROR,
+		NESTED PATH '$[*]' COLUMNS (c int PATH 'strict $.y' ERROR ON ERROR)
+	)
+) jt;
+
+SELECT count(*)
+FROM JSON_TABLE(
+	jsonb '[1, 2]', '$[*]'
+	COLUMNS (
+		a int PATH '$',
+		b int PATH 'strict $.x' ERROR ON ERROR,
+		NESTED PATH '$[*]' COLUMNS (c int PATH 'strict $.y' ERROR ON ERROR)
+	)
+) jt;
+
+SELECT a, c
+FROM JSON_TABLE(
+	jsonb '[1, 2]', '$[*]'
+	COLUMNS (
+		a int PATH '$',
+		b int PATH 'strict $.x' ERROR ON ERROR,
+		NESTED PATH '$[*]' COLUMNS (c int PATH 'strict $.y' ERROR ON ERROR)
+	)
+) jt;
+
+-- Quals on JSON_TABLE root path columns are checked on its items
+EXPLAIN (COSTS OFF)
+SELECT *
+FROM JSON_TABLE(
+	jsonb '{"items": [{"sku": "a", "qty": 5, "tags": [1]}, {"sku": "b", "qty": 20, "tags": [1, 2]}, {"sku": "c", "qty": "15"}]}',
+	'$.items[*]'
+	COLUMNS (
+		id FOR ORDINALITY,
+		sku text PATH '$.sku',
+		qty int PATH '$.qty',
+		NESTED PATH '$.tags[*]' COLUMNS (tag int PATH '$')
+	)
+) jt
+WHERE jt.qty > 10 AND jt.tag IS NOT NULL;
+
+SELECT *
+FROM JSON_TABLE(
+	jsonb '{"items": [{"sku": "a", "qty": 5, "tags": [1]}, {"sku": "b", "qty": 20, "tags": [1, 2]}, {"sku": "c", "qty": "15"}]}',
+	'$.items[*]'
+	COLUMNS (
+		id FOR ORDINALITY,
+		sku text PATH '$.sku',
+		qty int PATH '$.qty',
+		NESTED PATH '$.tags[*]' COLUMNS (tag int PATH '$')
+	)
+) jt
+WHERE jt.qty > 10;
+
+-- Items removed by the pushed down quals are counted
+EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF, TIMING OFF)
+SELECT *
+FROM JSON_TABLE(
+	jsonb '{"items": [{"sku": "a", "qty": 5, "tags": [1]}, {"sku": "b", "qty": 20, "tags": [1, 2]}, {"sku": "c", "qty": "15"}]}',
+	'$.items[*]'
+	COLUMNS (
+		id FOR ORDINALITY,
+		sku text PATH '$.sku',
+		qty int PATH '$.qty',
+		NESTED PATH '$.tags[*]' COLUMNS (tag int PATH '$')
+	)
+) jt
+WHERE jt.qty > 10 AND jt.tag IS NOT NULL;
+
+-- Columns computed by the pushed down quals are not computed again
+CREATE FUNCTION json_table_default(int) RETURNS int STABLE LANGUAGE plpgsql AS $$
+BEGIN
+	RAISE NOTICE 'default %', $1;
+	RETURN $1;
+END
+$$;
+
+SELECT *
+FROM JSON_TABLE(
+	jsonb '[{"a": 1}, {}, {"b": [1, 2]}]', '$[*]'
+	COLUMNS (
+		id FOR ORDINALITY,
+		a int PATH '$.a' DEFAULT json_table_default(0) ON EMPTY,
+		NESTED PATH '$.b[*]' COLUMNS (b int PATH '$')
+	)
+) jt
+WHERE jt.a < 1;
+
+DROP FUNCTION json_table_default(int);
+
 -- JSON_TABLE: ON EMPTY/ON ERROR behavior
 SELECT *
 FROM
@@ -1141,11 +1474,66 @@ FROM JSON_TABLE(
 		COLUMNS (y text FORMAT JSON PATH '$ ? (@ < $x)')
 	) jt;
 
+-- JSON_TABLE deparsing
+CREATE VIEW json_table_view AS
+SELECT *
+FROM JSON_TABLE(
+	jsonb '[{"a": 1, "b": [1, 2], "c": ["x"]}, {"b": [3]}]', '$[*]' AS p
+	PASSING 0 AS n
+	COLUMNS (
+		id FOR ORDINALITY,
+		a int PATH '$.a' DEFAULT 0 ON EMPTY,
+		js jsonb FORMAT JSONB PATH '$.b' WITH CONDITIONAL WRAPPER,
+		NESTED PATH '$.b[*] ? (@ > $n)' AS pb COLUMNS (b int PATH '$'),
+		NESTED PATH '$.c[*]' AS pc COLUMNS (c text PATH '$' ERROR ON ERROR)
+	)
+	PLAN (p OUTER (pb UNION pc))
+) jt;
+
+CREATE VIEW json_table_view2 AS
+SELECT *
+FROM JSON_TABLE(
+	jsonb '{"a": [1, 2], "b": ["x", "y"]}', '$' AS p
+	COLUMNS (
+		id FOR ORDINALITY,
+		NESTED PATH '$.a[*]' AS pa COLUMNS (a int PATH '$'),
+		NESTED PATH '$.b[*]' AS pb COLUMNS (b text FORMAT JSON PATH '$' OMIT QUOTES)
+	)
+	PLAN (p INNER (pa CROSS pb))
+	ERROR ON ERROR
+) jt;
+
+\sv json_table_view
+\sv json_table_view2
+
+-- Deparsed JSON_TABLE definitions can be parsed back
+DO $$
+BEGIN
+	EXECUTE 'CREATE VIEW json_table_view_copy AS ' ||
+		pg_get_viewdef('json_table_view');
+	EXECUTE 'CREATE VIEW json_table_view2_copy AS ' ||
+		pg_get_viewdef('json_table_view2');
+END
+$$;
+
+SELECT
+	pg_get_viewdef('json_table_view_copy') = pg_get_viewdef('json_table_view'),
+	pg_get_viewdef('json_table_view2_copy') = pg_get_viewdef('json_table_view2');
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT * FROM json_table_view;
+
+DROP VIEW json_table_view, json_table_view_copy,
+	json_table_view2, json_table_view2_copy;
+
 -- jsonpath operators
 
 SELECT jsonb '[{"a": 1}, {"a": 2}]' @* '$[*]';
 SELECT jsonb '[{"a": 1}, {"a": 2}]' @* '$[*] ? (@.a > 10)';
 SELECT jsonb '[{"a": 1}, {"a": 2}]' @* '[$[*].a]';
+SELECT (SELECT jsonb_agg(i) FROM generate_series(1, 3000) i) @* '[$[*] ? (@ % 3 == 0)][0, 499, last]';
+SELECT jsonb '[{"a": 1}, {"a": 2}, 3]' @* 'strict $[*].a' LIMIT 2;
+SELECT jsonb '[{"a": 1}, {"a": 2}, 3]' @* 'strict $[*].a';
 
 SELECT jsonb '[{"a": 1}, {"a": 2}]' @? '$[*].a > 1';
 SELECT jsonb '[{"a": 1}, {"a": 2}]' @? '$[*].a > 2';
@@ -1225,6 +1613,13 @@ select '$.max().floor()'::jsonpath;
 
 select '$ ? (@ starts with "abc")'::jsonpath;
 select '$ ? (@ starts with $var)'::jsonpath;
+select '$ ? (@ like_regex "pattern")'::jsonpath;
+select '$ ? (@ like_regex "pattern" flag "")'::jsonpath;
+select '$ ? (@ like_regex "pattern" flag "i")'::jsonpath;
+select '$ ? (@ like_regex "pattern" flag "is")'::jsonpath;
+select '$ ? (@ like_regex "pattern" flag "xsms")'::jsonpath;
+select '$ ? (@ like_regex "pattern" flag "a")'::jsonpath;
+select '$ ? (@ like_regex "(invalid pattern")'::jsonpath;
 
 select '$ < 1'::jsonpath;
 select '($ < 1) || $.a.b <= $x'::jsonpath;
@@ -1368,6 +1763,8 @@ select * from _jsonpath_object('[1,2,3]', '$[last]');
 select * from _jsonpath_object('[1,2,3]', '$[last - 1]');
 select * from _jsonpath_object('[1,2,3]', '$[last ? (@.type() == "number")]');
 select * from _jsonpath_object('[1,2,3]', '$[last ? (@.type() == "string")]');
+select * from _jsonpath_object('["a", {"b": 1}, 2.5, [3], "cd"]', '$[last - 3 to last - 1]');
+select * from _jsonpath_object((select jsonb_agg(i) from generate_series(1, 100) i), '$[31 to 33, last - 40]');
 
 -- extension: object subscripting
 select * from _jsonpath_object('{"a": 1}', '$["a"]');
@@ -1385,6 +1782,9 @@ select * from _jsonpath_object('[10,11,12,13,14,15]', '$.[0,1] ? (@ < $value)',
 select * from _jsonpath_object('[10,11,12,13,14,15]', '$.[0 to 2] ? (@ < $value)', '{"value" : 15}');
 select * from _jsonpath_object('[1,"1",2,"2",null]', '$.[*] ? (@ == "1")');
 select * from _jsonpath_object('[1,"1",2,"2",null]', '$.[*] ? (@ == $value)', '{"value" : "1"}');
+select * from _jsonpath_object('{"a": 1}', '$x.b[*]', '{"y": 2, "x": {"b": [3, 4]}}');
+select * from _jsonpath_object('{"a": 1}', '$z', '{"y": 2, "x": {"b": [3, 4]}}');
+select * from _jsonpath_object('{"a": 1}', '$x', '[{"x": 1}]');
 
 select * from _jsonpath_object('{"a": {"b": 1}}', 'lax $.**');
 select * from _jsonpath_object('{"a": {"b": 1}}', 'lax $.**{1}');
@@ -1405,6 +1805,8 @@ select * from _jsonpath_object('{"a": {"c": {"b": 1}}}', 'lax $.**{0,}.b ? (@ >
 select * from _jsonpath_object('{"a": {"c": {"b": 1}}}', 'lax $.**{1,}.b ? (@ > 0)');
 select * from _jsonpath_object('{"a": {"c": {"b": 1}}}', 'lax $.**{1,2}.b ? (@ > 0)');
 select * from _jsonpath_object('{"a": {"c": {"b": 1}}}', 'lax $.**{2,3}.b ? (@ > 0)');
+select * from _jsonpath_object('{"a": [{"b": 1}, {"c": {"b": 2}}, 3], "b": 4}', 'lax $.**.b');
+select * from _jsonpath_object('{"a": [{"b": 1}, {"c": {"b": 2}}, 3], "b": 4}', 'lax $.**{2}.b');
 
 select * from _jsonpath_exists('{"a": {"b": 1}}', '$.**.b ? (@ > 0)');
 select * from _jsonpath_exists('{"a": {"b": 1}}', '$.**{0}.b ? (@ > 0)');
@@ -1487,6 +1889,25 @@ select _jsonpath_object('null', 'aaa.type()');
 
 select _jsonpath_object('{"a": 2}', '($.a - 5).abs() + 10');
 select _jsonpath_object('{"a": 2.5}', '-($.a * $.a).floor() + 10');
+select _jsonpath_object('{"a": 2.0}', '$.a + 1');
+select _jsonpath_object('{"a": -7}', '$.a % 2');
+select _jsonpath_object('{"a": 9999999999999999}', '$.a + 1');
+select _jsonpath_object('{"a": 4294967296}', '$.a * $.a');
+select _jsonpath_object('{"a": 6}', '$.a / 3');
+select _jsonpath_object('[10, 2.0, 2, 30]', '$[*] ? (@ == 2)');
+select _jsonpath_object('[10, 12345678901234567, 2]', '$[*] ? (@ > 12345678901234566)');
+select _jsonpath_object('[1, 60, 3600]', '$[*] ? (@ == 60 * 60)');
+select _jsonpath_object('{"a": 1}', '$.a / (2 - 2)');
+select _jsonpath_object('[{"a": 1}]', '$[*] ? (@.a / 0 > 1 && exists(@.b))');
+select _jsonpath_object('[{"a": {"b": 1}}, {"a": {"b": 3}}, {"a": {"b": [2, 7]}}, {"a": 3}]', 'lax $[*] ? (@.a.b > 1 && @.a.b < 5)');
+select _jsonpath_object('[{"a": {"b": 1}}, {"a": {"b": 3}}, {"a": {"b": [2, 7]}}, {"a": 3}]', 'strict $[*] ? (@.a.b > 1 && @.a.b < 5)');
+select _jsonpath_object('[1, 150, "150", null, [200, 50], {"a": 300}, 101.5]', '$[*] ? (@ > 100)');
+select _jsonpath_object('[1, 150, "150", null, [200, 50], {"a": 300}, 101.5]', '$ ? (100 < @)');
+select _jsonpath_object('[1, 150, "150", null, [200, 50], {"a": 300}, 101.5]', 'strict $[*] ? (@ > 100)');
+select _jsonpath_object('[1, 150, "150", null, [200, 50], {"a": 300}, 101.5]', '[$[*] ? (@ > 100)]');
+select _jsonpath_object('[1, 150, "150", null, [200, 50], {"a": 300}, 101.5]', '[$ ? (@ > 100)]');
+select _jsonpath_object('[1, "a", null, "b", ["a"]]', '$[*] ? (@ != $x)', '{"x": "a"}');
+select _jsonpath_object('[1, "a", null, "b", ["a"]]', '$[*] ? (@ == $x)', '{"x": [1, "b"]}');
 select _jsonpath_object('[1, 2, 3]', '($[*] > 2) ? (@ == true)');
 select _jsonpath_object('[1, 2, 3]', '($[*] > 3).type()');
 select _jsonpath_object('[1, 2, 3]', '($[*].a > 3).type()');
@@ -1516,6 +1937,8 @@ select _jsonpath_object('{}', '$.double()');
 select _jsonpath_object('1.23', '$.double()');
 select _jsonpath_object('"1.23"', '$.double()');
 select _jsonpath_object('"1.23aaa"', '$.double()');
+select _jsonpath_object('"1e1000"', '$.double()');
+select _jsonpath_object('"inf"', '$.double()');
 
 select _jsonpath_object('["", "a", "abc", "abcabc"]', '$[*] ? (@ starts with "abc")');
 select _jsonpath_object('["", "a", "abc", "abcabc"]', 'strict $ ? (@[*] starts with "abc")');
@@ -1526,6 +1949,11 @@ select _jsonpath_object('[[null, 1, "abc", "abcabc"]]', 'lax $ ? (@[*] starts wi
 select _jsonpath_object('[[null, 1, "abd", "abdabc"]]', 'lax $ ? ((@[*] starts with "abc") is unknown)');
 select _jsonpath_object('[null, 1, "abd", "abdabc"]', 'lax $[*] ? ((@ starts with "abc") is unknown)');
 
+select _jsonpath_object('[null, 1, "abc", "abd", "aBdC", "abdacb", "babc"]', 'lax $[*] ? (@ like_regex "^ab.*c")');
+select _jsonpath_object('[null, 1, "abc", "abd", "aBdC", "abdacb", "babc"]', 'lax $[*] ? (@ like_regex "^ab.*c" flag "i")');
+select _jsonpath_object('[null, 1, "abc", "abd", "aBdC", "abdacb", "babc"]', 'strict $ ? (@[*] like_regex "^ab.*c")');
+select _jsonpath_object('[null, 1, "abc", "abd", "aBdC", "abdacb", "babc"]', 'strict $ ? ((@[*] like_regex "^ab.*c") is unknown)');
+
 select _jsonpath_object('null', '$.datetime()');
 select _jsonpath_object('true', '$.datetime()');
 select _jsonpath_object('[]', '$.datetime()');
@@ -1537,6 +1965,7 @@ select _jsonpath_object('""', '$.datetime()');
 select _jsonpath_object('0', '$.datetime()');
 select _jsonpath_object('0', '$.datetime().type()');
 select _jsonpath_object('1490216035.5', '$.datetime()');
+select _jsonpath_object('1e1000', '$.datetime()');
 
 select _jsonpath_object('"10-03-2017"',       '$.datetime("dd-mm-yyyy")');
 select _jsonpath_object('"10-03-2017"',       '$.datetime("dd-mm-yyyy").type()');
@@ -1594,6 +2023,9 @@ select _jsonpath_object('"12:34:56 +3"', '$.datetime().type()');
 select _jsonpath_object('"12:34:56 +3"', '$.datetime()');
 select _jsonpath_object('"12:34:56 +3:10"', '$.datetime().type()');
 select _jsonpath_object('"12:34:56 +3:10"', '$.datetime()');
+select _jsonpath_object('"10:11:12"', '$.datetime().type()');
+select _jsonpath_object('"2017-3-10"', '$.datetime()');
+select _jsonpath_object('"2017-02-29"', '$.datetime()');
 
 -- date comparison
 select _jsonpath_object(
@@ -1683,6 +2115,8 @@ select _jsonpath_object('[]', '$.fold($1 + $2, 100)');
 select _jsonpath_object('[1]', '$.reduce($1 + $2)');
 select _jsonpath_object('[1, 2, 3]', '$.foldl([$1, $2], [])');
 select _jsonpath_object('[1, 2, 3]', '$.foldr([$2, $1], [])');
+select _jsonpath_object('["a", {"b": 1}, 2.5, [3], "cd"]', '$.foldr([$2, $1], [])');
+select _jsonpath_object((select jsonb_agg(i) from generate_series(1, 100) i), '$.foldr($1 - $2, 0)');
 select _jsonpath_object('[[1, 2], [3, 4, 5], [], [6, 7]]', '$.fold($1 + $2.fold($1 + $2, 100), 1000)');
 
 -- extension: min/max item methods
@@ -1694,6 +2128,11 @@ select _jsonpath_object('[1, 2, 3]', '$.min()');
 select _jsonpath_object('[1, 2, 3]', '$.max()');
 select _jsonpath_object('[2, 3, 5, 1, 4]', '$.min()');
 select _jsonpath_object('[2, 3, 5, 1, 4]', '$.max()');
+select _jsonpath_object('["b", "a", "c"]', '$.min()');
+select _jsonpath_object('[2, "b", null, true, 1.5, "a"]', '$.min()');
+select _jsonpath_object('[2, "b", null, true, 1.5, "a"]', '$.max()');
+select _jsonpath_object('[3, [1], {"a": 1}, "x"]', '$.min()');
+select _jsonpath_object('[3, [1], {"a": 1}, "x"]', '$.max()');
 
 -- extension: path sequences
 select _jsonpath_object('[1,2,3,4,5]', '10, 20, $[*], 30');